@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <sys/mman.h>           // mmap, munmap
+
+namespace lvar {
+
+  // non-owning view over a chunk of memory, usually memory that comes from an arena.
+  // it doesn't free anything when it dies, whoever owns the arena does that
+  template<typename T>
+  class slice final {
+  public:
+    slice() noexcept
+      : ptr{ nullptr },
+        count{ 0 }
+    {
+    }
+    slice(T* p, std::size_t const n) noexcept
+      : ptr{ p },
+        count{ n }
+    {
+    }
+  public:
+    T& operator[](std::size_t const i) noexcept
+    {
+      assert(i < count);
+      return ptr[i];
+    }
+    T const& operator[](std::size_t const i) const noexcept
+    {
+      assert(i < count);
+      return ptr[i];
+    }
+    auto data() const noexcept { return ptr; }
+    auto size() const noexcept { return count; }
+    auto bytes() const noexcept { return count * sizeof(T); }
+    auto empty() const noexcept { return count == 0; }
+    auto begin() const noexcept { return ptr; }
+    auto end() const noexcept { return ptr + count; }
+  private:
+    T* ptr;
+    std::size_t count;
+  };
+
+  // linear allocator. it reserves a big range of virtual memory up front and then just bumps
+  // an offset every time you push something, so allocating is a couple of adds. the kernel only
+  // backs the pages you actually touch, so reserving a lot more than you need is cheap.
+  //
+  // you can't free individual allocations, only go back to a previous mark or reset everything,
+  // both O(1). this is exactly what you want for stuff with the same lifetime (all arrays of a
+  // mesh, all meshes of a level, temporary memory of a function, etc)
+  class arena final {
+  public:
+    explicit arena(std::size_t const capacity) noexcept
+      : base{ nullptr },
+        cap{ capacity },
+        used{ 0 },
+        err{ false }
+    {
+      void* const p{ mmap(nullptr, cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0) };
+      if(p == MAP_FAILED) {
+        err = true;
+        cap = 0;
+        return;
+      }
+      base = static_cast<unsigned char*>(p);
+    }
+    ~arena() noexcept
+    {
+      if(base) {
+        munmap(base, cap);
+      }
+    }
+    arena(arena const&) = delete;
+    arena& operator=(arena const&) = delete;
+  public:
+    // returns nullptr if there's no space left, you decide what to do with that
+    [[nodiscard]]
+    void* push(std::size_t const sz, std::size_t const align = 16) noexcept
+    {
+      assert((align & (align - 1)) == 0 && "alignment must be a power of 2");
+      std::uintptr_t const curr{ reinterpret_cast<std::uintptr_t>(base) + used };
+      std::uintptr_t const aligned{ (curr + (align - 1)) & ~(static_cast<std::uintptr_t>(align) - 1) };
+      std::size_t const offset{ static_cast<std::size_t>(aligned - reinterpret_cast<std::uintptr_t>(base)) };
+      if(!base || offset + sz > cap) {
+        return nullptr;
+      }
+      used = offset + sz;
+      return reinterpret_cast<void*>(aligned);
+    }
+    // @NOTE: no constructors are called, only use it with trivial types
+    template<typename T>
+    [[nodiscard]]
+    slice<T> push_array(std::size_t const n) noexcept
+    {
+      T* const p{ static_cast<T*>(push(sizeof(T) * n, alignof(T) > 16 ? alignof(T) : 16)) };
+      if(!p) {
+        return {};
+      }
+      return { p, n };
+    }
+    // memory pushed after the mark is gone once you pop to it
+    auto mark() const noexcept { return used; }
+    void pop_to(std::size_t const m) noexcept
+    {
+      assert(m <= used);
+      used = m;
+    }
+    void reset() noexcept { used = 0; }
+    auto capacity() const noexcept { return cap; }
+    auto size() const noexcept { return used; }
+    auto error() const noexcept { return err; }
+  private:
+    unsigned char* base;
+    std::size_t cap;
+    std::size_t used;
+    bool err;
+  };
+
+  // pops the arena back to where it was when this goes out of scope, handy for the temporary
+  // memory of a function, no matter how many returns it has
+  class arena_scope final {
+  public:
+    explicit arena_scope(arena& a) noexcept
+      : mem{ a },
+        mark{ a.mark() }
+    {
+    }
+    ~arena_scope() noexcept
+    {
+      mem.pop_to(mark);
+    }
+    arena_scope(arena_scope const&) = delete;
+    arena_scope& operator=(arena_scope const&) = delete;
+  private:
+    arena& mem;
+    std::size_t const mark;
+  };
+
+};
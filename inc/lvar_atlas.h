@@ -0,0 +1,68 @@
+#pragma once
+
+#include "lvar_texture.h"
+
+namespace lvar {
+  namespace tex {
+
+    // rectangles in a bigger one, bottom left first. the skyline is the top edge of what's been placed,
+    // left to right, and every new rectangle goes where its top ends up lowest. no rectangle is ever
+    // placed under an overhang, that space is lost, but it's fast and textures are mostly similar sizes
+    class skyline_packer final {
+    public:
+      static unsigned int constexpr max_segments{ 512 };
+    public:
+      skyline_packer(unsigned int const width, unsigned int const height) noexcept;
+      // false if it doesn't fit anywhere (nothing changes then)
+      bool insert(unsigned int const w, unsigned int const h, unsigned int& x, unsigned int& y) noexcept;
+      // of the area, the part that's been given out
+      float occupancy() const noexcept
+      {
+        return static_cast<float>(static_cast<double>(used) / (static_cast<double>(width) * height));
+      }
+    private:
+      class segment final {
+      public:
+        unsigned int x;
+        unsigned int y;
+        unsigned int width;
+      };
+    private:
+      // the y a w wide rectangle would sit at from segment i, false if it goes past the right or the top
+      bool fits(unsigned int const i, unsigned int const w, unsigned int const h, unsigned int& y) const noexcept;
+    private:
+      segment segments[max_segments];
+      unsigned int num_segments;
+      unsigned int width;
+      unsigned int height;
+      std::size_t used;
+    };
+
+    // where the [0, 1] uvs of a texture went in an atlas: u' = u + uv * width, v' = v + uv * height
+    class uv_rect final {
+    public:
+      float u;
+      float v;
+      float width;
+      float height;
+    };
+
+    // what texture_loader and the resource manager make atlases with: the biggest side every gpu takes,
+    // and a gutter that's still there 3 mips down
+    unsigned int constexpr max_atlas_size{ 8192 };
+    unsigned int constexpr atlas_padding{ 8 };
+
+    // the images in one, as small as it can be with power of two sides up to max_size. every image has
+    // padding pixels around it that repeat its edges, so bilinear filtering (and the first mips) never
+    // take anything from the neighbours. the atlas has the most channels of them: grey is copied to rgb,
+    // the alpha that's missing is 255 and the rest 0. false if they don't fit in max_size x max_size
+    bool build_atlas(image const* images, unsigned int const count, unsigned int const max_size, unsigned int const padding,
+                     image& o, uv_rect* rects, arena& mem) noexcept;
+
+    // the chains of the layers of a texture array in one chain: level l is all the layers of that level
+    // one after the other (height is the height of a layer * count), which is what glTexImage3D wants. the
+    // layers have to be the same size with the same channels
+    bool stack_layers(mip_chain const* layers, unsigned int const count, mip_chain& o, arena& mem) noexcept;
+
+  };
+};
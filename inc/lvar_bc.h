@@ -0,0 +1,100 @@
+#pragma once
+
+#include "lvar_texture.h"
+
+namespace lvar {
+  namespace tex {
+
+    // block compression, what the gpu samples without decompressing it anywhere. every 4x4 block is a
+    // fixed number of bytes:
+    //   bc1 (dxt1)  8 bytes, rgb: two 565 endpoints and 2 bits per pixel between them. 6:1 against rgb8
+    //   bc3 (dxt5) 16 bytes, rgba: a bc4 block for alpha and a bc1 one for the colour. 4:1 against rgba8
+    //   bc5 (rgtc2) 16 bytes, rg: two bc4 blocks, normal maps (z is rebuilt in the shader). 2:1 against rg8
+    enum class bc_format : unsigned int {
+      bc1 = 1,
+      bc3 = 3,
+      bc5 = 5
+    };
+
+    // fast: endpoints from the bounding box of the block and the indices computed from the projection on
+    // it. high: endpoints on the principal axis of the colours, indices from the nearest colour of the
+    // palette and a least squares refit of the endpoints. high is a few times slower and has less error
+    enum class bc_quality : unsigned int {
+      fast,
+      high
+    };
+
+    inline std::size_t bc_block_bytes(bc_format const f) noexcept
+    {
+      return f == bc_format::bc1 ? 8 : 16;
+    }
+
+    inline std::size_t bc_bytes(bc_format const f, unsigned int const width, unsigned int const height) noexcept
+    {
+      return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(f);
+    }
+
+    // a block is 16 rgba pixels, row by row. bc1 ignores alpha, bc5 only looks at r and g
+    void encode_bc1_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept;
+    void encode_bc3_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept;
+    void encode_bc5_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept;
+    // the one channel of 16 values, every stride bytes (4 for a channel of rgba)
+    void encode_bc4_block(unsigned char const* values, std::size_t const stride, unsigned char* out, bc_quality const q) noexcept;
+    // back to 16 rgba pixels, bc5 has b = 0 and a = 255
+    void decode_block(bc_format const f, unsigned char const* in, unsigned char* rgba) noexcept;
+
+    // the whole image, blocks row by row into out (bc_bytes of it), on all the cores. images with 1 to 4
+    // channels, the pixels past the edge of images that aren't multiples of 4 repeat the edge
+    void encode_image(image const& img, bc_format const f, bc_quality const q, unsigned char* out) noexcept;
+    // rgba, width * height * 4
+    void decode_image(unsigned char const* in, bc_format const f, unsigned int const width, unsigned int const height,
+                      unsigned char* rgba) noexcept;
+
+    // a compressed texture and all its mips, the biggest one first, one after the other in data
+    class compressed_texture final {
+    public:
+      static unsigned int constexpr max_levels{ mip_chain::max_levels };
+    public:
+      std::size_t level_offset(unsigned int const level) const noexcept;
+      unsigned int level_width(unsigned int const level) const noexcept { return width >> level ? width >> level : 1; }
+      unsigned int level_height(unsigned int const level) const noexcept { return height >> level ? height >> level : 1; }
+      std::size_t level_bytes(unsigned int const level) const noexcept { return bc_bytes(format, level_width(level), level_height(level)); }
+    public:
+      bc_format format;
+      unsigned int width;
+      unsigned int height;
+      unsigned int num_levels;
+      slice<unsigned char> data;
+    };
+
+    // every level of the chain encoded
+    bool compress(mip_chain const& mips, bc_format const f, bc_quality const q, compressed_texture& o, arena& mem) noexcept;
+
+    // the cache of compressed textures (.lvc), so a texture is encoded once and not every time the game
+    // starts: a header that says what it was made from (the size and mtime of the source and the
+    // quality) and the levels. load_compressed is false if it doesn't exist or it's out of date. version 2
+    // has the mips of generate_mips, version 1 files had box filtered ones and they're made again
+    class compressed_header final {
+    public:
+      static unsigned int constexpr lvc_magic{ 0x3143564c }; // "LVC1"
+      static unsigned int constexpr lvc_version{ 2 };
+    public:
+      unsigned int magic;
+      unsigned int version;
+      unsigned int format;
+      unsigned int quality;
+      unsigned int width;
+      unsigned int height;
+      unsigned int num_levels;
+      unsigned int padding;
+      unsigned long long source_size;
+      long long source_mtime;
+    };
+
+    bool save_compressed(char const* filepath, compressed_texture const& t, bc_quality const q,
+                         unsigned long long const source_size, long long const source_mtime) noexcept;
+    bool load_compressed(char const* filepath, bc_quality const q, unsigned long long const source_size,
+                         long long const source_mtime, compressed_texture& o, arena& mem) noexcept;
+
+  };
+};
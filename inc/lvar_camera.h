@@ -13,6 +13,7 @@ namespace lvar {
   public:
     void update(float const mouse_x, float const mouse_y, float const dt);
     auto& get_view() const noexcept { return view; } // don't fucking modify it
+    auto& get_pos() const noexcept { return pos; }
   private:
     void handle_input_kb();
   private:
@@ -1,20 +1,35 @@
 #pragma once
 
-#include <cstring>
+#include <cstddef>
 
 namespace lvar {
 
-  // used for converting strings to ids, wikipedia
-  inline int fnv1a(char const* str)
+  // used for converting strings to ids, wikipedia. constexpr so ids of literals can be computed at
+  // compile time ("model"_id), and they're the same as the ones computed at run time from the strings
+  constexpr int fnv1a(char const* str, std::size_t const len)
   {
-    std::size_t const len{ std::strlen(str) };
-    int constexpr prime{ 0x01000193 }; // FNV-1a 32-bit prime
+    unsigned int constexpr prime{ 0x01000193 }; // FNV-1a 32-bit prime
     unsigned int hash{ 0x811c9dc5 }; // FNV-1a 32-bit offset basis
     for(std::size_t i{ 0 }; i < len; ++i) {
       hash ^= static_cast<unsigned int>(str[i]);
       hash *= prime;
     }
-    return hash;
+    return static_cast<int>(hash);
+  }
+
+  constexpr int fnv1a(char const* str)
+  {
+    std::size_t len{ 0 };
+    while(str[len] != '\0') {
+      ++len;
+    }
+    return fnv1a(str, len);
+  }
+
+  // "model"_id
+  consteval int operator""_id(char const* str, std::size_t const len)
+  {
+    return fnv1a(str, len);
   }
 
 };
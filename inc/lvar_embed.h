@@ -0,0 +1,70 @@
+#pragma once
+
+#include "lvar_common.h"
+
+#include <cstddef>
+
+namespace lvar {
+  namespace embed {
+
+    // a file compiled into the program by tools/embed.cpp. data has a '\0' after the last byte, so
+    // shaders can be passed around as c strings
+    class asset final {
+    public:
+      char const* path;                 // without the ./
+      int id;                           // fnv1a of the path, same as pack::asset_id
+      unsigned char const* data;
+      std::size_t size;                 // without the '\0'
+    };
+
+  };
+};
+
+// release builds are built with -DLVAR_EMBED_ASSETS and the header make embed generates, everything in it
+// is read from memory. debug builds have nothing in the table, they read the disk and reload what changes
+#ifdef LVAR_EMBED_ASSETS
+#include "lvar_embedded.h"
+#else
+namespace lvar {
+  namespace embed {
+    inline constexpr asset const* assets{ nullptr };
+    inline constexpr std::size_t num_assets{ 0 };
+  };
+};
+#endif
+
+namespace lvar {
+  namespace embed {
+
+    // the table is sorted by id
+    constexpr asset const* find(int const id) noexcept
+    {
+      std::size_t lo{ 0 };
+      std::size_t hi{ num_assets };
+      while(lo < hi) {
+        std::size_t const mid{ lo + (hi - lo) / 2 };
+        if(assets[mid].id < id) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      return lo < num_assets && assets[lo].id == id ? assets + lo : nullptr;
+    }
+
+    // "./res/shaders/light_cube.vert" and "res/shaders/light_cube.vert" are the same file
+    constexpr asset const* find(char const* path) noexcept
+    {
+      if(path[0] == '.' && path[1] == '/') {
+        path += 2;
+      }
+      return find(fnv1a(path));
+    }
+
+    constexpr bool enabled() noexcept
+    {
+      return num_assets > 0;
+    }
+
+  };
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "lvar_obj.h"
+#include "lvar_math.h"
+
+#include <GL/gl.h>              // only for the type enums, nothing is called from here
+
+namespace lvar {
+  namespace obj {
+
+    // where every attribute goes, the shaders have to use the same ones
+    unsigned int constexpr attribute_position{ 0 };
+    unsigned int constexpr attribute_normal{ 1 };
+    unsigned int constexpr attribute_uv{ 2 };
+    unsigned int constexpr attribute_tangent{ 3 };
+    unsigned int constexpr max_attributes{ 4 };
+
+    // exactly what glVertexAttribPointer wants for one attribute
+    class vertex_attribute final {
+    public:
+      unsigned int location;
+      int components;
+      unsigned int type;        // GL_FLOAT, GL_UNSIGNED_SHORT, GL_SHORT, GL_HALF_FLOAT, GL_BYTE
+      bool normalised;
+      unsigned int offset;
+    };
+
+    // turn off whatever the shader can't decode (or you don't want to lose precision on)
+    class encode_options final {
+    public:
+      bool quantise_positions{ true }; // 3 x unorm16 in the aabb of the mesh, 8 bytes with the padding
+      bool pack_normals{ true };       // octahedral 2 x snorm16, tangents as 4 x snorm8
+      bool half_uvs{ true };           // 2 x half float
+      bool small_indices{ true };      // unsigned short when there are <= 65536 vertices
+    };
+
+    // the mesh as it goes to the gpu: one interleaved vbo and an ebo. quantised positions come out of
+    // the vertex fetch as [0, 1], the model matrix has to scale them back: mul(dequantise(), model).
+    // packed normals have to be decoded in the shader:
+    //
+    //   vec3 oct_decode(vec2 e) {
+    //     vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    //     float t = max(-n.z, 0.0);
+    //     n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    //     return normalize(n);
+    //   }
+    class encoded_mesh final {
+    public:
+      m4 dequantise() const noexcept
+      {
+        return {
+          aabb_extent[0], 0.0f, 0.0f, 0.0f,
+          0.0f, aabb_extent[1], 0.0f, 0.0f,
+          0.0f, 0.0f, aabb_extent[2], 0.0f,
+          aabb_min[0], aabb_min[1], aabb_min[2], 1.0f,
+        };
+      }
+      auto index_size() const noexcept { return index_type == GL_UNSIGNED_SHORT ? 2u : 4u; }
+    public:
+      slice<unsigned char> vertices; // stride bytes per vertex
+      slice<unsigned char> indices;  // num_indices of index_type, then the other lods if there are any
+      slice<lod> lods;               // the mesh's, ranges of indices (not bytes), empty if it has none
+      vertex_attribute attributes[max_attributes];
+      unsigned int num_attributes;
+      unsigned int stride;
+      unsigned int num_vertices;
+      unsigned int num_indices;      // level 0
+      unsigned int index_type;       // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for glDrawElements
+      float aabb_min[3];             // identity when positions aren't quantised
+      float aabb_extent[3];
+    };
+
+    // with a lod chain the ebo gets all the levels, drawing num_indices is still level 0 and lods (which
+    // points into the mesh) says where the others are
+    bool encode(mesh const& m, encoded_mesh& out, arena& mem, encode_options const& options = {}) noexcept;
+
+    // the conversions encode uses, for tools and tests
+    unsigned short float_to_half(float const f) noexcept;
+    float half_to_float(unsigned short const h) noexcept;
+    void oct_encode(float const x, float const y, float const z, short out[2]) noexcept;
+    v3 oct_decode(short const in[2]) noexcept;
+
+  };
+};
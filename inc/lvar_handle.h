@@ -0,0 +1,116 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+namespace lvar {
+
+  // 32 bits that say which resource of a slot_map: an index into its slots and the generation the slot
+  // had when the resource was put there. removing bumps the generation, so an old handle to a slot that
+  // is used again by something else is caught instead of silently pointing at the new thing. 0 is never a
+  // valid handle, so a default constructed one means "nothing".
+  template<typename T>
+  class handle final {
+  public:
+    static unsigned int constexpr index_bits{ 20 };
+    static unsigned int constexpr generation_bits{ 32 - index_bits };
+    static unsigned int constexpr index_mask{ (1u << index_bits) - 1 };
+    static unsigned int constexpr generation_mask{ (1u << generation_bits) - 1 };
+  public:
+    static handle make(unsigned int const index, unsigned int const generation) noexcept
+    {
+      return handle{ (generation << index_bits) | index };
+    }
+    auto index() const noexcept { return bits & index_mask; }
+    auto generation() const noexcept { return bits >> index_bits; }
+    auto valid() const noexcept { return bits != 0; }
+    bool operator==(handle const& o) const noexcept { return bits == o.bits; }
+  public:
+    unsigned int bits{ 0 };
+  };
+
+  // resources of one type one after the other in memory, no allocation per resource and no hashing to
+  // find one: a handle is the index of a slot, the slot has the position of the resource in items.
+  // removing moves the last item into the hole, so items stay dense and iterating them is a loop over an
+  // array, but pointers to items are only good until the next insert or remove, keep handles instead.
+  template<typename T>
+  class slot_map final {
+  public:
+    static unsigned int constexpr max_items{ 1u << handle<T>::index_bits };
+  public:
+    // an invalid handle if there are already max_items
+    handle<T> insert(T item) noexcept
+    {
+      unsigned int index;
+      if(free_head != no_slot) {
+        index = free_head;
+        free_head = slots[index].item;
+      } else {
+        if(slots.size() == max_items) {
+          return {};
+        }
+        index = static_cast<unsigned int>(slots.size());
+        slots.push_back(slot{ 0, 1 });
+      }
+      slots[index].item = static_cast<unsigned int>(items.size());
+      items.push_back(std::move(item));
+      owners.push_back(index);
+      return handle<T>::make(index, slots[index].generation);
+    }
+    // nullptr if h was removed (or never was)
+    T* get(handle<T> const h) noexcept
+    {
+      unsigned int const i{ h.index() };
+      if(i >= slots.size() || slots[i].generation != h.generation() || !h.valid()) {
+        return nullptr;
+      }
+      return &items[slots[i].item];
+    }
+    T const* get(handle<T> const h) const noexcept { return const_cast<slot_map*>(this)->get(h); }
+    bool remove(handle<T> const h) noexcept
+    {
+      if(!get(h)) {
+        return false;
+      }
+      unsigned int const i{ h.index() };
+      unsigned int const hole{ slots[i].item };
+      unsigned int const last{ static_cast<unsigned int>(items.size()) - 1 };
+      if(hole != last) {
+        items[hole] = std::move(items[last]);
+        owners[hole] = owners[last];
+        slots[owners[hole]].item = hole;
+      }
+      items.pop_back();
+      owners.pop_back();
+      // 0 is skipped so that the handle with all bits 0 stays invalid
+      unsigned int const next{ (slots[i].generation + 1) & handle<T>::generation_mask };
+      slots[i].generation = next == 0 ? 1 : next;
+      slots[i].item = free_head;
+      free_head = i;
+      return true;
+    }
+    // the handle of items[i], for when you're iterating
+    handle<T> handle_of(std::size_t const i) const noexcept
+    {
+      return handle<T>::make(owners[i], slots[owners[i]].generation);
+    }
+    auto size() const noexcept { return items.size(); }
+    auto begin() noexcept { return items.begin(); }
+    auto end() noexcept { return items.end(); }
+    auto begin() const noexcept { return items.begin(); }
+    auto end() const noexcept { return items.end(); }
+  private:
+    static unsigned int constexpr no_slot{ ~0u };
+    class slot final {
+    public:
+      unsigned int item;        // in items, or the next free slot if this one is free
+      unsigned int generation;
+    };
+  private:
+    std::vector<T> items;
+    std::vector<unsigned int> owners; // the slot of every item, to fix it when the item moves
+    std::vector<slot> slots;
+    unsigned int free_head{ no_slot };
+  };
+
+};
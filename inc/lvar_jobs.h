@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <semaphore>
+#include <thread>
+
+namespace lvar {
+  namespace jobs {
+
+    inline unsigned int num_workers() noexcept
+    {
+      unsigned int const n{ std::thread::hardware_concurrency() };
+      return n ? n : 1;
+    }
+
+    // splits [0, count) in one contiguous range per core and calls fx(begin, end) for every range, the
+    // calling thread does the first one. every range is at least min_chunk long, small stuff isn't worth
+    // waking up threads for. fx must only write to memory that belongs to its range.
+    template<typename F>
+    void parallel_for(std::size_t const count, std::size_t const min_chunk, F const& fx)
+    {
+      if(count == 0) {
+        return;
+      }
+      std::size_t const max_ranges{ std::max<std::size_t>(1, count / std::max<std::size_t>(1, min_chunk)) };
+      std::size_t constexpr max_threads{ 64 };
+      std::size_t const ranges{ std::min<std::size_t>({ num_workers(), max_ranges, max_threads + 1 }) };
+      if(ranges == 1) {
+        fx(std::size_t{ 0 }, count);
+        return;
+      }
+      std::size_t const chunk{ (count + ranges - 1) / ranges };
+      std::thread workers[max_threads];
+      std::size_t const num_threads{ ranges - 1 };
+      for(std::size_t i{ 0 }; i < num_threads; ++i) {
+        std::size_t const begin{ (i + 1) * chunk };
+        std::size_t const end{ std::min(count, begin + chunk) };
+        if(begin < end) {
+          workers[i] = std::thread([&fx, begin, end]() { fx(begin, end); });
+        }
+      }
+      fx(std::size_t{ 0 }, std::min(count, chunk));
+      for(std::size_t i{ 0 }; i < num_threads; ++i) {
+        if(workers[i].joinable()) {
+          workers[i].join();
+        }
+      }
+    }
+
+    // bounded multi producer multi consumer queue without locks (Dmitry Vyukov's). every cell has a
+    // sequence number that says whose turn it is, so producers and consumers only fight over the
+    // head/tail counters with a CAS and never wait for each other. N has to be a power of 2.
+    template<typename T, std::size_t N>
+    class mpmc_queue final {
+      static_assert(N >= 2 && (N & (N - 1)) == 0, "the size has to be a power of 2");
+    public:
+      mpmc_queue() noexcept
+        : head{ 0 },
+          tail{ 0 }
+      {
+        for(std::size_t i{ 0 }; i < N; ++i) {
+          cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+      }
+      mpmc_queue(mpmc_queue const&) = delete;
+      mpmc_queue& operator=(mpmc_queue const&) = delete;
+      // false if it's full
+      bool push(T const& value) noexcept
+      {
+        std::size_t pos{ tail.load(std::memory_order_relaxed) };
+        for(;;) {
+          cell& c{ cells[pos & (N - 1)] };
+          std::size_t const seq{ c.sequence.load(std::memory_order_acquire) };
+          auto const diff{ static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos) };
+          if(diff == 0) {
+            if(tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              c.value = value;
+              c.sequence.store(pos + 1, std::memory_order_release);
+              return true;
+            }
+          } else if(diff < 0) {
+            return false;
+          } else {
+            pos = tail.load(std::memory_order_relaxed);
+          }
+        }
+      }
+      // false if it's empty
+      bool pop(T& value) noexcept
+      {
+        std::size_t pos{ head.load(std::memory_order_relaxed) };
+        for(;;) {
+          cell& c{ cells[pos & (N - 1)] };
+          std::size_t const seq{ c.sequence.load(std::memory_order_acquire) };
+          auto const diff{ static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) };
+          if(diff == 0) {
+            if(head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              value = c.value;
+              c.sequence.store(pos + N, std::memory_order_release);
+              return true;
+            }
+          } else if(diff < 0) {
+            return false;
+          } else {
+            pos = head.load(std::memory_order_relaxed);
+          }
+        }
+      }
+    private:
+      class cell final {
+      public:
+        std::atomic<std::size_t> sequence;
+        T value;
+      };
+      // @NOTE: head and tail on their own cache lines, otherwise producers and consumers keep stealing
+      // the line from each other even when they don't touch the same cells
+      static std::size_t constexpr line{ 64 };
+      alignas(line) cell cells[N];
+      alignas(line) std::atomic<std::size_t> head;
+      alignas(line) std::atomic<std::size_t> tail;
+    };
+
+    // something for a worker to do. a function pointer and its data, no allocations
+    class task final {
+    public:
+      void (*fx)(void*);
+      void* data;
+    };
+
+    // threads that live as long as the pool and run whatever is submitted, in no particular order. submit
+    // can be called from any number of threads, just not while the pool is destroyed. the destructor runs
+    // everything that was already submitted and then joins them
+    class pool final {
+    public:
+      explicit pool(unsigned int const n = num_workers()) noexcept
+        : ready{ 0 },
+          quit{ false },
+          num_threads{ std::clamp(n, 1u, max_threads) }
+      {
+        for(unsigned int i{ 0 }; i < num_threads; ++i) {
+          threads[i] = std::thread([this]() { work(); });
+        }
+      }
+      ~pool()
+      {
+        quit.store(true, std::memory_order_release);
+        ready.release(num_threads);
+        for(unsigned int i{ 0 }; i < num_threads; ++i) {
+          threads[i].join();
+        }
+      }
+      pool(pool const&) = delete;
+      pool& operator=(pool const&) = delete;
+      // false if there are too many tasks waiting already
+      bool submit(void (*fx)(void*), void* data) noexcept
+      {
+        if(!tasks.push({ fx, data })) {
+          return false;
+        }
+        ready.release();
+        return true;
+      }
+      auto size() const noexcept { return num_threads; }
+    private:
+      void work() noexcept
+      {
+        for(;;) {
+          ready.acquire();
+          // every release is either a task or one of the destructor's, so each thread gets exactly one of
+          // those. a push claims its cell before it writes it and releases after, so with more than one
+          // thread submitting the count can be here before the task it's for. going back to acquire would
+          // lose it and leave the task with nothing to wake a worker up, the task is there in a moment
+          task t;
+          while(!tasks.pop(t)) {
+            if(quit.load(std::memory_order_acquire)) {
+              return;
+            }
+            std::this_thread::yield();
+          }
+          t.fx(t.data);
+        }
+      }
+    private:
+      static unsigned int constexpr max_threads{ 64 };
+      static std::size_t constexpr max_tasks{ 1024 };
+      mpmc_queue<task, max_tasks> tasks;
+      std::counting_semaphore<max_tasks + max_threads> ready;
+      std::atomic<bool> quit;
+      unsigned int const num_threads;
+      std::thread threads[max_threads];
+    };
+
+  };
+};
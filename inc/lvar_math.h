@@ -130,7 +130,7 @@ namespace lvar {
   // this matrix is used to transform from view to clip space. Clip coordinates are between [-1.0, 1.0] range.
   // Everything outside this range will get clipped. FOV -> vertical fov
   [[nodiscard]]
-  m4 perspective(float const fov, float const ratio, float const near, float const far)
+  inline m4 perspective(float const fov, float const ratio, float const near, float const far)
   {
     // no need to do simd here bc this function will be called only once or not too many times at least
     assert(fov > 0.0f);
@@ -138,7 +138,7 @@ namespace lvar {
     // basically took it out of the internet, the math is over my head at the moment, see:
     // http://www.songho.ca/opengl/gl_projectionmatrix.html#fov
     float const half_fov_rad{ radians(fov / 2.0f) };
-    float const tan_half_fov{ std::tanf(half_fov_rad) };
+    float const tan_half_fov{ std::tan(half_fov_rad) };
     float const top{ near * tan_half_fov };
     float const right{ top * ratio };
     m4 result;
@@ -268,7 +268,7 @@ namespace lvar {
   // @TODO: support multiple rotations
   // @TODO: use quaternions instead to avoid gimbal lock problem
   [[nodiscard]]
-  m4 rotate(m4 const& m, float const degrees, v3i const& axis)
+  inline m4 rotate(m4 const& m, float const degrees, v3i const& axis)
   {
     auto const rad = radians(degrees);
     m4 r;
@@ -321,7 +321,7 @@ namespace lvar {
   }
 
   [[nodiscard]]
-  m4 inverse_transform_noscale(m4 const& m)
+  inline m4 inverse_transform_noscale(m4 const& m)
   {
     m4 inv;
     // transpose the 3x3 rotation part
@@ -345,7 +345,7 @@ namespace lvar {
   }
 
   [[nodiscard]]
-  m4 inverse_transform(m4 const& m)
+  inline m4 inverse_transform(m4 const& m)
   {
     // this one is a little different from the previous one bc when scaling
     // is present in M. In this case, the upper-left 3x3 matrix is not purely
@@ -381,6 +381,52 @@ namespace lvar {
     return inv;
   }
 
+  // 6 planes (left, right, bottom, top, near, far) as (a, b, c, d) with the normal pointing inside,
+  // so a point p is inside a plane if dot(n, p) + d >= 0
+  class frustum final {
+  public:
+    v4 planes[6];
+  };
+
+  // Gribb & Hartmann: the planes are sums/diffs of the rows of the clip matrix. if you pass proj·view
+  // you get world space planes, proj·view·model gives you the planes in model space.
+  // remember mul is right to left, proj·view is mul(view, proj)
+  [[nodiscard]]
+  inline frustum extract_frustum(m4 const& clip)
+  {
+    auto const row = [&clip](int const r) {
+      return v4{ clip.get(0, r), clip.get(1, r), clip.get(2, r), clip.get(3, r) };
+    };
+    v4 const r0{ row(0) }, r1{ row(1) }, r2{ row(2) }, r3{ row(3) };
+    frustum f{ {
+      { r3.x + r0.x, r3.y + r0.y, r3.z + r0.z, r3.w + r0.w },
+      { r3.x - r0.x, r3.y - r0.y, r3.z - r0.z, r3.w - r0.w },
+      { r3.x + r1.x, r3.y + r1.y, r3.z + r1.z, r3.w + r1.w },
+      { r3.x - r1.x, r3.y - r1.y, r3.z - r1.z, r3.w - r1.w },
+      { r3.x + r2.x, r3.y + r2.y, r3.z + r2.z, r3.w + r2.w },
+      { r3.x - r2.x, r3.y - r2.y, r3.z - r2.z, r3.w - r2.w },
+    } };
+    // normalise so the plane eq gives actual distances, needed for spheres
+    for(auto& p : f.planes) {
+      float const len{ std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z) };
+      if(len > 0.0f) {
+        p = { p.x / len, p.y / len, p.z / len, p.w / len };
+      }
+    }
+    return f;
+  }
+
+  [[nodiscard]]
+  inline bool sphere_in_frustum(frustum const& f, v3 const& centre, float const radius)
+  {
+    for(auto const& p : f.planes) {
+      if(p.x * centre.x + p.y * centre.y + p.z * centre.z + p.w < -radius) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   inline m4 transpose(m4 const& m)
   {
     m4 trans;
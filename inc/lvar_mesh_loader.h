@@ -0,0 +1,99 @@
+#pragma once
+
+#include "lvar_obj.h"
+#include "lvar_encode.h"
+#include "lvar_meshlet.h"
+#include "lvar_jobs.h"
+
+#include <memory>
+
+namespace lvar {
+  namespace obj {
+
+    class mesh_loader;
+
+    // a mesh loaded by a worker, with all its memory: parsed (or read from a cooked .lvm), optimised,
+    // normals if it didn't have them, lods if it didn't have them, the meshlets of level 0 and encoded.
+    // everything is gone after the main thread is done with it, keep what you need.
+    class loaded_mesh final {
+    public:
+      explicit loaded_mesh(std::size_t const capacity) noexcept
+        : mem{ capacity }
+      {
+      }
+      // vertices and then indices, that's what drain hands out in pieces
+      auto gpu_bytes() const noexcept { return gpu.vertices.bytes() + gpu.indices.bytes(); }
+    public:
+      arena mem;
+      mesh m;
+      encoded_mesh gpu;
+      slice<meshlet> meshlets;  // in the units of the mesh, not the quantised ones of the gpu
+      char path[256];
+      encode_options options;
+      mesh_loader* loader;
+      unsigned int id;
+      bool ok;
+      std::size_t uploaded;     // bytes of gpu_bytes() already handed out, only the main thread touches it
+    };
+
+    // parse_file & co on the workers of a pool, so the render loop never waits for a file. finished
+    // meshes go into a lock-free queue and the main thread takes them from there once per frame with
+    // drain(), which never hands out more than a budget of bytes per frame: a big mesh takes a few
+    // frames to upload instead of making one of them long.
+    //
+    // everything but the workers runs on the main thread, the loader itself isn't thread safe.
+    class mesh_loader final {
+    public:
+      static std::size_t constexpr max_in_flight{ 64 };
+    public:
+      explicit mesh_loader(jobs::pool& p) noexcept
+        : workers{ p },
+          current{ nullptr },
+          pending{ 0 }
+      {
+      }
+      // waits for whatever the workers are still loading, it has nowhere to go otherwise
+      ~mesh_loader();
+      mesh_loader(mesh_loader const&) = delete;
+      mesh_loader& operator=(mesh_loader const&) = delete;
+      // id is whatever you want to recognise the mesh by when it comes out of drain. false if there are
+      // max_in_flight loads going on already, or the pool is full, try again next frame
+      bool load(char const* path, unsigned int const id, encode_options const& options = {}) noexcept;
+      // upload(loaded_mesh&, begin, end) for the byte range [begin, end) of gpu_bytes(), done(loaded_mesh&)
+      // when a mesh is complete (or it failed, ok is false then and there's nothing to upload). returns the
+      // bytes handed out, <= budget
+      template<typename U, typename D>
+      std::size_t drain(std::size_t const budget, U const& upload, D const& done)
+      {
+        std::size_t spent{ 0 };
+        while(spent < budget) {
+          if(!current && !completed.pop(current)) {
+            break;
+          }
+          std::size_t const total{ current->ok ? current->gpu_bytes() : 0 };
+          std::size_t const n{ std::min(total - current->uploaded, budget - spent) };
+          if(n > 0) {
+            upload(*current, current->uploaded, current->uploaded + n);
+            current->uploaded += n;
+            spent += n;
+          }
+          if(current->uploaded == total) {
+            done(*current);
+            finish();
+          }
+        }
+        return spent;
+      }
+      auto in_flight() const noexcept { return pending; }
+    private:
+      static void run(void* data) noexcept;
+      void finish() noexcept;
+    private:
+      jobs::pool& workers;
+      jobs::mpmc_queue<loaded_mesh*, max_in_flight> completed;
+      loaded_mesh* current;     // the one being uploaded, owned by the loader from the queue on
+      std::size_t pending;
+    };
+
+  };
+};
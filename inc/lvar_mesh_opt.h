@@ -0,0 +1,84 @@
+#pragma once
+
+#include "lvar_obj.h"
+
+namespace lvar {
+  namespace obj {
+
+    // acmr -> avg cache miss ratio, vertex shader invocations per triangle. 0.5 is the best you can
+    //         get on a regular grid, 3 means every single vertex is transformed again.
+    // atvr -> avg transformed vertex ratio, vertex shader invocations per vertex. 1 is perfect.
+    class cache_stats final {
+    public:
+      float acmr;
+      float atvr;
+    };
+
+    class optimise_report final {
+    public:
+      cache_stats before;
+      cache_stats after;
+    };
+
+    // size of the simulated post-transform cache, gpus don't really have a fifo of 16 anymore but
+    // optimising for it still gives good results on all of them
+    unsigned int constexpr vertex_cache_size{ 16 };
+
+    // vertex -> triangles that use it, compressed so it's only two arrays:
+    // triangles of vertex v are tris[offsets[v]] .. tris[offsets[v + 1]]
+    class adjacency final {
+    public:
+      slice<unsigned int> offsets;
+      slice<unsigned int> tris;
+    };
+
+    // triangles can't move from one submesh to another (it'd change their material), so the functions that
+    // reorder or simplify triangles run once per submesh on a mesh that only has its indices. fx(mesh&)
+    // returns false to stop
+    template<typename F>
+    bool for_each_submesh(mesh& m, F const& fx) noexcept
+    {
+      if(m.submeshes.empty()) {
+        return fx(m);
+      }
+      for(auto const& s : m.submeshes) {
+        mesh part{ m };
+        part.indices = slice<unsigned int>{ m.indices.data() + s.index_offset, s.index_count };
+        part.submeshes = {};
+        if(!fx(part)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // pushed in mem, together with a bit of temporary memory that stays there
+    bool build_adjacency(slice<unsigned int> const& indices, std::size_t const num_vertices,
+                         arena& mem, adjacency& adj) noexcept;
+
+    // all these functions only use the scratch arena for temporary memory, it's left exactly like it was
+    // when they return. they're deterministic, same input -> same output, so they can run in the cooker.
+    // triangles never leave their submesh, so materials stay where they were.
+
+    // simulates a fifo post-transform cache over the index buffer
+    cache_stats analyse_vertex_cache(slice<unsigned int> const& indices,
+                                     std::size_t const num_vertices,
+                                     arena& scratch,
+                                     unsigned int const cache_size = vertex_cache_size) noexcept;
+
+    // reorders triangles for the post-transform cache, tipsify (Sander, Nehab, Barczak 2007)
+    bool optimise_vertex_cache(mesh& m, arena& scratch, unsigned int const cache_size = vertex_cache_size) noexcept;
+    // splits the triangle order into clusters and draws first the ones facing out of the mesh, so the
+    // ones behind them fail the depth test. run it after optimise_vertex_cache, threshold is how much
+    // worse acmr is allowed to get (1.05 -> 5%)
+    bool optimise_overdraw(mesh& m, arena& scratch, float const threshold = 1.05f,
+                           unsigned int const cache_size = vertex_cache_size) noexcept;
+    // reorders the vertices in the order the index buffer uses them, so vertex fetch reads memory
+    // linearly. this one always goes last because it changes the vertices.
+    bool optimise_vertex_fetch(mesh& m, arena& scratch) noexcept;
+
+    // all of the above in the right order
+    bool optimise(mesh& m, arena& scratch, optimise_report* report = nullptr) noexcept;
+
+  };
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "lvar_obj.h"
+#include "lvar_math.h"
+
+namespace lvar {
+  namespace obj {
+
+    // small piece of a mesh, a contiguous range of its index buffer inside one of its submeshes. small
+    // enough that culling it on the cpu is worth it: if the sphere is outside the frustum or the camera is
+    // inside the cone of backfacing directions, none of its triangles can be visible.
+    class meshlet final {
+    public:
+      v3 centre;                // bounding sphere
+      float radius;
+      v3 cone_apex;             // backface cone, all the triangles face away from the camera if it's
+      v3 cone_axis;             // inside the cone with this apex/axis and cos(angle) = cone_cutoff
+      float cone_cutoff;        // 1 -> can't be cone culled
+      unsigned int index_offset;
+      unsigned int index_count;
+      unsigned int submesh;     // in mesh::submeshes, 0 if it has none
+    };
+
+    // what you actually send to glDrawElements, consecutive visible meshlets of the same submesh are merged
+    // (a draw has one material)
+    class draw_range final {
+    public:
+      unsigned int index_offset;
+      unsigned int index_count;
+      unsigned int submesh;
+    };
+
+    unsigned int constexpr meshlet_max_vertices{ 64 };
+    unsigned int constexpr meshlet_max_triangles{ 124 };
+
+    // groups triangles in meshlets growing them thru adjacent triangles, so they're compact. this
+    // reorders the index buffer of the mesh so every meshlet is a contiguous range, it keeps the
+    // vertex cache order inside them pretty well, but run it after optimise_vertex_cache anyway.
+    // every submesh is split on its own, so no meshlet has triangles of two materials and the triangles
+    // stay in their submesh. meshlets are pushed in mem, scratch is only used for temporary memory.
+    bool build_meshlets(mesh& m,
+                        slice<meshlet>& out,
+                        arena& mem,
+                        arena& scratch,
+                        unsigned int const max_vertices = meshlet_max_vertices,
+                        unsigned int const max_triangles = meshlet_max_triangles) noexcept;
+
+    // f and camera_pos must be in the space of the mesh: extract_frustum(proj·view·model) and the camera
+    // position transformed by the inverse of model. writes at most meshlets.size() ranges in out and
+    // returns how many it wrote.
+    std::size_t cull_meshlets(slice<meshlet> const& meshlets,
+                              frustum const& f,
+                              v3 const& camera_pos,
+                              draw_range* out) noexcept;
+
+  };
+};
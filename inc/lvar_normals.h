@@ -0,0 +1,35 @@
+#pragma once
+
+#include "lvar_obj.h"
+
+namespace lvar {
+  namespace obj {
+
+    // how much every triangle contributes to the normal of its vertices. angle weighting doesn't
+    // care about how the surface is tessellated, area weighting makes big triangles win
+    enum class normal_weight {
+      area,
+      angle
+    };
+
+    // smooth normals for meshes without vn (it overwrites them if there are). edges where the faces meet
+    // at more than crease_degrees stay hard, which means splitting the vertices there, so the vertex
+    // arrays can be pushed again in mem (the old ones are left there, it's an arena). 180 -> everything
+    // is smooth and the vertices never change.
+    //
+    // runs in parallel: face normals over face ranges, then every vertex gathers the normals of its
+    // faces over vertex ranges, so threads never write to the same memory and there are no atomics.
+    bool generate_normals(mesh& m,
+                          arena& mem,
+                          arena& scratch,
+                          float const crease_degrees = 180.0f,
+                          normal_weight const weight = normal_weight::angle) noexcept;
+
+    // per vertex tangents for normal mapping, needs normals and uvs. same conventions as mikktspace:
+    // the tangent is orthogonalised against the vertex normal, it's angle weighted and the bitangent
+    // is w * cross(normal, tangent). unlike mikktspace, vertices aren't split where the handedness of
+    // the triangles around them changes (mirrored uvs), the majority wins there.
+    bool generate_tangents(mesh& m, arena& mem, arena& scratch) noexcept;
+
+  };
+};
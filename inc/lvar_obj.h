@@ -1,6 +1,6 @@
 #pragma once
 
-#include <vector>
+#include "lvar_arena.h"
 
 namespace lvar {
   namespace obj {
@@ -12,6 +12,28 @@ namespace lvar {
       float z;
     };
 
+    class normal final {
+    public:
+      float x;
+      float y;
+      float z;
+    };
+
+    class texcoord final {
+    public:
+      float u;
+      float v;
+    };
+
+    // w is the handedness of the bitangent: bitangent = w * cross(normal, tangent)
+    class tangent final {
+    public:
+      float x;
+      float y;
+      float z;
+      float w;
+    };
+
     class face final {
     public:
       unsigned int idx_x;
@@ -19,15 +41,133 @@ namespace lvar {
       unsigned int idx_z;
     };
 
-    // @TODO: once you have the arena, use it here instead of a vector
+    // what a .mtl says about a material. the maps are only paths (relative to where the program runs,
+    // the directory of the .mtl is already in them), empty if there's no map: the textures are loaded
+    // by the resource manager the first time something is drawn with them, not with the mesh
+    class material final {
+    public:
+      char name[64];
+      float ambient[3];         // Ka
+      float diffuse[3];         // Kd
+      float specular[3];        // Ks
+      float shininess;          // Ns
+      float opacity;            // d, or 1 - Tr
+      char diffuse_map[256];    // map_Kd
+      char specular_map[256];   // map_Ks
+      char normal_map[256];     // map_Bump, bump or norm
+      unsigned int diffuse_layer; // where diffuse_map is in the mesh's atlas, see diffuse_layers
+    };
+
+    unsigned int constexpr no_material{ ~0u };
+    unsigned int constexpr no_layer{ ~0u };
+
+    // the diffuse maps of the materials, each one once and in the order they're first used, into paths
+    // (they point into the materials). diffuse_layer of every material is the index of its map in there,
+    // no_layer if it doesn't have one. that's what an atlas of them is made from, and the material says
+    // which of its rects it is. false if there are more than max_paths maps (nothing is changed then)
+    bool diffuse_layers(slice<material> materials, char const** paths, unsigned int const max_paths, unsigned int& count) noexcept;
+
+    // the triangles that use one material, one draw call each
+    class submesh final {
+    public:
+      unsigned int index_offset;
+      unsigned int index_count;
+      unsigned int material;    // in mesh::materials, or no_material
+    };
+
+    // one level of detail, a range in the index buffer of the lod chain. error is how far (in mesh
+    // units) the simplified surface is from the original one, more or less
+    class lod final {
+    public:
+      unsigned int index_offset;
+      unsigned int index_count;
+      float error;
+    };
+
+    // what build_lods (lvar_simplify.h) makes. all the levels live in the same index buffer and use the
+    // vertices of the original mesh, so the whole chain is one vbo + one ebo and switching lods is just
+    // changing the range you draw. level 0 is the full resolution mesh. when the mesh has submeshes
+    // every level has them too, in the same order and with the same materials, ranges of indices like
+    // the level itself.
+    class lod_chain final {
+    public:
+      slice<submesh> level_submeshes(std::size_t const l) const noexcept
+      {
+        std::size_t const per_level{ levels.empty() ? 0 : submeshes.size() / levels.size() };
+        return { submeshes.data() + l * per_level, per_level };
+      }
+    public:
+      slice<unsigned int> indices;
+      slice<lod> levels;
+      slice<submesh> submeshes; // levels.size() * the submeshes of the mesh, empty if it has none
+    };
+
+    // every array of the mesh lives in the arena that was passed to parse_file, one after the
+    // other, so freeing a mesh is popping the arena back to where it was before loading it (or
+    // resetting it if you loaded a whole level into it)
     class mesh final {
     public:
-      std::vector<vertex> vertices;
-      std::vector<face> faces;  // @TODO: why would you need this?
-      std::vector<unsigned int> indices;
+      // faces are just the indices grouped by 3, no need to store them twice
+      auto num_faces() const noexcept { return indices.size() / 3; }
+      face get_face(std::size_t const i) const noexcept
+      {
+        return { indices[i * 3], indices[i * 3 + 1], indices[i * 3 + 2] };
+      }
+    public:
+      // all the attribute arrays have the same size as vertices or they're empty if the mesh doesn't
+      // have that attribute
+      slice<vertex> vertices;
+      slice<normal> normals;
+      slice<texcoord> uvs;
+      slice<tangent> tangents;
+      slice<unsigned int> indices; // 0-based, ready to be used in an EBO
+      // empty if the file never says usemtl, otherwise they cover all the indices in order
+      slice<submesh> submeshes;
+      slice<material> materials;
+      // empty unless build_lods made them, lods.levels[0] has the same indices as indices
+      lod_chain lods;
     };
 
-    bool parse_file(char const* filepath, mesh& o);
+    // reads v, vt, vn and f (v, v/vt, v//vn, v/vt/vn, negative indices and polygons, which are
+    // triangulated as fans). when there are uvs or normals, every unique combination of indices
+    // becomes a vertex. mtllib and usemtl become materials and submeshes. if it fails, nothing is left
+    // in the arena.
+    bool parse_file(char const* filepath, mesh& o, arena& mem);
+
+    // binary mesh (.lvm), what the importer writes and what should be shipped: a header and then the
+    // arrays of the mesh as they are in memory (vertices, normals, uvs, tangents, indices, submeshes,
+    // materials and the lod chain's levels, submeshes and indices, the empty ones aren't there), so
+    // loading it is a read per array and no parsing
+    class mesh_header final {
+    public:
+      static unsigned int constexpr lvm_magic{ 0x314d564c }; // "LVM1"
+      static unsigned int constexpr lvm_version{ 4 }; // 3: material::diffuse_layer, 4: lods
+      static unsigned int constexpr has_normals{ 1 << 0 };
+      static unsigned int constexpr has_uvs{ 1 << 1 };
+      static unsigned int constexpr has_tangents{ 1 << 2 };
+    public:
+      unsigned int magic;
+      unsigned int version;
+      unsigned int flags;
+      unsigned int num_vertices;
+      unsigned long long num_indices;
+      unsigned int num_submeshes;
+      unsigned int num_materials;
+      unsigned int num_lods;
+      unsigned int num_lod_submeshes;
+      unsigned long long num_lod_indices;
+    };
+
+    bool save_mesh(char const* filepath, mesh const& m);
+    bool load_mesh(char const* filepath, mesh& o, arena& mem);
+
+    // .obj -> .lvm without ever having the whole thing in memory, for the multi-GB ones that parse_file
+    // can't do. the .obj is read through a sliding mmap window and the output is written through
+    // fixed size buffers, so the memory used stays under memory_budget no matter how big the file is.
+    // only positions and faces are converted (vertices are the v lines, like parse_file does when there
+    // are no vt/vn), welding uvs and normals needs a table as big as the mesh. generate_normals after
+    // loading it if you need them. materials are ignored too, scans are one big texture anyway.
+    bool import_file(char const* obj_path, char const* lvm_path, std::size_t const memory_budget = 64 * 1024 * 1024);
 
   };
 };
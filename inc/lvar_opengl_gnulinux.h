@@ -27,6 +27,7 @@ extern PFNGLCREATEPROGRAMPROC glCreateProgram;
 extern PFNGLATTACHSHADERPROC glAttachShader;
 extern PFNGLLINKPROGRAMPROC glLinkProgram;
 extern PFNGLGETPROGRAMIVPROC glGetProgramiv;
+extern PFNGLGETACTIVEUNIFORMPROC glGetActiveUniform;
 extern PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
 extern PFNGLUSEPROGRAMPROC glUseProgram;
 extern PFNGLGENERATEMIPMAPPROC glGenerateMipmap;
@@ -43,6 +44,26 @@ extern PFNGLUNIFORM4FPROC glUniform4f;
 extern PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndex;
 extern PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBinding;
 extern PFNGLBINDBUFFERBASEPROC glBindBufferBase;
+extern PFNGLBINDBUFFERRANGEPROC glBindBufferRange;
+extern PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+extern PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+extern PFNGLBUFFERSTORAGEPROC glBufferStorage;
+extern PFNGLFENCESYNCPROC glFenceSync;
+extern PFNGLCLIENTWAITSYNCPROC glClientWaitSync;
+extern PFNGLDELETESYNCPROC glDeleteSync;
+extern PFNGLGETPROGRAMBINARYPROC glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glProgramParameteri;
+extern PFNGLGETSTRINGIPROC glGetStringi;
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+extern PFNGLGETUNIFORMFVPROC glGetUniformfv;
+extern PFNGLGETUNIFORMIVPROC glGetUniformiv;
+extern PFNGLUNIFORM1FVPROC glUniform1fv;
+extern PFNGLUNIFORM2FVPROC glUniform2fv;
+extern PFNGLUNIFORM3FVPROC glUniform3fv;
+extern PFNGLUNIFORM4FVPROC glUniform4fv;
+extern PFNGLUNIFORMMATRIX3FVPROC glUniformMatrix3fv;
+extern PFNGLUNIFORM1IVPROC glUniform1iv;
 extern PFNGLPOLYGONMODEPROC myGlPolygonMode;
 
 #define glPolygonMode myGlPolygonMode
@@ -77,6 +98,7 @@ PFNGLCREATEPROGRAMPROC glCreateProgram;
 PFNGLATTACHSHADERPROC glAttachShader;
 PFNGLLINKPROGRAMPROC glLinkProgram;
 PFNGLGETPROGRAMIVPROC glGetProgramiv;
+PFNGLGETACTIVEUNIFORMPROC glGetActiveUniform;
 PFNGLGETPROGRAMINFOLOGPROC glGetProgramInfoLog;
 PFNGLUSEPROGRAMPROC glUseProgram;
 PFNGLGENERATEMIPMAPPROC glGenerateMipmap;
@@ -93,6 +115,26 @@ PFNGLUNIFORM4FPROC glUniform4f;
 PFNGLGETUNIFORMBLOCKINDEXPROC glGetUniformBlockIndex;
 PFNGLUNIFORMBLOCKBINDINGPROC glUniformBlockBinding;
 PFNGLBINDBUFFERBASEPROC glBindBufferBase;
+PFNGLBINDBUFFERRANGEPROC glBindBufferRange;
+PFNGLMAPBUFFERRANGEPROC glMapBufferRange;
+PFNGLUNMAPBUFFERPROC glUnmapBuffer;
+PFNGLBUFFERSTORAGEPROC glBufferStorage;
+PFNGLFENCESYNCPROC glFenceSync;
+PFNGLCLIENTWAITSYNCPROC glClientWaitSync;
+PFNGLDELETESYNCPROC glDeleteSync;
+PFNGLGETPROGRAMBINARYPROC glGetProgramBinary;
+PFNGLPROGRAMBINARYPROC glProgramBinary;
+PFNGLPROGRAMPARAMETERIPROC glProgramParameteri;
+PFNGLGETSTRINGIPROC glGetStringi;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR;
+PFNGLGETUNIFORMFVPROC glGetUniformfv;
+PFNGLGETUNIFORMIVPROC glGetUniformiv;
+PFNGLUNIFORM1FVPROC glUniform1fv;
+PFNGLUNIFORM2FVPROC glUniform2fv;
+PFNGLUNIFORM3FVPROC glUniform3fv;
+PFNGLUNIFORM4FVPROC glUniform4fv;
+PFNGLUNIFORMMATRIX3FVPROC glUniformMatrix3fv;
+PFNGLUNIFORM1IVPROC glUniform1iv;
 PFNGLPOLYGONMODEPROC myGlPolygonMode;
 
 void init_opengl_ptrs()
@@ -117,6 +159,7 @@ void init_opengl_ptrs()
   glAttachShader = (PFNGLATTACHSHADERPROC)getGLProcAddress("glAttachShader");
   glLinkProgram = (PFNGLLINKPROGRAMPROC)getGLProcAddress("glLinkProgram");
   glGetProgramiv = (PFNGLGETPROGRAMIVPROC)getGLProcAddress("glGetProgramiv");
+  glGetActiveUniform = (PFNGLGETACTIVEUNIFORMPROC)getGLProcAddress("glGetActiveUniform");
   glGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC)getGLProcAddress("glGetProgramInfoLog");
   glUseProgram = (PFNGLUSEPROGRAMPROC)getGLProcAddress("glUseProgram");
   glGenerateMipmap = (PFNGLGENERATEMIPMAPPROC)getGLProcAddress("glGenerateMipmap");
@@ -133,5 +176,25 @@ void init_opengl_ptrs()
   glGetUniformBlockIndex = (PFNGLGETUNIFORMBLOCKINDEXPROC)getGLProcAddress("glGetUniformBlockIndex");
   glUniformBlockBinding = (PFNGLUNIFORMBLOCKBINDINGPROC)getGLProcAddress("glUniformBlockBinding");
   glBindBufferBase = (PFNGLBINDBUFFERBASEPROC)getGLProcAddress("glBindBufferBase");
+  glBindBufferRange = (PFNGLBINDBUFFERRANGEPROC)getGLProcAddress("glBindBufferRange");
+  glMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)getGLProcAddress("glMapBufferRange");
+  glUnmapBuffer = (PFNGLUNMAPBUFFERPROC)getGLProcAddress("glUnmapBuffer");
+  glBufferStorage = (PFNGLBUFFERSTORAGEPROC)getGLProcAddress("glBufferStorage");
+  glFenceSync = (PFNGLFENCESYNCPROC)getGLProcAddress("glFenceSync");
+  glClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)getGLProcAddress("glClientWaitSync");
+  glDeleteSync = (PFNGLDELETESYNCPROC)getGLProcAddress("glDeleteSync");
+  glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)getGLProcAddress("glGetProgramBinary");
+  glProgramBinary = (PFNGLPROGRAMBINARYPROC)getGLProcAddress("glProgramBinary");
+  glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)getGLProcAddress("glProgramParameteri");
+  glGetStringi = (PFNGLGETSTRINGIPROC)getGLProcAddress("glGetStringi");
+  glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)getGLProcAddress("glMaxShaderCompilerThreadsKHR");
+  glGetUniformfv = (PFNGLGETUNIFORMFVPROC)getGLProcAddress("glGetUniformfv");
+  glGetUniformiv = (PFNGLGETUNIFORMIVPROC)getGLProcAddress("glGetUniformiv");
+  glUniform1fv = (PFNGLUNIFORM1FVPROC)getGLProcAddress("glUniform1fv");
+  glUniform2fv = (PFNGLUNIFORM2FVPROC)getGLProcAddress("glUniform2fv");
+  glUniform3fv = (PFNGLUNIFORM3FVPROC)getGLProcAddress("glUniform3fv");
+  glUniform4fv = (PFNGLUNIFORM4FVPROC)getGLProcAddress("glUniform4fv");
+  glUniformMatrix3fv = (PFNGLUNIFORMMATRIX3FVPROC)getGLProcAddress("glUniformMatrix3fv");
+  glUniform1iv = (PFNGLUNIFORM1IVPROC)getGLProcAddress("glUniform1iv");
   myGlPolygonMode = (PFNGLPOLYGONMODEPROC)getGLProcAddress("glPolygonMode");
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "lvar_arena.h"
+
+namespace lvar {
+  namespace pack {
+
+    // one file with all the assets (.lvp): a header, the blobs one after the other, each one aligned to
+    // blob_alignment, and at the end the directory, one entry per blob sorted by id. the id of an asset is
+    // the fnv1a of its path without a leading "./", so "./res/x.png" and "res/x.png" are the same asset.
+    // a blob can be compressed (a small lz77, lz_* below), the ones that don't get smaller aren't. a
+    // compressed blob is chunks of chunk_size bytes of the file (the last one is shorter), each one on its
+    // own: 4 bytes with its size in the pack and then its bytes, compressed or, with stored_chunk in the
+    // size, as they are. so nothing ever has more than a chunk of a file in memory to write or read it.
+    class header final {
+    public:
+      static unsigned int constexpr lvp_magic{ 0x3150564c }; // "LVP1"
+      static unsigned int constexpr lvp_version{ 2 };
+      static unsigned int constexpr blob_alignment{ 64 };
+    public:
+      unsigned int magic;
+      unsigned int version;
+      unsigned int num_entries;
+      unsigned int padding;
+      unsigned long long directory_offset;
+    };
+
+    class entry final {
+    public:
+      static unsigned int constexpr compressed{ 1 << 0 };
+      static std::size_t constexpr chunk_size{ 1 << 20 };
+      static unsigned int constexpr stored_chunk{ 1u << 31 };
+    public:
+      int id;
+      unsigned int flags;
+      unsigned long long offset;
+      unsigned long long size;     // in the file
+      unsigned long long raw_size; // once it's decompressed, same as size if it isn't compressed
+    };
+
+    int asset_id(char const* path) noexcept;
+
+    // writes the files into a pack, compressing them if compress says so and it's worth it (the first chunk
+    // of a file says if it is). they're streamed a chunk at a time, the size of a file doesn't matter. false
+    // if a file can't be read or two paths have the same id (rename one of them)
+    bool write_pack(char const* pack_path, char const* const* paths, unsigned int const count, bool const compress) noexcept;
+
+    // the pack mmapped once, everything after open() is reading memory. the blobs that aren't compressed can
+    // be used straight from the mapping with view(). thread safe after open(), nothing changes.
+    class reader final {
+    public:
+      reader() noexcept;
+      ~reader() noexcept;
+      reader(reader const&) = delete;
+      reader& operator=(reader const&) = delete;
+    public:
+      // false if it isn't there or it isn't a pack, and then nothing is found in it
+      bool open(char const* pack_path) noexcept;
+      // binary search in the directory, nullptr if it isn't in the pack
+      entry const* find(int const id) const noexcept;
+      entry const* find(char const* path) const noexcept { return find(asset_id(path)); }
+      // the bytes as they are in the file: compressed if the entry is
+      slice<unsigned char const> view(entry const& e) const noexcept;
+      // e.raw_size bytes into out, decompressed if it has to
+      bool read(entry const& e, void* out) const noexcept;
+      auto size() const noexcept { return num_entries; }
+    private:
+      unsigned char const* base;
+      std::size_t bytes;
+      entry const* directory;
+      unsigned int num_entries;
+    };
+
+    // the compression of the blobs, lz4-ish: a token with the number of literals and the length of the
+    // match, the literals, and the offset of the match (at most 64 KB back). fast to decompress, which is
+    // what matters at load time. lz_compress returns 0 if it doesn't fit in capacity
+    std::size_t lz_bound(std::size_t const size) noexcept;
+    std::size_t lz_compress(unsigned char const* src, std::size_t const size, unsigned char* dst, std::size_t const capacity) noexcept;
+    bool lz_decompress(unsigned char const* src, std::size_t const size, unsigned char* dst, std::size_t const raw_size) noexcept;
+
+  };
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "lvar_handle.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace lvar {
+  namespace resource {
+
+    // what the manager knows about a resource it can evict. refs is how many want it, the ones nobody wants
+    // stay resident anyway (a cache) until they're over the memory budget, least recently used first
+    class residency final {
+    public:
+      std::size_t bytes;        // on the gpu, 0 while it isn't resident
+      unsigned int refs;
+      unsigned int last_used;   // frame
+      int name;                 // fnv1a of the path
+    };
+
+    // the resources of one type that can be evicted (T has a residency res), the names they're found by and
+    // the bytes they take between them. it doesn't know what they are, freeing one is up to whoever evicts
+    // it (evict_lru), so there's no gl in here
+    template<typename T>
+    class resident_set final {
+    public:
+      // a new one with one ref, used in frame. invalid handle if the name is taken or it's full
+      handle<T> insert(T item, int const name, unsigned int const frame) noexcept
+      {
+        if(names.find(name) != names.end()) {
+          return {};
+        }
+        item.res.refs = 1;
+        item.res.last_used = frame;
+        item.res.name = name;
+        std::size_t const bytes{ item.res.bytes };
+        handle<T> const h{ items.insert(std::move(item)) };
+        if(h.valid()) {
+          names[name] = h;
+          resident += bytes;
+        }
+        return h;
+      }
+      handle<T> find(int const name) const noexcept
+      {
+        auto const it = names.find(name);
+        return it == names.end() ? handle<T>{} : it->second;
+      }
+      // one more ref, invalid handle if there's nothing with that name
+      handle<T> acquire(int const name) noexcept
+      {
+        handle<T> const h{ find(name) };
+        if(T* const item{ items.get(h) }) {
+          ++item->res.refs;
+        }
+        return h;
+      }
+      // nullptr if the handle is stale, it's the most recently used one otherwise
+      T* use(handle<T> const h, unsigned int const frame) noexcept
+      {
+        T* const item{ items.get(h) };
+        if(item) {
+          item->res.last_used = frame;
+        }
+        return item;
+      }
+      void release(handle<T> const h) noexcept
+      {
+        T* const item{ items.get(h) };
+        if(item && item->res.refs > 0) {
+          --item->res.refs;
+        }
+      }
+      // it was loaded, or replaced by something smaller
+      void set_bytes(handle<T> const h, std::size_t const bytes) noexcept
+      {
+        if(T* const item{ items.get(h) }) {
+          resident = resident - item->res.bytes + bytes;
+          item->res.bytes = bytes;
+        }
+      }
+      bool remove(handle<T> const h) noexcept
+      {
+        T const* const item{ items.get(h) };
+        if(!item) {
+          return false;
+        }
+        resident -= item->res.bytes;
+        names.erase(item->res.name);
+        return items.remove(h);
+      }
+      T* get(handle<T> const h) noexcept { return items.get(h); }
+      T const* get(handle<T> const h) const noexcept { return items.get(h); }
+      handle<T> handle_of(std::size_t const i) const noexcept { return items.handle_of(i); }
+      auto bytes() const noexcept { return resident; }
+      auto size() const noexcept { return items.size(); }
+      auto begin() noexcept { return items.begin(); }
+      auto end() noexcept { return items.end(); }
+      auto begin() const noexcept { return items.begin(); }
+      auto end() const noexcept { return items.end(); }
+    private:
+      slot_map<T> items;
+      std::unordered_map<int, handle<T>> names;
+      std::size_t resident{ 0 };
+    };
+
+    // what nobody wants in a and b goes, least recently used first, until the two of them take no more
+    // than budget. free_a(A&) and free_b(B&) are called right before each one is removed. what's still
+    // wanted is never evicted, even if that leaves them over the budget
+    template<typename A, typename B, typename FA, typename FB>
+    void evict_lru(resident_set<A>& a, resident_set<B>& b, std::size_t const budget, FA const& free_a, FB const& free_b)
+    {
+      if(a.bytes() + b.bytes() <= budget) {
+        return;
+      }
+      // only when it's over the budget, so the sort is rare
+      class candidate final {
+      public:
+        unsigned int last_used;
+        unsigned int handle_bits;
+        bool in_a;
+      };
+      std::vector<candidate> candidates;
+      for(std::size_t i{ 0 }; i < a.size(); ++i) {
+        residency const& r{ (a.begin() + i)->res };
+        if(r.refs == 0) {
+          candidates.push_back({ r.last_used, a.handle_of(i).bits, true });
+        }
+      }
+      for(std::size_t i{ 0 }; i < b.size(); ++i) {
+        residency const& r{ (b.begin() + i)->res };
+        if(r.refs == 0) {
+          candidates.push_back({ r.last_used, b.handle_of(i).bits, false });
+        }
+      }
+      std::stable_sort(candidates.begin(), candidates.end(),
+                       [](candidate const& x, candidate const& y) { return x.last_used < y.last_used; });
+      for(candidate const& c : candidates) {
+        if(a.bytes() + b.bytes() <= budget) {
+          break;
+        }
+        if(c.in_a) {
+          handle<A> const h{ c.handle_bits };
+          free_a(*a.get(h));
+          a.remove(h);
+        } else {
+          handle<B> const h{ c.handle_bits };
+          free_b(*b.get(h));
+          b.remove(h);
+        }
+      }
+    }
+
+  };
+};
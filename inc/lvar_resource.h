@@ -2,86 +2,268 @@
 
 #include "lvar_shader.h"
 #include "lvar_common.h"
+#include "lvar_handle.h"
+#include "lvar_residency.h"
+#include "lvar_encode.h"
+#include "lvar_watcher.h"
+#include "lvar_pack.h"
+#include "lvar_atlas.h"
 
-#include <unordered_map>
-#include <utility>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace lvar {
+  namespace jobs {
+    class pool;
+  };
   namespace resource {
 
-    // @NOTE: cursed code to be able to use the unordered_map with the pair
-    class pair_hash final {
+    // the uniform block "matrices" of every shader, one buffer for all of them
+    unsigned int constexpr frame_ubo_binding{ 1 };
+    // the uniform block "object", per draw data that comes from a uniform_stream
+    unsigned int constexpr object_ubo_binding{ 2 };
+
+    class alignas(16) uni_buff_obj final {
+    public:
+      m4 proj;
+      m4 view;
+    };
+
+    // per draw uniforms without a glUniform* per draw: one big buffer split in num_regions regions, a
+    // frame writes its data one after the other in its region and every draw binds its piece with
+    // glBindBufferRange. a region isn't written again until the fence of the frame that used it says the
+    // gpu is done with it, so neither side waits for the other as long as the gpu is less than
+    // num_regions - 1 frames behind.
+    //
+    //   begin_frame() -> push() the data of every draw -> flush() -> draws with bind() -> end_frame()
+    //
+    // the buffer is mapped once for good with glBufferStorage (gl 4.4), and every frame with
+    // glMapBufferRange unsynchronized otherwise, in that case nothing can be drawn before flush()
+    class uniform_stream final {
     public:
-      std::size_t operator()(const std::pair<unsigned int, char const*>& arg) const
+      static unsigned int constexpr num_regions{ 3 };
+    public:
+      // region_bytes is the most that can be pushed in a frame
+      explicit uniform_stream(std::size_t const region_bytes) noexcept;
+      ~uniform_stream() noexcept;
+      uniform_stream(uniform_stream const&) = delete;
+      uniform_stream& operator=(uniform_stream const&) = delete;
+    public:
+      auto error() const noexcept { return err; }
+      void begin_frame() noexcept;
+      // copies the data and says where it went, false if the region is full
+      bool push(void const* data, std::size_t const bytes, std::size_t& offset) noexcept;
+      void flush() noexcept;
+      void bind(unsigned int const binding, std::size_t const offset, std::size_t const bytes) const noexcept
       {
-        // yoooo, these {} create an instance of the hash for the types in <>!
-        const auto hash1 = std::hash<unsigned int>{}(arg.first);
-        const auto hash2 = std::hash<char const*>{}(arg.second);
-        return hash1 ^ (hash2 << 1);
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, ubo, offset, bytes);
       }
+      void end_frame() noexcept;
+    private:
+      unsigned char* mapped;    // the whole buffer if persistent, the current region otherwise
+      GLsync fences[num_regions];
+      std::size_t region_bytes;
+      std::size_t alignment;
+      std::size_t used;
+      unsigned int ubo;
+      unsigned int region;
+      bool persistent;
+      bool err;
     };
 
-    class alignas(16) uni_buff_obj final {
+    // glVertexAttribPointer + enable for every attribute of the mesh, the vao and the vbo have to be bound
+    void set_vertex_format(obj::encoded_mesh const& m) noexcept;
+
+    // an encoded mesh on the gpu, ready for glDrawElements
+    class mesh_buffers final {
     public:
-      m4 proj;
-      m4 view;
+      unsigned int vao;
+      unsigned int vbo;
+      unsigned int ebo;
+      unsigned int num_indices;
+      unsigned int index_type;
+    };
+
+    class texture final {
+    public:
+      unsigned int id;          // 0 until it's used for the first time, and if the file couldn't be loaded
+      bool loaded;
+      residency res;
+      char path[256];
+    };
+
+    class resident_mesh final {
+    public:
+      mesh_buffers buffers;
+      residency res;
+    };
+
+    // a gl buffer for whatever isn't a mesh
+    class buffer final {
+    public:
+      unsigned int id;
+      unsigned int target;
+      std::size_t bytes;
+    };
+
+    // uploads the bytes [begin, end) of the mesh, counting the vertices first and then the indices (what
+    // obj::mesh_loader::drain hands out). the buffers are created when begin is 0.
+    void upload_mesh_range(mesh_buffers& b, obj::encoded_mesh const& m, std::size_t const begin, std::size_t const end) noexcept;
+
+    // a program for manager::build_programs, the paths in and everything else out
+    class program_source final {
+    public:
+      char const* vertpath;
+      char const* fragpath;
+      std::string vertcode{};
+      std::string fragcode{};
+      unsigned int vert{ 0 };   // 0 if it came from the cache
+      unsigned int frag{ 0 };
+      unsigned int program{ 0 };
+      GLsync fence{ nullptr };  // without parallel compile, signalled once the driver got past the link
+      int source_hash{ 0 };
+      bool read{ false };
+    };
+
+    class reload_slot;
+    class encode_job;
+
+    // the maps of a texture made with manager::acquire_material_atlas, rects[i] is where paths[i] went
+    class material_atlas final {
+    public:
+      std::vector<std::string> paths;
+      std::vector<tex::uv_rect> rects;
     };
 
     // this class is expected to be omoi
     class manager final {
     public:
-      // all resources will be loaded in the constructor
-      manager() noexcept;
+      static unsigned int constexpr max_atlas_layers{ 16 };
+    public:
+      // the shaders are built in the constructor, textures and meshes come and go while it runs (see
+      // acquire_texture and add_mesh). with a pack, the files are looked for in it first and only read from
+      // disk when they aren't there (hot reload always reads the disk, that's what's edited). the pack has
+      // to outlive the manager
+      explicit manager(pack::reader const* assets = nullptr) noexcept;
       ~manager() noexcept;
     public:
       auto error() const noexcept { return err; }
-      auto get_shader(char const* sid) const noexcept { return shaders.at(fnv1a(sid)).get(); }
-      unsigned int get_uni_location(unsigned int const id, char const* uniname) noexcept
+      // every resource lives in a slot_map of its type and is asked for with its handle, which keeps working
+      // if things are added or removed (unlike the pointers, those are only good until then). nullptr if
+      // the handle is stale. the paths only matter to find a handle, once.
+      handle<shader> find_shader(char const* vertpath) const noexcept
       {
-        const auto key = std::make_pair(id, uniname);
-        const auto it  = uniforms.find(key);
-        if(it == uniforms.end()) { // not found
-          auto const location = glGetUniformLocation(id, uniname);
-          uniforms[key] = location;
-          return location;
-        }
-        return it->second;
+        auto const it = shader_names.find(fnv1a(vertpath));
+        return it == shader_names.end() ? handle<shader>{} : it->second;
       }
+      shader const* get_shader(handle<shader> const h) const noexcept { return shaders.get(h); }
+      buffer const* get_buffer(handle<buffer> const h) const noexcept { return buffers.get(h); }
+      // the gl object is deleted by remove_buffer or with the manager
+      handle<buffer> create_buffer(unsigned int const target, std::size_t const bytes, void const* data, unsigned int const usage) noexcept;
+      bool remove_buffer(handle<buffer> const h) noexcept;
+      // uni is the id of the name, "model"_id. -1 if the shader doesn't have it
+      int get_uni_location(shader const& s, int const uni) const noexcept { return s.uniforms.location(uni); }
       auto use_shader(unsigned int const id) const noexcept
       {
         glUseProgram(id);
       }
-      auto set_uni_mat4(unsigned int const id, char const* uniname, m4 const& m) noexcept
+      auto set_uni_mat4(shader const& s, int const uni, m4 const& m) const noexcept
       {
-        glUniformMatrix4fv(get_uni_location(id, uniname), 1, false, &m.get(0, 0));
+        glUniformMatrix4fv(get_uni_location(s, uni), 1, false, &m.get(0, 0));
       }
-      auto set_uni_vec3(unsigned int const id, char const* uniname, v3 const& value) noexcept
+      auto set_uni_vec3(shader const& s, int const uni, v3 const& value) const noexcept
       {
-        glUniform3f(get_uni_location(id, uniname), value.x, value.y, value.z);
+        glUniform3f(get_uni_location(s, uni), value.x, value.y, value.z);
       }
-      void update_ubo(uni_buff_obj const& data) noexcept
+      // textures and meshes are only resident while they're used. acquire says you want one, and the same
+      // path is the same handle; release says you're done with it. nothing is loaded until the first use:
+      // a texture is loaded the first time use_texture is called with it (a material drawn for the first
+      // time), not when the mesh that uses it is loaded. the id is 0 if it can't be loaded, and then it
+      // doesn't try again. invalid handle for an empty path. a texture in the compressed cache goes up from
+      // there without being decoded, one that isn't is drawn uncompressed until a worker has encoded it and
+      // end_frame swaps it in (same id)
+      handle<texture> acquire_texture(char const* path) noexcept;
+      unsigned int use_texture(handle<texture> const h) noexcept;
+      void release_texture(handle<texture> const h) noexcept;
+      // the diffuse maps of a mesh's materials in one atlas, so all its submeshes are drawn with the same
+      // texture bound instead of one per material. it sets the diffuse_layer of every material and the
+      // handle works like any other texture's (use_texture, release_texture), the same maps are the same
+      // atlas. atlas_rect(h, material.diffuse_layer) is where the material's uvs go, { 0, 0, 1, 1 } until
+      // it's loaded; they can't repeat. atlases are uploaded uncompressed, the .lvc has no rects. invalid
+      // handle if no material has a map or there are more than max_atlas_layers of them
+      handle<texture> acquire_material_atlas(slice<obj::material> materials) noexcept;
+      tex::uv_rect atlas_rect(handle<texture> const h, unsigned int const layer) const noexcept;
+      // meshes are loaded by whoever has the obj::mesh_loader, the manager only keeps them: add_mesh with
+      // the path it came from and the bytes it takes (it's acquired once), acquire_mesh to share one that's
+      // still resident (invalid handle if it isn't, load it again), use_mesh every frame it's drawn
+      handle<resident_mesh> add_mesh(char const* path, mesh_buffers const& b, std::size_t const bytes) noexcept;
+      handle<resident_mesh> acquire_mesh(char const* path) noexcept;
+      mesh_buffers const* use_mesh(handle<resident_mesh> const h) noexcept;
+      void release_mesh(handle<resident_mesh> const h) noexcept;
+      // gpu bytes of textures and meshes. what nobody wants is evicted in end_frame while it's over this
+      void set_memory_budget(std::size_t const bytes) noexcept { budget = bytes; }
+      auto resident_bytes() const noexcept { return textures.bytes() + meshes.bytes(); }
+      // after the last draw of a frame
+      void end_frame() noexcept;
+      // from now on the directories of the shaders are watched and a program is compiled again when one of its
+      // files is saved. the files are read on the watcher's thread, and the compile is only looked at when
+      // it's done (with parallel compile, the driver's threads do it), the old program stays until then
+      void enable_hot_reload() noexcept;
+      // at the start of a frame, the programs that were compiled again replace the old ones here, same
+      // shader* with a new id and the values of the uniforms copied over. the old one stays if the new one
+      // doesn't compile. costs an atomic load when nothing changed
+      void reload_shaders() noexcept;
+      // once per frame, whatever the number of shaders: they all read the same buffer
+      void update_ubo(uni_buff_obj const& data) const noexcept
       {
-        for(auto& s : shaders) {
-          use_shader(s.second->id);
-          glBindBuffer(GL_UNIFORM_BUFFER, s.second->ubo);
-          glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uni_buff_obj), &data);
-        }
+        glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uni_buff_obj), &data);
       }
     private:
       bool shader_compilation_has_errors(unsigned int const program, shader_type const type) const noexcept;
-      // load shader files, compile and link them, return the id of the gend program
-      unsigned int compile_link_shaders(char const* vertpath, char const* fragpath) noexcept;
-      shader create_shader(char const* path_vertex_sh,
-                           char const* path_frag_sh,
+      // reads the files of all the programs on workers, submits every compile and link (or loads the binary
+      // from the cache) and only then looks at how they went, so the driver can work on all of them at the
+      // same time. false if any of them failed
+      bool build_programs(program_source* const sources, std::size_t const count) noexcept;
+      // decodes, packs and uploads the maps of an atlas, 0 if any of them can't be loaded or they don't fit
+      unsigned int load_atlas(handle<texture> const h, material_atlas& a) noexcept;
+      // the textures the worker is done encoding replace the uncompressed ones
+      void finish_encodes() noexcept;
+      // status and logs once it's done, and the binary cache if cache is true (not for hot reloads, they'd
+      // write a file in the middle of a frame for a program that's about to be edited again)
+      bool finish_program(program_source& p, bool const cache) const noexcept;
+      static void on_file_changed(char const* path, void* data) noexcept;
+      // vao and vbo for a linked program
+      shader create_shader(unsigned int const program,
                            void* vertex_data,
                            std::size_t const vertex_sz,
                            unsigned int const num_attrs,
                            unsigned int const elem_per_attr,
                            std::size_t const stride_sz) noexcept;
     private:
-      std::unordered_map<int, std::unique_ptr<shader>> shaders;
-      std::unordered_map<std::pair<unsigned int, char const*>, unsigned int, pair_hash> uniforms;
+      pack::reader const* assets;
+      slot_map<shader> shaders;
+      resident_set<texture> textures;
+      resident_set<resident_mesh> meshes;
+      slot_map<buffer> buffers;
+      // fnv1a of the path, only to find the handles
+      std::unordered_map<int, handle<shader>> shader_names;
+      std::unordered_map<int, material_atlas> atlases; // by the name of the texture
+      std::size_t budget;
+      unsigned int frame;
+      std::vector<std::unique_ptr<reload_slot>> reload_slots; // at most 64, a bit each in reload_changed
+      std::unique_ptr<files::watcher> shader_watcher;
+      std::mutex reload_lock;
+      std::atomic<unsigned long long> reload_changed;
+      std::unique_ptr<jobs::pool> encoder; // made the first time a texture isn't in the compressed cache
+      std::vector<std::unique_ptr<encode_job>> encoding;
+      unsigned int frame_ubo;
+      unsigned int num_cached;  // programs that came from the binary cache
+      unsigned int num_compiling;
       bool err;
     };
 
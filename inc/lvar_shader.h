@@ -1,5 +1,7 @@
 #pragma once
 
+#include "lvar_common.h"
+
 namespace lvar {
   namespace resource {
 
@@ -9,6 +11,45 @@ namespace lvar {
       program
     };
 
+    // the active uniforms of a program, enumerated once after linking, keyed by the fnv1a of their
+    // names ("model"_id). open addressing with at most half of the slots used, so finding a location is
+    // masking the id and one array index most of the time, no strings and no allocations
+    class uniform_table final {
+    public:
+      static unsigned int constexpr max_slots{ 64 };
+    public:
+      uniform_table() noexcept
+        : count{ 0 }
+      {
+        for(auto& s : slots) {
+          s.location = -1;
+        }
+      }
+      bool insert(int const id, int const location) noexcept;
+      // -1 if the program doesn't have it, which glUniform* ignores, like glGetUniformLocation
+      int location(int const id) const noexcept
+      {
+        unsigned int i{ static_cast<unsigned int>(id) & (max_slots - 1) };
+        while(slots[i].location != -1) {
+          if(slots[i].id == id) {
+            return slots[i].location;
+          }
+          i = (i + 1) & (max_slots - 1);
+        }
+        return -1;
+      }
+      auto size() const noexcept { return count; }
+    private:
+      class slot final {
+      public:
+        int id;
+        int location;           // -1 is an empty slot
+      };
+    private:
+      slot slots[max_slots];
+      unsigned int count;
+    };
+
     // useful class to store shader's id, vao, vbo and ebo once they're created in
     // the resource manager; since every shader is diff (num of attrs, etc), it's
     // not a good idea to define these member functions in here, they should be
@@ -18,13 +59,11 @@ namespace lvar {
       shader(unsigned int const i,
              unsigned int const va,
              unsigned int const vb,
-             unsigned int const e,
-             unsigned int const u)
+             unsigned int const e)
         : id{ i },
           vao{ va },
           vbo{ vb },
-          ebo{ e },
-          ubo{ u }
+          ebo{ e }
       {
       }
       ~shader() = default;
@@ -33,7 +72,7 @@ namespace lvar {
       unsigned int vao;
       unsigned int vbo;
       unsigned int ebo;
-      unsigned int ubo;
+      uniform_table uniforms;
     };
   };
 };
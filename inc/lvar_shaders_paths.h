@@ -1,7 +1,12 @@
 #pragma once
 
+// relative to the repo root on the disk. the release builds (make colours-release) look the same paths up
+// in the shaders compiled into them, lvar_embed.h, and don't need to run from there
 #define SHADER_VERT_LIGHTING_COLOURS "./res/shaders/lighting_colour.vert"
 #define SHADER_FRAG_LIGHTING_COLOURS "./res/shaders/lighting_colour.frag"
 
 #define SHADER_VERT_LIGHT_CUBE "./res/shaders/light_cube.vert"
 #define SHADER_FRAG_LIGHT_CUBE "./res/shaders/light_cube.frag"
+
+#define SHADER_VERT_MESH "./res/shaders/mesh.vert"
+#define SHADER_FRAG_MESH "./res/shaders/mesh.frag"
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "lvar_obj.h"
+
+namespace lvar {
+  namespace obj {
+
+    unsigned int constexpr max_lods{ 8 };
+
+    // edge collapse simplification driven by quadric error metrics (Garland, Heckbert 1997). vertices
+    // only collapse onto other existing vertices, they're never moved, that's what allows every level
+    // to share the vertex buffer. border vertices are locked so open meshes don't shrink.
+    //
+    // returns how many indices the simplified mesh has, they're written in out when they fit (never more
+    // than indices.size()). when they don't, out isn't touched and it returns more than out.size(). it
+    // stops once it gets to target_index_count or when the next collapse would be worse than target_error.
+    std::size_t simplify(slice<unsigned int> const& indices,
+                         slice<vertex> const& vertices,
+                         std::size_t const target_index_count,
+                         float const target_error,
+                         slice<unsigned int> out,
+                         float* result_error,
+                         arena& scratch) noexcept;
+
+    // builds num_levels lods (including level 0), every level has ~reduction times the triangles of the
+    // previous one. it stops earlier if the mesh can't be simplified more. the chain is pushed in mem.
+    // every submesh is simplified on its own, so a level never mixes materials and the edges between
+    // two submeshes are borders that don't move.
+    bool build_lods(mesh const& m,
+                    lod_chain& chain,
+                    arena& mem,
+                    arena& scratch,
+                    unsigned int const num_levels = 4,
+                    float const reduction = 0.5f) noexcept;
+
+    // picks the coarsest level whose error, projected on the screen, is smaller than pixel_threshold.
+    // proj_scale is proj.get(1, 1) (cot of half the vertical fov), distance is from the camera to the
+    // mesh in the same units as the mesh (so take scaling into account)
+    unsigned int select_lod(lod_chain const& chain,
+                            float const distance,
+                            float const proj_scale,
+                            float const viewport_height,
+                            float const pixel_threshold = 1.0f) noexcept;
+
+  };
+};
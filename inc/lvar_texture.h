@@ -0,0 +1,85 @@
+#pragma once
+
+#include "lvar_arena.h"
+
+namespace lvar {
+  namespace tex {
+
+    // decoded pixels, 8 bits per channel, rows one after the other with no padding. the first row is the
+    // bottom one, which is what opengl wants
+    class image final {
+    public:
+      auto row_bytes() const noexcept { return static_cast<std::size_t>(width) * channels; }
+    public:
+      unsigned int width;
+      unsigned int height;
+      unsigned int channels;    // 1 to 4
+      slice<unsigned char> pixels;
+    };
+
+    // how the mips are filtered. box: the average of the 2x2 under every pixel, cheap and a bit blurry.
+    // kaiser: a windowed sinc 8 pixels wide, sharper mips with a little ringing on hard edges
+    enum class mip_filter : unsigned int {
+      box,
+      kaiser
+    };
+
+    // srgb: the rgb are averaged as the light they stand for and not as the numbers in the file, the mips
+    // of colour textures don't get darker than the texture. alpha never is. normal_map: the rgb (rg with 2
+    // channels) is a vector in [-1, 1] and it's unit length again after every level
+    class mip_settings final {
+    public:
+      mip_filter filter;
+      bool srgb;
+      bool normal_map;
+    };
+
+    // what the name and the channels say: "normal", "_n" or "_nrm" at the end of the name is a normal map,
+    // the rest of the rgb and rgba textures are colours and 1 and 2 channels are data. kaiser for all
+    mip_settings mip_settings_for(char const* path, unsigned int const channels) noexcept;
+
+    // all the levels of a texture down to 1x1, the biggest one first. the pixels of the levels are one
+    // after the other in data, that's the whole thing to upload or save
+    class mip_chain final {
+    public:
+      static unsigned int constexpr max_levels{ 16 };
+    public:
+      unsigned int num_levels;
+      image levels[max_levels];
+      slice<unsigned char> data;
+    };
+
+    // levels of a full chain, never more than max_levels
+    unsigned int num_mip_levels(unsigned int const width, unsigned int const height) noexcept;
+    // what generate_mips pushes into the arena for img, the size of an arena that's only for that
+    std::size_t mip_chain_bytes(image const& img) noexcept;
+    // level 0 is a copy of img, every other one is half the one before (never less than 1), filtered on
+    // all the cores
+    bool generate_mips(image const& img, mip_settings const& s, mip_chain& o, arena& mem) noexcept;
+
+    // cooked texture (.lvt), what lvar-cook writes for every png/jpg: a header and the pixels of all the
+    // levels as they're uploaded, so loading one is no decoding and no filtering, the jpg/png decoder and
+    // the mip generator never run in the game. version 1 files only have level 0
+    class texture_header final {
+    public:
+      static unsigned int constexpr lvt_magic{ 0x3154564c }; // "LVT1"
+      static unsigned int constexpr lvt_version{ 2 };
+    public:
+      unsigned int magic;
+      unsigned int version;
+      unsigned int width;
+      unsigned int height;
+      unsigned int channels;
+      unsigned int num_levels;
+    };
+
+    bool save_texture(char const* filepath, mip_chain const& mips) noexcept;
+    // level 0 only
+    bool save_texture(char const* filepath, image const& img) noexcept;
+    // the pixels point into data, nothing is copied (data can be an mmapped pack). false if it isn't a .lvt
+    bool read_texture(void const* data, std::size_t const sz, mip_chain& o) noexcept;
+    bool read_texture(void const* data, std::size_t const sz, image& o) noexcept;
+    bool is_texture(void const* data, std::size_t const sz) noexcept;
+
+  };
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "lvar_texture.h"
+#include "lvar_atlas.h"
+#include "lvar_jobs.h"
+
+namespace lvar {
+  namespace tex {
+
+    class texture_loader;
+
+    // one image, or a few of them in one texture: packed in an atlas, or the layers of an array
+    enum class texture_kind : unsigned int {
+      single,
+      atlas,
+      array
+    };
+
+    // an image decoded by a worker (a .lvt is only read), flipped for opengl, and all its mips. the pixels
+    // are gone after the main thread is done with it
+    class loaded_texture final {
+    public:
+      static unsigned int constexpr max_images{ 16 };
+    public:
+      explicit loaded_texture(std::size_t const capacity) noexcept
+        : mem{ capacity }
+      {
+      }
+      loaded_texture(loaded_texture const&) = delete;
+      loaded_texture& operator=(loaded_texture const&) = delete;
+      auto bytes() const noexcept { return mips.data.bytes(); }
+    public:
+      arena mem;                // the file and the mips
+      mip_chain mips;           // an array has all its layers in every level (stack_layers)
+      texture_kind kind;
+      unsigned int count;       // images, 1 unless it's an atlas or an array
+      char paths[max_images][256];
+      uv_rect rects[max_images]; // where the images of an atlas went
+      uv_rect* rects_out;       // the caller's, rects go there when it's done. the workers don't touch it
+      texture_loader* loader;
+      unsigned int id;
+      bool ok;
+      std::size_t uploaded;     // bytes of the pixels already handed out, only the main thread touches it
+    };
+
+    // same thing as obj::mesh_loader for textures: stb_image and generate_mips on the workers of a pool
+    // (the mips of a .lvt are cooked already), finished images in a lock-free queue, and drain() on the
+    // main thread hands out the pixels of all their levels in pieces, never more
+    // than a budget of bytes per frame. hundreds of textures at startup are hundreds of jobs, not hundreds
+    // of decodes before the first frame.
+    //
+    // no gl in here, texture_stream does the uploads. everything but the workers runs on the main thread.
+    class texture_loader final {
+    public:
+      static std::size_t constexpr max_in_flight{ 256 };
+    public:
+      explicit texture_loader(jobs::pool& p) noexcept
+        : workers{ p },
+          current{ nullptr },
+          pending{ 0 }
+      {
+      }
+      // waits for whatever the workers are still decoding
+      ~texture_loader();
+      texture_loader(texture_loader const&) = delete;
+      texture_loader& operator=(texture_loader const&) = delete;
+      // id is whatever you want to recognise the texture by when it comes out of drain. false if there are
+      // max_in_flight loads going on already or the pool is full, try again next frame
+      bool load(char const* path, unsigned int const id) noexcept;
+      // a few images in one texture (max_images): packed in an atlas (build_atlas) and rects_out[i] is where
+      // paths[i] went, or the layers of an array, paths[i] is layer i and they have to be the same size with
+      // the same channels
+      bool load_atlas(char const* const* paths, unsigned int const count, unsigned int const id, uv_rect* rects_out) noexcept;
+      bool load_array(char const* const* paths, unsigned int const count, unsigned int const id) noexcept;
+      // upload(loaded_texture&, begin, end) for the byte range [begin, end) of the pixels, done(loaded_texture&)
+      // when a texture is complete (or it failed, ok is false then and there's nothing to upload). returns
+      // the bytes handed out, <= budget
+      template<typename U, typename D>
+      std::size_t drain(std::size_t const budget, U const& upload, D const& done)
+      {
+        std::size_t spent{ 0 };
+        while(spent < budget) {
+          if(!current && !completed.pop(current)) {
+            break;
+          }
+          std::size_t const total{ current->ok ? current->bytes() : 0 };
+          std::size_t const n{ std::min(total - current->uploaded, budget - spent) };
+          if(n > 0) {
+            upload(*current, current->uploaded, current->uploaded + n);
+            current->uploaded += n;
+            spent += n;
+          }
+          if(current->uploaded == total) {
+            done(*current);
+            finish();
+          }
+        }
+        return spent;
+      }
+      auto in_flight() const noexcept { return pending; }
+    private:
+      bool submit(texture_kind const kind, char const* const* paths, unsigned int const count, unsigned int const id,
+                  uv_rect* rects_out) noexcept;
+      static void run(void* data) noexcept;
+      void finish() noexcept;
+    private:
+      jobs::pool& workers;
+      jobs::mpmc_queue<loaded_texture*, max_in_flight> completed;
+      loaded_texture* current;  // the one being uploaded, owned by the loader from the queue on
+      std::size_t pending;
+    };
+
+  };
+};
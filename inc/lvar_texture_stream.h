@@ -0,0 +1,41 @@
+#pragma once
+
+#include "lvar_texture_loader.h"
+
+namespace lvar {
+  namespace tex {
+
+    // the gl side of texture_loader. load() gives you a texture right away with a placeholder in it (a grey
+    // checkerboard) and that's what's drawn until the image arrives: the pixels of all its levels are copied
+    // into a pixel buffer object a budget of bytes per frame, and once they're all there a glTexImage2D per
+    // level from the pbo puts them in the same texture, so the id you got never changes and nobody has to
+    // know when it's done.
+    // the copy into the pbo is the part that costs cpu, the transfer from the pbo doesn't make the driver
+    // wait for anything.
+    class texture_stream final {
+    public:
+      explicit texture_stream(texture_loader& l) noexcept;
+      ~texture_stream() noexcept;
+      texture_stream(texture_stream const&) = delete;
+      texture_stream& operator=(texture_stream const&) = delete;
+      // the texture is yours, delete it when you're done. 0 if the loader can't take it now
+      unsigned int load(char const* path) noexcept;
+      // a few textures in one, to draw things with different textures without binding another one. an
+      // atlas is a GL_TEXTURE_2D and rects[i] is where paths[i] is in it ({ 0, 0, 1, 1 } until it's there,
+      // rects has to live until then): the uvs are remapped with it, and they can't repeat. an array is a
+      // GL_TEXTURE_2D_ARRAY and paths[i] is layer i, the same size and channels for all of them
+      unsigned int load_atlas(char const* const* paths, unsigned int const count, uv_rect* rects) noexcept;
+      unsigned int load_array(char const* const* paths, unsigned int const count) noexcept;
+      // once per frame, returns the bytes copied
+      std::size_t update(std::size_t const budget = 4 * 1024 * 1024) noexcept;
+      auto in_flight() const noexcept { return loader.in_flight(); }
+    private:
+      // a new texture with the placeholder in it
+      static unsigned int placeholder(unsigned int const target) noexcept;
+    private:
+      texture_loader& loader;
+      unsigned int pbo;
+    };
+
+  };
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+namespace lvar {
+  namespace files {
+
+    // inotify on a few directories. a thread of its own sleeps in poll() until a file in one of them is
+    // written (closed after writing) or renamed into it, which is what editors do when they save, and
+    // calls fx(path, data) there with "directory/name". nothing runs on the caller's thread, whatever fx
+    // does has to be thread safe. not recursive.
+    class watcher final {
+    public:
+      using callback = void (*)(char const* path, void* data);
+      static unsigned int constexpr max_directories{ 16 };
+    public:
+      watcher(char const* const* directories, unsigned int const count, callback const fx, void* const data) noexcept;
+      // wakes the thread up and waits for it
+      ~watcher() noexcept;
+      watcher(watcher const&) = delete;
+      watcher& operator=(watcher const&) = delete;
+    public:
+      auto error() const noexcept { return err; }
+    private:
+      void run() noexcept;
+    private:
+      class directory final {
+      public:
+        int wd;
+        char path[256];
+      };
+    private:
+      directory dirs[max_directories];
+      unsigned int num_dirs;
+      callback fx;
+      void* data;
+      int fd;                   // inotify
+      int wake;                 // eventfd, written to stop the thread
+      std::thread thread;
+      bool err;
+    };
+
+  };
+};
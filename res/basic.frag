@@ -4,10 +4,13 @@ in vec2 tex_coords;
 
 out vec4 FragColour;
 
-uniform sampler2D image1;
-uniform sampler2D image2;
+uniform sampler2D atlas;
+// where the two images are in the atlas, xy the corner and zw the size
+uniform vec4 rect1;
+uniform vec4 rect2;
 
 void main()
 {
-  FragColour = mix(texture(image1, tex_coords), texture(image2, tex_coords), 0.2);
+  vec2 uv = clamp(tex_coords, 0.0, 1.0);
+  FragColour = mix(texture(atlas, rect1.xy + uv * rect1.zw), texture(atlas, rect2.xy + uv * rect2.zw), 0.2);
 }
@@ -7,7 +7,10 @@ layout(std140) uniform matrices {
   mat4 view;
 };
 
-uniform mat4 model;
+layout(std140) uniform object {
+  mat4 model;
+  mat4 model_trans;
+};
 
 void main()
 {
@@ -11,8 +11,10 @@ layout(std140) uniform matrices {
   mat4 view;
 };
 
-uniform mat4 model;
-uniform mat4 model_trans;
+layout(std140) uniform object {
+  mat4 model;
+  mat4 model_trans;
+};
 
 void main()
 {
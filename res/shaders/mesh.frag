@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec3 normal;
+in vec3 frag_world_pos;
+in vec2 uv;
+
+out vec4 colour_frag;
+
+uniform sampler2D diffuse_map; // the atlas of the mesh, or a plain texture
+uniform vec3 colour_light;
+uniform vec3 light_pos;
+
+const float ambient_strength = 0.1f;
+
+void main()
+{
+  vec3 light_dir_normalised = normalize(light_pos - frag_world_pos);
+  float diff_factor = max(dot(normalize(normal), light_dir_normalised), 0.0f);
+  vec3 light = (ambient_strength + diff_factor) * colour_light;
+  colour_frag = vec4(light * texture(diffuse_map, uv).rgb, 1.0);
+}
@@ -0,0 +1,39 @@
+#version 330 core
+
+out vec3 normal;
+out vec3 frag_world_pos;
+out vec2 uv;
+
+// what obj::encode writes with the default options: positions as unorm16 in the aabb of the mesh,
+// octahedral normals as snorm16 and half float uvs
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec2 norm_oct;
+layout(location = 2) in vec2 tex_coords;
+
+layout(std140) uniform matrices {
+  mat4 projection;
+  mat4 view;
+};
+
+layout(std140) uniform object {
+  mat4 model;        // times the dequantise() of the mesh
+  mat4 model_trans;  // without it
+  vec4 uv_rect;      // u, v, width and height of the material's map in the atlas
+};
+
+vec3 oct_decode(vec2 e)
+{
+  vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+  return normalize(n);
+}
+
+void main()
+{
+  vec4 world = model * vec4(pos, 1.0);
+  gl_Position = projection * view * world;
+  normal = mat3(model_trans) * oct_decode(norm_oct);
+  frag_world_pos = vec3(world);
+  uv = uv_rect.xy + tex_coords * uv_rect.zw;
+}
@@ -9,7 +9,20 @@
 
 // one trans unit
 #include "../../lvar_camera.cpp"
+#include "../../lvar_shader.cpp"
 #include "../../lvar_resource.cpp"
+#include "../../lvar_watcher.cpp"
+#include "../../lvar_pack.cpp"
+#include "../../lvar_texture.cpp"
+#include "../../lvar_bc.cpp"
+#include "../../lvar_atlas.cpp"
+#include "../../lvar_obj.cpp"
+#include "../../lvar_mesh_opt.cpp"
+#include "../../lvar_normals.cpp"
+#include "../../lvar_encode.cpp"
+#include "../../lvar_simplify.cpp"
+#include "../../lvar_meshlet.cpp"
+#include "../../lvar_mesh_loader.cpp"
 
 #include <X11/Xatom.h>
 
@@ -17,6 +30,47 @@ using namespace lvar;
 
 v3 const light_pos{ 1.2f, 1.0f, 2.0f };
 
+// the uniform block "object" of the shaders
+class alignas(16) object_uniforms final {
+public:
+  m4 model;
+  m4 model_trans;
+};
+
+// and the one of the mesh shader, a draw per submesh
+class alignas(16) mesh_uniforms final {
+public:
+  m4 model;
+  m4 model_trans;
+  tex::uv_rect rect;            // of the material's map in the atlas of the mesh
+};
+
+// a mesh of the demo, what make lvar-cook writes (the .obj is never parsed here). it's loaded by a worker
+// and goes up a bit every frame, it's drawn once it's all there: only its meshlets that can be seen, a draw
+// per run of them in the same submesh
+class demo_mesh final {
+public:
+  // a submesh, with the layer of its material's map in the atlas (or no_layer, the plain texture then)
+  class part final {
+  public:
+    unsigned int layer;
+    std::size_t uniforms;       // offset in the uniform stream, this frame
+    bool pushed;                // false if the stream was full, it isn't drawn then
+  };
+public:
+  char const* path;
+  v3 pos;
+  float size;
+  m4 model;                     // pos and size, the mesh's dequantise goes before it once it's loaded
+  mesh_uniforms uniforms;
+  resource::mesh_buffers buffers; // while it's uploaded
+  handle<resource::resident_mesh> mesh;
+  handle<resource::texture> atlas;
+  std::vector<part> parts;      // one per submesh
+  std::vector<obj::meshlet> meshlets;
+  std::vector<obj::draw_range> draws; // this frame
+};
+
 float constexpr window_width { 2560.f };
 float constexpr window_height{ 1440.f };
 
@@ -191,15 +245,28 @@ int main()
   input::manager input_manager;
   // camera
   camera cam(v3{ 0.0f, 0.0f, 0.0f }, input_manager);
+  // assets.lvp is what make pack writes, the loose files (make lvar-cook) are used when it isn't there
+  pack::reader assets;
+  bool const packed{ assets.open("./assets.lvp") };
   // resource manager
-  resource::manager resource_manager;
+  resource::manager resource_manager(packed ? &assets : nullptr);
   if(resource_manager.error()) {
     std::cerr << "Failed to create resource manager\n";
     return EXIT_FAILURE;
   }
+  // edit res/shaders/* while it runs
+  resource_manager.enable_hot_reload();
   // get shader handles
-  auto const* shader_cube_light = resource_manager.get_shader(SHADER_VERT_LIGHT_CUBE);
-  auto const* shader_cube_object = resource_manager.get_shader(SHADER_VERT_LIGHTING_COLOURS);
+  auto const handle_cube_light = resource_manager.find_shader(SHADER_VERT_LIGHT_CUBE);
+  auto const handle_cube_object = resource_manager.find_shader(SHADER_VERT_LIGHTING_COLOURS);
+  auto const handle_mesh = resource_manager.find_shader(SHADER_VERT_MESH);
+  auto const* shader_cube_light = resource_manager.get_shader(handle_cube_light);
+  auto const* shader_cube_object = resource_manager.get_shader(handle_cube_object);
+  auto const* shader_mesh = resource_manager.get_shader(handle_mesh);
+  if(!shader_cube_light || !shader_cube_object || !shader_mesh) {
+    std::cerr << "Failed to find the shaders\n";
+    return EXIT_FAILURE;
+  }
   // opengl stuff
   glEnable(GL_BLEND);
   glEnable(GL_DEPTH_TEST);
@@ -219,18 +286,46 @@ int main()
   m4 light_model{ identity( )};
   translate(light_model, light_pos);
   m4 light_model_trans{ transpose(inverse_transform_noscale(light_model)) };
-  resource_manager.use_shader(shader_cube_light->id);
-  resource_manager.set_uni_mat4(shader_cube_light->id, "model", light_model);
+  // per draw, through the uniform stream
+  object_uniforms const cube_object{ .model = identity(), .model_trans = light_model_trans };
+  object_uniforms const cube_light{ .model = light_model, .model_trans = identity() };
+  resource::uniform_stream stream(64 * 1024);
+  if(stream.error()) {
+    std::cerr << "Failed to create uniform stream\n";
+    return EXIT_FAILURE;
+  }
+  // logged when it fills up, not every frame it stays full
+  bool stream_full{ false };
   resource_manager.use_shader(shader_cube_object->id);
-  resource_manager.set_uni_mat4(shader_cube_object->id, "model", identity());
-  resource_manager.set_uni_vec3(shader_cube_object->id, "colour_object", colour_coral);
-  resource_manager.set_uni_vec3(shader_cube_object->id, "colour_light", colour_light);
-  resource_manager.set_uni_vec3(shader_cube_object->id, "light_pos", light_pos);
-  resource_manager.set_uni_mat4(shader_cube_object->id, "model_trans", light_model_trans);
+  resource_manager.set_uni_vec3(*shader_cube_object, "colour_object"_id, colour_coral);
+  resource_manager.set_uni_vec3(*shader_cube_object, "colour_light"_id, colour_light);
+  resource_manager.set_uni_vec3(*shader_cube_object, "light_pos"_id, light_pos);
+  resource_manager.use_shader(shader_mesh->id);
+  resource_manager.set_uni_vec3(*shader_mesh, "colour_light"_id, colour_light);
+  resource_manager.set_uni_vec3(*shader_mesh, "light_pos"_id, light_pos);
+  // the manager keeps the meshes (add_mesh) and their textures, which are only loaded the first time
+  // they're drawn: the atlas of the maps of a mesh's materials, and a plain one for what has no map
+  demo_mesh meshes[]{
+    { .path = "./cooked/res/crate.lvm", .pos = { -1.5f, 0.0f, 0.0f }, .size = 1.0f },
+    { .path = "./cooked/res/MIT_teapot.lvm", .pos = { 1.5f, -1.0f, -2.0f }, .size = 0.3f },
+  };
+  jobs::pool workers(2);
+  obj::mesh_loader mesh_loader(workers);
+  for(unsigned int i{ 0 }; i < std::size(meshes); ++i) {
+    meshes[i].model = identity();
+    scale(meshes[i].model, v3{ meshes[i].size, meshes[i].size, meshes[i].size });
+    translate(meshes[i].model, meshes[i].pos);
+    meshes[i].uniforms.model_trans = transpose(inverse_transform_noscale(meshes[i].model));
+    if(!mesh_loader.load(meshes[i].path, i)) {
+      std::cerr << "Failed to load " << meshes[i].path << '\n';
+    }
+  }
+  handle<resource::texture> const plain_texture{ resource_manager.acquire_texture("./cooked/res/Cobblestone.lvt") };
   float lastframe{ 0.0f };
   bool quit{ false };
   while(!quit) {
     input_manager.begin_frame_kb();
+    resource_manager.reload_shaders();
     float currframe{ time() };
     float delta{ currframe - lastframe };
     lastframe = currframe;
@@ -298,17 +393,105 @@ int main()
     // -------------------------------------------------------------------------------------------------------
     // start render code
     // -------------------------------------------------------------------------------------------------------
-    resource_manager.use_shader(shader_cube_object->id);
-    glBindVertexArray(shader_cube_object->vao);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    resource_manager.use_shader(shader_cube_light->id);
-    glBindVertexArray(shader_cube_light->vao);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    mesh_loader.drain(256 * 1024,
+      [&meshes](obj::loaded_mesh& lm, std::size_t const begin, std::size_t const end) {
+        resource::upload_mesh_range(meshes[lm.id].buffers, lm.gpu, begin, end);
+      },
+      [&](obj::loaded_mesh& lm) {
+        if(!lm.ok) {
+          std::cerr << "Failed to load " << lm.path << '\n';
+          return;
+        }
+        demo_mesh& dm{ meshes[lm.id] };
+        dm.mesh = resource_manager.add_mesh(lm.path, dm.buffers, lm.gpu_bytes());
+        // the positions are in the aabb of the mesh
+        dm.uniforms.model = mul(lm.gpu.dequantise(), dm.model);
+        // it sets the layers of the materials, the mesh is gone after this so the parts keep them
+        dm.atlas = resource_manager.acquire_material_atlas(lm.m.materials);
+        for(obj::submesh const& sm : lm.m.submeshes) {
+          unsigned int const layer{ sm.material != obj::no_material && dm.atlas.valid() ?
+                                    lm.m.materials[sm.material].diffuse_layer : obj::no_layer };
+          dm.parts.push_back({ layer, 0, false });
+        }
+        if(dm.parts.empty()) {
+          dm.parts.push_back({ obj::no_layer, 0, false });
+        }
+        dm.meshlets.assign(lm.meshlets.begin(), lm.meshlets.end());
+        dm.draws.resize(dm.meshlets.size());
+      });
+    stream.begin_frame();
+    std::size_t offset_object{ 0 }, offset_light{ 0 };
+    bool const pushed_object{ stream.push(&cube_object, sizeof(cube_object), offset_object) };
+    bool const pushed_light{ stream.push(&cube_light, sizeof(cube_light), offset_light) };
+    bool full{ !pushed_object || !pushed_light };
+    for(demo_mesh& dm : meshes) {
+      for(demo_mesh::part& p : dm.parts) {
+        // the rects are only there once the atlas is, the first time it's used
+        dm.uniforms.rect = p.layer != obj::no_layer ? resource_manager.atlas_rect(dm.atlas, p.layer)
+                                                    : tex::uv_rect{ 0.0f, 0.0f, 1.0f, 1.0f };
+        p.pushed = stream.push(&dm.uniforms, sizeof(dm.uniforms), p.uniforms);
+        full = full || !p.pushed;
+      }
+    }
+    stream.flush();
+    if(full && !stream_full) {
+      std::cerr << "Uniform stream is full, some draws are skipped\n";
+    }
+    stream_full = full;
+    // pointers to resources are only good until something is added or removed, handles always are
+    shader_cube_object = resource_manager.get_shader(handle_cube_object);
+    shader_cube_light = resource_manager.get_shader(handle_cube_light);
+    if(pushed_object) {
+      resource_manager.use_shader(shader_cube_object->id);
+      stream.bind(resource::object_ubo_binding, offset_object, sizeof(object_uniforms));
+      glBindVertexArray(shader_cube_object->vao);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    if(pushed_light) {
+      resource_manager.use_shader(shader_cube_light->id);
+      stream.bind(resource::object_ubo_binding, offset_light, sizeof(object_uniforms));
+      glBindVertexArray(shader_cube_light->vao);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+    shader_mesh = resource_manager.get_shader(handle_mesh);
+    resource_manager.use_shader(shader_mesh->id);
+    for(demo_mesh& dm : meshes) {
+      // invalid handle until it's loaded, nullptr until then
+      resource::mesh_buffers const* const b{ resource_manager.use_mesh(dm.mesh) };
+      if(!b) {
+        continue;
+      }
+      // the meshlets are in the units of the mesh, so are the frustum and the camera
+      frustum const f{ extract_frustum(mul(mul(dm.model, ubo_data.view), ubo_data.proj)) };
+      v3 const eye{ scale(sub(cam.get_pos(), dm.pos), 1.0f / dm.size) };
+      std::size_t const num_draws{ obj::cull_meshlets(slice<obj::meshlet>{ dm.meshlets.data(), dm.meshlets.size() }, f, eye,
+                                                      dm.draws.data()) };
+      unsigned int const atlas{ resource_manager.use_texture(dm.atlas) };
+      std::size_t const index_size{ b->index_type == GL_UNSIGNED_SHORT ? 2u : 4u };
+      glBindVertexArray(b->vao);
+      for(std::size_t i{ 0 }; i < num_draws; ++i) {
+        obj::draw_range const& d{ dm.draws[i] };
+        demo_mesh::part const& p{ dm.parts[d.submesh] };
+        if(!p.pushed) {
+          continue;
+        }
+        glBindTexture(GL_TEXTURE_2D, p.layer != obj::no_layer ? atlas : resource_manager.use_texture(plain_texture));
+        stream.bind(resource::object_ubo_binding, p.uniforms, sizeof(mesh_uniforms));
+        glDrawElements(GL_TRIANGLES, d.index_count, b->index_type, reinterpret_cast<void*>(d.index_offset * index_size));
+      }
+    }
+    stream.end_frame();
     // end render code
     XGetWindowAttributes(display, window, &gwa);
     glXSwapBuffers(display, window);
+    resource_manager.end_frame();
   }
   // cleanup!
+  for(demo_mesh const& dm : meshes) {
+    resource_manager.release_mesh(dm.mesh);
+    resource_manager.release_texture(dm.atlas);
+  }
+  resource_manager.release_texture(plain_texture);
   XUngrabPointer(display, CurrentTime);
   glXMakeCurrent(display, None, nullptr);
   glXDestroyContext(display, glContext);
@@ -0,0 +1,234 @@
+#include "lvar_atlas.h"
+
+#include <algorithm>
+#include <cstring>              // memcpy, memset
+#include <iostream>
+
+namespace lvar {
+  namespace tex {
+
+    skyline_packer::skyline_packer(unsigned int const w, unsigned int const h) noexcept
+      : num_segments{ 1 },
+        width{ w },
+        height{ h },
+        used{ 0 }
+    {
+      segments[0] = segment{ 0, 0, w };
+    }
+
+    bool skyline_packer::fits(unsigned int const i, unsigned int const w, unsigned int const h, unsigned int& y) const noexcept
+    {
+      if(segments[i].x + w > width) {
+        return false;
+      }
+      // it sits on the highest of the segments under it. they go all the way to the right, so there are
+      // enough of them
+      y = 0;
+      unsigned int left{ w };
+      for(unsigned int j{ i }; left > 0; ++j) {
+        y = std::max(y, segments[j].y);
+        if(y + h > height) {
+          return false;
+        }
+        left -= std::min(left, segments[j].width);
+      }
+      return true;
+    }
+
+    bool skyline_packer::insert(unsigned int const w, unsigned int const h, unsigned int& x, unsigned int& y) noexcept
+    {
+      if(w == 0 || h == 0 || num_segments == max_segments) {
+        return false;
+      }
+      // the lowest top, and the narrowest segment when it's a tie: less space under overhangs
+      unsigned int best{ num_segments };
+      unsigned int best_y{ 0 };
+      unsigned int best_top{ ~0u };
+      for(unsigned int i{ 0 }; i < num_segments; ++i) {
+        unsigned int sy;
+        if(fits(i, w, h, sy) && (sy + h < best_top || (sy + h == best_top && segments[i].width < segments[best].width))) {
+          best = i;
+          best_y = sy;
+          best_top = sy + h;
+        }
+      }
+      if(best == num_segments) {
+        return false;
+      }
+      x = segments[best].x;
+      y = best_y;
+      // the new segment on top of it, and what's under it goes away (or gets shorter)
+      std::copy_backward(segments + best, segments + num_segments, segments + num_segments + 1);
+      ++num_segments;
+      segments[best] = segment{ x, best_top, w };
+      unsigned int const right{ x + w };
+      for(unsigned int j{ best + 1 }; j < num_segments && segments[j].x < right;) {
+        unsigned int const covered{ right - segments[j].x };
+        if(segments[j].width > covered) {
+          segments[j].x += covered;
+          segments[j].width -= covered;
+          break;
+        }
+        std::copy(segments + j + 1, segments + num_segments, segments + j);
+        --num_segments;
+      }
+      // neighbours at the same height are one segment
+      for(unsigned int j{ 0 }; j + 1 < num_segments;) {
+        if(segments[j].y == segments[j + 1].y) {
+          segments[j].width += segments[j + 1].width;
+          std::copy(segments + j + 2, segments + num_segments, segments + j + 1);
+          --num_segments;
+        } else {
+          ++j;
+        }
+      }
+      used += static_cast<std::size_t>(w) * h;
+      return true;
+    }
+
+    namespace {
+
+      // a pixel of src in a pixel with more (or the same) channels
+      void convert_pixel(unsigned char const* src, unsigned int const src_channels, unsigned char* dst, unsigned int const channels) noexcept
+      {
+        for(unsigned int c{ 0 }; c < channels; ++c) {
+          dst[c] = c < src_channels ? src[c] : src_channels == 1 && c < 3 ? src[0] : c == 3 ? 255 : 0;
+        }
+      }
+
+      // img at x, y of atlas with its edges repeated padding pixels out
+      void copy_padded(image const& img, unsigned int const padding, image const& atlas, unsigned int const x, unsigned int const y) noexcept
+      {
+        unsigned int const ch{ atlas.channels };
+        for(unsigned int r{ 0 }; r < img.height + padding * 2; ++r) {
+          unsigned int const sy{ std::min(r > padding ? r - padding : 0, img.height - 1) };
+          unsigned char const* const src{ img.pixels.data() + static_cast<std::size_t>(sy) * img.row_bytes() };
+          unsigned char* const dst{ atlas.pixels.data() + static_cast<std::size_t>(y + r) * atlas.row_bytes() + static_cast<std::size_t>(x) * ch };
+          if(img.channels == ch) {
+            std::memcpy(dst + static_cast<std::size_t>(padding) * ch, src, img.row_bytes());
+          } else {
+            for(unsigned int c{ 0 }; c < img.width; ++c) {
+              convert_pixel(src + static_cast<std::size_t>(c) * img.channels, img.channels, dst + static_cast<std::size_t>(padding + c) * ch, ch);
+            }
+          }
+          for(unsigned int c{ 0 }; c < padding; ++c) {
+            convert_pixel(src, img.channels, dst + static_cast<std::size_t>(c) * ch, ch);
+            convert_pixel(src + static_cast<std::size_t>(img.width - 1) * img.channels, img.channels,
+                          dst + static_cast<std::size_t>(padding + img.width + c) * ch, ch);
+          }
+        }
+      }
+
+    };
+
+    bool build_atlas(image const* images, unsigned int const count, unsigned int const max_size, unsigned int const padding,
+                     image& o, uv_rect* rects, arena& mem) noexcept
+    {
+      if(count == 0) {
+        return false;
+      }
+      unsigned int channels{ 1 };
+      unsigned int widest{ 0 };
+      unsigned int tallest{ 0 };
+      std::size_t area{ 0 };
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        channels = std::max(channels, images[i].channels);
+        widest = std::max(widest, images[i].width + padding * 2);
+        tallest = std::max(tallest, images[i].height + padding * 2);
+        area += static_cast<std::size_t>(images[i].width + padding * 2) * (images[i].height + padding * 2);
+      }
+      slice<unsigned int> order{ mem.push_array<unsigned int>(count) };
+      slice<unsigned int> xs{ mem.push_array<unsigned int>(count) };
+      slice<unsigned int> ys{ mem.push_array<unsigned int>(count) };
+      if(order.empty() || xs.empty() || ys.empty()) {
+        std::cerr << __FUNCTION__ << ": out of memory\n";
+        return false;
+      }
+      // the tallest first, the skyline stays flat
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        order[i] = i;
+      }
+      std::sort(order.begin(), order.end(), [images](unsigned int const a, unsigned int const b) {
+        return images[a].height > images[b].height || (images[a].height == images[b].height && images[a].width > images[b].width);
+      });
+      // the smallest power of two sides that could hold them, and bigger until they fit
+      unsigned int w{ 1 };
+      unsigned int h{ 1 };
+      while(w < widest) {
+        w *= 2;
+      }
+      while(h < tallest) {
+        h *= 2;
+      }
+      while(static_cast<std::size_t>(w) * h < area) {
+        (w <= h ? w : h) *= 2;
+      }
+      for(;;) {
+        if(w > max_size || h > max_size) {
+          std::cerr << __FUNCTION__ << ": " << count << " images don't fit in " << max_size << 'x' << max_size << '\n';
+          return false;
+        }
+        skyline_packer packer(w, h);
+        bool fit{ true };
+        for(unsigned int k{ 0 }; k < count && fit; ++k) {
+          image const& img{ images[order[k]] };
+          fit = packer.insert(img.width + padding * 2, img.height + padding * 2, xs[order[k]], ys[order[k]]);
+        }
+        if(fit) {
+          break;
+        }
+        (w <= h ? w : h) *= 2;
+      }
+      slice<unsigned char> const pixels{ mem.push_array<unsigned char>(static_cast<std::size_t>(w) * h * channels) };
+      if(pixels.empty()) {
+        std::cerr << __FUNCTION__ << ": out of memory\n";
+        return false;
+      }
+      // what's between them, the arena could have anything there
+      std::memset(pixels.data(), 0, pixels.bytes());
+      o = image{ w, h, channels, pixels };
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        copy_padded(images[i], padding, o, xs[i], ys[i]);
+        rects[i] = uv_rect{ static_cast<float>(xs[i] + padding) / static_cast<float>(w), static_cast<float>(ys[i] + padding) / static_cast<float>(h),
+                            static_cast<float>(images[i].width) / static_cast<float>(w), static_cast<float>(images[i].height) / static_cast<float>(h) };
+      }
+      return true;
+    }
+
+    bool stack_layers(mip_chain const* layers, unsigned int const count, mip_chain& o, arena& mem) noexcept
+    {
+      if(count == 0) {
+        return false;
+      }
+      image const& first{ layers[0].levels[0] };
+      for(unsigned int i{ 1 }; i < count; ++i) {
+        image const& top{ layers[i].levels[0] };
+        if(top.width != first.width || top.height != first.height || top.channels != first.channels ||
+           layers[i].num_levels != layers[0].num_levels) {
+          std::cerr << __FUNCTION__ << ": layer " << i << " is " << top.width << 'x' << top.height << 'x' << top.channels
+                    << " and layer 0 " << first.width << 'x' << first.height << 'x' << first.channels << '\n';
+          return false;
+        }
+      }
+      slice<unsigned char> const pixels{ mem.push_array<unsigned char>(layers[0].data.bytes() * count) };
+      if(pixels.empty()) {
+        std::cerr << __FUNCTION__ << ": out of memory\n";
+        return false;
+      }
+      std::size_t offset{ 0 };
+      for(unsigned int l{ 0 }; l < layers[0].num_levels; ++l) {
+        image const& level{ layers[0].levels[l] };
+        std::size_t const bytes{ level.pixels.bytes() };
+        o.levels[l] = image{ level.width, level.height * count, level.channels, { pixels.data() + offset, bytes * count } };
+        for(unsigned int i{ 0 }; i < count; ++i) {
+          std::memcpy(pixels.data() + offset + bytes * i, layers[i].levels[l].pixels.data(), bytes);
+        }
+        offset += bytes * count;
+      }
+      o.num_levels = layers[0].num_levels;
+      o.data = pixels;
+      return true;
+    }
+
+  };
+};
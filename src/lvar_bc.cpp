@@ -0,0 +1,572 @@
+#include "lvar_bc.h"
+#include "lvar_jobs.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>              // memcpy, strerror
+#include <iostream>
+#include <immintrin.h>          // SSE 4.2
+#include <fcntl.h>              // open
+#include <sys/stat.h>           // fstat
+#include <unistd.h>             // pread, pwrite, close
+
+namespace lvar {
+  namespace tex {
+
+    namespace {
+
+      unsigned short to_565(int const r, int const g, int const b) noexcept
+      {
+        return static_cast<unsigned short>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+      }
+
+      void from_565(unsigned short const c, unsigned char* rgba) noexcept
+      {
+        unsigned int const r{ (c >> 11) & 31u };
+        unsigned int const g{ (c >> 5) & 63u };
+        unsigned int const b{ c & 31u };
+        rgba[0] = static_cast<unsigned char>((r << 3) | (r >> 2));
+        rgba[1] = static_cast<unsigned char>((g << 2) | (g >> 4));
+        rgba[2] = static_cast<unsigned char>((b << 3) | (b >> 2));
+        rgba[3] = 255;
+      }
+
+      // the 4 colours of a bc1 block in 4 colour mode (c0 > c1), alpha is 0 so it doesn't count in the distances
+      void bc1_palette(unsigned short const c0, unsigned short const c1, unsigned char palette[4][4]) noexcept
+      {
+        from_565(c0, palette[0]);
+        from_565(c1, palette[1]);
+        for(unsigned int c{ 0 }; c < 3; ++c) {
+          palette[2][c] = static_cast<unsigned char>((2 * palette[0][c] + palette[1][c]) / 3);
+          palette[3][c] = static_cast<unsigned char>((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        for(unsigned int k{ 0 }; k < 4; ++k) {
+          palette[k][3] = 0;
+        }
+      }
+
+      // the block with alpha cleared, 4 pixels per register
+      void load_block(unsigned char const* rgba, __m128i px[4]) noexcept
+      {
+        __m128i const rgb_mask{ _mm_set1_epi32(0x00ffffff) };
+        for(unsigned int i{ 0 }; i < 4; ++i) {
+          px[i] = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(rgba + i * 16)), rgb_mask);
+        }
+      }
+
+      // the nearest colour of the palette for every pixel, 4 pixels at a time: squared distances with
+      // madd on 16 bit lanes and a running min. returns the 32 bits of indices, error is the sum of the
+      // squared distances
+      unsigned int match_palette(__m128i const px[4], unsigned char const palette[4][4], unsigned int& error) noexcept
+      {
+        __m128i pal[4];
+        for(unsigned int k{ 0 }; k < 4; ++k) {
+          int c;
+          std::memcpy(&c, palette[k], sizeof(c));
+          pal[k] = _mm_cvtepu8_epi16(_mm_set1_epi32(c));
+        }
+        unsigned int indices{ 0 };
+        __m128i total{ _mm_setzero_si128() };
+        for(unsigned int i{ 0 }; i < 4; ++i) {
+          __m128i const lo{ _mm_cvtepu8_epi16(px[i]) };
+          __m128i const hi{ _mm_cvtepu8_epi16(_mm_srli_si128(px[i], 8)) };
+          __m128i best{ _mm_set1_epi32(0x7fffffff) };
+          __m128i best_index{ _mm_setzero_si128() };
+          for(unsigned int k{ 0 }; k < 4; ++k) {
+            __m128i const dl{ _mm_sub_epi16(lo, pal[k]) };
+            __m128i const dh{ _mm_sub_epi16(hi, pal[k]) };
+            __m128i const d{ _mm_hadd_epi32(_mm_madd_epi16(dl, dl), _mm_madd_epi16(dh, dh)) };
+            __m128i const closer{ _mm_cmplt_epi32(d, best) };
+            best = _mm_min_epi32(best, d);
+            best_index = _mm_blendv_epi8(best_index, _mm_set1_epi32(static_cast<int>(k)), closer);
+          }
+          total = _mm_add_epi32(total, best);
+          // 4 indices of 2 bits, pixel 0 in the lowest bits
+          alignas(16) unsigned int idx[4];
+          _mm_store_si128(reinterpret_cast<__m128i*>(idx), best_index);
+          indices |= (idx[0] | idx[1] << 2 | idx[2] << 4 | idx[3] << 6) << (i * 8);
+        }
+        total = _mm_add_epi32(total, _mm_srli_si128(total, 8));
+        total = _mm_add_epi32(total, _mm_srli_si128(total, 4));
+        error = static_cast<unsigned int>(_mm_cvtsi128_si32(total));
+        return indices;
+      }
+
+      void write_bc1(unsigned short const c0, unsigned short const c1, unsigned int const indices, unsigned char* out) noexcept
+      {
+        std::memcpy(out, &c0, 2);
+        std::memcpy(out + 2, &c1, 2);
+        std::memcpy(out + 4, &indices, 4);
+      }
+
+      // encodes with these endpoints, error is what it costs. c0 == c1 is a solid block
+      unsigned int try_endpoints(__m128i const px[4], unsigned short c0, unsigned short c1, unsigned char* out) noexcept
+      {
+        if(c0 < c1) {
+          std::swap(c0, c1);
+        }
+        unsigned char palette[4][4];
+        bc1_palette(c0, c1, palette);
+        if(c0 == c1) {
+          // 3 colour mode, index 0 is c0 anyway
+          std::memcpy(palette[1], palette[0], 4);
+          std::memcpy(palette[2], palette[0], 4);
+          std::memcpy(palette[3], palette[0], 4);
+        }
+        unsigned int error;
+        unsigned int const indices{ match_palette(px, palette, error) };
+        write_bc1(c0, c1, c0 == c1 ? 0 : indices, out);
+        return error;
+      }
+
+      // least squares endpoints for the indices that were chosen (stb_dxt's refine): every pixel is
+      // a * c0 + b * c1 with a, b from its index, solved per channel
+      bool refit(unsigned char const* rgba, unsigned int const indices, unsigned short& c0, unsigned short& c1) noexcept
+      {
+        float constexpr weights[4]{ 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        float aa{ 0.0f }, bb{ 0.0f }, ab{ 0.0f };
+        float ax[3]{}, bx[3]{};
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          float const a{ weights[(indices >> (i * 2)) & 3] };
+          float const b{ 1.0f - a };
+          aa += a * a;
+          bb += b * b;
+          ab += a * b;
+          for(unsigned int c{ 0 }; c < 3; ++c) {
+            ax[c] += a * rgba[i * 4 + c];
+            bx[c] += b * rgba[i * 4 + c];
+          }
+        }
+        float const det{ aa * bb - ab * ab };
+        if(std::fabs(det) < 1e-6f) {
+          return false;
+        }
+        int e0[3], e1[3];
+        for(unsigned int c{ 0 }; c < 3; ++c) {
+          e0[c] = std::clamp(static_cast<int>(std::lround((bb * ax[c] - ab * bx[c]) / det)), 0, 255);
+          e1[c] = std::clamp(static_cast<int>(std::lround((aa * bx[c] - ab * ax[c]) / det)), 0, 255);
+        }
+        c0 = to_565(e0[0], e0[1], e0[2]);
+        c1 = to_565(e1[0], e1[1], e1[2]);
+        return true;
+      }
+
+      // bounding box of the colours, min and max per channel over the 16 pixels
+      void block_bounds(__m128i const px[4], unsigned char lo[4], unsigned char hi[4]) noexcept
+      {
+        __m128i mn{ _mm_min_epu8(_mm_min_epu8(px[0], px[1]), _mm_min_epu8(px[2], px[3])) };
+        __m128i mx{ _mm_max_epu8(_mm_max_epu8(px[0], px[1]), _mm_max_epu8(px[2], px[3])) };
+        mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 8));
+        mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 8));
+        mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+        mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+        int const l{ _mm_cvtsi128_si32(mn) };
+        int const h{ _mm_cvtsi128_si32(mx) };
+        std::memcpy(lo, &l, 4);
+        std::memcpy(hi, &h, 4);
+      }
+
+      // the direction the colours of the block spread the most in, power iteration on the covariance
+      void principal_axis(unsigned char const* rgba, float mean[3], float axis[3]) noexcept
+      {
+        mean[0] = mean[1] = mean[2] = 0.0f;
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          for(unsigned int c{ 0 }; c < 3; ++c) {
+            mean[c] += rgba[i * 4 + c];
+          }
+        }
+        for(unsigned int c{ 0 }; c < 3; ++c) {
+          mean[c] /= 16.0f;
+        }
+        float cov[6]{}; // rr rg rb gg gb bb
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          float const r{ rgba[i * 4] - mean[0] };
+          float const g{ rgba[i * 4 + 1] - mean[1] };
+          float const b{ rgba[i * 4 + 2] - mean[2] };
+          cov[0] += r * r;
+          cov[1] += r * g;
+          cov[2] += r * b;
+          cov[3] += g * g;
+          cov[4] += g * b;
+          cov[5] += b * b;
+        }
+        float v[3]{ 1.0f, 1.0f, 1.0f };
+        for(unsigned int it{ 0 }; it < 8; ++it) {
+          float const x{ cov[0] * v[0] + cov[1] * v[1] + cov[2] * v[2] };
+          float const y{ cov[1] * v[0] + cov[3] * v[1] + cov[4] * v[2] };
+          float const z{ cov[2] * v[0] + cov[4] * v[1] + cov[5] * v[2] };
+          float const m{ std::max({ std::fabs(x), std::fabs(y), std::fabs(z) }) };
+          if(m < 1e-6f) {
+            break;
+          }
+          v[0] = x / m;
+          v[1] = y / m;
+          v[2] = z / m;
+        }
+        axis[0] = v[0];
+        axis[1] = v[1];
+        axis[2] = v[2];
+      }
+
+      // 8 values of a bc4 block in 8 value mode (a0 > a1)
+      void bc4_palette(unsigned int const a0, unsigned int const a1, unsigned char palette[8]) noexcept
+      {
+        palette[0] = static_cast<unsigned char>(a0);
+        palette[1] = static_cast<unsigned char>(a1);
+        for(unsigned int i{ 1 }; i < 7; ++i) {
+          palette[i + 1] = static_cast<unsigned char>(((7 - i) * a0 + i * a1) / 7);
+        }
+      }
+
+      // the 6 value mode (a0 <= a1) only decodes, it's never written
+      void bc4_palette_any(unsigned int const a0, unsigned int const a1, unsigned char palette[8]) noexcept
+      {
+        if(a0 > a1) {
+          bc4_palette(a0, a1, palette);
+          return;
+        }
+        palette[0] = static_cast<unsigned char>(a0);
+        palette[1] = static_cast<unsigned char>(a1);
+        for(unsigned int i{ 1 }; i < 5; ++i) {
+          palette[i + 1] = static_cast<unsigned char>(((5 - i) * a0 + i * a1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+      }
+
+      void write_bc4(unsigned int const a0, unsigned int const a1, unsigned long long const indices, unsigned char* out) noexcept
+      {
+        out[0] = static_cast<unsigned char>(a0);
+        out[1] = static_cast<unsigned char>(a1);
+        for(unsigned int i{ 0 }; i < 6; ++i) {
+          out[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+        }
+      }
+
+      // the 16 rgba pixels of the block at bx, by. past the edge the edge repeats, 1 and 2 channel
+      // images become grey and rg
+      void fetch_block(image const& img, unsigned int const bx, unsigned int const by, unsigned char* rgba) noexcept
+      {
+        unsigned int const ch{ img.channels };
+        for(unsigned int y{ 0 }; y < 4; ++y) {
+          unsigned int const sy{ std::min(by * 4 + y, img.height - 1) };
+          unsigned char const* const row{ img.pixels.data() + static_cast<std::size_t>(sy) * img.row_bytes() };
+          for(unsigned int x{ 0 }; x < 4; ++x) {
+            unsigned int const sx{ std::min(bx * 4 + x, img.width - 1) };
+            unsigned char const* const p{ row + static_cast<std::size_t>(sx) * ch };
+            unsigned char* const o{ rgba + (y * 4 + x) * 4 };
+            o[0] = p[0];
+            o[1] = ch == 1 ? p[0] : p[1];
+            o[2] = ch == 1 ? p[0] : ch == 2 ? 0 : p[2];
+            o[3] = ch == 4 ? p[3] : 255;
+          }
+        }
+      }
+
+    };
+
+    void encode_bc1_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept
+    {
+      __m128i px[4];
+      load_block(rgba, px);
+      unsigned char lo[4], hi[4];
+      block_bounds(px, lo, hi);
+      // the box pulled in by 1/16 on every side, the extremes are rarely worth an endpoint
+      int e0[3], e1[3];
+      for(unsigned int c{ 0 }; c < 3; ++c) {
+        int const inset{ (hi[c] - lo[c]) >> 4 };
+        e0[c] = hi[c] - inset;
+        e1[c] = lo[c] + inset;
+      }
+      unsigned char best[8];
+      unsigned int const box_error{ try_endpoints(px, to_565(e0[0], e0[1], e0[2]), to_565(e1[0], e1[1], e1[2]), best) };
+      if(q == bc_quality::fast || box_error == 0) {
+        std::memcpy(out, best, 8);
+        return;
+      }
+      // the pixels with the smallest and the biggest projection on the axis are the endpoints
+      float mean[3], axis[3];
+      principal_axis(rgba, mean, axis);
+      float pmin{ 1e30f }, pmax{ -1e30f };
+      unsigned int imin{ 0 }, imax{ 0 };
+      for(unsigned int i{ 0 }; i < 16; ++i) {
+        float const p{ rgba[i * 4] * axis[0] + rgba[i * 4 + 1] * axis[1] + rgba[i * 4 + 2] * axis[2] };
+        if(p < pmin) {
+          pmin = p;
+          imin = i;
+        }
+        if(p > pmax) {
+          pmax = p;
+          imax = i;
+        }
+      }
+      unsigned char const* const a{ rgba + imax * 4 };
+      unsigned char const* const b{ rgba + imin * 4 };
+      // whichever of the box and the axis is better is refined
+      unsigned char candidate[8];
+      unsigned int best_error{ try_endpoints(px, to_565(a[0], a[1], a[2]), to_565(b[0], b[1], b[2]), candidate) };
+      if(best_error < box_error) {
+        std::memcpy(best, candidate, 8);
+      } else {
+        best_error = box_error;
+      }
+      // refit the endpoints to the indices a couple of times, keep whatever was best
+      for(unsigned int it{ 0 }; it < 2 && best_error > 0; ++it) {
+        unsigned int indices;
+        std::memcpy(&indices, best + 4, 4);
+        unsigned short c0, c1;
+        if(!refit(rgba, indices, c0, c1)) {
+          break;
+        }
+        unsigned int const error{ try_endpoints(px, c0, c1, candidate) };
+        if(error >= best_error) {
+          break;
+        }
+        best_error = error;
+        std::memcpy(best, candidate, 8);
+      }
+      std::memcpy(out, best, 8);
+    }
+
+    void encode_bc4_block(unsigned char const* values, std::size_t const stride, unsigned char* out, bc_quality const q) noexcept
+    {
+      unsigned char v[16];
+      for(unsigned int i{ 0 }; i < 16; ++i) {
+        v[i] = values[i * stride];
+      }
+      __m128i const all{ _mm_loadu_si128(reinterpret_cast<__m128i const*>(v)) };
+      __m128i mn{ _mm_min_epu8(all, _mm_srli_si128(all, 8)) };
+      __m128i mx{ _mm_max_epu8(all, _mm_srli_si128(all, 8)) };
+      mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 4));
+      mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 4));
+      mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 2));
+      mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 2));
+      mn = _mm_min_epu8(mn, _mm_srli_si128(mn, 1));
+      mx = _mm_max_epu8(mx, _mm_srli_si128(mx, 1));
+      unsigned int const a0{ static_cast<unsigned int>(_mm_cvtsi128_si32(mx) & 0xff) };
+      unsigned int const a1{ static_cast<unsigned int>(_mm_cvtsi128_si32(mn) & 0xff) };
+      if(a0 == a1) {
+        write_bc4(a0, a1, 0, out);
+        return;
+      }
+      unsigned long long indices{ 0 };
+      if(q == bc_quality::fast) {
+        // where it falls between a0 and a1 in sevenths, 0 is a0, 7 is a1 and the ones in between are 2..7
+        unsigned int const range{ a0 - a1 };
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          unsigned int const t{ ((a0 - v[i]) * 7 + range / 2) / range };
+          unsigned int const idx{ t == 0 ? 0u : t == 7 ? 1u : t + 1 };
+          indices |= static_cast<unsigned long long>(idx) << (i * 3);
+        }
+      } else {
+        // the nearest of the 8 values as the decoder rounds them
+        unsigned char palette[8];
+        bc4_palette(a0, a1, palette);
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          unsigned int best{ 0 };
+          int best_d{ 256 };
+          for(unsigned int k{ 0 }; k < 8; ++k) {
+            int const d{ std::abs(static_cast<int>(palette[k]) - static_cast<int>(v[i])) };
+            if(d < best_d) {
+              best_d = d;
+              best = k;
+            }
+          }
+          indices |= static_cast<unsigned long long>(best) << (i * 3);
+        }
+      }
+      write_bc4(a0, a1, indices, out);
+    }
+
+    void encode_bc3_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept
+    {
+      encode_bc4_block(rgba + 3, 4, out, q);
+      encode_bc1_block(rgba, out + 8, q);
+    }
+
+    void encode_bc5_block(unsigned char const* rgba, unsigned char* out, bc_quality const q) noexcept
+    {
+      encode_bc4_block(rgba, 4, out, q);
+      encode_bc4_block(rgba + 1, 4, out + 8, q);
+    }
+
+    static void decode_bc1(unsigned char const* in, unsigned char* rgba) noexcept
+    {
+      unsigned short c0, c1;
+      unsigned int indices;
+      std::memcpy(&c0, in, 2);
+      std::memcpy(&c1, in + 2, 2);
+      std::memcpy(&indices, in + 4, 4);
+      unsigned char palette[4][4];
+      bc1_palette(c0, c1, palette);
+      if(c0 <= c1) {
+        // 3 colours and transparent black
+        for(unsigned int c{ 0 }; c < 3; ++c) {
+          palette[2][c] = static_cast<unsigned char>((palette[0][c] + palette[1][c]) / 2);
+          palette[3][c] = 0;
+        }
+      }
+      for(unsigned int k{ 0 }; k < 4; ++k) {
+        palette[k][3] = (c0 <= c1 && k == 3) ? 0 : 255;
+      }
+      for(unsigned int i{ 0 }; i < 16; ++i) {
+        std::memcpy(rgba + i * 4, palette[(indices >> (i * 2)) & 3], 4);
+      }
+    }
+
+    static void decode_bc4(unsigned char const* in, unsigned char* values, std::size_t const stride) noexcept
+    {
+      unsigned char palette[8];
+      bc4_palette_any(in[0], in[1], palette);
+      unsigned long long indices{ 0 };
+      for(unsigned int i{ 0 }; i < 6; ++i) {
+        indices |= static_cast<unsigned long long>(in[2 + i]) << (i * 8);
+      }
+      for(unsigned int i{ 0 }; i < 16; ++i) {
+        values[i * stride] = palette[(indices >> (i * 3)) & 7];
+      }
+    }
+
+    void decode_block(bc_format const f, unsigned char const* in, unsigned char* rgba) noexcept
+    {
+      switch(f) {
+      case bc_format::bc1:
+        decode_bc1(in, rgba);
+        break;
+      case bc_format::bc3:
+        decode_bc1(in + 8, rgba);
+        decode_bc4(in, rgba + 3, 4);
+        break;
+      case bc_format::bc5:
+        decode_bc4(in, rgba, 4);
+        decode_bc4(in + 8, rgba + 1, 4);
+        for(unsigned int i{ 0 }; i < 16; ++i) {
+          rgba[i * 4 + 2] = 0;
+          rgba[i * 4 + 3] = 255;
+        }
+        break;
+      }
+    }
+
+    void encode_image(image const& img, bc_format const f, bc_quality const q, unsigned char* out) noexcept
+    {
+      unsigned int const bw{ (img.width + 3) / 4 };
+      unsigned int const bh{ (img.height + 3) / 4 };
+      std::size_t const block{ bc_block_bytes(f) };
+      // rows of blocks, every thread writes its own
+      jobs::parallel_for(bh, 8, [&img, f, q, out, bw, block](std::size_t const begin, std::size_t const end) {
+        alignas(16) unsigned char rgba[64];
+        for(std::size_t by{ begin }; by < end; ++by) {
+          for(unsigned int bx{ 0 }; bx < bw; ++bx) {
+            fetch_block(img, bx, static_cast<unsigned int>(by), rgba);
+            unsigned char* const o{ out + (by * bw + bx) * block };
+            switch(f) {
+            case bc_format::bc1:
+              encode_bc1_block(rgba, o, q);
+              break;
+            case bc_format::bc3:
+              encode_bc3_block(rgba, o, q);
+              break;
+            case bc_format::bc5:
+              encode_bc5_block(rgba, o, q);
+              break;
+            }
+          }
+        }
+      });
+    }
+
+    void decode_image(unsigned char const* in, bc_format const f, unsigned int const width, unsigned int const height,
+                      unsigned char* rgba) noexcept
+    {
+      unsigned int const bw{ (width + 3) / 4 };
+      unsigned int const bh{ (height + 3) / 4 };
+      unsigned char block[64];
+      for(unsigned int by{ 0 }; by < bh; ++by) {
+        for(unsigned int bx{ 0 }; bx < bw; ++bx) {
+          decode_block(f, in + (static_cast<std::size_t>(by) * bw + bx) * bc_block_bytes(f), block);
+          for(unsigned int y{ 0 }; y < 4 && by * 4 + y < height; ++y) {
+            for(unsigned int x{ 0 }; x < 4 && bx * 4 + x < width; ++x) {
+              std::memcpy(rgba + ((static_cast<std::size_t>(by) * 4 + y) * width + bx * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+            }
+          }
+        }
+      }
+    }
+
+    std::size_t compressed_texture::level_offset(unsigned int const level) const noexcept
+    {
+      std::size_t offset{ 0 };
+      for(unsigned int l{ 0 }; l < level; ++l) {
+        offset += level_bytes(l);
+      }
+      return offset;
+    }
+
+    bool compress(mip_chain const& mips, bc_format const f, bc_quality const q, compressed_texture& o, arena& mem) noexcept
+    {
+      image const& top{ mips.levels[0] };
+      o = compressed_texture{ f, top.width, top.height, mips.num_levels, {} };
+      o.data = mem.push_array<unsigned char>(o.level_offset(mips.num_levels));
+      if(o.data.empty()) {
+        std::cerr << __FUNCTION__ << ": out of memory\n";
+        return false;
+      }
+      for(unsigned int l{ 0 }; l < mips.num_levels; ++l) {
+        encode_image(mips.levels[l], f, q, o.data.data() + o.level_offset(l));
+      }
+      return true;
+    }
+
+    bool save_compressed(char const* filepath, compressed_texture const& t, bc_quality const q,
+                         unsigned long long const source_size, long long const source_mtime) noexcept
+    {
+      int const fd{ open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+      if(fd == -1) {
+        std::cerr << __FUNCTION__ << ": couldn't open " << filepath << ": " << std::strerror(errno) << '\n';
+        return false;
+      }
+      compressed_header const h{
+        compressed_header::lvc_magic, compressed_header::lvc_version, static_cast<unsigned int>(t.format),
+        static_cast<unsigned int>(q), t.width, t.height, t.num_levels, 0, source_size, source_mtime
+      };
+      bool const ok{ pwrite(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h)) &&
+                     pwrite(fd, t.data.data(), t.data.bytes(), sizeof(h)) == static_cast<ssize_t>(t.data.bytes()) };
+      close(fd);
+      if(!ok) {
+        std::cerr << __FUNCTION__ << ": couldn't write " << filepath << '\n';
+        unlink(filepath);
+      }
+      return ok;
+    }
+
+    bool load_compressed(char const* filepath, bc_quality const q, unsigned long long const source_size,
+                         long long const source_mtime, compressed_texture& o, arena& mem) noexcept
+    {
+      int const fd{ open(filepath, O_RDONLY) };
+      if(fd == -1) {
+        return false;
+      }
+      compressed_header h;
+      bool ok{ pread(fd, &h, sizeof(h), 0) == static_cast<ssize_t>(sizeof(h)) && h.magic == compressed_header::lvc_magic &&
+               h.version == compressed_header::lvc_version && h.quality == static_cast<unsigned int>(q) &&
+               h.source_size == source_size && h.source_mtime == source_mtime &&
+               h.num_levels > 0 && h.num_levels <= compressed_texture::max_levels &&
+               (h.format == 1 || h.format == 3 || h.format == 5) };
+      if(ok) {
+        o = compressed_texture{ static_cast<bc_format>(h.format), h.width, h.height, h.num_levels, {} };
+        std::size_t const bytes{ o.level_offset(h.num_levels) };
+        std::size_t const m{ mem.mark() };
+        o.data = mem.push_array<unsigned char>(bytes);
+        ok = !o.data.empty() && pread(fd, o.data.data(), bytes, sizeof(h)) == static_cast<ssize_t>(bytes);
+        if(!ok) {
+          mem.pop_to(m);
+        }
+      }
+      close(fd);
+      return ok;
+    }
+
+  };
+};
@@ -0,0 +1,234 @@
+#include "lvar_encode.h"
+
+#include <algorithm>            // clamp
+#include <iostream>
+#include <cmath>
+#include <cstring>              // memcpy, memset
+#include <limits>
+
+namespace lvar {
+  namespace obj {
+
+    namespace {
+
+      float sign_not_zero(float const v) noexcept
+      {
+        return v >= 0.0f ? 1.0f : -1.0f;
+      }
+
+      template<typename T>
+      T quantise(float const v, float const scale) noexcept
+      {
+        return static_cast<T>(std::lround(std::clamp(v, -1.0f, 1.0f) * scale));
+      }
+
+    };
+
+    // round to nearest even like the hw does, f16c would do this in one instruction but it isn't in the
+    // -m flags, and this only runs when loading
+    unsigned short float_to_half(float const f) noexcept
+    {
+      unsigned int bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      unsigned int const sign{ (bits >> 16) & 0x8000u };
+      unsigned int const exp{ (bits >> 23) & 0xffu };
+      unsigned int mant{ bits & 0x7fffffu };
+      if(exp == 0xff) {
+        // inf stays inf, nan stays nan
+        return static_cast<unsigned short>(sign | 0x7c00u | (mant ? 0x200u : 0u));
+      }
+      int const e{ static_cast<int>(exp) - 127 + 15 };
+      if(e >= 0x1f) {
+        return static_cast<unsigned short>(sign | 0x7c00u);
+      }
+      if(e <= 0) {
+        // too small for a normal half, it's a denormal or 0
+        if(e < -10) {
+          return static_cast<unsigned short>(sign);
+        }
+        mant |= 0x800000u;
+        unsigned int const shift{ static_cast<unsigned int>(14 - e) };
+        unsigned int h{ mant >> shift };
+        unsigned int const rest{ mant & ((1u << shift) - 1) };
+        unsigned int const halfway{ 1u << (shift - 1) };
+        h += (rest > halfway || (rest == halfway && (h & 1))) ? 1 : 0;
+        return static_cast<unsigned short>(sign | h);
+      }
+      unsigned int h{ (static_cast<unsigned int>(e) << 10) | (mant >> 13) };
+      unsigned int const rest{ mant & 0x1fffu };
+      // the carry can go into the exponent, that's still the right number (or inf)
+      h += (rest > 0x1000u || (rest == 0x1000u && (h & 1))) ? 1 : 0;
+      return static_cast<unsigned short>(sign | h);
+    }
+
+    float half_to_float(unsigned short const h) noexcept
+    {
+      unsigned int const sign{ (h & 0x8000u) << 16 };
+      unsigned int const exp{ (h >> 10) & 0x1fu };
+      unsigned int const mant{ h & 0x3ffu };
+      if(exp == 0) {
+        float const v{ std::ldexp(static_cast<float>(mant), -24) };
+        return sign ? -v : v;
+      }
+      unsigned int const bits{ exp == 0x1f ? (sign | 0x7f800000u | (mant << 13)) : (sign | ((exp + 112) << 23) | (mant << 13)) };
+      float f;
+      std::memcpy(&f, &bits, sizeof(f));
+      return f;
+    }
+
+    // project on the octahedron |x| + |y| + |z| = 1 and unfold the bottom half over the corners of the
+    // top one, so the whole sphere fits in a square with the same precision everywhere
+    void oct_encode(float const x, float const y, float const z, short out[2]) noexcept
+    {
+      float const l1{ std::fabs(x) + std::fabs(y) + std::fabs(z) };
+      float px{ l1 > 0.0f ? x / l1 : 0.0f };
+      float py{ l1 > 0.0f ? y / l1 : 0.0f };
+      if(z < 0.0f) {
+        float const ox{ px };
+        px = (1.0f - std::fabs(py)) * sign_not_zero(ox);
+        py = (1.0f - std::fabs(ox)) * sign_not_zero(py);
+      }
+      out[0] = quantise<short>(px, 32767.0f);
+      out[1] = quantise<short>(py, 32767.0f);
+    }
+
+    v3 oct_decode(short const in[2]) noexcept
+    {
+      // same as the glsl one, snorm16 -> [-1, 1] first
+      float const ex{ std::max(in[0] / 32767.0f, -1.0f) };
+      float const ey{ std::max(in[1] / 32767.0f, -1.0f) };
+      v3 n{ ex, ey, 1.0f - std::fabs(ex) - std::fabs(ey) };
+      float const t{ std::max(-n.z, 0.0f) };
+      n.x += n.x >= 0.0f ? -t : t;
+      n.y += n.y >= 0.0f ? -t : t;
+      return normalise(n);
+    }
+
+    bool encode(mesh const& m, encoded_mesh& out, arena& mem, encode_options const& options) noexcept
+    {
+      out = encoded_mesh{};
+      std::size_t const nv{ m.vertices.size() };
+      // the whole lod chain when there is one, level 0 is the same as the indices of the mesh
+      slice<unsigned int> const& indices{ m.lods.levels.empty() ? m.indices : m.lods.indices };
+      std::size_t const ni{ indices.size() };
+      if(nv > std::numeric_limits<unsigned int>::max() || ni > std::numeric_limits<unsigned int>::max()) {
+        std::cerr << __FUNCTION__ << ": mesh too big\n";
+        return false;
+      }
+      bool const quantised{ options.quantise_positions };
+      bool const packed{ options.pack_normals };
+      bool const half{ options.half_uvs };
+      // every attribute starts at a multiple of 4, some drivers are really slow with anything else
+      unsigned int stride{ 0 };
+      auto const add = [&out, &stride](unsigned int const location, int const components, unsigned int const type,
+                                       bool const normalised, unsigned int const sz) {
+        out.attributes[out.num_attributes++] = { location, components, type, normalised, stride };
+        stride += (sz + 3) & ~3u;
+      };
+      add(attribute_position, 3, quantised ? GL_UNSIGNED_SHORT : GL_FLOAT, quantised, quantised ? 6 : 12);
+      if(!m.normals.empty()) {
+        add(attribute_normal, packed ? 2 : 3, packed ? GL_SHORT : GL_FLOAT, packed, packed ? 4 : 12);
+      }
+      if(!m.uvs.empty()) {
+        add(attribute_uv, 2, half ? GL_HALF_FLOAT : GL_FLOAT, false, half ? 4 : 8);
+      }
+      if(!m.tangents.empty()) {
+        add(attribute_tangent, 4, packed ? GL_BYTE : GL_FLOAT, packed, packed ? 4 : 16);
+      }
+      out.stride = stride;
+      out.num_vertices = static_cast<unsigned int>(nv);
+      out.num_indices = static_cast<unsigned int>(m.indices.size());
+      out.lods = m.lods.levels;
+      // no restart index, so 65535 is a valid vertex
+      out.index_type = options.small_indices && nv <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+      for(int i{ 0 }; i < 3; ++i) {
+        out.aabb_min[i] = 0.0f;
+        out.aabb_extent[i] = 1.0f;
+      }
+      if(quantised && nv > 0) {
+        float lo[3]{ m.vertices[0].x, m.vertices[0].y, m.vertices[0].z };
+        float hi[3]{ lo[0], lo[1], lo[2] };
+        for(auto const& v : m.vertices) {
+          float const p[3]{ v.x, v.y, v.z };
+          for(int i{ 0 }; i < 3; ++i) {
+            lo[i] = std::min(lo[i], p[i]);
+            hi[i] = std::max(hi[i], p[i]);
+          }
+        }
+        for(int i{ 0 }; i < 3; ++i) {
+          out.aabb_min[i] = lo[i];
+          out.aabb_extent[i] = hi[i] - lo[i];
+        }
+      }
+      auto const mark = mem.mark();
+      out.vertices = mem.push_array<unsigned char>(nv * stride);
+      out.indices = mem.push_array<unsigned char>(ni * out.index_size());
+      if((nv && out.vertices.empty()) || (ni && out.indices.empty())) {
+        std::cerr << __FUNCTION__ << ": arena is too small\n";
+        mem.pop_to(mark);
+        out = encoded_mesh{};
+        return false;
+      }
+      // padding has to be something, might as well be 0 so the output is always the same
+      std::memset(out.vertices.data(), 0, out.vertices.bytes());
+      float inv_extent[3];
+      for(int i{ 0 }; i < 3; ++i) {
+        inv_extent[i] = out.aabb_extent[i] > 0.0f ? 1.0f / out.aabb_extent[i] : 0.0f;
+      }
+      for(std::size_t v{ 0 }; v < nv; ++v) {
+        unsigned char* const dst{ out.vertices.data() + v * stride };
+        unsigned int a{ 0 };
+        vertex const& p{ m.vertices[v] };
+        if(quantised) {
+          float const pos[3]{ p.x, p.y, p.z };
+          unsigned short q[3];
+          for(int i{ 0 }; i < 3; ++i) {
+            q[i] = static_cast<unsigned short>(std::lround(std::clamp((pos[i] - out.aabb_min[i]) * inv_extent[i], 0.0f, 1.0f) * 65535.0f));
+          }
+          std::memcpy(dst + out.attributes[a++].offset, q, sizeof(q));
+        } else {
+          std::memcpy(dst + out.attributes[a++].offset, &p, sizeof(p));
+        }
+        if(!m.normals.empty()) {
+          normal const& n{ m.normals[v] };
+          if(packed) {
+            short e[2];
+            oct_encode(n.x, n.y, n.z, e);
+            std::memcpy(dst + out.attributes[a++].offset, e, sizeof(e));
+          } else {
+            std::memcpy(dst + out.attributes[a++].offset, &n, sizeof(n));
+          }
+        }
+        if(!m.uvs.empty()) {
+          texcoord const& t{ m.uvs[v] };
+          if(half) {
+            unsigned short const h[2]{ float_to_half(t.u), float_to_half(t.v) };
+            std::memcpy(dst + out.attributes[a++].offset, h, sizeof(h));
+          } else {
+            std::memcpy(dst + out.attributes[a++].offset, &t, sizeof(t));
+          }
+        }
+        if(!m.tangents.empty()) {
+          tangent const& t{ m.tangents[v] };
+          if(packed) {
+            signed char const s[4]{ quantise<signed char>(t.x, 127.0f), quantise<signed char>(t.y, 127.0f),
+                                    quantise<signed char>(t.z, 127.0f), quantise<signed char>(t.w, 127.0f) };
+            std::memcpy(dst + out.attributes[a++].offset, s, sizeof(s));
+          } else {
+            std::memcpy(dst + out.attributes[a++].offset, &t, sizeof(t));
+          }
+        }
+      }
+      if(out.index_type == GL_UNSIGNED_SHORT) {
+        unsigned short* const dst{ reinterpret_cast<unsigned short*>(out.indices.data()) };
+        for(std::size_t i{ 0 }; i < ni; ++i) {
+          dst[i] = static_cast<unsigned short>(indices[i]);
+        }
+      } else if(ni > 0) {
+        std::memcpy(out.indices.data(), indices.data(), indices.bytes());
+      }
+      return true;
+    }
+
+  };
+};
@@ -0,0 +1,89 @@
+#include "lvar_mesh_loader.h"
+#include "lvar_mesh_opt.h"
+#include "lvar_normals.h"
+#include "lvar_simplify.h"
+
+#include <iostream>
+#include <cstring>              // strlen, memcpy, strcmp
+#include <sys/stat.h>           // stat
+
+namespace lvar {
+  namespace obj {
+
+    mesh_loader::~mesh_loader()
+    {
+      while(pending > 0) {
+        if(current || completed.pop(current)) {
+          finish();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    bool mesh_loader::load(char const* path, unsigned int const id, encode_options const& options) noexcept
+    {
+      if(pending == max_in_flight) {
+        return false;
+      }
+      std::size_t const len{ std::strlen(path) };
+      if(len >= sizeof(loaded_mesh::path)) {
+        std::cerr << __FUNCTION__ << ": path too long " << path << '\n';
+        return false;
+      }
+      // the arena only reserves address space, so be generous: no .obj becomes more than this
+      struct stat sb;
+      std::size_t const file_sz{ stat(path, &sb) == 0 ? static_cast<std::size_t>(sb.st_size) : 0 };
+      std::unique_ptr<loaded_mesh> lm{ new loaded_mesh(file_sz * 16 + 64 * 1024 * 1024) };
+      std::memcpy(lm->path, path, len + 1);
+      lm->options = options;
+      lm->loader = this;
+      lm->id = id;
+      lm->ok = false;
+      lm->uploaded = 0;
+      if(!workers.submit(run, lm.get())) {
+        return false;
+      }
+      // the worker has it now, it comes back through the queue
+      lm.release();
+      ++pending;
+      return true;
+    }
+
+    void mesh_loader::run(void* data) noexcept
+    {
+      loaded_mesh& lm{ *static_cast<loaded_mesh*>(data) };
+      if(!lm.mem.error()) {
+        arena scratch(lm.mem.capacity());
+        // a cooked .lvm is optimised and has its lods already, an .obj gets them here
+        std::size_t const len{ std::strlen(lm.path) };
+        if(len > 4 && std::strcmp(lm.path + len - 4, ".lvm") == 0) {
+          lm.ok = !scratch.error() && load_mesh(lm.path, lm.m, lm.mem) &&
+                  (!lm.m.normals.empty() || generate_normals(lm.m, lm.mem, scratch));
+        } else {
+          lm.ok = !scratch.error() && parse_file(lm.path, lm.m, lm.mem) && optimise(lm.m, scratch) &&
+                  (!lm.m.normals.empty() || generate_normals(lm.m, lm.mem, scratch));
+        }
+        lm.ok = lm.ok && (!lm.m.lods.levels.empty() || build_lods(lm.m, lm.m.lods, lm.mem, scratch)) &&
+                build_meshlets(lm.m, lm.meshlets, lm.mem, scratch);
+        // the meshlets reorder the triangles of level 0, the chain's copy of it has to follow
+        if(lm.ok) {
+          std::memcpy(lm.m.lods.indices.data(), lm.m.indices.data(), lm.m.indices.bytes());
+        }
+        lm.ok = lm.ok && encode(lm.m, lm.gpu, lm.mem, lm.options);
+      }
+      // there are never more than max_in_flight of these, it can't be full
+      bool const pushed{ lm.loader->completed.push(&lm) };
+      assert(pushed);
+      (void)pushed;
+    }
+
+    void mesh_loader::finish() noexcept
+    {
+      std::unique_ptr<loaded_mesh> const done{ current };
+      current = nullptr;
+      --pending;
+    }
+
+  };
+};
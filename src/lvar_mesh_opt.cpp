@@ -0,0 +1,401 @@
+#include "lvar_mesh_opt.h"
+#include "lvar_math.h"
+
+#include <iostream>
+#include <algorithm>            // sort
+#include <cstring>              // memcpy
+
+namespace lvar {
+  namespace obj {
+
+    namespace {
+
+      // the cache is simulated with timestamps instead of an actual fifo: a vertex is in the cache
+      // if less than cache_size misses happened since it was put in there. this way checking it is
+      // O(1) and "flushing" the whole cache is just moving the timestamp forward.
+      class cache_sim final {
+      public:
+        cache_sim(slice<unsigned int> t, unsigned int const sz) noexcept
+          : time{ t },
+            stamp{ sz + 1 },
+            size{ sz }
+        {
+          for(auto& i : time) {
+            i = 0;
+          }
+        }
+        bool miss(unsigned int const v) noexcept
+        {
+          if(stamp - time[v] > size) {
+            time[v] = stamp++;
+            return true;
+          }
+          return false;
+        }
+        void flush() noexcept { stamp += size + 1; }
+      public:
+        slice<unsigned int> time;
+        unsigned int stamp;
+        unsigned int const size;
+      };
+
+      bool out_of_memory(char const* fx) noexcept
+      {
+        std::cerr << fx << ": scratch arena is too small\n";
+        return false;
+      }
+
+    };
+
+    bool build_adjacency(slice<unsigned int> const& indices, std::size_t const num_vertices,
+                         arena& mem, adjacency& adj) noexcept
+    {
+      adj.offsets = mem.push_array<unsigned int>(num_vertices + 1);
+      adj.tris = mem.push_array<unsigned int>(indices.size());
+      if(adj.offsets.empty() || (indices.size() && adj.tris.empty())) {
+        return false;
+      }
+      for(auto& o : adj.offsets) {
+        o = 0;
+      }
+      // count, then prefix sum shifted by one so offsets[v + 1] can be used as a write cursor
+      for(auto const i : indices) {
+        ++adj.offsets[i + 1];
+      }
+      for(std::size_t v{ 1 }; v <= num_vertices; ++v) {
+        adj.offsets[v] += adj.offsets[v - 1];
+      }
+      auto cursor = mem.push_array<unsigned int>(num_vertices);
+      if(num_vertices && cursor.empty()) {
+        return false;
+      }
+      for(std::size_t v{ 0 }; v < num_vertices; ++v) {
+        cursor[v] = adj.offsets[v];
+      }
+      for(std::size_t i{ 0 }; i < indices.size(); ++i) {
+        adj.tris[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+      }
+      return true;
+    }
+
+    cache_stats analyse_vertex_cache(slice<unsigned int> const& indices,
+                                     std::size_t const num_vertices,
+                                     arena& scratch,
+                                     unsigned int const cache_size) noexcept
+    {
+      if(indices.empty() || num_vertices == 0) {
+        return { 0.0f, 0.0f };
+      }
+      arena_scope scope(scratch);
+      auto time = scratch.push_array<unsigned int>(num_vertices);
+      if(time.empty()) {
+        out_of_memory(__FUNCTION__);
+        return { 0.0f, 0.0f };
+      }
+      cache_sim cache(time, cache_size);
+      std::size_t misses{ 0 };
+      std::size_t unique{ 0 };
+      for(auto const v : indices) {
+        unique += cache.time[v] == 0 ? 1 : 0;
+        misses += cache.miss(v) ? 1 : 0;
+      }
+      return {
+        static_cast<float>(misses) / static_cast<float>(indices.size() / 3),
+        static_cast<float>(misses) / static_cast<float>(unique)
+      };
+    }
+
+    static bool optimise_vertex_cache_range(mesh& m, arena& scratch, unsigned int const cache_size) noexcept
+    {
+      std::size_t const num_tris{ m.num_faces() };
+      std::size_t const num_vertices{ m.vertices.size() };
+      if(num_tris == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      adjacency adj;
+      if(!build_adjacency(m.indices, num_vertices, scratch, adj)) {
+        return out_of_memory(__FUNCTION__);
+      }
+      auto live = scratch.push_array<unsigned int>(num_vertices);        // triangles not emitted yet
+      auto time = scratch.push_array<unsigned int>(num_vertices);
+      auto emitted = scratch.push_array<unsigned char>(num_tris);
+      auto dead_end = scratch.push_array<unsigned int>(num_tris * 3);
+      auto out = scratch.push_array<unsigned int>(num_tris * 3);
+      if(live.empty() || time.empty() || emitted.empty() || dead_end.empty() || out.empty()) {
+        return out_of_memory(__FUNCTION__);
+      }
+      for(std::size_t v{ 0 }; v < num_vertices; ++v) {
+        live[v] = adj.offsets[v + 1] - adj.offsets[v];
+      }
+      for(auto& e : emitted) {
+        e = 0;
+      }
+      cache_sim cache(time, cache_size);
+      std::size_t top{ 0 };     // dead end stack
+      std::size_t written{ 0 };
+      std::size_t cursor{ 0 };  // for when there's nothing better, next vertex in input order
+      long long fan{ m.indices[0] };
+      while(fan >= 0) {
+        // emit all the triangles around the fanning vertex that haven't been emitted yet
+        std::size_t const candidates{ top };
+        for(unsigned int a{ adj.offsets[fan] }; a < adj.offsets[fan + 1]; ++a) {
+          unsigned int const t{ adj.tris[a] };
+          if(emitted[t]) {
+            continue;
+          }
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            unsigned int const v{ m.indices[t * 3 + k] };
+            out[written++] = v;
+            dead_end[top++] = v;
+            --live[v];
+            cache.miss(v);
+          }
+          emitted[t] = 1;
+        }
+        // next fanning vertex, the one that's been in the cache the longest that will still be in
+        // it after emitting all its triangles. vertices with no triangles left are useless.
+        fan = -1;
+        int best{ -1 };
+        for(std::size_t c{ candidates }; c < top; ++c) {
+          unsigned int const v{ dead_end[c] };
+          if(live[v] == 0) {
+            continue;
+          }
+          int priority{ 0 };
+          unsigned int const age{ cache.stamp - cache.time[v] };
+          if(age + 2 * live[v] <= cache_size) {
+            priority = static_cast<int>(age);
+          }
+          if(priority > best) {
+            best = priority;
+            fan = v;
+          }
+        }
+        if(fan == -1) {
+          // dead end, go back thru the recently used vertices first and only then use the input order
+          while(top > 0) {
+            unsigned int const v{ dead_end[--top] };
+            if(live[v] > 0) {
+              fan = v;
+              break;
+            }
+          }
+          while(fan == -1 && cursor < num_vertices) {
+            if(live[cursor] > 0) {
+              fan = static_cast<long long>(cursor);
+            }
+            ++cursor;
+          }
+        }
+      }
+      assert(written == m.indices.size());
+      std::memcpy(m.indices.data(), out.data(), out.bytes());
+      return true;
+    }
+
+    bool optimise_vertex_cache(mesh& m, arena& scratch, unsigned int const cache_size) noexcept
+    {
+      return for_each_submesh(m, [&scratch, cache_size](mesh& part) {
+        return optimise_vertex_cache_range(part, scratch, cache_size);
+      });
+    }
+
+    static bool optimise_overdraw_range(mesh& m, arena& scratch, float const threshold, unsigned int const cache_size) noexcept
+    {
+      std::size_t const num_tris{ m.num_faces() };
+      std::size_t const num_vertices{ m.vertices.size() };
+      if(num_tris == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      auto time = scratch.push_array<unsigned int>(num_vertices);
+      auto hard = scratch.push_array<unsigned int>(num_tris + 1);
+      auto clusters = scratch.push_array<unsigned int>(num_tris + 1);
+      if(time.empty() || hard.empty() || clusters.empty()) {
+        return out_of_memory(__FUNCTION__);
+      }
+      // hard boundaries: triangles where the cache had none of the 3 vertices, that's where the vertex
+      // cache optimisation jumped somewhere else, so cutting there costs nothing
+      std::size_t num_hard{ 0 };
+      {
+        cache_sim cache(time, cache_size);
+        for(std::size_t t{ 0 }; t < num_tris; ++t) {
+          unsigned int misses{ 0 };
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            misses += cache.miss(m.indices[t * 3 + k]) ? 1 : 0;
+          }
+          if(t == 0 || misses == 3) {
+            hard[num_hard++] = static_cast<unsigned int>(t);
+          }
+        }
+        hard[num_hard] = static_cast<unsigned int>(num_tris);
+      }
+      // soft boundaries: split the hard clusters further while the acmr of the piece is still within
+      // threshold of the acmr of the whole cluster
+      std::size_t num_clusters{ 0 };
+      {
+        cache_sim cache(time, cache_size);
+        for(std::size_t h{ 0 }; h < num_hard; ++h) {
+          unsigned int const start{ hard[h] };
+          unsigned int const end{ hard[h + 1] };
+          cache.flush();
+          unsigned int cluster_misses{ 0 };
+          for(unsigned int i{ start * 3 }; i < end * 3; ++i) {
+            cluster_misses += cache.miss(m.indices[i]) ? 1 : 0;
+          }
+          float const target{ threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - start) };
+          clusters[num_clusters++] = start;
+          cache.flush();
+          unsigned int running_misses{ 0 };
+          unsigned int running_tris{ 0 };
+          for(unsigned int t{ start }; t < end; ++t) {
+            for(unsigned int k{ 0 }; k < 3; ++k) {
+              running_misses += cache.miss(m.indices[t * 3 + k]) ? 1 : 0;
+            }
+            ++running_tris;
+            if(t + 1 < end && static_cast<float>(running_misses) <= target * static_cast<float>(running_tris)) {
+              clusters[num_clusters++] = t + 1;
+              cache.flush();
+              running_misses = 0;
+              running_tris = 0;
+            }
+          }
+        }
+        clusters[num_clusters] = static_cast<unsigned int>(num_tris);
+      }
+      // sort key of every cluster: how much it faces away from the centre of the mesh
+      auto keys = scratch.push_array<float>(num_clusters);
+      auto order = scratch.push_array<unsigned int>(num_clusters);
+      auto out = scratch.push_array<unsigned int>(m.indices.size());
+      if(keys.empty() || order.empty() || out.empty()) {
+        return out_of_memory(__FUNCTION__);
+      }
+      auto const position = [&m](unsigned int const i) {
+        vertex const& v{ m.vertices[i] };
+        return v3{ v.x, v.y, v.z };
+      };
+      v3 mesh_centre{ 0.0f, 0.0f, 0.0f };
+      float mesh_area{ 0.0f };
+      for(std::size_t t{ 0 }; t < num_tris; ++t) {
+        v3 const a{ position(m.indices[t * 3]) };
+        v3 const b{ position(m.indices[t * 3 + 1]) };
+        v3 const c{ position(m.indices[t * 3 + 2]) };
+        v3 const n{ cross(sub(b, a), sub(c, a)) };
+        float const area{ std::sqrt(dot(n, n)) };
+        mesh_centre = add(mesh_centre, scale(add(add(a, b), c), area / 3.0f));
+        mesh_area += area;
+      }
+      mesh_centre = scale(mesh_centre, mesh_area > 0.0f ? 1.0f / mesh_area : 0.0f);
+      for(std::size_t c{ 0 }; c < num_clusters; ++c) {
+        v3 centre{ 0.0f, 0.0f, 0.0f };
+        v3 normal{ 0.0f, 0.0f, 0.0f };
+        float area_total{ 0.0f };
+        for(unsigned int t{ clusters[c] }; t < clusters[c + 1]; ++t) {
+          v3 const a{ position(m.indices[t * 3]) };
+          v3 const b{ position(m.indices[t * 3 + 1]) };
+          v3 const d{ position(m.indices[t * 3 + 2]) };
+          v3 const n{ cross(sub(b, a), sub(d, a)) }; // length is 2 * area, so it's already area weighted
+          float const area{ std::sqrt(dot(n, n)) };
+          centre = add(centre, scale(add(add(a, b), d), area / 3.0f));
+          normal = add(normal, n);
+          area_total += area;
+        }
+        centre = scale(centre, area_total > 0.0f ? 1.0f / area_total : 0.0f);
+        keys[c] = dot(sub(centre, mesh_centre), normalise(normal));
+        order[c] = static_cast<unsigned int>(c);
+      }
+      // ties broken by index, otherwise std::sort isn't deterministic across implementations
+      std::sort(order.begin(), order.end(), [&keys](unsigned int const a, unsigned int const b) {
+        return keys[a] > keys[b] || (keys[a] == keys[b] && a < b);
+      });
+      std::size_t written{ 0 };
+      for(auto const c : order) {
+        std::size_t const first{ clusters[c] * 3 };
+        std::size_t const count{ (clusters[c + 1] - clusters[c]) * 3 };
+        std::memcpy(out.data() + written, m.indices.data() + first, count * sizeof(unsigned int));
+        written += count;
+      }
+      std::memcpy(m.indices.data(), out.data(), out.bytes());
+      return true;
+    }
+
+    bool optimise_overdraw(mesh& m, arena& scratch, float const threshold, unsigned int const cache_size) noexcept
+    {
+      return for_each_submesh(m, [&scratch, threshold, cache_size](mesh& part) {
+        return optimise_overdraw_range(part, scratch, threshold, cache_size);
+      });
+    }
+
+    // moves every element of a vertex attribute to where remap says
+    template<typename T>
+    static bool permute(slice<T>& attr, slice<unsigned int> const& remap, arena& scratch) noexcept
+    {
+      if(attr.empty()) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      auto tmp = scratch.push_array<T>(attr.size());
+      if(tmp.empty()) {
+        return false;
+      }
+      for(std::size_t v{ 0 }; v < attr.size(); ++v) {
+        tmp[remap[v]] = attr[v];
+      }
+      std::memcpy(attr.data(), tmp.data(), tmp.bytes());
+      return true;
+    }
+
+    bool optimise_vertex_fetch(mesh& m, arena& scratch) noexcept
+    {
+      std::size_t const num_vertices{ m.vertices.size() };
+      if(num_vertices == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      auto remap = scratch.push_array<unsigned int>(num_vertices);
+      if(remap.empty()) {
+        return out_of_memory(__FUNCTION__);
+      }
+      unsigned int constexpr unused{ ~0u };
+      for(auto& r : remap) {
+        r = unused;
+      }
+      unsigned int next{ 0 };
+      for(auto const i : m.indices) {
+        if(remap[i] == unused) {
+          remap[i] = next++;
+        }
+      }
+      // vertices nobody uses go at the end, they're kept so the vertex count doesn't change under you
+      for(auto& r : remap) {
+        if(r == unused) {
+          r = next++;
+        }
+      }
+      if(!permute(m.vertices, remap, scratch) || !permute(m.normals, remap, scratch) ||
+         !permute(m.uvs, remap, scratch) || !permute(m.tangents, remap, scratch)) {
+        return out_of_memory(__FUNCTION__);
+      }
+      for(auto& i : m.indices) {
+        i = remap[i];
+      }
+      return true;
+    }
+
+    bool optimise(mesh& m, arena& scratch, optimise_report* report) noexcept
+    {
+      if(report) {
+        report->before = analyse_vertex_cache(m.indices, m.vertices.size(), scratch);
+      }
+      if(!optimise_vertex_cache(m, scratch) || !optimise_overdraw(m, scratch) || !optimise_vertex_fetch(m, scratch)) {
+        return false;
+      }
+      if(report) {
+        report->after = analyse_vertex_cache(m.indices, m.vertices.size(), scratch);
+      }
+      return true;
+    }
+
+  };
+};
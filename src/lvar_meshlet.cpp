@@ -0,0 +1,272 @@
+#include "lvar_meshlet.h"
+#include "lvar_mesh_opt.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstring>              // memcpy
+
+namespace lvar {
+  namespace obj {
+
+    namespace {
+
+      v3 vertex_pos(mesh const& m, unsigned int const i) noexcept
+      {
+        vertex const& v{ m.vertices[i] };
+        return { v.x, v.y, v.z };
+      }
+
+      float distance_sq(v3 const& a, v3 const& b) noexcept
+      {
+        v3 const d{ sub(a, b) };
+        return dot(d, d);
+      }
+
+      // Ritter's bounding sphere, not the smallest one but close enough and it's O(n)
+      void bounding_sphere(mesh const& m, slice<unsigned int> const& verts, meshlet& ml) noexcept
+      {
+        v3 const p0{ vertex_pos(m, verts[0]) };
+        v3 p1{ p0 };
+        for(auto const v : verts) {
+          if(distance_sq(vertex_pos(m, v), p0) > distance_sq(p1, p0)) {
+            p1 = vertex_pos(m, v);
+          }
+        }
+        v3 p2{ p1 };
+        for(auto const v : verts) {
+          if(distance_sq(vertex_pos(m, v), p1) > distance_sq(p2, p1)) {
+            p2 = vertex_pos(m, v);
+          }
+        }
+        v3 centre{ scale(add(p1, p2), 0.5f) };
+        float radius{ std::sqrt(distance_sq(p1, p2)) * 0.5f };
+        for(auto const v : verts) {
+          v3 const p{ vertex_pos(m, v) };
+          float const d{ std::sqrt(distance_sq(p, centre)) };
+          if(d > radius) {
+            // grow just enough to contain p, moving the centre towards it
+            float const new_radius{ (radius + d) * 0.5f };
+            centre = add(centre, scale(sub(p, centre), (new_radius - radius) / d));
+            radius = new_radius;
+          }
+        }
+        ml.centre = centre;
+        ml.radius = radius;
+      }
+
+      // the axis is the avg normal, the angle is the one of the normal that's furthest from it. the apex
+      // is moved back along the axis until it's behind all the triangles, otherwise the camera could be
+      // in the cone while seeing the front of a triangle near the edge of the meshlet
+      void normal_cone(mesh const& m, meshlet& ml) noexcept
+      {
+        v3 axis{ 0.0f, 0.0f, 0.0f };
+        for(unsigned int i{ ml.index_offset }; i < ml.index_offset + ml.index_count; i += 3) {
+          v3 const a{ vertex_pos(m, m.indices[i]) };
+          v3 const n{ normalise(cross(sub(vertex_pos(m, m.indices[i + 1]), a), sub(vertex_pos(m, m.indices[i + 2]), a))) };
+          axis = add(axis, n);
+        }
+        axis = normalise(axis);
+        float min_dot{ 1.0f };
+        for(unsigned int i{ ml.index_offset }; i < ml.index_offset + ml.index_count; i += 3) {
+          v3 const a{ vertex_pos(m, m.indices[i]) };
+          v3 const n{ normalise(cross(sub(vertex_pos(m, m.indices[i + 1]), a), sub(vertex_pos(m, m.indices[i + 2]), a))) };
+          if(dot(n, n) > 0.0f) {
+            min_dot = std::min(min_dot, dot(n, axis));
+          }
+        }
+        ml.cone_axis = axis;
+        ml.cone_apex = ml.centre;
+        // cone too wide (or no valid triangles at all), it'd never be culled, don't bother
+        if(dot(axis, axis) == 0.0f || min_dot <= 0.1f) {
+          ml.cone_cutoff = 1.0f;
+          return;
+        }
+        float max_t{ 0.0f };
+        for(unsigned int i{ ml.index_offset }; i < ml.index_offset + ml.index_count; i += 3) {
+          v3 const a{ vertex_pos(m, m.indices[i]) };
+          v3 const n{ normalise(cross(sub(vertex_pos(m, m.indices[i + 1]), a), sub(vertex_pos(m, m.indices[i + 2]), a))) };
+          float const dn{ dot(n, axis) };
+          if(dot(n, n) == 0.0f || dn <= 0.0f) {
+            continue;
+          }
+          // apex = centre - axis * t must be on the back side of the plane of every triangle
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            float const t{ dot(sub(ml.centre, vertex_pos(m, m.indices[i + k])), n) / dn };
+            max_t = std::max(max_t, t);
+          }
+        }
+        ml.cone_apex = sub(ml.centre, scale(axis, max_t));
+        ml.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+      }
+
+      bool out_of_arena(char const* fx) noexcept
+      {
+        std::cerr << fx << ": arena is too small\n";
+        return false;
+      }
+
+    };
+
+    // the meshlets of one submesh (m only has its indices) after the ones that are in meshlets already.
+    // the offsets are in the index buffer of the whole mesh, base is where m's indices start in there
+    static bool build_meshlets_range(mesh& m,
+                                     std::size_t const base,
+                                     unsigned int const submesh,
+                                     slice<meshlet> meshlets,
+                                     std::size_t& num_meshlets,
+                                     arena& scratch,
+                                     unsigned int const max_vertices,
+                                     unsigned int const max_triangles) noexcept
+    {
+      std::size_t const num_tris{ m.num_faces() };
+      std::size_t const num_vertices{ m.vertices.size() };
+      if(num_tris == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      adjacency adj;
+      if(!build_adjacency(m.indices, num_vertices, scratch, adj)) {
+        return out_of_arena(__FUNCTION__);
+      }
+      auto emitted = scratch.push_array<unsigned char>(num_tris);
+      auto owner = scratch.push_array<unsigned int>(num_vertices); // meshlet that last used the vertex, + 1
+      auto verts = scratch.push_array<unsigned int>(max_vertices);
+      auto indices = scratch.push_array<unsigned int>(m.indices.size());
+      if(emitted.empty() || owner.empty() || verts.empty() || indices.empty()) {
+        return out_of_arena(__FUNCTION__);
+      }
+      std::memset(emitted.data(), 0, emitted.bytes());
+      std::memset(owner.data(), 0, owner.bytes());
+      std::size_t const first{ num_meshlets };
+      std::size_t written{ 0 };
+      std::size_t cursor{ 0 };
+      while(written < m.indices.size()) {
+        while(emitted[cursor]) {
+          ++cursor;
+        }
+        unsigned int const id{ static_cast<unsigned int>(num_meshlets - first + 1) };
+        meshlet& ml{ meshlets[num_meshlets++] };
+        ml.index_offset = static_cast<unsigned int>(written);
+        ml.submesh = submesh;
+        unsigned int num_verts{ 0 };
+        unsigned int num_meshlet_tris{ 0 };
+        long long t{ static_cast<long long>(cursor) };
+        while(t >= 0) {
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            unsigned int const v{ m.indices[t * 3 + k] };
+            if(owner[v] != id) {
+              owner[v] = id;
+              verts[num_verts++] = v;
+            }
+            indices[written++] = v;
+          }
+          emitted[t] = 1;
+          if(++num_meshlet_tris == max_triangles) {
+            break;
+          }
+          // next triangle: the one around the meshlet that adds the fewest new vertices. look around the
+          // last triangle first, it's where the good ones are most of the time, and only then around the
+          // whole meshlet
+          long long best{ -1 };
+          unsigned int best_new{ 4 };
+          auto const look_around = [&](unsigned int const v) {
+            for(unsigned int a{ adj.offsets[v] }; a < adj.offsets[v + 1]; ++a) {
+              unsigned int const u{ adj.tris[a] };
+              if(emitted[u]) {
+                continue;
+              }
+              unsigned int added{ 0 };
+              for(unsigned int k{ 0 }; k < 3; ++k) {
+                added += owner[m.indices[u * 3 + k]] != id ? 1 : 0;
+              }
+              if(num_verts + added > max_vertices) {
+                continue;
+              }
+              if(added < best_new || (added == best_new && u < best)) {
+                best_new = added;
+                best = u;
+              }
+            }
+          };
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            look_around(m.indices[t * 3 + k]);
+          }
+          if(best == -1) {
+            for(unsigned int i{ 0 }; i < num_verts; ++i) {
+              look_around(verts[i]);
+            }
+          }
+          t = best;
+        }
+        ml.index_count = static_cast<unsigned int>(written) - ml.index_offset;
+        bounding_sphere(m, slice<unsigned int>{ verts.data(), num_verts }, ml);
+      }
+      std::memcpy(m.indices.data(), indices.data(), indices.bytes());
+      for(std::size_t i{ first }; i < num_meshlets; ++i) {
+        normal_cone(m, meshlets[i]);
+        meshlets[i].index_offset += static_cast<unsigned int>(base);
+      }
+      return true;
+    }
+
+    bool build_meshlets(mesh& m,
+                        slice<meshlet>& out,
+                        arena& mem,
+                        arena& scratch,
+                        unsigned int const max_vertices,
+                        unsigned int const max_triangles) noexcept
+    {
+      assert(max_vertices >= 3 && max_triangles >= 1);
+      std::size_t const num_tris{ m.num_faces() };
+      out = {};
+      if(num_tris == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      // never more than a meshlet per triangle, whatever the submeshes are
+      auto meshlets = scratch.push_array<meshlet>(num_tris);
+      if(meshlets.empty()) {
+        return out_of_arena(__FUNCTION__);
+      }
+      std::size_t num_meshlets{ 0 };
+      unsigned int submesh{ 0 };
+      bool const ok{ for_each_submesh(m, [&](mesh& part) {
+        std::size_t const base{ static_cast<std::size_t>(part.indices.data() - m.indices.data()) };
+        return build_meshlets_range(part, base, submesh++, meshlets, num_meshlets, scratch, max_vertices, max_triangles);
+      }) };
+      if(!ok) {
+        return false;
+      }
+      out = mem.push_array<meshlet>(num_meshlets);
+      if(out.empty()) {
+        return out_of_arena(__FUNCTION__);
+      }
+      std::memcpy(out.data(), meshlets.data(), out.bytes());
+      return true;
+    }
+
+    std::size_t cull_meshlets(slice<meshlet> const& meshlets,
+                              frustum const& f,
+                              v3 const& camera_pos,
+                              draw_range* out) noexcept
+    {
+      std::size_t count{ 0 };
+      for(auto const& ml : meshlets) {
+        if(!sphere_in_frustum(f, ml.centre, ml.radius)) {
+          continue;
+        }
+        if(ml.cone_cutoff < 1.0f && dot(normalise(sub(ml.cone_apex, camera_pos)), ml.cone_axis) >= ml.cone_cutoff) {
+          continue;
+        }
+        draw_range* const last{ count > 0 ? &out[count - 1] : nullptr };
+        if(last && last->submesh == ml.submesh && last->index_offset + last->index_count == ml.index_offset) {
+          last->index_count += ml.index_count;
+        } else {
+          out[count++] = { ml.index_offset, ml.index_count, ml.submesh };
+        }
+      }
+      return count;
+    }
+
+  };
+};
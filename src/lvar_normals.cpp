@@ -0,0 +1,316 @@
+#include "lvar_normals.h"
+#include "lvar_mesh_opt.h"
+#include "lvar_jobs.h"
+#include "lvar_math.h"
+
+#include <algorithm>            // clamp
+#include <iostream>
+#include <cmath>
+#include <cstring>              // memcpy
+
+namespace lvar {
+  namespace obj {
+
+    namespace {
+
+      std::size_t constexpr min_chunk{ 4096 };
+
+      // structure of arrays, the parallel loops write whole ranges of these with no gaps
+      class soa3 final {
+      public:
+        bool push(arena& mem, std::size_t const n) noexcept
+        {
+          x = mem.push_array<float>(n);
+          y = mem.push_array<float>(n);
+          z = mem.push_array<float>(n);
+          return n == 0 || (!x.empty() && !y.empty() && !z.empty());
+        }
+        v3 get(std::size_t const i) const noexcept { return { x[i], y[i], z[i] }; }
+        void set(std::size_t const i, v3 const& v) noexcept
+        {
+          x[i] = v.x;
+          y[i] = v.y;
+          z[i] = v.z;
+        }
+      public:
+        slice<float> x;
+        slice<float> y;
+        slice<float> z;
+      };
+
+      v3 position(mesh const& m, unsigned int const i) noexcept
+      {
+        vertex const& v{ m.vertices[i] };
+        return { v.x, v.y, v.z };
+      }
+
+      // angle of the triangle at corner k
+      float corner_angle(v3 const& p, v3 const& prev, v3 const& next) noexcept
+      {
+        float const d{ dot(normalise(sub(prev, p)), normalise(sub(next, p))) };
+        return std::acos(std::clamp(d, -1.0f, 1.0f));
+      }
+
+      // a triangle can use the same vertex twice (degenerate), then it's twice in the adjacency of the
+      // vertex, one after the other. calls fx(corner) once for every corner of t that uses v.
+      template<typename F>
+      void for_each_corner(adjacency const& adj, slice<unsigned int> const& indices, unsigned int const v, F const& fx)
+      {
+        for(unsigned int a{ adj.offsets[v] }; a < adj.offsets[v + 1]; ++a) {
+          unsigned int const t{ adj.tris[a] };
+          if(a > adj.offsets[v] && adj.tris[a - 1] == t) {
+            continue;
+          }
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            if(indices[t * 3 + k] == v) {
+              fx(t * 3 + k);
+            }
+          }
+        }
+      }
+
+      template<typename T>
+      bool grow(slice<T>& attr, std::size_t const n, slice<unsigned int> const& source, arena& mem) noexcept
+      {
+        if(attr.empty()) {
+          return true;
+        }
+        auto bigger = mem.push_array<T>(n);
+        if(bigger.empty()) {
+          return false;
+        }
+        for(std::size_t v{ 0 }; v < n; ++v) {
+          bigger[v] = attr[source[v]];
+        }
+        attr = bigger;
+        return true;
+      }
+
+      bool arena_too_small(char const* fx) noexcept
+      {
+        std::cerr << fx << ": arena is too small\n";
+        return false;
+      }
+
+    };
+
+    bool generate_normals(mesh& m,
+                          arena& mem,
+                          arena& scratch,
+                          float const crease_degrees,
+                          normal_weight const weight) noexcept
+    {
+      std::size_t const num_tris{ m.num_faces() };
+      std::size_t const num_vertices{ m.vertices.size() };
+      std::size_t const num_corners{ num_tris * 3 };
+      if(num_vertices == 0) {
+        return true;
+      }
+      arena_scope scope(scratch);
+      soa3 face;                // unit normal of every face
+      soa3 contrib;             // weighted normal every corner adds to its vertex
+      if(!face.push(scratch, num_tris) || !contrib.push(scratch, num_corners)) {
+        return arena_too_small(__FUNCTION__);
+      }
+      jobs::parallel_for(num_tris, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+        for(std::size_t t{ begin }; t < end; ++t) {
+          v3 const p[3]{ position(m, m.indices[t * 3]), position(m, m.indices[t * 3 + 1]), position(m, m.indices[t * 3 + 2]) };
+          v3 const n{ cross(sub(p[1], p[0]), sub(p[2], p[0])) }; // length is 2 * area
+          v3 const unit{ normalise(n) };
+          face.set(t, unit);
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            if(weight == normal_weight::angle) {
+              contrib.set(t * 3 + k, scale(unit, corner_angle(p[k], p[(k + 2) % 3], p[(k + 1) % 3])));
+            } else {
+              contrib.set(t * 3 + k, n);
+            }
+          }
+        }
+      });
+      adjacency adj;
+      if(!build_adjacency(m.indices, num_vertices, scratch, adj)) {
+        return arena_too_small(__FUNCTION__);
+      }
+      if(crease_degrees >= 180.0f) {
+        // everything smooth, one normal per vertex
+        if(m.normals.size() != num_vertices) {
+          m.normals = mem.push_array<normal>(num_vertices);
+          if(m.normals.empty()) {
+            return arena_too_small(__FUNCTION__);
+          }
+        }
+        jobs::parallel_for(num_vertices, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+          for(std::size_t v{ begin }; v < end; ++v) {
+            v3 sum{ 0.0f, 0.0f, 0.0f };
+            for_each_corner(adj, m.indices, static_cast<unsigned int>(v), [&](unsigned int const c) {
+              sum = add(sum, contrib.get(c));
+            });
+            v3 const n{ normalise(sum) };
+            m.normals[v] = { n.x, n.y, n.z };
+          }
+        });
+        return true;
+      }
+      // with creases every corner only takes the faces around its vertex that are within the crease
+      // angle of its own face, and corners of the same vertex that end up with different normals need
+      // different vertices
+      float const cos_crease{ std::cos(radians(crease_degrees)) };
+      soa3 corner;
+      auto group = scratch.push_array<unsigned int>(num_corners);   // which copy of the vertex the corner uses
+      auto extra = scratch.push_array<unsigned int>(num_vertices);  // how many copies each vertex needs
+      auto indices = scratch.push_array<unsigned int>(num_corners);
+      if(!corner.push(scratch, num_corners) || (num_corners && (group.empty() || indices.empty())) || extra.empty()) {
+        return arena_too_small(__FUNCTION__);
+      }
+      jobs::parallel_for(num_vertices, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+        for(std::size_t v{ begin }; v < end; ++v) {
+          unsigned int groups{ 0 };
+          unsigned int const vertex{ static_cast<unsigned int>(v) };
+          for_each_corner(adj, m.indices, vertex, [&](unsigned int const c) {
+            v3 const own{ face.get(c / 3) };
+            v3 sum{ 0.0f, 0.0f, 0.0f };
+            for_each_corner(adj, m.indices, vertex, [&](unsigned int const o) {
+              if(dot(own, face.get(o / 3)) >= cos_crease) {
+                sum = add(sum, contrib.get(o));
+              }
+            });
+            v3 const n{ normalise(sum) };
+            corner.set(c, n);
+            // same set of faces -> same sum in the same order -> exactly the same floats
+            group[c] = groups;
+            bool found{ false };
+            for_each_corner(adj, m.indices, vertex, [&](unsigned int const o) {
+              if(!found && o != c && group[o] < groups && corner.x[o] == n.x && corner.y[o] == n.y &&
+                 corner.z[o] == n.z) {
+                group[c] = group[o];
+                found = true;
+              }
+              // only corners that come before c have a group yet
+              if(o == c) {
+                found = true;
+              }
+            });
+            groups += group[c] == groups ? 1 : 0;
+          });
+          extra[v] = groups > 0 ? groups - 1 : 0;
+        }
+      });
+      // copies go after the original vertices, in vertex order
+      auto base = scratch.push_array<unsigned int>(num_vertices);
+      if(base.empty()) {
+        return arena_too_small(__FUNCTION__);
+      }
+      std::size_t total{ num_vertices };
+      for(std::size_t v{ 0 }; v < num_vertices; ++v) {
+        base[v] = static_cast<unsigned int>(total);
+        total += extra[v];
+      }
+      auto source = scratch.push_array<unsigned int>(total);        // new vertex -> old vertex
+      if(source.empty()) {
+        return arena_too_small(__FUNCTION__);
+      }
+      for(std::size_t v{ 0 }; v < num_vertices; ++v) {
+        source[v] = static_cast<unsigned int>(v);
+        for(unsigned int e{ 0 }; e < extra[v]; ++e) {
+          source[base[v] + e] = static_cast<unsigned int>(v);
+        }
+      }
+      if(total != num_vertices) {
+        if(!grow(m.vertices, total, source, mem) || !grow(m.uvs, total, source, mem) ||
+           !grow(m.tangents, total, source, mem)) {
+          return arena_too_small(__FUNCTION__);
+        }
+        m.normals = {};
+      }
+      if(m.normals.size() != total) {
+        m.normals = mem.push_array<normal>(total);
+        if(m.normals.empty()) {
+          return arena_too_small(__FUNCTION__);
+        }
+      }
+      jobs::parallel_for(num_vertices, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+        for(std::size_t v{ begin }; v < end; ++v) {
+          for_each_corner(adj, m.indices, static_cast<unsigned int>(v), [&](unsigned int const c) {
+            unsigned int const id{ group[c] == 0 ? static_cast<unsigned int>(v) : base[v] + group[c] - 1 };
+            indices[c] = id;
+            m.normals[id] = { corner.x[c], corner.y[c], corner.z[c] };
+          });
+        }
+      });
+      std::memcpy(m.indices.data(), indices.data(), indices.bytes());
+      return true;
+    }
+
+    bool generate_tangents(mesh& m, arena& mem, arena& scratch) noexcept
+    {
+      std::size_t const num_tris{ m.num_faces() };
+      std::size_t const num_vertices{ m.vertices.size() };
+      if(num_vertices == 0) {
+        return true;
+      }
+      if(m.normals.size() != num_vertices || m.uvs.size() != num_vertices) {
+        std::cerr << __FUNCTION__ << ": tangents need normals and uvs\n";
+        return false;
+      }
+      arena_scope scope(scratch);
+      soa3 tan;
+      soa3 bitan;
+      if(!tan.push(scratch, num_tris * 3) || !bitan.push(scratch, num_tris * 3)) {
+        return arena_too_small(__FUNCTION__);
+      }
+      jobs::parallel_for(num_tris, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+        for(std::size_t t{ begin }; t < end; ++t) {
+          unsigned int const i[3]{ m.indices[t * 3], m.indices[t * 3 + 1], m.indices[t * 3 + 2] };
+          v3 const p[3]{ position(m, i[0]), position(m, i[1]), position(m, i[2]) };
+          v3 const e1{ sub(p[1], p[0]) };
+          v3 const e2{ sub(p[2], p[0]) };
+          float const du1{ m.uvs[i[1]].u - m.uvs[i[0]].u }, dv1{ m.uvs[i[1]].v - m.uvs[i[0]].v };
+          float const du2{ m.uvs[i[2]].u - m.uvs[i[0]].u }, dv2{ m.uvs[i[2]].v - m.uvs[i[0]].v };
+          float const det{ du1 * dv2 - du2 * dv1 };
+          // uvs collapsed to a line or a point, this triangle can't tell you anything
+          bool const degenerate{ std::fabs(det) < 1e-12f };
+          float const r{ degenerate ? 0.0f : 1.0f / det };
+          v3 const sdir{ normalise(scale(sub(scale(e1, dv2), scale(e2, dv1)), r)) };
+          v3 const tdir{ normalise(scale(sub(scale(e2, du1), scale(e1, du2)), r)) };
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            float const angle{ corner_angle(p[k], p[(k + 2) % 3], p[(k + 1) % 3]) };
+            tan.set(t * 3 + k, scale(sdir, angle));
+            bitan.set(t * 3 + k, scale(tdir, angle));
+          }
+        }
+      });
+      adjacency adj;
+      if(!build_adjacency(m.indices, num_vertices, scratch, adj)) {
+        return arena_too_small(__FUNCTION__);
+      }
+      if(m.tangents.size() != num_vertices) {
+        m.tangents = mem.push_array<tangent>(num_vertices);
+        if(m.tangents.empty()) {
+          return arena_too_small(__FUNCTION__);
+        }
+      }
+      jobs::parallel_for(num_vertices, min_chunk, [&](std::size_t const begin, std::size_t const end) {
+        for(std::size_t v{ begin }; v < end; ++v) {
+          v3 t{ 0.0f, 0.0f, 0.0f };
+          v3 b{ 0.0f, 0.0f, 0.0f };
+          for_each_corner(adj, m.indices, static_cast<unsigned int>(v), [&](unsigned int const c) {
+            t = add(t, tan.get(c));
+            b = add(b, bitan.get(c));
+          });
+          v3 const n{ m.normals[v].x, m.normals[v].y, m.normals[v].z };
+          // gram-schmidt, remove the part of t that goes along n
+          v3 tn{ normalise(sub(t, scale(n, dot(n, t)))) };
+          if(dot(tn, tn) == 0.0f) {
+            // no uv info at all, any vector perpendicular to n will do
+            v3 const axis{ std::fabs(n.x) < 0.9f ? v3{ 1.0f, 0.0f, 0.0f } : v3{ 0.0f, 1.0f, 0.0f } };
+            tn = normalise(cross(axis, n));
+          }
+          float const w{ dot(cross(n, tn), b) < 0.0f ? -1.0f : 1.0f };
+          m.tangents[v] = { tn.x, tn.y, tn.z, w };
+        }
+      });
+      return true;
+    }
+
+  };
+};
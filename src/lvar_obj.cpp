@@ -5,19 +5,27 @@
 #include <fcntl.h>              // open
 #include <sys/stat.h>           // fstat
 #include <sys/mman.h>           // mmap, munmap
-#include <cstdio>               // sscanf
+#include <charconv>             // from_chars
+#include <cstring>              // memchr
 #include <unistd.h>             // close
 #include <string.h>             // strerror
+#include <algorithm>            // min
+#include <string_view>
 
 namespace lvar {
   namespace obj {
 
+    static unsigned int constexpr invalid_index{ ~0u };
+
     // avoid fkin leaks
     class raiifile final {
     public:
       raiifile(char const* filepath)
+        : data{ nullptr },
+          sz{ 0 },
+          fd{ -1 },
+          err{ false }
       {
-        err = false;
         fd = open(filepath, O_RDONLY);
         if(fd == -1) {
           std::cerr << "couldn't open file " << filepath << '\n';
@@ -42,8 +50,12 @@ namespace lvar {
       }
       ~raiifile()
       {
-        munmap(data, sz);
-        close(fd);
+        if(data && data != MAP_FAILED) {
+          munmap(data, sz);
+        }
+        if(fd != -1) {
+          close(fd);
+        }
       }
       auto ptr() const noexcept { return data; }
       auto size() const noexcept { return sz; }
@@ -55,56 +67,955 @@ namespace lvar {
       bool err;
     };
 
-    bool parse_file(char const* filepath, mesh& o)
+    // @NOTE: sscanf calls strlen on its input, and the input here is the rest of the file (which isn't
+    // even null terminated), so every line would be O(file size). these ones stop at the end of the line.
+    static char const* skip_spaces(char const* p, char const* end) noexcept
+    {
+      while(p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+      }
+      return p;
+    }
+
+    static bool parse_float(char const*& p, char const* end, float& out) noexcept
+    {
+      p = skip_spaces(p, end);
+      auto const [ptr, ec] = std::from_chars(p, end, out);
+      if(ec != std::errc{}) {
+        return false;
+      }
+      p = ptr;
+      return true;
+    }
+
+    // .obj indices start at 1 and can be negative, meaning relative to the last element read so far
+    static bool parse_index(char const*& p, char const* end, std::size_t const count, unsigned int& out) noexcept
+    {
+      long long i{ 0 };
+      auto const [ptr, ec] = std::from_chars(p, end, i);
+      if(ec != std::errc{}) {
+        return false;
+      }
+      p = ptr;
+      long long const resolved{ i < 0 ? static_cast<long long>(count) + i : i - 1 };
+      // out of range is still parsed fine, it's up to the caller what to do with it
+      out = (resolved < 0 || resolved >= static_cast<long long>(count)) ? invalid_index
+                                                                        : static_cast<unsigned int>(resolved);
+      return true;
+    }
+
+    static bool is_keyword(char const* p, char const* end, char const c) noexcept
+    {
+      return p + 1 < end && p[0] == c && (p[1] == ' ' || p[1] == '\t');
+    }
+
+    static bool is_keyword(char const* p, char const* end, char const c0, char const c1) noexcept
+    {
+      return p + 2 < end && p[0] == c0 && p[1] == c1 && (p[2] == ' ' || p[2] == '\t');
+    }
+
+    static bool is_keyword(char const* p, char const* end, char const* k) noexcept
+    {
+      std::size_t const len{ std::strlen(k) };
+      return static_cast<std::size_t>(end - p) > len && std::memcmp(p, k, len) == 0 && (p[len] == ' ' || p[len] == '\t');
+    }
+
+    static char const* next_line(char const* p, char const* end) noexcept
+    {
+      p = static_cast<char const*>(std::memchr(p, '\n', end - p));
+      return p ? p + 1 : end;
+    }
+
+    static char const* line_end(char const* p, char const* end) noexcept
+    {
+      while(p < end && *p != '\n' && *p != '\r' && *p != '#') {
+        ++p;
+      }
+      return p;
+    }
+
+    static char const* token_end(char const* p, char const* end) noexcept
+    {
+      while(p < end && *p != ' ' && *p != '\t') {
+        ++p;
+      }
+      return p;
+    }
+
+    // [begin, end) into a null terminated out, false (and empty) if it doesn't fit
+    static bool copy_string(char const* begin, char const* end, char* out, std::size_t const size) noexcept
+    {
+      std::size_t const len{ static_cast<std::size_t>(end - begin) };
+      if(len >= size) {
+        out[0] = '\0';
+        return false;
+      }
+      std::memcpy(out, begin, len);
+      out[len] = '\0';
+      return true;
+    }
+
+    // files named in an .obj/.mtl are relative to the directory of the file that names them
+    static bool resolve_path(char const* base_file, char const* name, char const* name_end, char* out,
+                             std::size_t const size) noexcept
+    {
+      char const* const slash{ std::strrchr(base_file, '/') };
+      std::size_t const dir_len{ (slash && *name != '/') ? static_cast<std::size_t>(slash - base_file) + 1 : 0 };
+      std::size_t const len{ static_cast<std::size_t>(name_end - name) };
+      if(dir_len + len >= size) {
+        out[0] = '\0';
+        return false;
+      }
+      std::memcpy(out, base_file, dir_len);
+      std::memcpy(out + dir_len, name, len);
+      out[dir_len + len] = '\0';
+      return true;
+    }
+
+    // one corner of a face: v, v/vt, v//vn or v/vt/vn
+    class corner final {
+    public:
+      unsigned int v;
+      unsigned int vt;
+      unsigned int vn;
+    };
+
+    static bool parse_corner(char const*& p, char const* end, std::size_t const num_v, std::size_t const num_vt,
+                             std::size_t const num_vn, corner& c) noexcept
+    {
+      c = { invalid_index, invalid_index, invalid_index };
+      if(!parse_index(p, end, num_v, c.v)) {
+        return false;
+      }
+      if(p < end && *p == '/') {
+        ++p;
+        if(p < end && *p != '/' && !parse_index(p, end, num_vt, c.vt)) {
+          return false;
+        }
+        if(p < end && *p == '/') {
+          ++p;
+          if(!parse_index(p, end, num_vn, c.vn)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+    // (v, vt, vn) -> vertex, open addressing. only used when the file has uvs or normals, those need
+    // a vertex per unique combination bc opengl only has one index buffer for everything.
+    class corner_table final {
+    public:
+      corner_table(slice<corner> k, slice<unsigned int> v) noexcept
+        : keys{ k },
+          values{ v },
+          mask{ k.size() - 1 }
+      {
+        assert((k.size() & mask) == 0);
+        for(auto& i : values) {
+          i = invalid_index;
+        }
+      }
+      // returns the vertex of the corner, inserting it with next if it's not there
+      unsigned int insert(corner const& c, unsigned int const next) noexcept
+      {
+        std::size_t h{ (c.v * 73856093u) ^ (c.vt * 19349663u) ^ (c.vn * 83492791u) };
+        for(h &= mask; ; h = (h + 1) & mask) {
+          if(values[h] == invalid_index) {
+            keys[h] = c;
+            values[h] = next;
+            return next;
+          }
+          if(keys[h].v == c.v && keys[h].vt == c.vt && keys[h].vn == c.vn) {
+            return values[h];
+          }
+        }
+      }
+    private:
+      slice<corner> keys;
+      slice<unsigned int> values;
+      std::size_t const mask;
+    };
+
+    static std::size_t count_materials(char const* mtl_path) noexcept
+    {
+      raiifile file(mtl_path);
+      if(file.error()) {
+        return 0;
+      }
+      char const* const end{ file.ptr() + file.size() };
+      std::size_t n{ 0 };
+      for(char const* p{ file.ptr() }; p < end; p = next_line(p, end)) {
+        n += is_keyword(skip_spaces(p, end), end, "newmtl") ? 1 : 0;
+      }
+      return n;
+    }
+
+    static void parse_colour(char const* p, char const* end, float out[3]) noexcept
+    {
+      // "Kd r" is the same as "Kd r r r"
+      if(parse_float(p, end, out[0]) && (!parse_float(p, end, out[1]) || !parse_float(p, end, out[2]))) {
+        out[1] = out[2] = out[0];
+      }
+    }
+
+    // map_Kd -s 1 1 1 -bm 0.5 tex.png: the options go first, the file is the last thing on the line
+    static void parse_map(char const* mtl_path, char const* p, char const* le, char* out, std::size_t const size) noexcept
+    {
+      while(le > p && (le[-1] == ' ' || le[-1] == '\t')) {
+        --le;
+      }
+      char const* name{ le };
+      while(name > p && name[-1] != ' ' && name[-1] != '\t') {
+        --name;
+      }
+      if(name == le || !resolve_path(mtl_path, name, le, out, size)) {
+        std::cerr << "parse_mtl: bad texture path in " << mtl_path << '\n';
+      }
+    }
+
+    // appends the materials of the file to mats, which has room for count_materials() of them
+    static void parse_mtl(char const* mtl_path, slice<material>& mats, std::size_t& num) noexcept
+    {
+      raiifile file(mtl_path);
+      if(file.error()) {
+        return;
+      }
+      char const* const end{ file.ptr() + file.size() };
+      material* m{ nullptr };
+      for(char const* curr{ file.ptr() }; curr < end; curr = next_line(curr, end)) {
+        char const* const p{ skip_spaces(curr, end) };
+        char const* const le{ line_end(p, end) };
+        if(is_keyword(p, le, "newmtl")) {
+          if(num == mats.size()) {
+            return;             // the file changed since it was counted
+          }
+          m = &mats[num++];
+          *m = material{ {}, { 0.0f, 0.0f, 0.0f }, { 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f }, 0.0f, 1.0f, {}, {}, {}, no_layer };
+          char const* const name{ skip_spaces(p + 6, le) };
+          copy_string(name, token_end(name, le), m->name, sizeof(m->name));
+        } else if(!m) {
+          continue;
+        } else if(is_keyword(p, le, 'K', 'a')) {
+          parse_colour(p + 2, le, m->ambient);
+        } else if(is_keyword(p, le, 'K', 'd')) {
+          parse_colour(p + 2, le, m->diffuse);
+        } else if(is_keyword(p, le, 'K', 's')) {
+          parse_colour(p + 2, le, m->specular);
+        } else if(is_keyword(p, le, 'N', 's')) {
+          char const* q{ p + 2 };
+          parse_float(q, le, m->shininess);
+        } else if(is_keyword(p, le, 'd')) {
+          char const* q{ p + 1 };
+          parse_float(q, le, m->opacity);
+        } else if(is_keyword(p, le, 'T', 'r')) {
+          char const* q{ p + 2 };
+          float tr{ 0.0f };
+          if(parse_float(q, le, tr)) {
+            m->opacity = 1.0f - tr;
+          }
+        } else if(is_keyword(p, le, "map_Kd")) {
+          parse_map(mtl_path, p + 6, le, m->diffuse_map, sizeof(m->diffuse_map));
+        } else if(is_keyword(p, le, "map_Ks")) {
+          parse_map(mtl_path, p + 6, le, m->specular_map, sizeof(m->specular_map));
+        } else if(is_keyword(p, le, "map_Bump") || is_keyword(p, le, "map_bump")) {
+          parse_map(mtl_path, p + 8, le, m->normal_map, sizeof(m->normal_map));
+        } else if(is_keyword(p, le, "bump") || is_keyword(p, le, "norm")) {
+          parse_map(mtl_path, p + 4, le, m->normal_map, sizeof(m->normal_map));
+        }
+      }
+    }
+
+    // calls fx(path) for every file in an mtllib line
+    template<typename F>
+    static void for_each_mtllib(char const* obj_path, char const* p, char const* le, F const& fx) noexcept
+    {
+      char path[512];
+      for(p = skip_spaces(p + 6, le); p < le; p = skip_spaces(p, le)) {
+        char const* const e{ token_end(p, le) };
+        if(resolve_path(obj_path, p, e, path, sizeof(path))) {
+          fx(static_cast<char const*>(path));
+        }
+        p = e;
+      }
+    }
+
+    bool parse_file(char const* filepath, mesh& o, arena& mem)
     {
       raiifile file(filepath);
       if(file.error()) {
         return false;
       }
-      // count lines
-      unsigned int ln{ 0 };
-      char* ptr{ file.ptr() };
-      for(std::size_t i{ 0 }; i < file.size(); ++i) {
-        if(ptr[i] == '\n') {
-          ++ln;
-        }
-      }
-      // do rough estimation of vertices and faces to reserve space, yolo ~60% faces, ~40% vertices
-      o.vertices.reserve(static_cast<unsigned int>(ln * 0.4));
-      o.faces.reserve(static_cast<unsigned int>(ln * 0.6));
-      o.indices.reserve(o.faces.capacity() * 3);
-      // parse
-      char* curr{ file.ptr() };
-      char const* end{ curr + file.size() };
-      while(curr < end) {
-        if(*curr == 'v') {
-          // vertex
-          vertex v;
-          if(std::sscanf(curr, "v %f %f %f", &v.x, &v.y, &v.z) != 3) {
+      o = mesh{};
+      char const* const begin{ file.ptr() };
+      char const* const end{ begin + file.size() };
+      // first pass, count exactly how many of everything there is so every array can be pushed into an
+      // arena in one go, no reallocations, no guessing
+      std::size_t num_v{ 0 }, num_vt{ 0 }, num_vn{ 0 };
+      std::size_t num_tris{ 0 };
+      std::size_t num_corners{ 0 };
+      std::size_t num_usemtl{ 0 };
+      std::size_t num_materials{ 0 };
+      for(char const* p{ begin }; p < end; p = next_line(p, end)) {
+        if(is_keyword(p, end, 'v')) {
+          ++num_v;
+        } else if(is_keyword(p, end, 'v', 't')) {
+          ++num_vt;
+        } else if(is_keyword(p, end, 'v', 'n')) {
+          ++num_vn;
+        } else if(is_keyword(p, end, "usemtl")) {
+          ++num_usemtl;
+        } else if(is_keyword(p, end, "mtllib")) {
+          for_each_mtllib(filepath, p, line_end(p, end), [&num_materials](char const* path) {
+            num_materials += count_materials(path);
+          });
+        } else if(is_keyword(p, end, 'f')) {
+          // count corners, polygons are turned into fans
+          std::size_t n{ 0 };
+          char const* const le{ line_end(p, end) };
+          for(char const* q{ skip_spaces(p + 1, le) }; q < le; q = skip_spaces(q, le)) {
+            ++n;
+            while(q < le && *q != ' ' && *q != '\t') {
+              ++q;
+            }
+          }
+          num_tris += n >= 3 ? n - 2 : 0;
+          num_corners += n;
+        }
+      }
+      bool const has_attrs{ num_vt > 0 || num_vn > 0 };
+      // everything that's only needed while parsing goes in here and it's gone when returning
+      std::size_t table_sz{ 16 };
+      while(has_attrs && table_sz < num_tris * 3 * 2) {
+        table_sz *= 2;
+      }
+      std::size_t const tmp_sz{ (num_v * sizeof(vertex) + num_vt * sizeof(texcoord) + num_vn * sizeof(normal) +
+                                 (has_attrs ? table_sz * (sizeof(corner) + sizeof(unsigned int)) : 0) +
+                                 num_tris * 3 * (sizeof(corner) + sizeof(unsigned int)) +
+                                 num_materials * sizeof(material) + (num_usemtl + 1) * sizeof(submesh) + 4096) };
+      arena tmp(tmp_sz + 64 * 16);
+      auto positions = tmp.push_array<vertex>(num_v);
+      auto uvs = tmp.push_array<texcoord>(num_vt);
+      auto normals = tmp.push_array<normal>(num_vn);
+      auto corners = tmp.push_array<corner>(num_tris * 3);
+      auto materials = tmp.push_array<material>(num_materials);
+      auto submeshes = tmp.push_array<submesh>(num_usemtl + 1);
+      if(tmp.error() || (num_v && positions.empty()) || (num_vt && uvs.empty()) || (num_vn && normals.empty()) ||
+         (num_tris && corners.empty()) || (num_materials && materials.empty()) || submeshes.empty()) {
+        std::cerr << __FUNCTION__ << ": couldn't allocate memory to parse " << filepath << '\n';
+        return false;
+      }
+      // second pass, parse everything
+      std::size_t vi{ 0 }, vti{ 0 }, vni{ 0 };
+      std::size_t ci{ 0 };
+      std::size_t skipped{ 0 };
+      std::size_t mi{ 0 };
+      std::size_t si{ 0 };
+      // the submesh that's open gets its count when the next one starts or at the end, empty ones are dropped
+      auto const close_submesh = [&submeshes, &si, &ci]() {
+        if(si > 0) {
+          submeshes[si - 1].index_count = static_cast<unsigned int>(ci - submeshes[si - 1].index_offset);
+          si -= submeshes[si - 1].index_count == 0 ? 1 : 0;
+        }
+      };
+      for(char const* curr{ begin }; curr < end; curr = next_line(curr, end)) {
+        if(is_keyword(curr, end, "mtllib")) {
+          for_each_mtllib(filepath, curr, line_end(curr, end), [&materials, &mi](char const* path) {
+            parse_mtl(path, materials, mi);
+          });
+        } else if(is_keyword(curr, end, "usemtl")) {
+          char const* const le{ line_end(curr, end) };
+          char const* const name{ skip_spaces(curr + 6, le) };
+          std::size_t const len{ static_cast<std::size_t>(token_end(name, le) - name) };
+          unsigned int id{ no_material };
+          for(std::size_t i{ 0 }; i < mi && id == no_material; ++i) {
+            if(std::strlen(materials[i].name) == len && std::memcmp(materials[i].name, name, len) == 0) {
+              id = static_cast<unsigned int>(i);
+            }
+          }
+          if(id == no_material) {
+            std::cerr << __FUNCTION__ << ": unknown material " << std::string_view(name, len) << " in " << filepath << '\n';
+          }
+          // faces before the first usemtl don't have a material
+          if(si == 0 && ci > 0) {
+            submeshes[si++] = { 0, 0, no_material };
+          }
+          close_submesh();
+          if(si == 0 || submeshes[si - 1].material != id) {
+            submeshes[si++] = { static_cast<unsigned int>(ci), 0, id };
+          }
+        } else if(is_keyword(curr, end, 'v')) {
+          char const* p{ curr + 1 };
+          vertex& v{ positions[vi++] };
+          if(!parse_float(p, end, v.x) || !parse_float(p, end, v.y) || !parse_float(p, end, v.z)) {
             std::cerr << __FUNCTION__ << ": couldn't get vertex data\n";
             return false;
           }
-          o.vertices.emplace_back(v);
-        } else if(*curr == 'f') {
-          // face
-          face f;
-          if(std::sscanf(curr, "f %u %u %u", &f.idx_x, &f.idx_y, &f.idx_z) != 3) {
-            std::cerr << __FUNCTION__ << ": couldn't get face data\n";
+        } else if(is_keyword(curr, end, 'v', 't')) {
+          char const* p{ curr + 2 };
+          texcoord& t{ uvs[vti++] };
+          if(!parse_float(p, end, t.u)) {
+            std::cerr << __FUNCTION__ << ": couldn't get texture coord data\n";
+            return false;
+          }
+          // v is optional, 1D textures are a thing apparently
+          if(!parse_float(p, end, t.v)) {
+            t.v = 0.0f;
+          }
+        } else if(is_keyword(curr, end, 'v', 'n')) {
+          char const* p{ curr + 2 };
+          normal& n{ normals[vni++] };
+          if(!parse_float(p, end, n.x) || !parse_float(p, end, n.y) || !parse_float(p, end, n.z)) {
+            std::cerr << __FUNCTION__ << ": couldn't get normal data\n";
+            return false;
+          }
+        } else if(is_keyword(curr, end, 'f')) {
+          char const* const le{ line_end(curr, end) };
+          char const* p{ skip_spaces(curr + 1, le) };
+          corner first, prev, c;
+          std::size_t n{ 0 };
+          bool valid{ true };
+          std::size_t const face_start{ ci };
+          for(; p < le; p = skip_spaces(p, le), ++n) {
+            // relative indices are relative to what has been read so far, not to the whole file
+            if(!parse_corner(p, le, vi, vti, vni, c)) {
+              std::cerr << __FUNCTION__ << ": couldn't get face data\n";
+              return false;
+            }
+            // some exporters write garbage (yes, the teapot has a couple of these), drop the face
+            // instead of letting it index out of the vbo
+            valid = valid && c.v != invalid_index;
+            if(n == 0) {
+              first = c;
+            } else if(n >= 2) {
+              corners[ci++] = first;
+              corners[ci++] = prev;
+              corners[ci++] = c;
+            }
+            prev = c;
+          }
+          if(n < 3 || !valid) {
+            ci = face_start;
+            ++skipped;
+          }
+        }
+      }
+      close_submesh();
+      if(skipped) {
+        std::cerr << __FUNCTION__ << ": skipped " << skipped << " faces with invalid indices in " << filepath << '\n';
+      }
+      auto const mark = mem.mark();
+      auto const fail = [&mem, &o, mark, filepath]() {
+        std::cerr << "parse_file: arena is too small for " << filepath << '\n';
+        mem.pop_to(mark);
+        o = mesh{};
+        return false;
+      };
+      if(si > 0) {
+        o.submeshes = mem.push_array<submesh>(si);
+        if(o.submeshes.empty()) {
+          return fail();
+        }
+        std::memcpy(o.submeshes.data(), submeshes.data(), o.submeshes.bytes());
+      }
+      if(mi > 0) {
+        o.materials = mem.push_array<material>(mi);
+        if(o.materials.empty()) {
+          return fail();
+        }
+        std::memcpy(o.materials.data(), materials.data(), o.materials.bytes());
+      }
+      if(!has_attrs) {
+        // only positions, the vertices are just the positions
+        o.vertices = mem.push_array<vertex>(num_v);
+        o.indices = mem.push_array<unsigned int>(ci);
+        if((num_v && o.vertices.empty()) || (ci && o.indices.empty())) {
+          return fail();
+        }
+        std::memcpy(o.vertices.data(), positions.data(), positions.bytes());
+        for(std::size_t i{ 0 }; i < ci; ++i) {
+          o.indices[i] = corners[i].v;
+        }
+        return true;
+      }
+      // weld corners into unique vertices
+      auto keys = tmp.push_array<corner>(table_sz);
+      auto values = tmp.push_array<unsigned int>(table_sz);
+      auto remap = tmp.push_array<unsigned int>(ci);
+      if(keys.empty() || values.empty() || (ci && remap.empty())) {
+        return fail();
+      }
+      corner_table table(keys, values);
+      unsigned int num_vertices{ 0 };
+      for(std::size_t i{ 0 }; i < ci; ++i) {
+        remap[i] = table.insert(corners[i], num_vertices);
+        num_vertices += remap[i] == num_vertices ? 1 : 0;
+      }
+      o.vertices = mem.push_array<vertex>(num_vertices);
+      if(num_vt) {
+        o.uvs = mem.push_array<texcoord>(num_vertices);
+      }
+      if(num_vn) {
+        o.normals = mem.push_array<normal>(num_vertices);
+      }
+      o.indices = mem.push_array<unsigned int>(ci);
+      if((num_vertices && (o.vertices.empty() || (num_vt && o.uvs.empty()) || (num_vn && o.normals.empty()))) ||
+         (ci && o.indices.empty())) {
+        return fail();
+      }
+      for(std::size_t i{ 0 }; i < ci; ++i) {
+        unsigned int const v{ remap[i] };
+        corner const& c{ corners[i] };
+        o.indices[i] = v;
+        o.vertices[v] = positions[c.v];
+        if(num_vt) {
+          o.uvs[v] = c.vt != invalid_index ? uvs[c.vt] : texcoord{ 0.0f, 0.0f };
+        }
+        if(num_vn) {
+          o.normals[v] = c.vn != invalid_index ? normals[c.vn] : normal{ 0.0f, 0.0f, 0.0f };
+        }
+      }
+      return true;
+    }
+
+    // plain fd that closes itself, raiifile maps the whole file and that's exactly what the .lvm and
+    // streaming code don't want
+    class fdfile final {
+    public:
+      fdfile(char const* filepath, int const flags) noexcept
+        : fd{ open(filepath, flags, 0644) }
+      {
+        if(fd == -1) {
+          std::cerr << "couldn't open file " << filepath << ": " << strerror(errno) << '\n';
+        }
+      }
+      ~fdfile()
+      {
+        if(fd != -1) {
+          close(fd);
+        }
+      }
+      fdfile(fdfile const&) = delete;
+      fdfile& operator=(fdfile const&) = delete;
+      auto handle() const noexcept { return fd; }
+      auto error() const noexcept { return fd == -1; }
+    private:
+      int const fd;
+    };
+
+    // pread/pwrite can do less than asked for, these don't return until it's all done
+    static bool write_all(int const fd, void const* data, std::size_t sz, std::size_t offset) noexcept
+    {
+      char const* p{ static_cast<char const*>(data) };
+      while(sz > 0) {
+        ssize_t const n{ pwrite(fd, p, sz, static_cast<off_t>(offset)) };
+        if(n < 0) {
+          if(errno == EINTR) {
+            continue;
+          }
+          std::cerr << "pwrite : " << strerror(errno) << '\n';
+          return false;
+        }
+        p += n;
+        sz -= static_cast<std::size_t>(n);
+        offset += static_cast<std::size_t>(n);
+      }
+      return true;
+    }
+
+    static bool read_all(int const fd, void* data, std::size_t sz, std::size_t offset) noexcept
+    {
+      char* p{ static_cast<char*>(data) };
+      while(sz > 0) {
+        ssize_t const n{ pread(fd, p, sz, static_cast<off_t>(offset)) };
+        if(n <= 0) {
+          if(n < 0 && errno == EINTR) {
+            continue;
+          }
+          std::cerr << "pread : " << (n == 0 ? "unexpected end of file" : strerror(errno)) << '\n';
+          return false;
+        }
+        p += n;
+        sz -= static_cast<std::size_t>(n);
+        offset += static_cast<std::size_t>(n);
+      }
+      return true;
+    }
+
+    bool diffuse_layers(slice<material> materials, char const** paths, unsigned int const max_paths, unsigned int& count) noexcept
+    {
+      auto const find = [paths](unsigned int const n, char const* const map) {
+        unsigned int l{ 0 };
+        while(l < n && std::strcmp(paths[l], map) != 0) {
+          ++l;
+        }
+        return l;
+      };
+      // the maps first, the materials are only changed if they all fit
+      unsigned int n{ 0 };
+      for(material const& m : materials) {
+        if(m.diffuse_map[0] != '\0' && find(n, m.diffuse_map) == n) {
+          if(n == max_paths) {
+            return false;
+          }
+          paths[n++] = m.diffuse_map;
+        }
+      }
+      for(material& m : materials) {
+        m.diffuse_layer = m.diffuse_map[0] == '\0' ? no_layer : find(n, m.diffuse_map);
+      }
+      count = n;
+      return true;
+    }
+
+    static std::size_t mesh_bytes(mesh_header const& h) noexcept
+    {
+      std::size_t const nv{ h.num_vertices };
+      return sizeof(mesh_header) + nv * sizeof(vertex) +
+             ((h.flags & mesh_header::has_normals) ? nv * sizeof(normal) : 0) +
+             ((h.flags & mesh_header::has_uvs) ? nv * sizeof(texcoord) : 0) +
+             ((h.flags & mesh_header::has_tangents) ? nv * sizeof(tangent) : 0) +
+             h.num_indices * sizeof(unsigned int) + h.num_submeshes * sizeof(submesh) +
+             h.num_materials * sizeof(material) + h.num_lods * sizeof(lod) + h.num_lod_submeshes * sizeof(submesh) +
+             h.num_lod_indices * sizeof(unsigned int);
+    }
+
+    bool save_mesh(char const* filepath, mesh const& m)
+    {
+      std::size_t const nv{ m.vertices.size() };
+      assert(m.normals.empty() || m.normals.size() == nv);
+      assert(m.uvs.empty() || m.uvs.size() == nv);
+      assert(m.tangents.empty() || m.tangents.size() == nv);
+      fdfile file(filepath, O_WRONLY | O_CREAT | O_TRUNC);
+      if(file.error()) {
+        return false;
+      }
+      mesh_header const h{
+        mesh_header::lvm_magic,
+        mesh_header::lvm_version,
+        (m.normals.empty() ? 0 : mesh_header::has_normals) | (m.uvs.empty() ? 0 : mesh_header::has_uvs) |
+          (m.tangents.empty() ? 0 : mesh_header::has_tangents),
+        static_cast<unsigned int>(nv),
+        m.indices.size(),
+        static_cast<unsigned int>(m.submeshes.size()),
+        static_cast<unsigned int>(m.materials.size()),
+        static_cast<unsigned int>(m.lods.levels.size()),
+        static_cast<unsigned int>(m.lods.submeshes.size()),
+        m.lods.indices.size()
+      };
+      std::size_t offset{ 0 };
+      auto const put = [&file, &offset](void const* data, std::size_t const sz) {
+        bool const ok{ write_all(file.handle(), data, sz, offset) };
+        offset += sz;
+        return ok;
+      };
+      return put(&h, sizeof(h)) && put(m.vertices.data(), m.vertices.bytes()) &&
+             put(m.normals.data(), m.normals.bytes()) && put(m.uvs.data(), m.uvs.bytes()) &&
+             put(m.tangents.data(), m.tangents.bytes()) && put(m.indices.data(), m.indices.bytes()) &&
+             put(m.submeshes.data(), m.submeshes.bytes()) && put(m.materials.data(), m.materials.bytes()) &&
+             put(m.lods.levels.data(), m.lods.levels.bytes()) && put(m.lods.submeshes.data(), m.lods.submeshes.bytes()) &&
+             put(m.lods.indices.data(), m.lods.indices.bytes());
+    }
+
+    bool load_mesh(char const* filepath, mesh& o, arena& mem)
+    {
+      o = mesh{};
+      fdfile file(filepath, O_RDONLY);
+      if(file.error()) {
+        return false;
+      }
+      struct stat sb;
+      if(fstat(file.handle(), &sb) == -1) {
+        std::cerr << "fstat : couldn't get file size: " << strerror(errno) << '\n';
+        return false;
+      }
+      mesh_header h;
+      std::size_t const sz{ static_cast<std::size_t>(sb.st_size) };
+      if(sz < sizeof(h) || !read_all(file.handle(), &h, sizeof(h), 0) || h.magic != mesh_header::lvm_magic ||
+         h.version != mesh_header::lvm_version || mesh_bytes(h) != sz) {
+        std::cerr << __FUNCTION__ << ": " << filepath << " isn't a valid mesh\n";
+        return false;
+      }
+      auto const mark = mem.mark();
+      std::size_t offset{ sizeof(h) };
+      // straight from the file into the arena
+      auto const get = [&file, &mem, &offset]<typename T>(slice<T>& s, std::size_t const n, bool const present) {
+        if(!present || n == 0) {
+          return true;
+        }
+        s = mem.push_array<T>(n);
+        if(s.empty()) {
+          std::cerr << "load_mesh: arena is too small\n";
+          return false;
+        }
+        bool const ok{ read_all(file.handle(), s.data(), s.bytes(), offset) };
+        offset += s.bytes();
+        return ok;
+      };
+      if(!get(o.vertices, h.num_vertices, true) || !get(o.normals, h.num_vertices, h.flags & mesh_header::has_normals) ||
+         !get(o.uvs, h.num_vertices, h.flags & mesh_header::has_uvs) ||
+         !get(o.tangents, h.num_vertices, h.flags & mesh_header::has_tangents) ||
+         !get(o.indices, h.num_indices, true) || !get(o.submeshes, h.num_submeshes, true) ||
+         !get(o.materials, h.num_materials, true) || !get(o.lods.levels, h.num_lods, true) ||
+         !get(o.lods.submeshes, h.num_lod_submeshes, true) || !get(o.lods.indices, h.num_lod_indices, true)) {
+        mem.pop_to(mark);
+        o = mesh{};
+        return false;
+      }
+      return true;
+    }
+
+    // reads a file line by line through a window that slides forward, so only the window is ever mapped.
+    // the kernel is told it's read sequentially, it reads ahead and the pages behind are gone as soon as
+    // the window moves past them (munmap)
+    class window_reader final {
+    public:
+      window_reader(char const* filepath, std::size_t const window_size) noexcept
+        : file{ filepath, O_RDONLY },
+          data{ nullptr },
+          map_off{ 0 },
+          map_sz{ 0 },
+          file_sz{ 0 },
+          window{ window_size },
+          cursor{ 0 },
+          err{ file.error() }
+      {
+        if(err) {
+          return;
+        }
+        struct stat sb;
+        if(fstat(file.handle(), &sb) == -1) {
+          std::cerr << "fstat : couldn't get file size: " << strerror(errno) << '\n';
+          err = true;
+          return;
+        }
+        file_sz = static_cast<std::size_t>(sb.st_size);
+      }
+      ~window_reader()
+      {
+        unmap();
+      }
+      window_reader(window_reader const&) = delete;
+      window_reader& operator=(window_reader const&) = delete;
+      // [line, le) is the next line without the '\n', false at the end of the file or if it failed
+      bool next(char const*& line, char const*& le) noexcept
+      {
+        while(!err && cursor < file_sz) {
+          if(data && cursor >= map_off && cursor < map_off + map_sz) {
+            char const* const p{ data + (cursor - map_off) };
+            char const* const end{ data + map_sz };
+            char const* const nl{ static_cast<char const*>(std::memchr(p, '\n', end - p)) };
+            if(nl || map_off + map_sz == file_sz) {
+              line = p;
+              le = nl ? nl : end;
+              cursor += static_cast<std::size_t>(le - p) + 1;
+              return true;
+            }
+          }
+          // the line doesn't end in this window, move it so it starts at the page of the line
+          if(!map(cursor)) {
             return false;
           }
-          o.faces.emplace_back(f);
-          o.indices.emplace_back(f.idx_x);
-          o.indices.emplace_back(f.idx_y);
-          o.indices.emplace_back(f.idx_z);
         }
-        // now move to end of line
-        while(curr < end && *curr != '\n') {
-          ++curr;
+        return false;
+      }
+      void rewind() noexcept { cursor = 0; }
+      auto error() const noexcept { return err; }
+    private:
+      bool map(std::size_t const offset) noexcept
+      {
+        static std::size_t const page{ static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) };
+        std::size_t const off{ offset / page * page };
+        if(data && off == map_off) {
+          std::cerr << "window_reader: there's a line longer than the window (" << window << " bytes)\n";
+          err = true;
+          return false;
+        }
+        unmap();
+        map_off = off;
+        map_sz = std::min(window, file_sz - map_off);
+        void* const p{ mmap(nullptr, map_sz, PROT_READ, MAP_PRIVATE, file.handle(), static_cast<off_t>(map_off)) };
+        if(p == MAP_FAILED) {
+          std::cerr << "mmap : error mapping file: " << strerror(errno) << '\n';
+          err = true;
+          return false;
+        }
+        data = static_cast<char*>(p);
+        madvise(p, map_sz, MADV_SEQUENTIAL);
+        return true;
+      }
+      void unmap() noexcept
+      {
+        if(data) {
+          munmap(data, map_sz);
+          data = nullptr;
         }
-        if(curr < end) {
-          // skip newline char
-          ++curr;
+      }
+    private:
+      fdfile file;
+      char* data;
+      std::size_t map_off;
+      std::size_t map_sz;
+      std::size_t file_sz;
+      std::size_t const window;
+      std::size_t cursor;
+      bool err;
+    };
+
+    // appends to a region of a file through a fixed size buffer
+    class stream_writer final {
+    public:
+      stream_writer(int const file, std::size_t const start, slice<char> buf) noexcept
+        : fd{ file },
+          offset{ start },
+          buffer{ buf },
+          used{ 0 }
+      {
+      }
+      bool write(void const* data, std::size_t const sz) noexcept
+      {
+        assert(sz <= buffer.size());
+        if(used + sz > buffer.size() && !flush()) {
+          return false;
         }
+        std::memcpy(buffer.data() + used, data, sz);
+        used += sz;
+        return true;
+      }
+      bool flush() noexcept
+      {
+        bool const ok{ write_all(fd, buffer.data(), used, offset) };
+        offset += used;
+        used = 0;
+        return ok;
+      }
+    private:
+      int const fd;
+      std::size_t offset;
+      slice<char> buffer;
+      std::size_t used;
+    };
+
+    static bool import_stream(char const* obj_path, int const out, std::size_t const memory_budget)
+    {
+      // half of the budget is the window, a quarter goes to the output buffers
+      window_reader in(obj_path, memory_budget / 2);
+      if(in.error()) {
+        return false;
+      }
+      // first pass, the number of vertices is where the indices start in the output
+      std::size_t num_v{ 0 };
+      bool has_attrs{ false };
+      char const* line;
+      char const* le;
+      while(in.next(line, le)) {
+        if(is_keyword(line, le, 'v')) {
+          ++num_v;
+        } else if(is_keyword(line, le, 'v', 't') || is_keyword(line, le, 'v', 'n')) {
+          has_attrs = true;
+        }
+      }
+      if(in.error()) {
+        return false;
+      }
+      if(num_v >= invalid_index) {
+        std::cerr << __FUNCTION__ << ": too many vertices in " << obj_path << '\n';
+        return false;
+      }
+      if(has_attrs) {
+        std::cerr << __FUNCTION__ << ": vt and vn in " << obj_path << " are ignored\n";
+      }
+      std::size_t const buffer_sz{ memory_budget / 8 };
+      arena mem(buffer_sz * 2 + 64);
+      auto const positions_buf = mem.push_array<char>(buffer_sz);
+      auto const indices_buf = mem.push_array<char>(buffer_sz);
+      if(positions_buf.empty() || indices_buf.empty()) {
+        std::cerr << __FUNCTION__ << ": couldn't allocate the output buffers\n";
+        return false;
+      }
+      stream_writer positions(out, sizeof(mesh_header), positions_buf);
+      stream_writer indices(out, sizeof(mesh_header) + num_v * sizeof(vertex), indices_buf);
+      // second pass, convert
+      in.rewind();
+      std::size_t vi{ 0 };
+      std::size_t num_indices{ 0 };
+      std::size_t skipped{ 0 };
+      while(in.next(line, le)) {
+        if(is_keyword(line, le, 'v')) {
+          char const* p{ line + 1 };
+          vertex v;
+          if(!parse_float(p, le, v.x) || !parse_float(p, le, v.y) || !parse_float(p, le, v.z)) {
+            std::cerr << __FUNCTION__ << ": couldn't get vertex data\n";
+            return false;
+          }
+          if(!positions.write(&v, sizeof(v))) {
+            return false;
+          }
+          ++vi;
+        } else if(is_keyword(line, le, 'f')) {
+          char const* const end{ line_end(line, le) };
+          // once to check it, once to write the fan, there's nowhere to put it in between
+          corner c;
+          std::size_t n{ 0 };
+          bool valid{ true };
+          for(char const* p{ skip_spaces(line + 1, end) }; p < end; p = skip_spaces(p, end), ++n) {
+            if(!parse_corner(p, end, vi, 0, 0, c)) {
+              std::cerr << __FUNCTION__ << ": couldn't get face data\n";
+              return false;
+            }
+            valid = valid && c.v != invalid_index;
+          }
+          if(n < 3 || !valid) {
+            ++skipped;
+            continue;
+          }
+          unsigned int first{ 0 }, prev{ 0 };
+          n = 0;
+          for(char const* p{ skip_spaces(line + 1, end) }; p < end; p = skip_spaces(p, end), ++n) {
+            parse_corner(p, end, vi, 0, 0, c);
+            if(n == 0) {
+              first = c.v;
+            } else if(n >= 2) {
+              unsigned int const tri[3]{ first, prev, c.v };
+              if(!indices.write(tri, sizeof(tri))) {
+                return false;
+              }
+              num_indices += 3;
+            }
+            prev = c.v;
+          }
+        }
+      }
+      if(in.error() || !positions.flush() || !indices.flush()) {
+        return false;
+      }
+      if(vi != num_v) {
+        std::cerr << __FUNCTION__ << ": " << obj_path << " changed while importing it\n";
+        return false;
+      }
+      if(skipped) {
+        std::cerr << __FUNCTION__ << ": skipped " << skipped << " faces with invalid indices in " << obj_path << '\n';
+      }
+      // the header goes last, now that the number of indices is known
+      mesh_header const h{ mesh_header::lvm_magic, mesh_header::lvm_version, 0, static_cast<unsigned int>(num_v), num_indices, 0, 0, 0, 0, 0 };
+      return write_all(out, &h, sizeof(h), 0);
+    }
+
+    bool import_file(char const* obj_path, char const* lvm_path, std::size_t const memory_budget)
+    {
+      std::size_t constexpr min_budget{ 1024 * 1024 };
+      if(memory_budget < min_budget) {
+        std::cerr << __FUNCTION__ << ": the memory budget has to be at least " << min_budget << " bytes\n";
+        return false;
+      }
+      fdfile out(lvm_path, O_WRONLY | O_CREAT | O_TRUNC);
+      if(out.error()) {
+        return false;
+      }
+      if(!import_stream(obj_path, out.handle(), memory_budget)) {
+        // don't leave half a mesh around
+        unlink(lvm_path);
+        return false;
       }
       return true;
     }
@@ -0,0 +1,419 @@
+#include "lvar_pack.h"
+#include "lvar_common.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>              // memcpy, strerror
+#include <iostream>
+#include <fcntl.h>              // open
+#include <sys/mman.h>           // mmap
+#include <sys/stat.h>           // fstat
+#include <unistd.h>             // pread, pwrite, close
+
+namespace lvar {
+  namespace pack {
+
+    static void out_of_memory(char const* fx) noexcept
+    {
+      std::cerr << fx << ": out of memory\n";
+    }
+
+    class fdfile final {
+    public:
+      fdfile(char const* filepath, int const flags) noexcept
+        : fd{ ::open(filepath, flags, 0644) }
+      {
+      }
+      ~fdfile()
+      {
+        if(fd != -1) {
+          close(fd);
+        }
+      }
+      fdfile(fdfile const&) = delete;
+      fdfile& operator=(fdfile const&) = delete;
+      auto handle() const noexcept { return fd; }
+      auto error() const noexcept { return fd == -1; }
+    private:
+      int const fd;
+    };
+
+    static bool write_all(int const fd, void const* data, std::size_t sz, std::size_t offset) noexcept
+    {
+      char const* p{ static_cast<char const*>(data) };
+      while(sz > 0) {
+        ssize_t const n{ pwrite(fd, p, sz, static_cast<off_t>(offset)) };
+        if(n < 0) {
+          if(errno == EINTR) {
+            continue;
+          }
+          return false;
+        }
+        p += n;
+        sz -= static_cast<std::size_t>(n);
+        offset += static_cast<std::size_t>(n);
+      }
+      return true;
+    }
+
+    static bool read_all(int const fd, void* data, std::size_t sz, std::size_t offset) noexcept
+    {
+      char* p{ static_cast<char*>(data) };
+      while(sz > 0) {
+        ssize_t const n{ pread(fd, p, sz, static_cast<off_t>(offset)) };
+        if(n < 0) {
+          if(errno == EINTR) {
+            continue;
+          }
+          return false;
+        }
+        if(n == 0) {
+          return false;
+        }
+        p += n;
+        sz -= static_cast<std::size_t>(n);
+        offset += static_cast<std::size_t>(n);
+      }
+      return true;
+    }
+
+    int asset_id(char const* path) noexcept
+    {
+      if(path[0] == '.' && path[1] == '/') {
+        path += 2;
+      }
+      return fnv1a(path);
+    }
+
+    // ------------------------------------------------------------------------------------------------------
+    // lz
+    // ------------------------------------------------------------------------------------------------------
+
+    static std::size_t constexpr min_match{ 4 };
+    // the last bytes are always literals, so the decoder never reads a match past the end
+    static std::size_t constexpr last_literals{ 5 };
+    static unsigned int constexpr hash_bits{ 14 };
+
+    static unsigned int load32(unsigned char const* p) noexcept
+    {
+      unsigned int v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    // 15 in the nibble means the rest comes in bytes of 255 until one that's smaller
+    static unsigned char* write_length(unsigned char* out, std::size_t len) noexcept
+    {
+      while(len >= 255) {
+        *out++ = 255;
+        len -= 255;
+      }
+      *out++ = static_cast<unsigned char>(len);
+      return out;
+    }
+
+    std::size_t lz_bound(std::size_t const size) noexcept
+    {
+      return size + size / 255 + 16;
+    }
+
+    std::size_t lz_compress(unsigned char const* src, std::size_t const size, unsigned char* dst, std::size_t const capacity) noexcept
+    {
+      if(capacity < lz_bound(size)) {
+        return 0;
+      }
+      // position + 1 of the last time every hash was seen, 0 is never
+      static thread_local unsigned int table[1 << hash_bits];
+      std::memset(table, 0, sizeof(table));
+      unsigned char* out{ dst };
+      std::size_t anchor{ 0 };
+      std::size_t i{ 0 };
+      std::size_t const limit{ size > min_match + last_literals ? size - min_match - last_literals : 0 };
+      while(i < limit) {
+        unsigned int const seq{ load32(src + i) };
+        unsigned int const h{ (seq * 2654435761u) >> (32 - hash_bits) };
+        std::size_t const candidate{ table[h] };
+        table[h] = static_cast<unsigned int>(i + 1);
+        if(candidate == 0 || i - (candidate - 1) > 0xffff || load32(src + candidate - 1) != seq) {
+          ++i;
+          continue;
+        }
+        std::size_t const match{ candidate - 1 };
+        std::size_t len{ min_match };
+        while(i + len < size - last_literals && src[match + len] == src[i + len]) {
+          ++len;
+        }
+        std::size_t const literals{ i - anchor };
+        unsigned char* const token{ out++ };
+        *token = static_cast<unsigned char>((std::min<std::size_t>(literals, 15) << 4) | std::min<std::size_t>(len - min_match, 15));
+        if(literals >= 15) {
+          out = write_length(out, literals - 15);
+        }
+        std::memcpy(out, src + anchor, literals);
+        out += literals;
+        std::size_t const offset{ i - match };
+        *out++ = static_cast<unsigned char>(offset & 0xff);
+        *out++ = static_cast<unsigned char>(offset >> 8);
+        if(len - min_match >= 15) {
+          out = write_length(out, len - min_match - 15);
+        }
+        i += len;
+        anchor = i;
+      }
+      // the rest are literals, without a match after them
+      std::size_t const literals{ size - anchor };
+      *out++ = static_cast<unsigned char>(std::min<std::size_t>(literals, 15) << 4);
+      if(literals >= 15) {
+        out = write_length(out, literals - 15);
+      }
+      std::memcpy(out, src + anchor, literals);
+      out += literals;
+      return static_cast<std::size_t>(out - dst);
+    }
+
+    static bool read_length(unsigned char const*& in, unsigned char const* const end, std::size_t& len) noexcept
+    {
+      unsigned char b;
+      do {
+        if(in == end) {
+          return false;
+        }
+        b = *in++;
+        len += b;
+      } while(b == 255);
+      return true;
+    }
+
+    bool lz_decompress(unsigned char const* src, std::size_t const size, unsigned char* dst, std::size_t const raw_size) noexcept
+    {
+      unsigned char const* in{ src };
+      unsigned char const* const in_end{ src + size };
+      std::size_t o{ 0 };
+      while(in < in_end) {
+        unsigned char const token{ *in++ };
+        std::size_t literals{ static_cast<std::size_t>(token >> 4) };
+        if(literals == 15 && !read_length(in, in_end, literals)) {
+          return false;
+        }
+        if(literals > static_cast<std::size_t>(in_end - in) || literals > raw_size - o) {
+          return false;
+        }
+        std::memcpy(dst + o, in, literals);
+        in += literals;
+        o += literals;
+        if(in == in_end) { // the last one doesn't have a match
+          break;
+        }
+        if(in_end - in < 2) {
+          return false;
+        }
+        std::size_t const offset{ static_cast<std::size_t>(in[0]) | static_cast<std::size_t>(in[1]) << 8 };
+        in += 2;
+        std::size_t len{ static_cast<std::size_t>(token & 0xf) };
+        if(len == 15 && !read_length(in, in_end, len)) {
+          return false;
+        }
+        len += min_match;
+        if(offset == 0 || offset > o || len > raw_size - o) {
+          return false;
+        }
+        // byte by byte, the match can overlap what it's writing (offset 1 repeats a byte)
+        unsigned char const* m{ dst + o - offset };
+        for(std::size_t k{ 0 }; k < len; ++k) {
+          dst[o + k] = m[k];
+        }
+        o += len;
+      }
+      return o == raw_size;
+    }
+
+    // ------------------------------------------------------------------------------------------------------
+    // writing
+    // ------------------------------------------------------------------------------------------------------
+
+    bool write_pack(char const* pack_path, char const* const* paths, unsigned int const count, bool const compress) noexcept
+    {
+      // the directory, and a chunk of a file and what it compresses to, the same ones for every file
+      std::size_t constexpr chunk_size{ entry::chunk_size };
+      arena mem(static_cast<std::size_t>(count) * sizeof(entry) + chunk_size + lz_bound(chunk_size) + 64);
+      slice<entry> entries{ mem.push_array<entry>(count) };
+      unsigned char* const raw{ static_cast<unsigned char*>(mem.push(chunk_size)) };
+      unsigned char* const packed{ static_cast<unsigned char*>(mem.push(lz_bound(chunk_size))) };
+      if((count > 0 && entries.empty()) || !raw || !packed) {
+        out_of_memory(__FUNCTION__);
+        return false;
+      }
+      fdfile out(pack_path, O_WRONLY | O_CREAT | O_TRUNC);
+      if(out.error()) {
+        std::cerr << __FUNCTION__ << ": couldn't open " << pack_path << ": " << std::strerror(errno) << '\n';
+        return false;
+      }
+      bool ok{ true };
+      std::size_t offset{ (sizeof(header) + header::blob_alignment - 1) / header::blob_alignment * header::blob_alignment };
+      for(unsigned int i{ 0 }; i < count && ok; ++i) {
+        fdfile in(paths[i], O_RDONLY);
+        struct stat sb;
+        if(in.error() || fstat(in.handle(), &sb) == -1) {
+          std::cerr << __FUNCTION__ << ": couldn't read " << paths[i] << ": " << std::strerror(errno) << '\n';
+          ok = false;
+          break;
+        }
+        std::size_t const raw_size{ static_cast<std::size_t>(sb.st_size) };
+        entry& e{ entries[i] };
+        e = entry{ asset_id(paths[i]), 0, offset, 0, raw_size };
+        for(std::size_t done{ 0 }; done < raw_size && ok;) {
+          std::size_t const n{ std::min(chunk_size, raw_size - done) };
+          if(!read_all(in.handle(), raw, n, done)) {
+            std::cerr << __FUNCTION__ << ": couldn't read " << paths[i] << '\n';
+            ok = false;
+            break;
+          }
+          bool const chunked{ (e.flags & entry::compressed) != 0 };
+          std::size_t const packed_size{ compress && (done == 0 || chunked) ? lz_compress(raw, n, packed, lz_bound(chunk_size)) : 0 };
+          // less than 1/8 smaller isn't worth decompressing, jpgs and pngs never are. the first chunk decides
+          // for the whole file, the rest can't go back and change it
+          if(done == 0 && packed_size > 0 && packed_size < n - n / 8) {
+            e.flags |= entry::compressed;
+          }
+          if(e.flags & entry::compressed) {
+            bool const smaller{ packed_size > 0 && packed_size < n };
+            std::size_t const sz{ smaller ? packed_size : n };
+            unsigned int const tag{ static_cast<unsigned int>(sz) | (smaller ? 0 : entry::stored_chunk) };
+            ok = write_all(out.handle(), &tag, sizeof(tag), offset + e.size) &&
+                 write_all(out.handle(), smaller ? packed : raw, sz, offset + e.size + sizeof(tag));
+            e.size += sizeof(tag) + sz;
+          } else {
+            ok = write_all(out.handle(), raw, n, offset + e.size);
+            e.size += n;
+          }
+          done += n;
+        }
+        offset = (offset + e.size + header::blob_alignment - 1) / header::blob_alignment * header::blob_alignment;
+      }
+      std::sort(entries.begin(), entries.begin() + count, [](entry const& a, entry const& b) { return a.id < b.id; });
+      for(unsigned int i{ 1 }; i < count && ok; ++i) {
+        if(entries[i].id == entries[i - 1].id) {
+          std::cerr << __FUNCTION__ << ": two paths have the same id " << entries[i].id << '\n';
+          ok = false;
+        }
+      }
+      header const h{ header::lvp_magic, header::lvp_version, count, 0, offset };
+      ok = ok && write_all(out.handle(), entries.data(), entries.bytes(), offset) &&
+           write_all(out.handle(), &h, sizeof(h), 0);
+      if(!ok) {
+        unlink(pack_path);
+      }
+      return ok;
+    }
+
+    // ------------------------------------------------------------------------------------------------------
+    // reading
+    // ------------------------------------------------------------------------------------------------------
+
+    reader::reader() noexcept
+      : base{ nullptr },
+        bytes{ 0 },
+        directory{ nullptr },
+        num_entries{ 0 }
+    {
+    }
+
+    reader::~reader() noexcept
+    {
+      if(base) {
+        munmap(const_cast<unsigned char*>(base), bytes);
+      }
+    }
+
+    bool reader::open(char const* pack_path) noexcept
+    {
+      fdfile f(pack_path, O_RDONLY);
+      struct stat sb;
+      if(f.error() || fstat(f.handle(), &sb) == -1 || static_cast<std::size_t>(sb.st_size) < sizeof(header)) {
+        return false;
+      }
+      std::size_t const sz{ static_cast<std::size_t>(sb.st_size) };
+      void* const p{ mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, f.handle(), 0) };
+      if(p == MAP_FAILED) {
+        std::cerr << __FUNCTION__ << ": couldn't mmap " << pack_path << ": " << std::strerror(errno) << '\n';
+        return false;
+      }
+      unsigned char const* const b{ static_cast<unsigned char const*>(p) };
+      header h;
+      std::memcpy(&h, b, sizeof(h));
+      bool const ok{ h.magic == header::lvp_magic && h.version == header::lvp_version &&
+                     h.directory_offset % alignof(entry) == 0 && h.directory_offset <= sz &&
+                     (sz - h.directory_offset) / sizeof(entry) >= h.num_entries };
+      if(!ok) {
+        std::cerr << __FUNCTION__ << ": " << pack_path << " isn't a pack (or not this version)\n";
+        munmap(p, sz);
+        return false;
+      }
+      entry const* const dir{ reinterpret_cast<entry const*>(b + h.directory_offset) };
+      for(unsigned int i{ 0 }; i < h.num_entries; ++i) {
+        if(dir[i].offset > h.directory_offset || dir[i].size > h.directory_offset - dir[i].offset) {
+          std::cerr << __FUNCTION__ << ": " << pack_path << " is broken\n";
+          munmap(p, sz);
+          return false;
+        }
+      }
+      if(base) {
+        munmap(const_cast<unsigned char*>(base), bytes);
+      }
+      base = b;
+      bytes = sz;
+      directory = dir;
+      num_entries = h.num_entries;
+      return true;
+    }
+
+    entry const* reader::find(int const id) const noexcept
+    {
+      entry const* const end{ directory + num_entries };
+      entry const* const e{ std::lower_bound(directory, end, id, [](entry const& a, int const v) { return a.id < v; }) };
+      return e != end && e->id == id ? e : nullptr;
+    }
+
+    slice<unsigned char const> reader::view(entry const& e) const noexcept
+    {
+      return { base + e.offset, static_cast<std::size_t>(e.size) };
+    }
+
+    bool reader::read(entry const& e, void* out) const noexcept
+    {
+      if(!(e.flags & entry::compressed)) {
+        std::memcpy(out, base + e.offset, e.size);
+        return true;
+      }
+      unsigned char const* in{ base + e.offset };
+      unsigned char const* const end{ in + e.size };
+      unsigned char* o{ static_cast<unsigned char*>(out) };
+      for(std::size_t left{ e.raw_size }; left > 0;) {
+        unsigned int tag;
+        if(end - in < static_cast<std::ptrdiff_t>(sizeof(tag))) {
+          return false;
+        }
+        std::memcpy(&tag, in, sizeof(tag));
+        in += sizeof(tag);
+        std::size_t const n{ std::min(entry::chunk_size, left) };
+        std::size_t const sz{ tag & ~entry::stored_chunk };
+        if(sz > static_cast<std::size_t>(end - in)) {
+          return false;
+        }
+        if(tag & entry::stored_chunk) {
+          if(sz != n) {
+            return false;
+          }
+          std::memcpy(o, in, n);
+        } else if(!lz_decompress(in, sz, o, n)) {
+          return false;
+        }
+        in += sz;
+        o += n;
+        left -= n;
+      }
+      return in == end;
+    }
+
+  };
+};
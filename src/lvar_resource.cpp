@@ -1,11 +1,26 @@
 #include "lvar_resource.h"
 #include "lvar_opengl_gnulinux.h"
 #include "lvar_shaders_paths.h"
+#include "lvar_jobs.h"
+#include "lvar_watcher.h"
+#include "lvar_texture.h"
+#include "lvar_bc.h"
+#include "lvar_atlas.h"
+#include "lvar_embed.h"
 
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>               // snprintf
+#include <cstring>              // strcmp, memcpy
 #include <fstream>
 #include <sstream>
 #include <array>
 #include <string>
+#include <thread>
+#include <sys/stat.h>           // mkdir
 
 // @TEMP: this is temporary, objects will be .obj files most of the time, but for simple demos you'll use
 // cubes, so put them in here.
@@ -56,34 +71,747 @@ static float cube_vertices[] = {
 namespace lvar {
   namespace resource {
 
-    manager::manager() noexcept
-      : err{ false }
-    {
-      // initialise all resources here, maybe it's better to have a function to load at demand
-      shaders[fnv1a(SHADER_VERT_LIGHTING_COLOURS)] =
-        std::make_unique<shader>(create_shader(SHADER_VERT_LIGHTING_COLOURS,
-                                               SHADER_FRAG_LIGHTING_COLOURS,
-                                               cube_vertices,
-                                               sizeof(cube_vertices),
-                                               2,
-                                               3,
-                                               sizeof(float) * 6));
-      if(err) {
+    // linked programs from previous runs, one file per program. the name is the hash of the sources and
+    // the header has the hash of the driver (vendor, renderer and version), a binary from another driver
+    // or gpu is useless and then the program is compiled again and the file replaced
+    static char const* const program_cache_dir{ "./cache" };
+
+    class program_cache_header final {
+    public:
+      static unsigned int constexpr magic_value{ 0x31475250 }; // "PRG1"
+    public:
+      unsigned int magic;
+      int source_hash;
+      int driver_hash;
+      unsigned int format;
+      unsigned int length;
+    };
+
+    static bool program_binaries_supported() noexcept
+    {
+      static int const num_formats{ []() {
+        int n{ 0 };
+        if(glGetProgramBinary && glProgramBinary && glProgramParameteri) {
+          glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &n);
+        }
+        return n;
+      }() };
+      return num_formats > 0;
+    }
+
+    static int driver_hash() noexcept
+    {
+      static int const hash{ []() {
+        std::string driver;
+        for(GLenum const name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+          char const* const str{ reinterpret_cast<char const*>(glGetString(name)) };
+          driver += str ? str : "";
+          driver += '\n';
+        }
+        return fnv1a(driver.c_str(), driver.size());
+      }() };
+      return hash;
+    }
+
+    static std::string program_cache_path(int const source_hash)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "/%08x.bin", static_cast<unsigned int>(source_hash));
+      return std::string(program_cache_dir) + name;
+    }
+
+    // 0 if it isn't there or the driver doesn't like it
+    static unsigned int load_cached_program(int const source_hash) noexcept
+    {
+      if(!program_binaries_supported()) {
+        return 0;
+      }
+      std::ifstream in(program_cache_path(source_hash), std::ios::binary);
+      if(!in) {
+        return 0;
+      }
+      program_cache_header h;
+      if(!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || h.magic != program_cache_header::magic_value ||
+         h.source_hash != source_hash || h.driver_hash != driver_hash()) {
+        return 0;
+      }
+      std::string binary(h.length, '\0');
+      if(!in.read(binary.data(), h.length)) {
+        return 0;
+      }
+      unsigned int const id{ glCreateProgram() };
+      glProgramBinary(id, h.format, binary.data(), static_cast<int>(h.length));
+      int success{ 0 };
+      glGetProgramiv(id, GL_LINK_STATUS, &success);
+      if(success != GL_TRUE) { // a driver update can do this even with the same version string
+        glDeleteProgram(id);
+        return 0;
+      }
+      return id;
+    }
+
+    static void save_cached_program(unsigned int const id, int const source_hash) noexcept
+    {
+      if(!program_binaries_supported()) {
         return;
       }
-      shaders[fnv1a(SHADER_VERT_LIGHT_CUBE)] =
-        std::make_unique<shader>(create_shader(SHADER_VERT_LIGHT_CUBE,
-                                               SHADER_FRAG_LIGHT_CUBE,
-                                               cube_vertices,
-                                               sizeof(cube_vertices),
-                                               1,
-                                               3,
-                                               sizeof(float) * 6));
+      int length{ 0 };
+      glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+      if(length <= 0) {
+        return;
+      }
+      std::string binary(static_cast<std::size_t>(length), '\0');
+      GLenum format{ 0 };
+      glGetProgramBinary(id, length, &length, &format, binary.data());
+      mkdir(program_cache_dir, 0755);
+      std::string const path{ program_cache_path(source_hash) };
+      std::ofstream out(path, std::ios::binary | std::ios::trunc);
+      program_cache_header const h{ program_cache_header::magic_value, source_hash, driver_hash(), format,
+                                    static_cast<unsigned int>(length) };
+      out.write(reinterpret_cast<char const*>(&h), sizeof(h));
+      out.write(binary.data(), length);
+      if(!out) {
+        std::cerr << __FUNCTION__ << ": couldn't write " << path << '\n';
+      }
+    }
+
+    // GL_EXT_texture_compression_s3tc for bc1 and bc3, bc5 (rgtc) is core since 3.0
+    static bool s3tc_supported() noexcept
+    {
+      static bool const supported{ []() {
+        int n{ 0 };
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for(int i{ 0 }; i < n && glGetStringi; ++i) {
+          char const* const ext{ reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<unsigned int>(i))) };
+          if(ext && std::strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0) {
+            return true;
+          }
+        }
+        return false;
+      }() };
+      return supported;
+    }
+
+    // next to the program binaries, one per texture, the format is in the header
+    static std::string texture_cache_path(char const* path)
+    {
+      char name[32];
+      std::snprintf(name, sizeof(name), "/tex_%08x.lvc", static_cast<unsigned int>(fnv1a(path)));
+      return std::string(program_cache_dir) + name;
+    }
+
+    tex::bc_quality constexpr texture_quality{ tex::bc_quality::high };
+    // a 16k x 16k bc3 texture and its mips, the arena only commits what load_compressed reads
+    std::size_t constexpr max_compressed_bytes{ 512ull * 1024 * 1024 };
+
+    // rgb is bc1, rgba bc3 and rg bc5. false if there's no format the driver can sample for these channels
+    // (1 channel, or no s3tc), the pixels go up as they are then
+    static bool bc_format_for(unsigned int const channels, tex::bc_format& f) noexcept
+    {
+      if(channels == 1 || (channels != 2 && !s3tc_supported())) {
+        return false;
+      }
+      f = channels == 2 ? tex::bc_format::bc5 : channels == 3 ? tex::bc_format::bc1 : tex::bc_format::bc3;
+      return true;
+    }
+
+    // into the bound texture, all the mips, replacing whatever it had. what it takes on the gpu
+    static std::size_t upload_compressed(tex::compressed_texture const& ct) noexcept
+    {
+      GLenum const internal{ static_cast<GLenum>(ct.format == tex::bc_format::bc1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                 : ct.format == tex::bc_format::bc3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+                                                 : GL_COMPRESSED_RG_RGTC2) };
+      // every level comes from here, nothing to generate
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(ct.num_levels) - 1);
+      for(unsigned int l{ 0 }; l < ct.num_levels; ++l) {
+        glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<int>(l), internal, static_cast<int>(ct.level_width(l)),
+                               static_cast<int>(ct.level_height(l)), 0, static_cast<int>(ct.level_bytes(l)),
+                               ct.data.data() + ct.level_offset(l));
+      }
+      return ct.data.size();
+    }
+
+    // a texture that wasn't in the compressed cache. it's encoded on the manager's worker while the
+    // uncompressed mips are drawn with, end_frame swaps it in and the .lvc is there for the next run
+    class encode_job final {
+    public:
+      explicit encode_job(std::size_t const bytes) noexcept
+        : mem{ bytes },
+          cancelled{ false },
+          done{ false },
+          ok{ false }
+      {
+      }
+    public:
+      handle<texture> target;
+      std::string path;
+      std::string cache_path;
+      tex::bc_format format;
+      unsigned long long source_size;
+      long long source_mtime;
+      arena mem;                // a copy of the mips and what they're encoded into
+      tex::mip_chain mips;
+      tex::compressed_texture ct;
+      std::atomic<bool> cancelled;
+      std::atomic<bool> done;
+      bool ok;                  // only read after done
+    };
+
+    static void encode_texture(void* data) noexcept
+    {
+      encode_job& j{ *static_cast<encode_job*>(data) };
+      if(!j.cancelled.load(std::memory_order_acquire)) {
+        auto const start = std::chrono::steady_clock::now();
+        j.ok = tex::compress(j.mips, j.format, texture_quality, j.ct, j.mem);
+        if(j.ok) {
+          double const ms{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+          tex::image const& img{ j.mips.levels[0] };
+          std::clog << __FUNCTION__ << ": " << j.path << " " << img.width << 'x' << img.height << " bc" << static_cast<unsigned int>(j.format)
+                    << " encoded in " << ms << " ms (" << static_cast<double>(img.width) * img.height / (ms * 1000.0)
+                    << " Mpx/s), " << j.mips.data.size() / 1024 << " KB -> " << j.ct.data.size() / 1024 << " KB with mips\n";
+          mkdir(program_cache_dir, 0755);
+          tex::save_compressed(j.cache_path.c_str(), j.ct, texture_quality, j.source_size, j.source_mtime);
+        }
+      }
+      j.done.store(true, std::memory_order_release);
+    }
+
+    // the levels of from into mem, from's pixels are gone once use_texture returns
+    static bool copy_chain(tex::mip_chain const& from, tex::mip_chain& to, arena& mem) noexcept
+    {
+      slice<unsigned char> data{ mem.push_array<unsigned char>(from.data.size()) };
+      if(data.empty()) {
+        return false;
+      }
+      std::memcpy(data.data(), from.data.data(), from.data.size());
+      to.num_levels = from.num_levels;
+      to.data = data;
+      for(unsigned int l{ 0 }; l < from.num_levels; ++l) {
+        tex::image const& level{ from.levels[l] };
+        to.levels[l] = tex::image{ level.width, level.height, level.channels,
+                                   { data.data() + (level.pixels.data() - from.data.data()), level.pixels.size() } };
+      }
+      return true;
+    }
+
+    // a cooked .lvt is ready to upload with its mips (they point into blob), anything else goes through
+    // stb_image and only has level 0 (decoded is stb_image's then, free it)
+    static bool decode_source(char const* path, slice<unsigned char const> const blob, tex::mip_chain& mips, tex::image& img,
+                              unsigned char*& decoded) noexcept
+    {
+      mips = tex::mip_chain{};
+      decoded = nullptr;
+      if(tex::read_texture(blob.data(), blob.size(), mips)) {
+        img = mips.levels[0];
+        return true;
+      }
+      int width, height, channels;
+      stbi_set_flip_vertically_on_load(true); // opengl wants the first row at the bottom
+      decoded = stbi_load_from_memory(blob.data(), static_cast<int>(blob.size()), &width, &height, &channels, 0);
+      if(!decoded) {
+        std::cerr << __FUNCTION__ << ": couldn't load texture " << path << ": " << stbi_failure_reason() << '\n';
+        return false;
+      }
+      img = tex::image{ static_cast<unsigned int>(width), static_cast<unsigned int>(height), static_cast<unsigned int>(channels),
+                        { decoded, static_cast<std::size_t>(width) * height * channels } };
+      return true;
+    }
+
+    // into the bound texture as they are, what it takes on the gpu
+    static std::size_t upload_levels(tex::mip_chain const& mips) noexcept
+    {
+      unsigned int const channels{ mips.levels[0].channels };
+      GLenum const format{ static_cast<GLenum>(channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA) };
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rgb rows aren't multiples of 4 bytes
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(mips.num_levels) - 1);
+      for(unsigned int l{ 0 }; l < mips.num_levels; ++l) {
+        tex::image const& level{ mips.levels[l] };
+        glTexImage2D(GL_TEXTURE_2D, static_cast<int>(l), format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE,
+                     level.pixels.data());
+      }
+      return mips.data.size();
+    }
+
+    // every active uniform outside of a block, arrays by the name without [0] too ("lights" and "lights[0]")
+    static void enumerate_uniforms(unsigned int const program, uniform_table& t) noexcept
+    {
+      int count{ 0 };
+      glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+      for(int i{ 0 }; i < count; ++i) {
+        char name[256];
+        int len{ 0 };
+        int size{ 0 };
+        GLenum type;
+        glGetActiveUniform(program, static_cast<unsigned int>(i), sizeof(name), &len, &size, &type, name);
+        int const location{ glGetUniformLocation(program, name) };
+        if(location == -1) { // in a uniform block, those go through the ubo
+          continue;
+        }
+        t.insert(fnv1a(name, static_cast<std::size_t>(len)), location);
+        if(len > 3 && std::strcmp(name + len - 3, "[0]") == 0) {
+          t.insert(fnv1a(name, static_cast<std::size_t>(len - 3)), location);
+        }
+      }
+    }
+
+    // what a reload needs to know about a program, the watcher thread fills in the sources
+    class reload_slot final {
+    public:
+      program_source src;       // vertcode and fragcode are only touched by the main thread
+      handle<shader> target;
+      std::string vertcode;     // the new ones, under manager::reload_lock
+      std::string fragcode;
+      bool compiling;
+    };
+
+    static bool read_file(char const* path, std::string& out) noexcept
+    {
+      std::ifstream fs(path);
+      if(!fs) {
+        return false;
+      }
+      std::stringstream ss;
+      ss << fs.rdbuf();
+      out = ss.str();
+      return true;
+    }
+
+    // compiled into the program (release builds), from the pack if it's there, the disk otherwise
+    static bool read_asset(pack::reader const* assets, char const* path, std::string& out) noexcept
+    {
+      if(embed::asset const* const a{ embed::find(path) }) {
+        out.assign(reinterpret_cast<char const*>(a->data), a->size);
+        return true;
+      }
+      pack::entry const* const e{ assets ? assets->find(path) : nullptr };
+      if(!e) {
+        return read_file(path, out);
+      }
+      out.resize(e->raw_size);
+      return assets->read(*e, out.data());
+    }
+
+    // a submitted program nobody is going to look at
+    static void abandon_program(program_source& p) noexcept
+    {
+      glDeleteShader(p.vert);
+      glDeleteShader(p.frag);
+      glDeleteProgram(p.program);
+      glDeleteSync(p.fence); // 0 is ignored
+      p.vert = 0;
+      p.frag = 0;
+      p.program = 0;
+      p.fence = nullptr;
+    }
+
+    manager::manager(pack::reader const* assets) noexcept
+      : assets{ assets },
+        budget{ 512 * 1024 * 1024 },
+        frame{ 0 },
+        reload_changed{ 0 },
+        frame_ubo{ 0 },
+        num_cached{ 0 },
+        num_compiling{ 0 },
+        err{ false }
+    {
+      auto const start = std::chrono::steady_clock::now();
+      // bound once for good, the shaders only say that their block is at this binding point
+      glGenBuffers(1, &frame_ubo);
+      glBindBuffer(GL_UNIFORM_BUFFER, frame_ubo);
+      glBufferData(GL_UNIFORM_BUFFER, sizeof(uni_buff_obj), nullptr, GL_DYNAMIC_DRAW);
+      glBindBufferBase(GL_UNIFORM_BUFFER, frame_ubo_binding, frame_ubo);
+      // only the shaders are built here, the first frame can't draw without them. textures and meshes are
+      // loaded when they're used, see acquire_texture and add_mesh. all the programs are built together,
+      // see build_programs
+      program_source sources[]{
+        { .vertpath = SHADER_VERT_LIGHTING_COLOURS, .fragpath = SHADER_FRAG_LIGHTING_COLOURS },
+        { .vertpath = SHADER_VERT_LIGHT_CUBE, .fragpath = SHADER_FRAG_LIGHT_CUBE },
+        { .vertpath = SHADER_VERT_MESH, .fragpath = SHADER_FRAG_MESH },
+      };
+      if(!build_programs(sources, std::size(sources))) {
+        err = true;
+        return;
+      }
+      shader_names[fnv1a(SHADER_VERT_LIGHTING_COLOURS)] =
+        shaders.insert(create_shader(sources[0].program,
+                                     cube_vertices,
+                                     sizeof(cube_vertices),
+                                     2,
+                                     3,
+                                     sizeof(float) * 6));
+      shader_names[fnv1a(SHADER_VERT_LIGHT_CUBE)] =
+        shaders.insert(create_shader(sources[1].program,
+                                     cube_vertices,
+                                     sizeof(cube_vertices),
+                                     1,
+                                     3,
+                                     sizeof(float) * 6));
+      // the meshes have their own vaos (upload_mesh_range), this one has nothing in it
+      shader_names[fnv1a(SHADER_VERT_MESH)] = shaders.insert(create_shader(sources[2].program, nullptr, 0, 0, 0, 0));
+      // whatever is compiled from a file can be reloaded
+      for(auto const& src : sources) {
+        if(reload_slots.size() == 64) {
+          break;
+        }
+        handle<shader> const target{ find_shader(src.vertpath) };
+        reload_slots.push_back(std::make_unique<reload_slot>(
+          reload_slot{ .src = { .vertpath = src.vertpath, .fragpath = src.fragpath }, .target = target, .compiling = false }));
+      }
+      // cold vs warm cache, delete ./cache to see the cold one again
+      std::clog << "resource manager: " << shaders.size() << " programs (" << num_cached << " from the cache) in "
+                << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
     }
 
     manager::~manager() noexcept
     {
+      // what's waiting to be encoded isn't, the one being encoded is finished and saved
+      for(auto const& job : encoding) {
+        job->cancelled.store(true, std::memory_order_release);
+      }
+      encoder.reset();
       // cleanup shaders
+      shader_watcher.reset(); // before the slots, it writes into them
+      for(auto const& slot : reload_slots) {
+        if(slot->compiling) {
+          abandon_program(slot->src);
+        }
+      }
+      glDeleteBuffers(1, &frame_ubo);
+      for(shader const& s : shaders) {
+        glDeleteProgram(s.id);
+        glDeleteVertexArrays(1, &s.vao);
+        glDeleteBuffers(1, &s.vbo);
+      }
+      for(texture const& t : textures) {
+        if(t.id != 0) {
+          glDeleteTextures(1, &t.id);
+        }
+      }
+      for(resident_mesh const& m : meshes) {
+        glDeleteVertexArrays(1, &m.buffers.vao);
+        glDeleteBuffers(1, &m.buffers.vbo);
+        glDeleteBuffers(1, &m.buffers.ebo);
+      }
+      for(buffer const& b : buffers) {
+        glDeleteBuffers(1, &b.id);
+      }
+    }
+
+    handle<buffer> manager::create_buffer(unsigned int const target, std::size_t const bytes, void const* data,
+                                          unsigned int const usage) noexcept
+    {
+      buffer b{ 0, target, bytes };
+      glGenBuffers(1, &b.id);
+      glBindBuffer(target, b.id);
+      glBufferData(target, bytes, data, usage);
+      handle<buffer> const h{ buffers.insert(b) };
+      if(!h.valid()) {
+        std::cerr << __FUNCTION__ << ": too many buffers\n";
+        glDeleteBuffers(1, &b.id);
+      }
+      return h;
+    }
+
+    bool manager::remove_buffer(handle<buffer> const h) noexcept
+    {
+      buffer const* const b{ buffers.get(h) };
+      if(!b) {
+        return false;
+      }
+      glDeleteBuffers(1, &b->id);
+      return buffers.remove(h);
+    }
+
+    handle<texture> manager::acquire_texture(char const* path) noexcept
+    {
+      if(!path || path[0] == '\0') {
+        return {};
+      }
+      int const key{ fnv1a(path) };
+      if(handle<texture> const h{ textures.acquire(key) }; h.valid()) {
+        return h;
+      }
+      std::size_t const len{ std::strlen(path) };
+      if(len >= sizeof(texture::path)) {
+        std::cerr << __FUNCTION__ << ": path too long " << path << '\n';
+        return {};
+      }
+      texture t{ .id = 0, .loaded = false, .res = {}, .path = {} };
+      std::memcpy(t.path, path, len + 1);
+      return textures.insert(t, key, frame);
+    }
+
+    unsigned int manager::use_texture(handle<texture> const h) noexcept
+    {
+      texture* const t{ textures.use(h, frame) };
+      if(!t) {
+        return 0;
+      }
+      if(t->loaded) {
+        return t->id;
+      }
+      // failures are "loaded" too, a missing file would be looked for every frame otherwise
+      t->loaded = true;
+      auto const atlas = atlases.find(t->res.name);
+      if(atlas != atlases.end()) {
+        return load_atlas(h, atlas->second);
+      }
+      // the file as it is, from the pack (straight from the mapping if it isn't compressed) or the disk.
+      // what it was made from, the compressed cache is only good for the same thing: the size and mtime of
+      // the file, or the size and hash of the blob when it only is in a pack
+      std::string file;
+      slice<unsigned char const> blob;
+      unsigned long long source_size{ 0 };
+      long long source_mtime{ 0 };
+      pack::entry const* const e{ assets ? assets->find(t->path) : nullptr };
+      if(e) {
+        if(!(e->flags & pack::entry::compressed)) {
+          blob = assets->view(*e);
+        } else if(file.resize(e->raw_size), assets->read(*e, file.data())) {
+          blob = { reinterpret_cast<unsigned char const*>(file.data()), file.size() };
+        }
+        source_size = blob.size();
+        source_mtime = fnv1a(reinterpret_cast<char const*>(blob.data()), blob.size());
+      } else {
+        struct stat sb;
+        if(stat(t->path, &sb) == 0) {
+          source_size = static_cast<unsigned long long>(sb.st_size);
+          source_mtime = static_cast<long long>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec;
+        }
+      }
+      glGenTextures(1, &t->id);
+      glBindTexture(GL_TEXTURE_2D, t->id);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      // the compressed cache before anything else, a hit doesn't read the file, decode it or make mips
+      std::string cache_path{ texture_cache_path(t->path) };
+      if(source_size > 0) {
+        arena mem(max_compressed_bytes);
+        tex::compressed_texture ct;
+        if(tex::load_compressed(cache_path.c_str(), texture_quality, source_size, source_mtime, ct, mem) &&
+           (ct.format == tex::bc_format::bc5 || s3tc_supported())) {
+          textures.set_bytes(h, upload_compressed(ct));
+          return t->id;
+        }
+      }
+      if(!e && read_file(t->path, file)) {
+        blob = { reinterpret_cast<unsigned char const*>(file.data()), file.size() };
+      }
+      tex::mip_chain mips;
+      tex::image img;
+      unsigned char* decoded;
+      if(!decode_source(t->path, blob, mips, img, decoded)) {
+        glDeleteTextures(1, &t->id);
+        t->id = 0;
+        return 0;
+      }
+      // the mips are made here for whatever wasn't cooked with them (and .lvt from before they were),
+      // glGenerateMipmap can't do srgb or normal maps and it's slow on some drivers
+      arena mem(tex::mip_chain_bytes(img));
+      if(mips.num_levels != tex::num_mip_levels(img.width, img.height) &&
+         !tex::generate_mips(img, tex::mip_settings_for(t->path, img.channels), mips, mem)) {
+        if(decoded) {
+          stbi_image_free(decoded);
+        }
+        glDeleteTextures(1, &t->id);
+        t->id = 0;
+        return 0;
+      }
+      // uncompressed for now. the encode is too slow for a frame, it goes to the worker and end_frame swaps
+      // it in when it's done
+      textures.set_bytes(h, upload_levels(mips));
+      tex::bc_format f;
+      if(source_size > 0 && bc_format_for(img.channels, f)) {
+        // the copy and the blocks, which are never bigger than the pixels
+        auto job = std::make_unique<encode_job>(mips.data.size() * 2 + 1024 * 1024);
+        job->target = h;
+        job->path = t->path;
+        job->cache_path = std::move(cache_path);
+        job->format = f;
+        job->source_size = source_size;
+        job->source_mtime = source_mtime;
+        if(copy_chain(mips, job->mips, job->mem)) {
+          if(!encoder) {
+            encoder = std::make_unique<jobs::pool>(1); // the encode is on all the cores already
+          }
+          if(encoder->submit(encode_texture, job.get())) {
+            encoding.push_back(std::move(job));
+          }
+        }
+      }
+      if(decoded) {
+        stbi_image_free(decoded);
+      }
+      return t->id;
+    }
+
+    handle<texture> manager::acquire_material_atlas(slice<obj::material> materials) noexcept
+    {
+      char const* paths[max_atlas_layers];
+      unsigned int count{ 0 };
+      if(!obj::diffuse_layers(materials, paths, max_atlas_layers, count)) {
+        std::cerr << __FUNCTION__ << ": more than " << max_atlas_layers << " diffuse maps\n";
+        return {};
+      }
+      if(count == 0) {
+        return {};
+      }
+      // the same maps in the same order are the same atlas, whichever mesh asks
+      std::string key{ "atlas" };
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        key += '\n';
+        key += paths[i];
+      }
+      int const name{ fnv1a(key.c_str(), key.size()) };
+      if(handle<texture> const h{ textures.acquire(name) }; h.valid()) {
+        return h;
+      }
+      // the path is only for the logs, the first map's
+      texture t{ .id = 0, .loaded = false, .res = {}, .path = {} };
+      std::snprintf(t.path, sizeof(t.path), "%s", paths[0]);
+      handle<texture> const h{ textures.insert(t, name, frame) };
+      if(h.valid()) {
+        material_atlas& a{ atlases[name] };
+        a.paths.assign(paths, paths + count);
+        a.rects.assign(count, tex::uv_rect{ 0.0f, 0.0f, 1.0f, 1.0f });
+      }
+      return h;
+    }
+
+    tex::uv_rect manager::atlas_rect(handle<texture> const h, unsigned int const layer) const noexcept
+    {
+      texture const* const t{ textures.get(h) };
+      auto const it = t ? atlases.find(t->res.name) : atlases.end();
+      if(it == atlases.end() || layer >= it->second.rects.size()) {
+        return { 0.0f, 0.0f, 1.0f, 1.0f };
+      }
+      return it->second.rects[layer];
+    }
+
+    unsigned int manager::load_atlas(handle<texture> const h, material_atlas& a) noexcept
+    {
+      texture& t{ *textures.get(h) };
+      // every map decoded, then packed, then the mips of the whole thing
+      unsigned int const count{ static_cast<unsigned int>(a.paths.size()) };
+      std::string files[max_atlas_layers];
+      tex::image images[max_atlas_layers];
+      unsigned char* decoded[max_atlas_layers]{};
+      bool ok{ true };
+      for(unsigned int i{ 0 }; i < count && ok; ++i) {
+        char const* const path{ a.paths[i].c_str() };
+        slice<unsigned char const> blob;
+        if(read_asset(assets, path, files[i])) {
+          blob = { reinterpret_cast<unsigned char const*>(files[i].data()), files[i].size() };
+        }
+        tex::mip_chain mips;
+        ok = decode_source(path, blob, mips, images[i], decoded[i]);
+      }
+      // the biggest atlas there can be, the arena only commits what build_atlas writes
+      arena mem(static_cast<std::size_t>(tex::max_atlas_size) * tex::max_atlas_size * 4 + 16);
+      tex::image packed;
+      tex::uv_rect rects[max_atlas_layers];
+      ok = ok && tex::build_atlas(images, count, tex::max_atlas_size, tex::atlas_padding, packed, rects, mem);
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        if(decoded[i]) {
+          stbi_image_free(decoded[i]);
+        }
+      }
+      tex::mip_chain mips;
+      arena chain_mem(ok ? tex::mip_chain_bytes(packed) : 0);
+      // box like texture_loader's atlases, the kaiser lobes would reach past the padding sooner. srgb if the
+      // first one is a colour, and never a normal map: they're diffuse maps
+      tex::mip_settings const settings{ tex::mip_filter::box, tex::mip_settings_for(t.path, packed.channels).srgb, false };
+      if(!ok || !tex::generate_mips(packed, settings, mips, chain_mem)) {
+        std::cerr << __FUNCTION__ << ": no atlas for " << t.path << " and the " << count - 1 << " maps after it\n";
+        return 0;
+      }
+      std::copy(rects, rects + count, a.rects.begin());
+      glGenTextures(1, &t.id);
+      glBindTexture(GL_TEXTURE_2D, t.id);
+      // the rects are next to each other, nothing can repeat
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      textures.set_bytes(h, upload_levels(mips));
+      return t.id;
+    }
+
+    void manager::finish_encodes() noexcept
+    {
+      for(std::size_t i{ 0 }; i < encoding.size();) {
+        encode_job& j{ *encoding[i] };
+        if(!j.done.load(std::memory_order_acquire)) {
+          ++i;
+          continue;
+        }
+        // evicted while it was being encoded, the .lvc is written anyway
+        texture* const t{ textures.get(j.target) };
+        if(j.ok && t && t->id != 0) {
+          glBindTexture(GL_TEXTURE_2D, t->id);
+          textures.set_bytes(j.target, upload_compressed(j.ct));
+        }
+        encoding[i] = std::move(encoding.back());
+        encoding.pop_back();
+      }
+    }
+
+    void manager::release_texture(handle<texture> const h) noexcept
+    {
+      textures.release(h);
+    }
+
+    // the mesh's gl objects, it's about to be removed
+    static void delete_mesh_buffers(resident_mesh const& m) noexcept
+    {
+      glDeleteVertexArrays(1, &m.buffers.vao);
+      glDeleteBuffers(1, &m.buffers.vbo);
+      glDeleteBuffers(1, &m.buffers.ebo);
+    }
+
+    handle<resident_mesh> manager::add_mesh(char const* path, mesh_buffers const& b, std::size_t const bytes) noexcept
+    {
+      int const key{ fnv1a(path) };
+      handle<resident_mesh> const old{ meshes.find(key) };
+      if(old.valid()) { // loaded twice, the new one wins
+        delete_mesh_buffers(*meshes.get(old));
+        meshes.remove(old);
+      }
+      return meshes.insert(resident_mesh{ b, { .bytes = bytes, .refs = 0, .last_used = 0, .name = 0 } }, key, frame);
+    }
+
+    handle<resident_mesh> manager::acquire_mesh(char const* path) noexcept
+    {
+      return meshes.acquire(fnv1a(path));
+    }
+
+    mesh_buffers const* manager::use_mesh(handle<resident_mesh> const h) noexcept
+    {
+      resident_mesh const* const m{ meshes.use(h, frame) };
+      return m ? &m->buffers : nullptr;
+    }
+
+    void manager::release_mesh(handle<resident_mesh> const h) noexcept
+    {
+      meshes.release(h);
+    }
+
+    void manager::end_frame() noexcept
+    {
+      ++frame;
+      if(!encoding.empty()) {
+        finish_encodes();
+      }
+      evict_lru(textures, meshes, budget,
+        [this](texture const& t) {
+          if(t.id != 0) {
+            glDeleteTextures(1, &t.id);
+          }
+          atlases.erase(t.res.name);
+        },
+        delete_mesh_buffers);
     }
 
     bool manager::shader_compilation_has_errors(unsigned int const prg, shader_type const type) const noexcept
@@ -119,91 +847,478 @@ namespace lvar {
       return false;
     }
 
-    unsigned int manager::compile_link_shaders(char const* vertpath, char const* fragpath) noexcept
+    // GL_KHR_parallel_shader_compile (or the ARB one, same thing): the driver compiles on its own
+    // threads and GL_COMPLETION_STATUS says when it's done without waiting for it
+    static bool parallel_compile_supported() noexcept
     {
-      std::ifstream vertfs(vertpath), fragfs(fragpath);
-      if(!vertfs) {
-        std::cerr << __FUNCTION__ << ": couldn't open vertex file: " << vertpath << '\n';
-        err = true;
-        return 0;
+      static bool const supported{ []() {
+        int n{ 0 };
+        glGetIntegerv(GL_NUM_EXTENSIONS, &n);
+        for(int i{ 0 }; i < n && glGetStringi; ++i) {
+          char const* const ext{ reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<unsigned int>(i))) };
+          if(ext && (std::strcmp(ext, "GL_KHR_parallel_shader_compile") == 0 ||
+                     std::strcmp(ext, "GL_ARB_parallel_shader_compile") == 0)) {
+            return glMaxShaderCompilerThreadsKHR != nullptr;
+          }
+        }
+        return false;
+      }() };
+      return supported;
+    }
+
+    // compile and link without asking how it went, that would wait for the driver
+    static void submit_program(program_source& p) noexcept
+    {
+      char const* vertcodec{ p.vertcode.c_str() };
+      char const* fragcodec{ p.fragcode.c_str() };
+      p.vert = glCreateShader(GL_VERTEX_SHADER);
+      glShaderSource(p.vert, 1, &vertcodec, nullptr);
+      glCompileShader(p.vert);
+      p.frag = glCreateShader(GL_FRAGMENT_SHADER);
+      glShaderSource(p.frag, 1, &fragcodec, nullptr);
+      glCompileShader(p.frag);
+      p.program = glCreateProgram();
+      glAttachShader(p.program, p.vert);
+      glAttachShader(p.program, p.frag);
+      if(program_binaries_supported()) {
+        glProgramParameteri(p.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
       }
-      if(!fragfs) {
-        std::cerr << __FUNCTION__ << ": couldn't open fragment file: " << fragpath << '\n';
-        err = true;
-        return 0;
+      glLinkProgram(p.program);
+      // without parallel compile there's no status to ask, but a driver that compiles on its own thread
+      // has the link behind it in the command stream, and so has a fence after it
+      if(!parallel_compile_supported()) {
+        p.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
       }
-      std::stringstream vertss, fragss;
-      vertss << vertfs.rdbuf();
-      fragss << fragfs.rdbuf();
-      unsigned int id_vert, id_frag;
-      // @NOTE: this step is necessary
-      std::string const vertcode{ vertss.str() };
-      std::string const fragcode{ fragss.str() };
-      // you only care about the c str, really
-      char const* vertcodec{ vertcode.c_str() };
-      char const* fragcodec{ fragcode.c_str() };
-      id_vert = glCreateShader(GL_VERTEX_SHADER);
-      glShaderSource(id_vert, 1, &vertcodec, nullptr);
-      glCompileShader(id_vert);
-      if(shader_compilation_has_errors(id_vert, shader_type::vertex)) {
-        glDeleteShader(id_vert);
-        err = true;
-        return 0;
+    }
+
+    // true if asking for the link status won't wait. without parallel compile it's the fence, polled with a
+    // timeout of 0 so a reload is looked at again the next frame instead of waiting in this one
+    static bool program_ready(program_source const& p) noexcept
+    {
+      if(!parallel_compile_supported()) {
+        if(!p.fence) {
+          return true;
+        }
+        GLenum const r{ glClientWaitSync(p.fence, 0, 0) };
+        return r != GL_TIMEOUT_EXPIRED;
       }
-      id_frag = glCreateShader(GL_FRAGMENT_SHADER);
-      glShaderSource(id_frag, 1, &fragcodec, nullptr);
-      glCompileShader(id_frag);
-      if(shader_compilation_has_errors(id_frag, shader_type::fragment)) {
-        glDeleteShader(id_vert);
-        glDeleteShader(id_frag);
-        err = true;
-        return 0;
+      int done{ GL_FALSE };
+      glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &done);
+      return done != GL_FALSE;
+    }
+
+    bool manager::finish_program(program_source& p, bool const cache) const noexcept
+    {
+      if(p.fence) {
+        glDeleteSync(p.fence);
+        p.fence = nullptr;
       }
-      unsigned int id_prg{ glCreateProgram() };
-      glAttachShader(id_prg, id_vert);
-      glAttachShader(id_prg, id_frag);
-      glLinkProgram(id_prg);
-      if(shader_compilation_has_errors(id_prg, shader_type::program)) {
-        glDeleteShader(id_vert);
-        glDeleteShader(id_frag);
-        err = true;
-        return 0;
+      bool ok{ true };
+      // the link fails if a compile failed, and then the compile logs say why
+      if(shader_compilation_has_errors(p.program, shader_type::program)) {
+        shader_compilation_has_errors(p.vert, shader_type::vertex);
+        shader_compilation_has_errors(p.frag, shader_type::fragment);
+        std::cerr << __FUNCTION__ << ": " << p.vertpath << " + " << p.fragpath << '\n';
+        glDeleteProgram(p.program);
+        p.program = 0;
+        ok = false;
+      } else if(cache) {
+        save_cached_program(p.program, p.source_hash);
       }
-      glDeleteShader(id_vert);
-      glDeleteShader(id_frag);
-      return id_prg;
+      glDeleteShader(p.vert);
+      glDeleteShader(p.frag);
+      p.vert = 0;
+      p.frag = 0;
+      return ok;
     }
 
-    shader manager::create_shader(char const* path_vertex_sh,
-                                  char const* path_frag_sh,
+    bool manager::build_programs(program_source* const sources, std::size_t const count) noexcept
+    {
+      // the files are read on workers, no gl in there
+      jobs::parallel_for(count, 1, [sources, assets = assets](std::size_t const begin, std::size_t const end) {
+        for(std::size_t i{ begin }; i < end; ++i) {
+          program_source& p{ sources[i] };
+          p.read = read_asset(assets, p.vertpath, p.vertcode) && read_asset(assets, p.fragpath, p.fragcode);
+          std::string const both{ p.vertcode + '\0' + p.fragcode };
+          p.source_hash = fnv1a(both.c_str(), both.size());
+        }
+      });
+      for(std::size_t i{ 0 }; i < count; ++i) {
+        if(!sources[i].read) {
+          std::cerr << __FUNCTION__ << ": couldn't read " << sources[i].vertpath << " or " << sources[i].fragpath << '\n';
+          return false;
+        }
+      }
+      if(parallel_compile_supported()) {
+        glMaxShaderCompilerThreadsKHR(0xffffffff); // as many as the driver wants
+      }
+      // everything is submitted before asking about any of it: asking for a status waits for the compile
+      for(std::size_t i{ 0 }; i < count; ++i) {
+        program_source& p{ sources[i] };
+        // the program from the last run if nothing changed
+        p.program = load_cached_program(p.source_hash);
+        if(p.program != 0) {
+          ++num_cached;
+          continue;
+        }
+        submit_program(p);
+      }
+      bool ok{ true };
+      for(std::size_t i{ 0 }; i < count; ++i) {
+        program_source& p{ sources[i] };
+        if(p.vert == 0) { // from the cache
+          continue;
+        }
+        // the status below would wait anyway, this only keeps this thread from blocking in the driver
+        while(!program_ready(p)) {
+          std::this_thread::yield();
+        }
+        ok = finish_program(p, true) && ok;
+      }
+      return ok;
+    }
+
+    static void bind_uniform_blocks(unsigned int const id) noexcept
+    {
+      auto const uni_block_idx = glGetUniformBlockIndex(id, "matrices");
+      if(uni_block_idx != GL_INVALID_INDEX) {
+        glUniformBlockBinding(id, uni_block_idx, frame_ubo_binding);
+      }
+      auto const object_block_idx = glGetUniformBlockIndex(id, "object");
+      if(object_block_idx != GL_INVALID_INDEX) {
+        glUniformBlockBinding(id, object_block_idx, object_ubo_binding);
+      }
+    }
+
+    // on the watcher thread: if it's a file of a program, read it and let the main thread know
+    void manager::on_file_changed(char const* path, void* data) noexcept
+    {
+      manager* const m{ static_cast<manager*>(data) };
+      for(std::size_t i{ 0 }; i < m->reload_slots.size(); ++i) {
+        reload_slot& slot{ *m->reload_slots[i] };
+        if(std::strcmp(path, slot.src.vertpath) != 0 && std::strcmp(path, slot.src.fragpath) != 0) {
+          continue;
+        }
+        std::string vertcode, fragcode;
+        if(!read_file(slot.src.vertpath, vertcode) || !read_file(slot.src.fragpath, fragcode)) {
+          std::cerr << __FUNCTION__ << ": couldn't read " << slot.src.vertpath << " or " << slot.src.fragpath << '\n';
+          continue;
+        }
+        {
+          std::lock_guard<std::mutex> const lock(m->reload_lock);
+          slot.vertcode = std::move(vertcode);
+          slot.fragcode = std::move(fragcode);
+        }
+        m->reload_changed.fetch_or(1ull << i, std::memory_order_release);
+      }
+    }
+
+    // the values set with glUniform* belong to the program, the new one starts with zeros. blocks and
+    // arrays aren't copied, the first come from buffers and the second are rare enough
+    static void copy_uniforms(unsigned int const from, unsigned int const to) noexcept
+    {
+      int current{ 0 };
+      glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+      glUseProgram(to);
+      int count{ 0 };
+      glGetProgramiv(to, GL_ACTIVE_UNIFORMS, &count);
+      for(int i{ 0 }; i < count; ++i) {
+        char name[256];
+        int size{ 0 };
+        GLenum type;
+        glGetActiveUniform(to, static_cast<unsigned int>(i), sizeof(name), nullptr, &size, &type, name);
+        int const dst{ glGetUniformLocation(to, name) };
+        int const src{ glGetUniformLocation(from, name) };
+        if(dst == -1 || src == -1 || size != 1) {
+          continue;
+        }
+        float f[16]{};
+        int n[4]{};
+        switch(type) {
+        case GL_FLOAT:      glGetUniformfv(from, src, f); glUniform1fv(dst, 1, f); break;
+        case GL_FLOAT_VEC2: glGetUniformfv(from, src, f); glUniform2fv(dst, 1, f); break;
+        case GL_FLOAT_VEC3: glGetUniformfv(from, src, f); glUniform3fv(dst, 1, f); break;
+        case GL_FLOAT_VEC4: glGetUniformfv(from, src, f); glUniform4fv(dst, 1, f); break;
+        case GL_FLOAT_MAT3: glGetUniformfv(from, src, f); glUniformMatrix3fv(dst, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4: glGetUniformfv(from, src, f); glUniformMatrix4fv(dst, 1, GL_FALSE, f); break;
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_CUBE:
+          glGetUniformiv(from, src, n);
+          glUniform1iv(dst, 1, n);
+          break;
+        default:
+          break;
+        }
+      }
+      glUseProgram(static_cast<unsigned int>(current));
+    }
+
+    void manager::enable_hot_reload() noexcept
+    {
+      if(shader_watcher) {
+        return;
+      }
+      // the shaders aren't read from the disk, editing the files changes nothing
+      if(embed::enabled()) {
+        std::clog << __FUNCTION__ << ": the shaders are compiled in, no hot reload\n";
+        return;
+      }
+      // every directory with a shader in it, once
+      char dirs[files::watcher::max_directories][256];
+      char const* dir_ptrs[files::watcher::max_directories];
+      unsigned int num_dirs{ 0 };
+      for(auto const& slot : reload_slots) {
+        for(char const* const path : { slot->src.vertpath, slot->src.fragpath }) {
+          char const* const slash{ std::strrchr(path, '/') };
+          std::size_t const len{ slash ? static_cast<std::size_t>(slash - path) : 1 };
+          char dir[256];
+          if(len >= sizeof(dir)) {
+            continue;
+          }
+          std::memcpy(dir, slash ? path : ".", len);
+          dir[len] = '\0';
+          bool seen{ false };
+          for(unsigned int d{ 0 }; d < num_dirs; ++d) {
+            seen = seen || std::strcmp(dirs[d], dir) == 0;
+          }
+          if(!seen && num_dirs < files::watcher::max_directories) {
+            std::memcpy(dirs[num_dirs], dir, len + 1);
+            dir_ptrs[num_dirs] = dirs[num_dirs];
+            ++num_dirs;
+          }
+        }
+      }
+      shader_watcher = std::make_unique<files::watcher>(dir_ptrs, num_dirs, on_file_changed, this);
+      if(shader_watcher->error()) {
+        std::cerr << __FUNCTION__ << ": no hot reload\n";
+        shader_watcher.reset();
+      }
+    }
+
+    void manager::reload_shaders() noexcept
+    {
+      // what every frame pays when nothing changed
+      if(num_compiling == 0 && reload_changed.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+      unsigned long long const changed{ reload_changed.exchange(0, std::memory_order_acquire) };
+      for(std::size_t i{ 0 }; i < reload_slots.size(); ++i) {
+        reload_slot& slot{ *reload_slots[i] };
+        if(changed & (1ull << i)) {
+          if(slot.compiling) { // saved again before the last one was done, that one is old already
+            abandon_program(slot.src);
+            --num_compiling;
+          }
+          {
+            std::lock_guard<std::mutex> const lock(reload_lock);
+            slot.src.vertcode = std::move(slot.vertcode);
+            slot.src.fragcode = std::move(slot.fragcode);
+          }
+          std::string const both{ slot.src.vertcode + '\0' + slot.src.fragcode };
+          slot.src.source_hash = fnv1a(both.c_str(), both.size());
+          submit_program(slot.src);
+          slot.compiling = true;
+          ++num_compiling;
+        }
+        if(!slot.compiling || !program_ready(slot.src)) {
+          continue;
+        }
+        slot.compiling = false;
+        --num_compiling;
+        if(!finish_program(slot.src, false)) {
+          std::cerr << __FUNCTION__ << ": keeping the old " << slot.src.vertpath << " + " << slot.src.fragpath << '\n';
+          continue;
+        }
+        shader* const target{ shaders.get(slot.target) };
+        if(!target) {
+          glDeleteProgram(slot.src.program);
+          continue;
+        }
+        // swapped in place, whoever has the handle gets the new one
+        unsigned int const old{ target->id };
+        copy_uniforms(old, slot.src.program);
+        bind_uniform_blocks(slot.src.program);
+        target->id = slot.src.program;
+        target->uniforms = uniform_table{};
+        enumerate_uniforms(slot.src.program, target->uniforms);
+        glDeleteProgram(old);
+        std::clog << __FUNCTION__ << ": reloaded " << slot.src.vertpath << " + " << slot.src.fragpath << '\n';
+      }
+    }
+
+    void set_vertex_format(obj::encoded_mesh const& m) noexcept
+    {
+      for(unsigned int i{ 0 }; i < m.num_attributes; ++i) {
+        obj::vertex_attribute const& a{ m.attributes[i] };
+        glVertexAttribPointer(a.location, a.components, a.type, a.normalised ? GL_TRUE : GL_FALSE, m.stride,
+                              reinterpret_cast<void*>(static_cast<std::size_t>(a.offset)));
+        glEnableVertexAttribArray(a.location);
+      }
+    }
+
+    void upload_mesh_range(mesh_buffers& b, obj::encoded_mesh const& m, std::size_t const begin, std::size_t const end) noexcept
+    {
+      std::size_t const vertex_bytes{ m.vertices.bytes() };
+      if(begin == 0) {
+        // storage for everything now, the data comes in pieces over the next frames
+        glGenVertexArrays(1, &b.vao);
+        glGenBuffers(1, &b.vbo);
+        glGenBuffers(1, &b.ebo);
+        glBindVertexArray(b.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertex_bytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, b.ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m.indices.bytes(), nullptr, GL_STATIC_DRAW);
+        set_vertex_format(m);
+        glBindVertexArray(0);
+        b.num_indices = m.num_indices;
+        b.index_type = m.index_type;
+      }
+      if(begin < vertex_bytes) {
+        std::size_t const last{ std::min(end, vertex_bytes) };
+        glBindBuffer(GL_ARRAY_BUFFER, b.vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, begin, last - begin, m.vertices.data() + begin);
+      }
+      if(end > vertex_bytes) {
+        // not through GL_ELEMENT_ARRAY_BUFFER, that one belongs to whatever vao is bound
+        std::size_t const first{ std::max(begin, vertex_bytes) - vertex_bytes };
+        glBindBuffer(GL_COPY_WRITE_BUFFER, b.ebo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, first, end - vertex_bytes - first, m.indices.data() + first);
+      }
+    }
+
+    uniform_stream::uniform_stream(std::size_t const bytes) noexcept
+      : mapped{ nullptr },
+        fences{},
+        region_bytes{ 0 },
+        alignment{ 256 },
+        used{ 0 },
+        ubo{ 0 },
+        region{ num_regions - 1 },
+        persistent{ false },
+        err{ false }
+    {
+      int align{ 0 };
+      glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+      if(align > 0) {
+        alignment = static_cast<std::size_t>(align);
+      }
+      // every region starts aligned
+      region_bytes = (bytes + alignment - 1) / alignment * alignment;
+      int major{ 0 }, minor{ 0 };
+      glGetIntegerv(GL_MAJOR_VERSION, &major);
+      glGetIntegerv(GL_MINOR_VERSION, &minor);
+      persistent = glBufferStorage && (major > 4 || (major == 4 && minor >= 4));
+      glGenBuffers(1, &ubo);
+      glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+      if(persistent) {
+        GLbitfield const flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+        glBufferStorage(GL_UNIFORM_BUFFER, region_bytes * num_regions, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, region_bytes * num_regions, flags));
+        if(!mapped) {
+          std::cerr << __FUNCTION__ << ": couldn't map the uniform buffer\n";
+          err = true;
+        }
+      } else {
+        glBufferData(GL_UNIFORM_BUFFER, region_bytes * num_regions, nullptr, GL_STREAM_DRAW);
+      }
+    }
+
+    uniform_stream::~uniform_stream() noexcept
+    {
+      for(auto& f : fences) {
+        if(f) {
+          glDeleteSync(f);
+        }
+      }
+      if(ubo != 0) {
+        if(mapped) {
+          glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+          glUnmapBuffer(GL_UNIFORM_BUFFER);
+        }
+        glDeleteBuffers(1, &ubo);
+      }
+    }
+
+    void uniform_stream::begin_frame() noexcept
+    {
+      region = (region + 1) % num_regions;
+      used = 0;
+      if(fences[region]) {
+        // only waits if the gpu is num_regions frames behind
+        GLenum r{ glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0) };
+        while(r == GL_TIMEOUT_EXPIRED) {
+          r = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        if(r == GL_WAIT_FAILED) {
+          std::cerr << __FUNCTION__ << ": glClientWaitSync failed\n";
+        }
+        glDeleteSync(fences[region]);
+        fences[region] = nullptr;
+      }
+      if(!persistent) {
+        // the fence already said nobody uses this region, no need for the driver to check
+        GLbitfield const flags{ GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT };
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, region * region_bytes, region_bytes, flags));
+        if(!mapped) {
+          std::cerr << __FUNCTION__ << ": couldn't map the uniform buffer\n";
+        }
+      }
+    }
+
+    bool uniform_stream::push(void const* data, std::size_t const bytes, std::size_t& offset) noexcept
+    {
+      if(!mapped || used + bytes > region_bytes) {
+        return false;
+      }
+      std::size_t const in_region{ used };
+      std::memcpy(mapped + (persistent ? region * region_bytes : 0) + in_region, data, bytes);
+      offset = region * region_bytes + in_region;
+      used = std::min(region_bytes, (used + bytes + alignment - 1) / alignment * alignment);
+      return true;
+    }
+
+    void uniform_stream::flush() noexcept
+    {
+      if(!persistent && mapped) {
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        mapped = nullptr;
+      }
+    }
+
+    void uniform_stream::end_frame() noexcept
+    {
+      flush();
+      fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    shader manager::create_shader(unsigned int const id,
                                   void* vertex_data,
                                   std::size_t const vertex_sz,
                                   unsigned int const num_attrs,
                                   unsigned int const elem_per_attr,
                                   std::size_t const stride_sz) noexcept
     {
-      unsigned int id{ compile_link_shaders(path_vertex_sh, path_frag_sh) };
-      if(id == 0) {
-        return shader{ 0, 0, 0, 0, 0 };
-      }
-      unsigned int vao, vbo, ubo;
+      unsigned int vao, vbo;
       glGenVertexArrays(1, &vao);
       glGenBuffers(1, &vbo);
-      glGenBuffers(1, &ubo);
       glBindBuffer(GL_ARRAY_BUFFER, vbo);
       glBufferData(GL_ARRAY_BUFFER, vertex_sz, vertex_data, GL_STATIC_DRAW); // @TODO: parametrise draw type!
-      glBindBuffer(GL_UNIFORM_BUFFER, ubo);
-      glBufferData(GL_UNIFORM_BUFFER, sizeof(uni_buff_obj), nullptr, GL_STATIC_DRAW);
-      auto const uni_block_idx = glGetUniformBlockIndex(id, "matrices");
-      unsigned int const unused_bind_point{ 1 };
-      glUniformBlockBinding(id, uni_block_idx, unused_bind_point);
-      glBindBufferBase(GL_UNIFORM_BUFFER, unused_bind_point, ubo);
+      bind_uniform_blocks(id);
       glBindVertexArray(vao);
       for(unsigned int i{ 0 }; i < num_attrs; ++i) {
         glVertexAttribPointer(i, elem_per_attr, GL_FLOAT, GL_FALSE, stride_sz, reinterpret_cast<void*>(i * sizeof(float) * elem_per_attr)); // this is wrong lol
         glEnableVertexAttribArray(i);
       }
-      return shader{ id, vao, vbo, 0, ubo };
+      shader s{ id, vao, vbo, 0 };
+      enumerate_uniforms(id, s.uniforms);
+      return s;
     }
   };
 };
@@ -0,0 +1,26 @@
+#include "lvar_shader.h"
+
+#include <iostream>
+
+namespace lvar {
+  namespace resource {
+
+    bool uniform_table::insert(int const id, int const location) noexcept
+    {
+      if((count + 1) * 2 > max_slots) {
+        std::cerr << __FUNCTION__ << ": too many uniforms, max is " << max_slots / 2 << '\n';
+        return false;
+      }
+      unsigned int i{ static_cast<unsigned int>(id) & (max_slots - 1) };
+      while(slots[i].location != -1 && slots[i].id != id) {
+        i = (i + 1) & (max_slots - 1);
+      }
+      if(slots[i].location == -1) {
+        ++count;
+      }
+      slots[i] = slot{ id, location };
+      return true;
+    }
+
+  };
+};
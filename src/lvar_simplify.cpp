@@ -0,0 +1,428 @@
+#include "lvar_simplify.h"
+#include "lvar_mesh_opt.h"
+
+#include <iostream>
+#include <algorithm>            // sort, lower_bound
+#include <cmath>                // sqrt, pow, ceil
+#include <cstring>              // memcpy
+#include <limits>
+
+namespace lvar {
+  namespace obj {
+
+    namespace {
+
+      // symmetric 4x4 matrix, only the upper triangle is stored. doubles bc the error of a collapse is
+      // a difference of big sums and floats lose it pretty quick on big meshes
+      class quadric final {
+      public:
+        double a2, ab, ac, ad;
+        double b2, bc, bd;
+        double c2, cd;
+        double d2;
+        double weight;
+      };
+
+      void add_plane(quadric& q, double const a, double const b, double const c, double const d, double const w) noexcept
+      {
+        q.a2 += w * a * a; q.ab += w * a * b; q.ac += w * a * c; q.ad += w * a * d;
+        q.b2 += w * b * b; q.bc += w * b * c; q.bd += w * b * d;
+        q.c2 += w * c * c; q.cd += w * c * d;
+        q.d2 += w * d * d;
+        q.weight += w;
+      }
+
+      void add(quadric& q, quadric const& o) noexcept
+      {
+        q.a2 += o.a2; q.ab += o.ab; q.ac += o.ac; q.ad += o.ad;
+        q.b2 += o.b2; q.bc += o.bc; q.bd += o.bd;
+        q.c2 += o.c2; q.cd += o.cd;
+        q.d2 += o.d2;
+        q.weight += o.weight;
+      }
+
+      // squared distance from p to all the planes of the quadric, weighted by their area, so it's
+      // the avg squared distance between p and the surface around it
+      double error(quadric const& q, vertex const& p) noexcept
+      {
+        double const x{ p.x }, y{ p.y }, z{ p.z };
+        double const e{ q.a2 * x * x + 2 * q.ab * x * y + 2 * q.ac * x * z + 2 * q.ad * x
+                        + q.b2 * y * y + 2 * q.bc * y * z + 2 * q.bd * y
+                        + q.c2 * z * z + 2 * q.cd * z
+                        + q.d2 };
+        return q.weight > 0.0 ? std::fabs(e) / q.weight : 0.0;
+      }
+
+      class collapse final {
+      public:
+        float cost;
+        unsigned int from;
+        unsigned int to;
+      };
+
+      void triangle_normal(vertex const& a, vertex const& b, vertex const& c, double n[3]) noexcept
+      {
+        double const e1[3]{ b.x - a.x, b.y - a.y, b.z - a.z };
+        double const e2[3]{ c.x - a.x, c.y - a.y, c.z - a.z };
+        n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+        n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+        n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+      }
+
+      // moving from onto to must not flip or squash any of the triangles around from (except the ones
+      // that use both, those are the ones that disappear)
+      bool collapse_flips(slice<unsigned int> const& indices, slice<vertex> const& vertices,
+                          adjacency const& adj, unsigned int const from, unsigned int const to) noexcept
+      {
+        for(unsigned int a{ adj.offsets[from] }; a < adj.offsets[from + 1]; ++a) {
+          unsigned int const t{ adj.tris[a] };
+          unsigned int const i0{ indices[t * 3] }, i1{ indices[t * 3 + 1] }, i2{ indices[t * 3 + 2] };
+          if(i0 == to || i1 == to || i2 == to) {
+            continue;
+          }
+          double before[3], after[3];
+          triangle_normal(vertices[i0], vertices[i1], vertices[i2], before);
+          triangle_normal(vertices[i0 == from ? to : i0],
+                          vertices[i1 == from ? to : i1],
+                          vertices[i2 == from ? to : i2], after);
+          double const d{ before[0] * after[0] + before[1] * after[1] + before[2] * after[2] };
+          double const len_before{ before[0] * before[0] + before[1] * before[1] + before[2] * before[2] };
+          double const len_after{ after[0] * after[0] + after[1] * after[1] + after[2] * after[2] };
+          // flipped or the normal turned more than ~75 degrees
+          if(d <= 0.25 * std::sqrt(len_before * len_after)) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      bool scratch_too_small(char const* fx) noexcept
+      {
+        std::cerr << fx << ": scratch arena is too small\n";
+        return false;
+      }
+
+    };
+
+    std::size_t simplify(slice<unsigned int> const& indices,
+                         slice<vertex> const& vertices,
+                         std::size_t const target_index_count,
+                         float const target_error,
+                         slice<unsigned int> out,
+                         float* result_error,
+                         arena& scratch) noexcept
+    {
+      std::size_t const num_vertices{ vertices.size() };
+      if(result_error) {
+        *result_error = 0.0f;
+      }
+      arena_scope scope(scratch);
+      auto canonical = scratch.push_array<unsigned int>(num_vertices);
+      auto quadrics = scratch.push_array<quadric>(num_vertices);
+      auto locked = scratch.push_array<unsigned char>(num_vertices);
+      auto touched = scratch.push_array<unsigned char>(num_vertices);
+      auto remap = scratch.push_array<unsigned int>(num_vertices);
+      auto current = scratch.push_array<unsigned int>(indices.size());
+      if(num_vertices == 0 || canonical.empty() || quadrics.empty() || locked.empty() || touched.empty() ||
+         remap.empty() || (indices.size() && current.empty())) {
+        scratch_too_small(__FUNCTION__);
+        return 0;
+      }
+      // vertices with the same position are the same vertex for the simplifier (uv seams, etc),
+      // otherwise collapsing one side of the seam would open cracks
+      {
+        arena_scope tmp(scratch);
+        auto order = scratch.push_array<unsigned int>(num_vertices);
+        if(order.empty()) {
+          scratch_too_small(__FUNCTION__);
+          return 0;
+        }
+        for(unsigned int v{ 0 }; v < num_vertices; ++v) {
+          order[v] = v;
+        }
+        auto const less = [&vertices](unsigned int const a, unsigned int const b) {
+          vertex const& va{ vertices[a] };
+          vertex const& vb{ vertices[b] };
+          if(va.x != vb.x) return va.x < vb.x;
+          if(va.y != vb.y) return va.y < vb.y;
+          if(va.z != vb.z) return va.z < vb.z;
+          return a < b;
+        };
+        std::sort(order.begin(), order.end(), less);
+        for(std::size_t i{ 0 }; i < num_vertices; ++i) {
+          vertex const& v{ vertices[order[i]] };
+          bool const same{ i > 0 && vertices[order[i - 1]].x == v.x && vertices[order[i - 1]].y == v.y &&
+                           vertices[order[i - 1]].z == v.z };
+          canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+        }
+      }
+      std::size_t count{ 0 };
+      for(std::size_t t{ 0 }; t + 2 < indices.size(); t += 3) {
+        unsigned int const a{ canonical[indices[t]] }, b{ canonical[indices[t + 1]] }, c{ canonical[indices[t + 2]] };
+        if(a != b && b != c && c != a) {
+          current[count++] = a;
+          current[count++] = b;
+          current[count++] = c;
+        }
+      }
+      // quadric of every vertex, planes of the triangles around it weighted by their area
+      std::memset(quadrics.data(), 0, quadrics.bytes());
+      for(std::size_t t{ 0 }; t < count; t += 3) {
+        double n[3];
+        vertex const& a{ vertices[current[t]] };
+        triangle_normal(a, vertices[current[t + 1]], vertices[current[t + 2]], n);
+        double const len{ std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) };
+        if(len == 0.0) {
+          continue;
+        }
+        n[0] /= len; n[1] /= len; n[2] /= len;
+        double const d{ -(n[0] * a.x + n[1] * a.y + n[2] * a.z) };
+        for(unsigned int k{ 0 }; k < 3; ++k) {
+          add_plane(quadrics[current[t + k]], n[0], n[1], n[2], d, len * 0.5);
+        }
+      }
+      // border vertices (edges without a twin going the other way) and non manifold stuff never move
+      std::memset(locked.data(), 0, locked.bytes());
+      {
+        arena_scope tmp(scratch);
+        auto edges = scratch.push_array<unsigned long long>(count);
+        if(count && edges.empty()) {
+          scratch_too_small(__FUNCTION__);
+          return 0;
+        }
+        for(std::size_t t{ 0 }; t < count; t += 3) {
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            unsigned long long const a{ current[t + k] };
+            unsigned long long const b{ current[t + (k + 1) % 3] };
+            edges[t + k] = (a << 32) | b;
+          }
+        }
+        std::sort(edges.begin(), edges.end());
+        for(std::size_t e{ 0 }; e < count; ++e) {
+          unsigned long long const twin{ (edges[e] << 32) | (edges[e] >> 32) };
+          bool const duplicated{ (e > 0 && edges[e - 1] == edges[e]) || (e + 1 < count && edges[e + 1] == edges[e]) };
+          if(duplicated || !std::binary_search(edges.begin(), edges.end(), twin)) {
+            locked[edges[e] >> 32] = 1;
+            locked[edges[e] & 0xffffffffull] = 1;
+          }
+        }
+      }
+      for(unsigned int v{ 0 }; v < num_vertices; ++v) {
+        remap[v] = v;
+      }
+      double const max_cost{ static_cast<double>(target_error) * target_error };
+      double worst{ 0.0 };
+      // every pass sorts all the possible collapses by cost and does as many as it can as long as they
+      // don't touch each other. cheaper than keeping a heap up to date and the result is the same-ish.
+      while(count > target_index_count) {
+        arena_scope pass(scratch);
+        slice<unsigned int> const tris{ current.data(), count };
+        adjacency adj;
+        auto candidates = scratch.push_array<collapse>(count);
+        if(!build_adjacency(tris, num_vertices, scratch, adj) || candidates.empty()) {
+          scratch_too_small(__FUNCTION__);
+          return 0;
+        }
+        std::size_t num_candidates{ 0 };
+        for(std::size_t t{ 0 }; t < count; t += 3) {
+          for(unsigned int k{ 0 }; k < 3; ++k) {
+            unsigned int const a{ tris[t + k] };
+            unsigned int const b{ tris[t + (k + 1) % 3] };
+            // interior edges show up twice, once per direction, only take one of them
+            if(a > b) {
+              continue;
+            }
+            if(locked[a] && locked[b]) {
+              continue;
+            }
+            quadric q{ quadrics[a] };
+            add(q, quadrics[b]);
+            double const cost_ab{ locked[a] ? std::numeric_limits<double>::max() : error(q, vertices[b]) };
+            double const cost_ba{ locked[b] ? std::numeric_limits<double>::max() : error(q, vertices[a]) };
+            if(cost_ab <= cost_ba) {
+              candidates[num_candidates++] = { static_cast<float>(cost_ab), a, b };
+            } else {
+              candidates[num_candidates++] = { static_cast<float>(cost_ba), b, a };
+            }
+          }
+        }
+        if(num_candidates == 0) {
+          break;
+        }
+        std::sort(candidates.data(), candidates.data() + num_candidates, [](collapse const& x, collapse const& y) {
+          return x.cost < y.cost || (x.cost == y.cost && (x.from < y.from || (x.from == y.from && x.to < y.to)));
+        });
+        std::memset(touched.data(), 0, touched.bytes());
+        std::size_t removed{ 0 };
+        std::size_t collapses{ 0 };
+        std::size_t const to_remove{ count - target_index_count };
+        for(std::size_t c{ 0 }; c < num_candidates && removed < to_remove; ++c) {
+          collapse const& col{ candidates[c] };
+          if(col.cost > max_cost) {
+            break;
+          }
+          if(touched[col.from] || touched[col.to]) {
+            continue;
+          }
+          if(collapse_flips(tris, vertices, adj, col.from, col.to)) {
+            continue;
+          }
+          // nothing else around from can change during this pass, otherwise the flip check is a lie
+          for(unsigned int a{ adj.offsets[col.from] }; a < adj.offsets[col.from + 1]; ++a) {
+            unsigned int const t{ adj.tris[a] };
+            bool gone{ false };
+            for(unsigned int k{ 0 }; k < 3; ++k) {
+              touched[tris[t * 3 + k]] = 1;
+              gone = gone || tris[t * 3 + k] == col.to;
+            }
+            removed += gone ? 3 : 0;
+          }
+          remap[col.from] = col.to;
+          add(quadrics[col.to], quadrics[col.from]);
+          worst = std::max(worst, static_cast<double>(col.cost));
+          ++collapses;
+        }
+        if(collapses == 0) {
+          break;
+        }
+        std::size_t const prev{ count };
+        count = 0;
+        for(std::size_t t{ 0 }; t < prev; t += 3) {
+          unsigned int const a{ remap[current[t]] }, b{ remap[current[t + 1]] }, c{ remap[current[t + 2]] };
+          if(a != b && b != c && c != a) {
+            current[count++] = a;
+            current[count++] = b;
+            current[count++] = c;
+          }
+        }
+        for(unsigned int v{ 0 }; v < num_vertices; ++v) {
+          remap[v] = v;
+        }
+      }
+      if(count <= out.size()) {
+        std::memcpy(out.data(), current.data(), count * sizeof(unsigned int));
+      }
+      if(result_error) {
+        *result_error = static_cast<float>(std::sqrt(worst));
+      }
+      return count;
+    }
+
+    bool build_lods(mesh const& m,
+                    lod_chain& chain,
+                    arena& mem,
+                    arena& scratch,
+                    unsigned int const num_levels,
+                    float const reduction) noexcept
+    {
+      assert(num_levels > 0 && num_levels <= max_lods);
+      assert(reduction > 0.0f && reduction < 1.0f);
+      std::size_t const n{ m.indices.size() };
+      std::size_t const parts{ m.submeshes.size() };
+      auto const mark = mem.mark();
+      auto levels = mem.push_array<lod>(num_levels);
+      auto submeshes = mem.push_array<submesh>(num_levels * parts);
+      // a level is kept with up to 0.9 times the indices of the previous one (simplify stops above the
+      // target when the error gets too big), so the chain can be as big as n * sum(0.9^k). the unused
+      // part is given back to the arena at the end
+      double bound{ 0.0 };
+      for(unsigned int l{ 0 }; l < num_levels; ++l) {
+        bound += static_cast<double>(n) * std::pow(0.9, l);
+      }
+      auto const indices_mark = mem.mark();
+      auto indices = mem.push_array<unsigned int>(static_cast<std::size_t>(std::ceil(bound)));
+      if(levels.empty() || (parts && submeshes.empty()) || (n && indices.empty())) {
+        mem.pop_to(mark);
+        return scratch_too_small(__FUNCTION__);
+      }
+      // errors bigger than this wreck the mesh, no matter how far it is
+      vertex lo{ m.vertices.empty() ? vertex{ 0, 0, 0 } : m.vertices[0] };
+      vertex hi{ lo };
+      for(auto const& v : m.vertices) {
+        lo = { std::min(lo.x, v.x), std::min(lo.y, v.y), std::min(lo.z, v.z) };
+        hi = { std::max(hi.x, v.x), std::max(hi.y, v.y), std::max(hi.z, v.z) };
+      }
+      float const extent{ std::sqrt((hi.x - lo.x) * (hi.x - lo.x) + (hi.y - lo.y) * (hi.y - lo.y) +
+                                    (hi.z - lo.z) * (hi.z - lo.z)) };
+      std::memcpy(indices.data(), m.indices.data(), m.indices.bytes());
+      std::memcpy(submeshes.data(), m.submeshes.data(), m.submeshes.bytes());
+      levels[0] = { 0, static_cast<unsigned int>(n), 0.0f };
+      // level l as a mesh, for for_each_submesh: the offsets of the submeshes are in the whole chain
+      auto const level_mesh = [&](unsigned int const l) {
+        mesh level;
+        level.vertices = m.vertices;
+        level.indices = parts ? indices : slice<unsigned int>{ indices.data() + levels[l].index_offset, levels[l].index_count };
+        level.submeshes = slice<submesh>{ submeshes.data() + l * parts, parts };
+        return level;
+      };
+      unsigned int built{ 1 };
+      std::size_t written{ n };
+      for(; built < num_levels; ++built) {
+        lod const& prev{ levels[built - 1] };
+        std::size_t count{ 0 };
+        unsigned int part{ 0 };
+        float err{ 0.0f };
+        mesh source{ level_mesh(built - 1) };
+        bool const fits{ for_each_submesh(source, [&](mesh& p) {
+          std::size_t const target{ static_cast<std::size_t>(p.indices.size() * reduction) / 3 * 3 };
+          slice<unsigned int> const dst{ indices.data() + written + count, indices.size() - written - count };
+          float part_err{ 0.0f };
+          std::size_t const part_count{ simplify(p.indices, m.vertices, target, extent * 0.1f, dst, &part_err, scratch) };
+          if(part_count > dst.size()) {
+            return false;
+          }
+          if(parts) {
+            submeshes[built * parts + part] = {
+              static_cast<unsigned int>(written + count), static_cast<unsigned int>(part_count), m.submeshes[part].material
+            };
+          }
+          ++part;
+          count += part_count;
+          err = std::max(err, part_err);
+          return true;
+        }) };
+        // not worth it if it barely changed
+        if(!fits || count == 0 || count > prev.index_count * 0.9f) {
+          break;
+        }
+        levels[built] = { static_cast<unsigned int>(written), static_cast<unsigned int>(count), 0.0f };
+        mesh level{ level_mesh(built) };
+        optimise_vertex_cache(level, scratch);
+        // every level is simplified from the previous one, so errors add up
+        levels[built].error = prev.error + err;
+        written += count;
+      }
+      // give back what wasn't used, same offset -> same pointer, the data is still there
+      mem.pop_to(indices_mark);
+      chain.indices = mem.push_array<unsigned int>(written);
+      if(written && chain.indices.empty()) {
+        mem.pop_to(mark);
+        chain = lod_chain{};
+        return scratch_too_small(__FUNCTION__);
+      }
+      chain.levels = slice<lod>{ levels.data(), built };
+      chain.submeshes = slice<submesh>{ submeshes.data(), built * parts };
+      return true;
+    }
+
+    unsigned int select_lod(lod_chain const& chain,
+                            float const distance,
+                            float const proj_scale,
+                            float const viewport_height,
+                            float const pixel_threshold) noexcept
+    {
+      if(distance <= 0.0f || chain.levels.empty()) {
+        return 0;
+      }
+      // size in pixels of something that is error units big at that distance
+      float const pixels_per_unit{ proj_scale * viewport_height * 0.5f / distance };
+      for(std::size_t l{ chain.levels.size() - 1 }; l > 0; --l) {
+        if(chain.levels[l].error * pixels_per_unit <= pixel_threshold) {
+          return static_cast<unsigned int>(l);
+        }
+      }
+      return 0;
+    }
+
+  };
+};
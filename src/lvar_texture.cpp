@@ -0,0 +1,401 @@
+#include "lvar_texture.h"
+#include "lvar_jobs.h"
+
+#include <algorithm>
+#include <cctype>               // tolower
+#include <cerrno>
+#include <cmath>
+#include <cstring>              // memcpy, strerror, strstr
+#include <iostream>
+#include <vector>
+#include <immintrin.h>          // SSE 4.2
+#include <fcntl.h>              // open
+#include <unistd.h>             // pwrite, close
+
+namespace lvar {
+  namespace tex {
+
+    mip_settings mip_settings_for(char const* path, unsigned int const channels) noexcept
+    {
+      // the name without the directory and the extension, lower case
+      char const* const slash{ std::strrchr(path, '/') };
+      char const* const name{ slash ? slash + 1 : path };
+      char const* const dot{ std::strrchr(name, '.') };
+      std::size_t const len{ std::min<std::size_t>(dot ? static_cast<std::size_t>(dot - name) : std::strlen(name), 255) };
+      char lower[256];
+      for(std::size_t i{ 0 }; i < len; ++i) {
+        lower[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+      }
+      lower[len] = '\0';
+      auto const ends_with = [&lower, len](char const* suffix) {
+        std::size_t const n{ std::strlen(suffix) };
+        return len >= n && std::memcmp(lower + len - n, suffix, n) == 0;
+      };
+      bool const normal{ channels >= 2 && (std::strstr(lower, "normal") || ends_with("_n") || ends_with("_nrm")) };
+      return mip_settings{ mip_filter::kaiser, !normal && channels >= 3, normal };
+    }
+
+    unsigned int num_mip_levels(unsigned int const width, unsigned int const height) noexcept
+    {
+      unsigned int levels{ 1 };
+      while(levels < mip_chain::max_levels && ((width >> levels) > 0 || (height >> levels) > 0)) {
+        ++levels;
+      }
+      return levels;
+    }
+
+    namespace {
+
+      // 8 bit srgb -> linear [0, 1] and back, through enough steps that two of them are never more than
+      // half an 8 bit step apart
+      class colour_tables final {
+      public:
+        static unsigned int constexpr linear_steps{ 8192 };
+      public:
+        colour_tables() noexcept
+        {
+          for(unsigned int i{ 0 }; i < 256; ++i) {
+            float const c{ static_cast<float>(i) / 255.0f };
+            to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+          }
+          for(unsigned int i{ 0 }; i < linear_steps; ++i) {
+            float const l{ static_cast<float>(i) / static_cast<float>(linear_steps - 1) };
+            float const c{ l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f };
+            to_srgb[i] = static_cast<unsigned char>(c * 255.0f + 0.5f);
+          }
+        }
+      public:
+        float to_linear[256];
+        unsigned char to_srgb[linear_steps];
+      };
+
+      colour_tables const& tables() noexcept
+      {
+        static colour_tables const t;
+        return t;
+      }
+
+      // a separable filter for halving: pixel x of the next level is the sum of weights[i] * the pixel
+      // 2x + first + i of this one (clamped to the edges), same thing for the rows
+      class kernel final {
+      public:
+        static unsigned int constexpr max_taps{ 8 };
+      public:
+        float weights[max_taps];
+        unsigned int taps;
+        int first;
+      };
+
+      double bessel_i0(double const x) noexcept
+      {
+        double sum{ 1.0 };
+        double term{ 1.0 };
+        for(unsigned int k{ 1 }; k < 32; ++k) {
+          term *= (x / (2.0 * k)) * (x / (2.0 * k));
+          sum += term;
+        }
+        return sum;
+      }
+
+      kernel make_kernel(mip_filter const f) noexcept
+      {
+        if(f == mip_filter::box) {
+          return kernel{ { 0.5f, 0.5f }, 2, 0 };
+        }
+        // sinc windowed by kaiser (alpha 4), 2 pixels of the next level on each side
+        double constexpr radius{ 2.0 };
+        double constexpr alpha{ 4.0 };
+        double constexpr pi{ 3.14159265358979323846 };
+        kernel k{ {}, kernel::max_taps, -3 };
+        double w[kernel::max_taps];
+        double sum{ 0.0 };
+        for(unsigned int i{ 0 }; i < k.taps; ++i) {
+          // from the centre of the new pixel to the centre of this one, in pixels of the next level. never 0
+          double const t{ (static_cast<double>(i) - 3.5) / 2.0 };
+          double const r{ t / radius };
+          w[i] = std::sin(pi * t) / (pi * t) * bessel_i0(alpha * std::sqrt(1.0 - r * r)) / bessel_i0(alpha);
+          sum += w[i];
+        }
+        // a flat colour stays the same colour
+        for(unsigned int i{ 0 }; i < k.taps; ++i) {
+          k.weights[i] = static_cast<float>(w[i] / sum);
+        }
+        return k;
+      }
+
+      // a row of an 8 bit level as linear rgba floats, what isn't there is 0 (alpha 1)
+      void load_row(image const& img, unsigned int const y, mip_settings const& s, __m128* out) noexcept
+      {
+        float const* const linear{ tables().to_linear };
+        unsigned char const* p{ img.pixels.data() + static_cast<std::size_t>(y) * img.row_bytes() };
+        unsigned int const ch{ img.channels };
+        bool const srgb{ s.srgb && ch >= 3 };
+        __m128 const scale{ _mm_set1_ps(1.0f / 255.0f) };
+        for(unsigned int x{ 0 }; x < img.width; ++x, p += ch) {
+          unsigned int bytes{ 0xff000000 };
+          // no memcpy, it's a call with -fno-builtin
+          for(unsigned int c{ 0 }; c < ch; ++c) {
+            bytes = (bytes & ~(0xffu << (c * 8))) | (static_cast<unsigned int>(p[c]) << (c * 8));
+          }
+          __m128 v{ _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(bytes)))), scale) };
+          if(srgb) {
+            v = _mm_blend_ps(v, _mm_setr_ps(linear[p[0]], linear[p[1]], linear[p[2]], 0.0f), 0x7);
+          }
+          out[x] = v;
+        }
+      }
+
+      // back to 8 bits, after putting the normals back on the sphere
+      void store_row(__m128 const* in, image const& img, unsigned int const y, mip_settings const& s) noexcept
+      {
+        unsigned char const* const srgb_table{ tables().to_srgb };
+        unsigned char* p{ img.pixels.data() + static_cast<std::size_t>(y) * img.row_bytes() };
+        unsigned int const ch{ img.channels };
+        bool const srgb{ s.srgb && ch >= 3 };
+        __m128 const zero{ _mm_setzero_ps() };
+        __m128 const one{ _mm_set1_ps(1.0f) };
+        __m128 const two{ _mm_set1_ps(2.0f) };
+        __m128 const half{ _mm_set1_ps(0.5f) };
+        for(unsigned int x{ 0 }; x < img.width; ++x, p += ch) {
+          __m128 v{ in[x] };
+          if(s.normal_map) {
+            __m128 const n{ _mm_sub_ps(_mm_mul_ps(v, two), one) };
+            // xyz, or xy that can't be longer than 1 (z is what's left)
+            __m128 const len2{ ch >= 3 ? _mm_dp_ps(n, n, 0x7f) : _mm_dp_ps(n, n, 0x3f) };
+            float const l2{ _mm_cvtss_f32(len2) };
+            if(l2 > 1e-12f && (ch >= 3 || l2 > 1.0f)) {
+              __m128 const unit{ _mm_div_ps(n, _mm_sqrt_ps(len2)) };
+              v = _mm_blend_ps(v, _mm_add_ps(_mm_mul_ps(unit, half), half), 0x7);
+            }
+          }
+          // the negative lobes of kaiser go a bit past 0 and 1 around hard edges
+          v = _mm_min_ps(_mm_max_ps(v, zero), one);
+          __m128i const q{ _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f))) };
+          unsigned int const bytes{ static_cast<unsigned int>(_mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(q, q), q))) };
+          for(unsigned int c{ 0 }; c < ch; ++c) {
+            p[c] = static_cast<unsigned char>(bytes >> (c * 8));
+          }
+          if(srgb) {
+            alignas(16) int i[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(i),
+                            _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(static_cast<float>(colour_tables::linear_steps - 1)))));
+            p[0] = srgb_table[i[0]];
+            p[1] = srgb_table[i[1]];
+            p[2] = srgb_table[i[2]];
+          }
+        }
+      }
+
+      // one row of the next level from a row of this one, taps is a constant so the loops are unrolled.
+      // only the pixels at the ends need the clamps
+      template<unsigned int taps>
+      void filter_row(__m128 const* in, unsigned int const in_width, kernel const& k, __m128* out, unsigned int const out_width) noexcept
+      {
+        __m128 w[taps];
+        for(unsigned int i{ 0 }; i < taps; ++i) {
+          w[i] = _mm_set1_ps(k.weights[i]);
+        }
+        int const last{ static_cast<int>(in_width) - 1 };
+        for(unsigned int x{ 0 }; x < out_width; ++x) {
+          int const first{ static_cast<int>(x) * 2 + k.first };
+          __m128 acc{ _mm_setzero_ps() };
+          if(first >= 0 && first + static_cast<int>(taps) - 1 <= last) {
+            for(unsigned int i{ 0 }; i < taps; ++i) {
+              acc = _mm_add_ps(acc, _mm_mul_ps(w[i], in[first + static_cast<int>(i)]));
+            }
+          } else {
+            for(unsigned int i{ 0 }; i < taps; ++i) {
+              acc = _mm_add_ps(acc, _mm_mul_ps(w[i], in[std::clamp(first + static_cast<int>(i), 0, last)]));
+            }
+          }
+          out[x] = acc;
+        }
+      }
+
+      template<unsigned int taps>
+      void combine_rows(__m128 const* const* rows, kernel const& k, __m128* out, unsigned int const width) noexcept
+      {
+        __m128 w[taps];
+        for(unsigned int i{ 0 }; i < taps; ++i) {
+          w[i] = _mm_set1_ps(k.weights[i]);
+        }
+        for(unsigned int x{ 0 }; x < width; ++x) {
+          __m128 acc{ _mm_setzero_ps() };
+          for(unsigned int i{ 0 }; i < taps; ++i) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(w[i], rows[i][x]));
+          }
+          out[x] = acc;
+        }
+      }
+
+      // dst is half of src, rows split among the cores. a range keeps the last rows it filtered
+      // horizontally in a ring: the next row down needs k.taps of them and only 2 are new
+      void downsample(image const& src, image const& dst, mip_settings const& s, kernel const& k) noexcept
+      {
+        unsigned int constexpr ring_rows{ kernel::max_taps };
+        jobs::parallel_for(dst.height, 16, [&src, &dst, &s, &k](std::size_t const begin, std::size_t const end) {
+          // new aligns to 16, a pixel is 4 floats
+          std::vector<float> scratch((src.width + static_cast<std::size_t>(ring_rows) * dst.width) * 4);
+          __m128* const line{ reinterpret_cast<__m128*>(scratch.data()) };
+          __m128* const ring{ line + src.width };
+          int held[ring_rows];
+          std::fill(held, held + ring_rows, -1);
+          int const last_y{ static_cast<int>(src.height) - 1 };
+          for(std::size_t y{ begin }; y < end; ++y) {
+            __m128 const* rows[kernel::max_taps];
+            for(unsigned int t{ 0 }; t < k.taps; ++t) {
+              int const sy{ std::clamp(static_cast<int>(y) * 2 + k.first + static_cast<int>(t), 0, last_y) };
+              __m128* const r{ ring + static_cast<std::size_t>(sy % ring_rows) * dst.width };
+              if(held[sy % ring_rows] != sy) {
+                load_row(src, static_cast<unsigned int>(sy), s, line);
+                if(k.taps == 2) {
+                  filter_row<2>(line, src.width, k, r, dst.width);
+                } else {
+                  filter_row<kernel::max_taps>(line, src.width, k, r, dst.width);
+                }
+                held[sy % ring_rows] = sy;
+              }
+              rows[t] = r;
+            }
+            // line is free again, the vertical pass goes there
+            if(k.taps == 2) {
+              combine_rows<2>(rows, k, line, dst.width);
+            } else {
+              combine_rows<kernel::max_taps>(rows, k, line, dst.width);
+            }
+            store_row(line, dst, static_cast<unsigned int>(y), s);
+          }
+        });
+      }
+
+      // where the levels go in pixels (the levels of o point there), and the bytes of all of them
+      std::size_t lay_out(unsigned int const width, unsigned int const height, unsigned int const channels,
+                          unsigned int const num_levels, unsigned char* pixels, mip_chain& o) noexcept
+      {
+        std::size_t offset{ 0 };
+        o.num_levels = num_levels;
+        for(unsigned int l{ 0 }; l < num_levels; ++l) {
+          unsigned int const w{ std::max(width >> l, 1u) };
+          unsigned int const h{ std::max(height >> l, 1u) };
+          std::size_t const bytes{ static_cast<std::size_t>(w) * h * channels };
+          o.levels[l] = image{ w, h, channels, { pixels ? pixels + offset : nullptr, bytes } };
+          offset += bytes;
+        }
+        o.data = { pixels, offset };
+        return offset;
+      }
+
+    };
+
+    std::size_t mip_chain_bytes(image const& img) noexcept
+    {
+      mip_chain o;
+      // and the alignment of push_array
+      return lay_out(img.width, img.height, img.channels, num_mip_levels(img.width, img.height), nullptr, o) + 16;
+    }
+
+    bool generate_mips(image const& img, mip_settings const& s, mip_chain& o, arena& mem) noexcept
+    {
+      unsigned int const levels{ num_mip_levels(img.width, img.height) };
+      slice<unsigned char> const pixels{ mem.push_array<unsigned char>(lay_out(img.width, img.height, img.channels, levels, nullptr, o)) };
+      if(pixels.empty()) {
+        std::cerr << __FUNCTION__ << ": out of memory\n";
+        return false;
+      }
+      lay_out(img.width, img.height, img.channels, levels, pixels.data(), o);
+      std::memcpy(o.levels[0].pixels.data(), img.pixels.data(), img.pixels.bytes());
+      kernel const k{ make_kernel(s.filter) };
+      // every level from the one before, it's 4 times smaller and as good as going from level 0
+      for(unsigned int l{ 1 }; l < levels; ++l) {
+        downsample(o.levels[l - 1], o.levels[l], s, k);
+      }
+      return true;
+    }
+
+    bool save_texture(char const* filepath, mip_chain const& mips) noexcept
+    {
+      int const fd{ open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644) };
+      if(fd == -1) {
+        std::cerr << __FUNCTION__ << ": couldn't open " << filepath << ": " << std::strerror(errno) << '\n';
+        return false;
+      }
+      image const& top{ mips.levels[0] };
+      texture_header const h{ texture_header::lvt_magic, texture_header::lvt_version, top.width, top.height, top.channels, mips.num_levels };
+      char const* parts[2]{ reinterpret_cast<char const*>(&h), reinterpret_cast<char const*>(mips.data.data()) };
+      std::size_t sizes[2]{ sizeof(h), mips.data.bytes() };
+      std::size_t offset{ 0 };
+      bool ok{ true };
+      for(unsigned int i{ 0 }; i < 2 && ok; ++i) {
+        while(sizes[i] > 0) {
+          ssize_t const n{ pwrite(fd, parts[i], sizes[i], static_cast<off_t>(offset)) };
+          if(n < 0 && errno == EINTR) {
+            continue;
+          }
+          if(n < 0) {
+            ok = false;
+            break;
+          }
+          parts[i] += n;
+          sizes[i] -= static_cast<std::size_t>(n);
+          offset += static_cast<std::size_t>(n);
+        }
+      }
+      close(fd);
+      if(!ok) {
+        std::cerr << __FUNCTION__ << ": couldn't write " << filepath << '\n';
+      }
+      return ok;
+    }
+
+    bool save_texture(char const* filepath, image const& img) noexcept
+    {
+      mip_chain mips;
+      mips.num_levels = 1;
+      mips.levels[0] = img;
+      mips.data = img.pixels;
+      return save_texture(filepath, mips);
+    }
+
+    bool is_texture(void const* data, std::size_t const sz) noexcept
+    {
+      unsigned int magic;
+      if(sz < sizeof(texture_header)) {
+        return false;
+      }
+      std::memcpy(&magic, data, sizeof(magic));
+      return magic == texture_header::lvt_magic;
+    }
+
+    bool read_texture(void const* data, std::size_t const sz, mip_chain& o) noexcept
+    {
+      if(!is_texture(data, sz)) {
+        return false;
+      }
+      texture_header h;
+      std::memcpy(&h, data, sizeof(h));
+      if(h.version < 1 || h.version > texture_header::lvt_version || h.channels < 1 || h.channels > 4) {
+        return false;
+      }
+      // version 1 had padding there
+      unsigned int const levels{ h.version == 1 ? 1 : h.num_levels };
+      if(levels < 1 || levels > num_mip_levels(h.width, h.height) ||
+         sz - sizeof(h) < lay_out(h.width, h.height, h.channels, levels, nullptr, o)) {
+        return false;
+      }
+      unsigned char* const pixels{ const_cast<unsigned char*>(static_cast<unsigned char const*>(data)) + sizeof(h) };
+      lay_out(h.width, h.height, h.channels, levels, pixels, o);
+      return true;
+    }
+
+    bool read_texture(void const* data, std::size_t const sz, image& o) noexcept
+    {
+      mip_chain mips;
+      if(!read_texture(data, sz, mips)) {
+        return false;
+      }
+      o = mips.levels[0];
+      return true;
+    }
+
+  };
+};
@@ -0,0 +1,198 @@
+#include "lvar_texture_loader.h"
+#include "stb_image.h"          // whoever links this defines STB_IMAGE_IMPLEMENTATION once
+
+#include <cerrno>
+#include <iostream>
+#include <memory>
+#include <cstring>              // strlen, strcpy, memcpy
+#include <fcntl.h>              // open
+#include <sys/stat.h>           // fstat
+#include <unistd.h>             // read, close
+
+namespace lvar {
+  namespace tex {
+
+    texture_loader::~texture_loader()
+    {
+      while(pending > 0) {
+        if(current || completed.pop(current)) {
+          finish();
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    }
+
+    bool texture_loader::load(char const* path, unsigned int const id) noexcept
+    {
+      return submit(texture_kind::single, &path, 1, id, nullptr);
+    }
+
+    bool texture_loader::load_atlas(char const* const* paths, unsigned int const count, unsigned int const id,
+                                    uv_rect* rects_out) noexcept
+    {
+      return submit(texture_kind::atlas, paths, count, id, rects_out);
+    }
+
+    bool texture_loader::load_array(char const* const* paths, unsigned int const count, unsigned int const id) noexcept
+    {
+      return submit(texture_kind::array, paths, count, id, nullptr);
+    }
+
+    bool texture_loader::submit(texture_kind const kind, char const* const* paths, unsigned int const count, unsigned int const id,
+                                uv_rect* rects_out) noexcept
+    {
+      if(pending == max_in_flight) {
+        return false;
+      }
+      if(count == 0 || count > loaded_texture::max_images) {
+        std::cerr << __FUNCTION__ << ": " << count << " images, it has to be 1 to " << loaded_texture::max_images << '\n';
+        return false;
+      }
+      // the files and the mips go in the arena, the decoded pixels are stb_image's until the mips are made.
+      // what a png decodes to isn't known before it's decoded, 256 MB per image is the biggest it takes
+      std::size_t files_sz{ 0 };
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        if(std::strlen(paths[i]) >= sizeof(loaded_texture::paths[i])) {
+          std::cerr << __FUNCTION__ << ": path too long " << paths[i] << '\n';
+          return false;
+        }
+        struct stat sb;
+        files_sz += stat(paths[i], &sb) == 0 ? static_cast<std::size_t>(sb.st_size) : 0;
+      }
+      std::unique_ptr<loaded_texture> lt{ new loaded_texture(files_sz * 2 + count * 256 * 1024 * 1024) };
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        std::strcpy(lt->paths[i], paths[i]);
+      }
+      lt->mips = mip_chain{};
+      lt->kind = kind;
+      lt->count = count;
+      lt->rects_out = rects_out;
+      lt->loader = this;
+      lt->id = id;
+      lt->ok = false;
+      lt->uploaded = 0;
+      if(!workers.submit(run, lt.get())) {
+        return false;
+      }
+      // the worker has it now, it comes back through the queue
+      lt.release();
+      ++pending;
+      return true;
+    }
+
+    static bool read_whole_file(char const* path, arena& mem, slice<unsigned char>& o) noexcept
+    {
+      int const fd{ open(path, O_RDONLY) };
+      if(fd == -1) {
+        return false;
+      }
+      struct stat sb;
+      bool ok{ fstat(fd, &sb) == 0 };
+      std::size_t const sz{ ok ? static_cast<std::size_t>(sb.st_size) : 0 };
+      o = ok ? mem.push_array<unsigned char>(sz) : slice<unsigned char>{};
+      ok = ok && (sz == 0 || !o.empty());
+      for(std::size_t done{ 0 }; ok && done < sz;) {
+        ssize_t const n{ read(fd, o.data() + done, sz - done) };
+        if(n < 0 && errno == EINTR) {
+          continue;
+        }
+        ok = n > 0;
+        done += ok ? static_cast<std::size_t>(n) : 0;
+      }
+      close(fd);
+      return ok;
+    }
+
+    // a file to pixels in mem, all the levels or only level 0 (an atlas makes its own mips)
+    static bool decode(char const* path, bool const with_mips, arena& mem, mip_chain& o) noexcept
+    {
+      slice<unsigned char> file;
+      if(!read_whole_file(path, mem, file)) {
+        return false;
+      }
+      mip_chain cooked{};
+      if(read_texture(file.data(), file.size(), cooked)) {
+        image const top{ cooked.levels[0] };
+        o = cooked;
+        // a .lvt from before the mips were cooked gets them here
+        return !with_mips || cooked.num_levels == num_mip_levels(top.width, top.height) ||
+               generate_mips(top, mip_settings_for(path, top.channels), o, mem);
+      }
+      if(is_texture(file.data(), file.size())) {
+        return false;
+      }
+      // the global one isn't safe with other threads decoding
+      stbi_set_flip_vertically_on_load_thread(true);
+      int width, height, channels;
+      unsigned char* const decoded{ stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, 0) };
+      if(!decoded) {
+        return false;
+      }
+      image const img{ static_cast<unsigned int>(width), static_cast<unsigned int>(height), static_cast<unsigned int>(channels),
+                       { decoded, static_cast<std::size_t>(width) * height * channels } };
+      bool ok;
+      if(with_mips) {
+        ok = generate_mips(img, mip_settings_for(path, img.channels), o, mem);
+      } else {
+        slice<unsigned char> const pixels{ mem.push_array<unsigned char>(img.pixels.size()) };
+        ok = !pixels.empty();
+        if(ok) {
+          std::memcpy(pixels.data(), img.pixels.data(), pixels.size());
+          o.num_levels = 1;
+          o.levels[0] = image{ img.width, img.height, img.channels, pixels };
+          o.data = pixels;
+        }
+      }
+      stbi_image_free(decoded);
+      return ok;
+    }
+
+    void texture_loader::run(void* data) noexcept
+    {
+      loaded_texture& lt{ *static_cast<loaded_texture*>(data) };
+      if(!lt.mem.error()) {
+        switch(lt.kind) {
+        case texture_kind::single:
+          lt.ok = decode(lt.paths[0], true, lt.mem, lt.mips);
+          break;
+        case texture_kind::atlas: {
+          mip_chain images[loaded_texture::max_images];
+          image tops[loaded_texture::max_images];
+          lt.ok = true;
+          for(unsigned int i{ 0 }; i < lt.count && lt.ok; ++i) {
+            lt.ok = decode(lt.paths[i], false, lt.mem, images[i]);
+            tops[i] = images[i].levels[0];
+          }
+          // box, the kaiser lobes would reach past the padding sooner. srgb if the first one is a colour
+          image atlas;
+          lt.ok = lt.ok && build_atlas(tops, lt.count, max_atlas_size, atlas_padding, atlas, lt.rects, lt.mem) &&
+                  generate_mips(atlas, { mip_filter::box, mip_settings_for(lt.paths[0], atlas.channels).srgb, false }, lt.mips, lt.mem);
+          break;
+        }
+        case texture_kind::array: {
+          mip_chain layers[loaded_texture::max_images];
+          lt.ok = true;
+          for(unsigned int i{ 0 }; i < lt.count && lt.ok; ++i) {
+            lt.ok = decode(lt.paths[i], true, lt.mem, layers[i]);
+          }
+          lt.ok = lt.ok && stack_layers(layers, lt.count, lt.mips, lt.mem);
+          break;
+        }
+        }
+      }
+      // there are never more than max_in_flight of these, it can't be full
+      bool const pushed{ lt.loader->completed.push(&lt) };
+      assert(pushed);
+      (void)pushed;
+    }
+
+    void texture_loader::finish() noexcept
+    {
+      std::unique_ptr<loaded_texture> const done{ current };
+      current = nullptr;
+      --pending;
+    }
+
+  };
+};
@@ -0,0 +1,134 @@
+#include "lvar_texture_stream.h"
+#include "lvar_opengl_gnulinux.h"
+
+#include <algorithm>
+#include <cstring>              // memcpy
+#include <iostream>
+
+namespace lvar {
+  namespace tex {
+
+    static GLenum format_of(unsigned int const channels) noexcept
+    {
+      return static_cast<GLenum>(channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA);
+    }
+
+    texture_stream::texture_stream(texture_loader& l) noexcept
+      : loader{ l },
+        pbo{ 0 }
+    {
+      glGenBuffers(1, &pbo);
+    }
+
+    texture_stream::~texture_stream() noexcept
+    {
+      glDeleteBuffers(1, &pbo);
+    }
+
+    unsigned int texture_stream::placeholder(unsigned int const target) noexcept
+    {
+      // 2x2 and its 1x1 mip, it has to be complete with the same filters the image is going to have
+      unsigned char const pixels[]{ 96, 96, 96, 255, 160, 160, 160, 255, 160, 160, 160, 255, 96, 96, 96, 255 };
+      unsigned char const average[]{ 128, 128, 128, 255 };
+      unsigned int id{ 0 };
+      glGenTextures(1, &id);
+      glBindTexture(target, id);
+      glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+      glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+      glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+      glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      if(target == GL_TEXTURE_2D_ARRAY) {
+        glTexImage3D(target, 0, GL_RGBA, 2, 2, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glTexImage3D(target, 1, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, average);
+      } else {
+        glTexImage2D(target, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        glTexImage2D(target, 1, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, average);
+      }
+      return id;
+    }
+
+    unsigned int texture_stream::load(char const* path) noexcept
+    {
+      unsigned int const id{ placeholder(GL_TEXTURE_2D) };
+      if(!loader.load(path, id)) {
+        glDeleteTextures(1, &id);
+        return 0;
+      }
+      return id;
+    }
+
+    unsigned int texture_stream::load_atlas(char const* const* paths, unsigned int const count, uv_rect* rects) noexcept
+    {
+      unsigned int const id{ placeholder(GL_TEXTURE_2D) };
+      if(!loader.load_atlas(paths, count, id, rects)) {
+        glDeleteTextures(1, &id);
+        return 0;
+      }
+      // the whole placeholder for every one of them until then
+      std::fill(rects, rects + count, uv_rect{ 0.0f, 0.0f, 1.0f, 1.0f });
+      return id;
+    }
+
+    unsigned int texture_stream::load_array(char const* const* paths, unsigned int const count) noexcept
+    {
+      unsigned int const id{ placeholder(GL_TEXTURE_2D_ARRAY) };
+      if(!loader.load_array(paths, count, id)) {
+        glDeleteTextures(1, &id);
+        return 0;
+      }
+      return id;
+    }
+
+    std::size_t texture_stream::update(std::size_t const budget) noexcept
+    {
+      if(loader.in_flight() == 0) {
+        return 0;
+      }
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+      std::size_t const spent{ loader.drain(budget,
+        [](loaded_texture& lt, std::size_t const begin, std::size_t const end) {
+          if(begin == 0) {
+            // orphaned, the driver keeps the old storage until the last transfer from it is done
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(lt.bytes()), nullptr, GL_STREAM_DRAW);
+          }
+          // unsynchronized is fine, nothing reads this storage until the whole image is in it
+          void* const dst{ glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, static_cast<GLintptr>(begin), static_cast<GLsizeiptr>(end - begin),
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT) };
+          if(dst) {
+            std::memcpy(dst, lt.mips.data.data() + begin, end - begin);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+          }
+        },
+        [](loaded_texture& lt) {
+          if(!lt.ok) {
+            // the placeholder stays, it's better than nothing
+            std::cerr << "texture_stream: couldn't load " << lt.paths[0] << (lt.count > 1 ? " and the rest" : "") << '\n';
+            return;
+          }
+          GLenum const format{ format_of(lt.mips.levels[0].channels) };
+          GLenum const target{ static_cast<GLenum>(lt.kind == texture_kind::array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D) };
+          glBindTexture(target, lt.id);
+          glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rgb rows aren't multiples of 4 bytes
+          glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, static_cast<int>(lt.mips.num_levels) - 1);
+          // every level from the pbo, the pointer is an offset in it. the levels of an array are all its
+          // layers one after the other
+          for(unsigned int l{ 0 }; l < lt.mips.num_levels; ++l) {
+            image const& level{ lt.mips.levels[l] };
+            void const* const offset{ reinterpret_cast<void const*>(static_cast<std::size_t>(level.pixels.data() - lt.mips.data.data())) };
+            if(lt.kind == texture_kind::array) {
+              glTexImage3D(target, static_cast<int>(l), format, level.width, level.height / lt.count, lt.count, 0, format, GL_UNSIGNED_BYTE, offset);
+            } else {
+              glTexImage2D(target, static_cast<int>(l), format, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, offset);
+            }
+          }
+          if(lt.kind == texture_kind::atlas) {
+            std::copy(lt.rects, lt.rects + lt.count, lt.rects_out);
+          }
+        }) };
+      // the rest of the glTexImage2D calls pass pointers to memory
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return spent;
+    }
+
+  };
+};
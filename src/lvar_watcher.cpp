@@ -0,0 +1,114 @@
+#include "lvar_watcher.h"
+
+#include <iostream>
+#include <cerrno>
+#include <cstring>              // strlen, memcpy, strerror
+#include <poll.h>               // poll
+#include <sys/eventfd.h>        // eventfd
+#include <sys/inotify.h>        // inotify_*
+#include <unistd.h>             // read, write, close
+
+namespace lvar {
+  namespace files {
+
+    watcher::watcher(char const* const* directories, unsigned int const count, callback const f, void* const d) noexcept
+      : num_dirs{ 0 },
+        fx{ f },
+        data{ d },
+        fd{ -1 },
+        wake{ -1 },
+        err{ false }
+    {
+      if(count > max_directories) {
+        std::cerr << __FUNCTION__ << ": too many directories, max is " << max_directories << '\n';
+        err = true;
+        return;
+      }
+      fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+      wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if(fd == -1 || wake == -1) {
+        std::cerr << __FUNCTION__ << ": couldn't create the inotify instance: " << std::strerror(errno) << '\n';
+        err = true;
+        return;
+      }
+      for(unsigned int i{ 0 }; i < count; ++i) {
+        std::size_t const len{ std::strlen(directories[i]) };
+        if(len >= sizeof(directory::path)) {
+          std::cerr << __FUNCTION__ << ": path too long " << directories[i] << '\n';
+          err = true;
+          return;
+        }
+        int const wd{ inotify_add_watch(fd, directories[i], IN_CLOSE_WRITE | IN_MOVED_TO) };
+        if(wd == -1) {
+          std::cerr << __FUNCTION__ << ": couldn't watch " << directories[i] << ": " << std::strerror(errno) << '\n';
+          err = true;
+          return;
+        }
+        dirs[num_dirs].wd = wd;
+        std::memcpy(dirs[num_dirs].path, directories[i], len + 1);
+        ++num_dirs;
+      }
+      thread = std::thread([this]() { run(); });
+    }
+
+    watcher::~watcher() noexcept
+    {
+      if(thread.joinable()) {
+        unsigned long long const one{ 1 };
+        [[maybe_unused]] auto const written{ write(wake, &one, sizeof(one)) };
+        thread.join();
+      }
+      if(fd != -1) {
+        close(fd);
+      }
+      if(wake != -1) {
+        close(wake);
+      }
+    }
+
+    void watcher::run() noexcept
+    {
+      // big enough for a bunch of events, they're at most sizeof(inotify_event) + NAME_MAX + 1 each
+      alignas(inotify_event) char buffer[16 * 1024];
+      pollfd fds[2]{ { fd, POLLIN, 0 }, { wake, POLLIN, 0 } };
+      for(;;) {
+        if(poll(fds, 2, -1) == -1) {
+          if(errno == EINTR) {
+            continue;
+          }
+          std::cerr << __FUNCTION__ << ": poll failed: " << std::strerror(errno) << '\n';
+          return;
+        }
+        if(fds[1].revents & POLLIN) {
+          return;
+        }
+        ssize_t const n{ read(fd, buffer, sizeof(buffer)) };
+        if(n <= 0) {
+          continue;
+        }
+        for(ssize_t i{ 0 }; i < n;) {
+          inotify_event const* const e{ reinterpret_cast<inotify_event const*>(buffer + i) };
+          i += sizeof(inotify_event) + e->len;
+          if(e->len == 0) { // about the directory itself
+            continue;
+          }
+          for(unsigned int d{ 0 }; d < num_dirs; ++d) {
+            if(dirs[d].wd != e->wd) {
+              continue;
+            }
+            char path[sizeof(directory::path) + 256];
+            std::size_t const dir_len{ std::strlen(dirs[d].path) };
+            std::size_t const name_len{ std::strlen(e->name) };
+            if(name_len < 256) {
+              std::memcpy(path, dirs[d].path, dir_len);
+              path[dir_len] = '/';
+              std::memcpy(path + dir_len + 1, e->name, name_len + 1);
+              fx(path, data);
+            }
+          }
+        }
+      }
+    }
+
+  };
+};
@@ -13,6 +13,13 @@
 #include <X11/Xatom.h>
 #include <X11/keysym.h>
 
+// one trans unit. before the implementation of stb_image, including it again after that would be
+// including the implementation again
+#include "../lvar_texture.cpp"
+#include "../lvar_atlas.cpp"
+#include "../lvar_texture_loader.cpp"
+#include "../lvar_texture_stream.cpp"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -405,48 +412,20 @@ int main()
   }
   hidePointer(display, window);
   // run the game
-  unsigned int texture1, texture2;
-  // texture 1
-  // ---------
-  glGenTextures(1, &texture1);
-  glBindTexture(GL_TEXTURE_2D, texture1);
-  // set the texture wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  // set texture filtering parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // load image, create texture and generate mipmaps
-  int width, height, nrChannels;
-  stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-  unsigned char *data = stbi_load("./res/despera.jpg", &width, &height, &nrChannels, 0);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-  glGenerateMipmap(GL_TEXTURE_2D);
-  stbi_image_free(data);
-  // texture 2
-  // ---------
-  glGenTextures(1, &texture2);
-  glBindTexture(GL_TEXTURE_2D, texture2);
-  // set the texture wrapping parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  // set texture filtering parameters
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // load image, create texture and generate mipmaps
-  data = stbi_load("./res/sky.png", &width, &height, &nrChannels, 0);
-  if (data){
-    // note that the awesomeface.png has transparency and thus an alpha channel, so make sure to tell OpenGL the data type is of GL_RGBA
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  stbi_image_free(data);
+  // textures are decoded on the workers and uploaded a few MB per frame, the cubes are grey until then.
+  // both images are in one atlas, one bind for the two of them. they're the cooked ones with their mips
+  // (make lvar-cook), nothing is decoded from a jpg here
+  jobs::pool workers;
+  tex::texture_loader texture_loader(workers);
+  tex::texture_stream texture_stream(texture_loader);
+  char const* const atlas_paths[]{ "./cooked/res/sky.lvt", "./cooked/res/despera.lvt" };
+  tex::uv_rect atlas_rects[2];
+  unsigned int const atlas{ texture_stream.load_atlas(atlas_paths, 2, atlas_rects) };
   m4 const projection{ perspective(45.0f, 1920.0f / 1080.0f, 0.1f, 100.f) };
   auto s = loadBackgroundShader("./res/basic.vert",
                                 "./res/basic.frag");
   useShaderProgram(s.id);
-  setUniformInt(s.id, "image1", 0);
-  setUniformInt(s.id, "image2", 1);
+  setUniformInt(s.id, "atlas", 0);
   setUniformMat4(s.id, "projection", projection);
   // 3D
   grid levelGrid;
@@ -565,6 +544,7 @@ int main()
       }
     }
     levelGrid.update(cameraPosition);
+    texture_stream.update();
     // view matrix (camera)
     m4 const view{ look_at(cameraPosition, add(cameraPosition, cameraFront), cameraUp) };
     // -------------------------------------------------------------------------------------------------------
@@ -573,10 +553,13 @@ int main()
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     useShaderProgram(s.id);
     setUniformMat4(s.id, "view", view);
+    // they change when the atlas arrives
+    for(unsigned int i{ 0 }; i < 2; ++i) {
+      tex::uv_rect const& r{ atlas_rects[i] };
+      setUniformVec4(s.id, i == 0 ? "rect1" : "rect2", v4{ r.u, r.v, r.width, r.height });
+    }
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture2);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture1);
+    glBindTexture(GL_TEXTURE_2D, atlas);
     glBindVertexArray(s.VAO);
     // model matrix contains translations, rotations and scales
     for(int i{ 0 }; i < 2; ++i) {
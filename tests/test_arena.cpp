@@ -0,0 +1,72 @@
+#include "lvar_arena.h"
+#include "lvar_obj.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+using namespace lvar;
+
+void test_arena_push()
+{
+  arena mem(1024 * 1024);
+  assert(!mem.error());
+  void* const a{ mem.push(3) };
+  void* const b{ mem.push(8, 64) };
+  assert(a && b);
+  assert(reinterpret_cast<std::uintptr_t>(b) % 64 == 0);
+  assert(static_cast<char*>(b) > static_cast<char*>(a));
+  auto const floats = mem.push_array<float>(100);
+  assert(floats.size() == 100 && reinterpret_cast<std::uintptr_t>(floats.data()) % 16 == 0);
+  // out of space must not blow up
+  assert(mem.push(2 * 1024 * 1024) == nullptr);
+}
+
+void test_arena_mark()
+{
+  arena mem(4096);
+  auto const mark = mem.mark();
+  void* const a{ mem.push(100) };
+  mem.pop_to(mark);
+  void* const b{ mem.push(100) };
+  assert(a == b);
+  mem.reset();
+  assert(mem.size() == 0);
+}
+
+void test_arena_mesh()
+{
+  arena mem(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  assert(teapot.vertices.size() == 3644);
+  assert(teapot.num_faces() == 6320);
+  for(auto const i : teapot.indices) {
+    assert(i < teapot.vertices.size());
+  }
+  // all arrays are next to each other in the same block
+  assert(reinterpret_cast<char const*>(teapot.indices.data()) >=
+         reinterpret_cast<char const*>(teapot.vertices.end()));
+  assert(mem.size() >= teapot.vertices.bytes() + teapot.indices.bytes());
+  // failing to load doesn't leave garbage behind
+  auto const used = mem.size();
+  obj::mesh nope;
+  assert(!obj::parse_file("./res/does_not_exist.obj", nope, mem));
+  assert(mem.size() == used);
+}
+
+void test_arena()
+{
+  test_arena_push();
+  test_arena_mark();
+  test_arena_mesh();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_arena();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include "lvar_atlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace lvar;
+
+static bool overlap(unsigned int const ax, unsigned int const ay, unsigned int const aw, unsigned int const ah,
+                    unsigned int const bx, unsigned int const by, unsigned int const bw, unsigned int const bh)
+{
+  return ax < bx + bw && bx < ax + aw && ay < by + bh && by < ay + ah;
+}
+
+void test_skyline()
+{
+  tex::skyline_packer packer(64, 64);
+  unsigned int x, y;
+  // the first one goes in the corner, the next on its right, then on top of the lowest
+  assert(packer.insert(32, 16, x, y) && x == 0 && y == 0);
+  assert(packer.insert(32, 8, x, y) && x == 32 && y == 0);
+  assert(packer.insert(16, 16, x, y) && x == 32 && y == 8);
+  assert(!packer.insert(65, 1, x, y) && !packer.insert(1, 65, x, y) && !packer.insert(0, 4, x, y));
+  // filled to the top, and nothing fits after
+  unsigned int rx[64], ry[64], rw[64], rh[64];
+  unsigned int n{ 0 };
+  for(unsigned int i{ 0 }; i < 64; ++i) {
+    unsigned int const w{ 4 + (i * 7) % 13 };
+    unsigned int const h{ 4 + (i * 5) % 11 };
+    if(packer.insert(w, h, x, y)) {
+      assert(x + w <= 64 && y + h <= 64);
+      rx[n] = x;
+      ry[n] = y;
+      rw[n] = w;
+      rh[n] = h;
+      ++n;
+    }
+  }
+  assert(n > 10);
+  for(unsigned int i{ 0 }; i < n; ++i) {
+    assert(!overlap(rx[i], ry[i], rw[i], rh[i], 0, 0, 32, 16) && !overlap(rx[i], ry[i], rw[i], rh[i], 32, 0, 32, 8));
+    assert(!overlap(rx[i], ry[i], rw[i], rh[i], 32, 8, 16, 16));
+    for(unsigned int j{ i + 1 }; j < n; ++j) {
+      assert(!overlap(rx[i], ry[i], rw[i], rh[i], rx[j], ry[j], rw[j], rh[j]));
+    }
+  }
+  assert(packer.occupancy() > 0.5f && packer.occupancy() <= 1.0f);
+}
+
+void test_build_atlas()
+{
+  // rgb 6x4 and grey 3x5, the atlas is rgb
+  unsigned char rgb[6 * 4 * 3];
+  for(unsigned int i{ 0 }; i < sizeof(rgb); ++i) {
+    rgb[i] = static_cast<unsigned char>(i + 1);
+  }
+  unsigned char grey[3 * 5];
+  for(unsigned int i{ 0 }; i < sizeof(grey); ++i) {
+    grey[i] = static_cast<unsigned char>(200 + i);
+  }
+  tex::image const images[]{ { 6, 4, 3, { rgb, sizeof(rgb) } }, { 3, 5, 1, { grey, sizeof(grey) } } };
+  arena mem(1024 * 1024);
+  tex::image atlas;
+  tex::uv_rect rects[2];
+  unsigned int constexpr padding{ 2 };
+  assert(tex::build_atlas(images, 2, 64, padding, atlas, rects, mem));
+  assert(atlas.channels == 3 && atlas.width <= 32 && atlas.height <= 32);
+  assert((atlas.width & (atlas.width - 1)) == 0 && (atlas.height & (atlas.height - 1)) == 0);
+  for(unsigned int i{ 0 }; i < 2; ++i) {
+    tex::image const& img{ images[i] };
+    unsigned int const x0{ static_cast<unsigned int>(rects[i].u * atlas.width + 0.5f) };
+    unsigned int const y0{ static_cast<unsigned int>(rects[i].v * atlas.height + 0.5f) };
+    assert(rects[i].width * atlas.width == img.width && rects[i].height * atlas.height == img.height);
+    assert(x0 >= padding && y0 >= padding && x0 + img.width + padding <= atlas.width && y0 + img.height + padding <= atlas.height);
+    // the pixels, and the padding repeats the edges
+    for(int y{ -static_cast<int>(padding) }; y < static_cast<int>(img.height + padding); ++y) {
+      for(int x{ -static_cast<int>(padding) }; x < static_cast<int>(img.width + padding); ++x) {
+        unsigned int const sx{ static_cast<unsigned int>(std::clamp(x, 0, static_cast<int>(img.width) - 1)) };
+        unsigned int const sy{ static_cast<unsigned int>(std::clamp(y, 0, static_cast<int>(img.height) - 1)) };
+        unsigned char const* const a{ atlas.pixels.data() + (static_cast<std::size_t>(y0 + y) * atlas.width + x0 + x) * 3 };
+        unsigned char const* const s{ img.pixels.data() + (static_cast<std::size_t>(sy) * img.width + sx) * img.channels };
+        for(unsigned int c{ 0 }; c < 3; ++c) {
+          assert(a[c] == s[img.channels == 1 ? 0 : c]);
+        }
+      }
+    }
+  }
+  // too big for the size it can be
+  assert(!tex::build_atlas(images, 2, 8, padding, atlas, rects, mem));
+}
+
+void test_stack_layers()
+{
+  unsigned char a[4 * 2 * 2];
+  unsigned char b[4 * 2 * 2];
+  for(unsigned int i{ 0 }; i < sizeof(a); ++i) {
+    a[i] = static_cast<unsigned char>(i);
+    b[i] = static_cast<unsigned char>(100 + i);
+  }
+  arena mem(64 * 1024);
+  tex::mip_chain chains[2];
+  assert(tex::generate_mips({ 4, 2, 2, { a, sizeof(a) } }, { tex::mip_filter::box, false, false }, chains[0], mem));
+  assert(tex::generate_mips({ 4, 2, 2, { b, sizeof(b) } }, { tex::mip_filter::box, false, false }, chains[1], mem));
+  tex::mip_chain stacked;
+  assert(tex::stack_layers(chains, 2, stacked, mem));
+  assert(stacked.num_levels == 3 && stacked.data.size() == chains[0].data.size() * 2);
+  for(unsigned int l{ 0 }; l < 3; ++l) {
+    tex::image const& level{ stacked.levels[l] };
+    std::size_t const bytes{ chains[0].levels[l].pixels.size() };
+    // every level is layer 0 and then layer 1
+    assert(level.width == chains[0].levels[l].width && level.height == chains[0].levels[l].height * 2);
+    assert(std::memcmp(level.pixels.data(), chains[0].levels[l].pixels.data(), bytes) == 0);
+    assert(std::memcmp(level.pixels.data() + bytes, chains[1].levels[l].pixels.data(), bytes) == 0);
+  }
+  // not the same size
+  tex::mip_chain other[2]{ chains[0] };
+  assert(tex::generate_mips({ 2, 4, 2, { b, sizeof(b) } }, { tex::mip_filter::box, false, false }, other[1], mem));
+  assert(!tex::stack_layers(other, 2, stacked, mem));
+}
+
+void test_atlas()
+{
+  test_skyline();
+  test_build_atlas();
+  test_stack_layers();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_atlas();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include "lvar_bc.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace lvar;
+
+static double psnr(unsigned char const* a, unsigned char const* b, std::size_t const n, unsigned int const channels)
+{
+  double err{ 0.0 };
+  for(std::size_t i{ 0 }; i < n; ++i) {
+    for(unsigned int c{ 0 }; c < channels; ++c) {
+      int const d{ static_cast<int>(a[i * 4 + c]) - static_cast<int>(b[i * 4 + c]) };
+      err += d * d;
+    }
+  }
+  double const mse{ err / static_cast<double>(n * channels) };
+  return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+void test_solid_block()
+{
+  unsigned char block[64];
+  for(unsigned int i{ 0 }; i < 16; ++i) {
+    // exact in 565
+    block[i * 4 + 0] = 255;
+    block[i * 4 + 1] = 0;
+    block[i * 4 + 2] = 255;
+    block[i * 4 + 3] = 255;
+  }
+  for(tex::bc_quality const q : { tex::bc_quality::fast, tex::bc_quality::high }) {
+    unsigned char out[8];
+    unsigned char decoded[64];
+    tex::encode_bc1_block(block, out, q);
+    tex::decode_block(tex::bc_format::bc1, out, decoded);
+    assert(std::memcmp(block, decoded, sizeof(block)) == 0);
+  }
+}
+
+void test_bc4_two_values()
+{
+  // two values have to come back exactly, they are the endpoints
+  unsigned char values[16];
+  for(unsigned int i{ 0 }; i < 16; ++i) {
+    values[i] = i % 3 == 0 ? 17 : 201;
+  }
+  for(tex::bc_quality const q : { tex::bc_quality::fast, tex::bc_quality::high }) {
+    unsigned char rgba[64];
+    for(unsigned int i{ 0 }; i < 16; ++i) {
+      rgba[i * 4 + 0] = values[i];
+      rgba[i * 4 + 1] = values[15 - i];
+      rgba[i * 4 + 2] = 0;
+      rgba[i * 4 + 3] = 255;
+    }
+    unsigned char out[16];
+    unsigned char decoded[64];
+    tex::encode_bc5_block(rgba, out, q);
+    tex::decode_block(tex::bc_format::bc5, out, decoded);
+    assert(std::memcmp(rgba, decoded, sizeof(rgba)) == 0);
+  }
+}
+
+void test_gradient_error()
+{
+  unsigned int constexpr w{ 64 };
+  unsigned int constexpr h{ 64 };
+  static unsigned char pixels[w * h * 4];
+  for(unsigned int y{ 0 }; y < h; ++y) {
+    for(unsigned int x{ 0 }; x < w; ++x) {
+      unsigned char* const p{ pixels + (y * w + x) * 4 };
+      p[0] = static_cast<unsigned char>(x * 4);
+      p[1] = static_cast<unsigned char>(y * 4);
+      p[2] = static_cast<unsigned char>((x + y) * 2);
+      p[3] = static_cast<unsigned char>(255 - x * 2);
+    }
+  }
+  tex::image const img{ w, h, 4, { pixels, sizeof(pixels) } };
+  static unsigned char out[w * h];
+  static unsigned char decoded[w * h * 4];
+  double error[2][2];
+  for(tex::bc_quality const q : { tex::bc_quality::fast, tex::bc_quality::high }) {
+    tex::encode_image(img, tex::bc_format::bc3, q, out);
+    tex::decode_image(out, tex::bc_format::bc3, w, h, decoded);
+    error[static_cast<unsigned int>(q)][0] = psnr(pixels, decoded, w * h, 4);
+    tex::encode_image(img, tex::bc_format::bc5, q, out);
+    tex::decode_image(out, tex::bc_format::bc5, w, h, decoded);
+    error[static_cast<unsigned int>(q)][1] = psnr(pixels, decoded, w * h, 2);
+  }
+  assert(error[0][0] > 35.0 && error[0][1] > 40.0);
+  assert(error[1][0] >= error[0][0] && error[1][1] >= error[0][1]);
+}
+
+void test_image_edges()
+{
+  // 6x5 rgb, the blocks on the right and at the bottom repeat the edge
+  unsigned int constexpr w{ 6 };
+  unsigned int constexpr h{ 5 };
+  unsigned char pixels[w * h * 3];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i * 37);
+  }
+  tex::image const img{ w, h, 3, { pixels, sizeof(pixels) } };
+  assert(tex::bc_bytes(tex::bc_format::bc1, w, h) == 4 * 8);
+  unsigned char out[4 * 8];
+  tex::encode_image(img, tex::bc_format::bc1, tex::bc_quality::high, out);
+  for(unsigned int by{ 0 }; by < 2; ++by) {
+    for(unsigned int bx{ 0 }; bx < 2; ++bx) {
+      unsigned char block[64];
+      for(unsigned int y{ 0 }; y < 4; ++y) {
+        for(unsigned int x{ 0 }; x < 4; ++x) {
+          unsigned int const sx{ std::min(bx * 4 + x, w - 1) };
+          unsigned int const sy{ std::min(by * 4 + y, h - 1) };
+          std::memcpy(block + (y * 4 + x) * 4, pixels + (sy * w + sx) * 3, 3);
+          block[(y * 4 + x) * 4 + 3] = 255;
+        }
+      }
+      unsigned char expected[8];
+      tex::encode_bc1_block(block, expected, tex::bc_quality::high);
+      assert(std::memcmp(out + (by * 2 + bx) * 8, expected, 8) == 0);
+    }
+  }
+}
+
+void test_compressed_cache()
+{
+  static unsigned char pixels[16 * 8 * 4];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i * 13);
+  }
+  tex::image const img{ 16, 8, 4, { pixels, sizeof(pixels) } };
+  arena mem(1024 * 1024);
+  tex::mip_chain mips;
+  assert(tex::generate_mips(img, { tex::mip_filter::box, false, false }, mips, mem));
+  tex::compressed_texture ct;
+  assert(tex::compress(mips, tex::bc_format::bc3, tex::bc_quality::fast, ct, mem));
+  // 16x8, 8x4, 4x2, 2x1, 1x1
+  assert(ct.num_levels == 5);
+  assert(ct.level_width(4) == 1 && ct.level_height(3) == 1);
+  assert(ct.level_offset(1) == tex::bc_bytes(tex::bc_format::bc3, 16, 8));
+  assert(ct.data.size() == ct.level_offset(4) + ct.level_bytes(4));
+  char const* const path{ "/tmp/lvar_test_bc.lvc" };
+  assert(tex::save_compressed(path, ct, tex::bc_quality::fast, 1234, 5678));
+  tex::compressed_texture loaded;
+  assert(tex::load_compressed(path, tex::bc_quality::fast, 1234, 5678, loaded, mem));
+  assert(loaded.format == ct.format && loaded.width == 16 && loaded.height == 8 && loaded.num_levels == 5);
+  assert(loaded.data.size() == ct.data.size() && std::memcmp(loaded.data.data(), ct.data.data(), ct.data.size()) == 0);
+  // the source changed, or it was cooked at another quality
+  assert(!tex::load_compressed(path, tex::bc_quality::fast, 1234, 5679, loaded, mem));
+  assert(!tex::load_compressed(path, tex::bc_quality::fast, 1235, 5678, loaded, mem));
+  assert(!tex::load_compressed(path, tex::bc_quality::high, 1234, 5678, loaded, mem));
+  assert(!tex::load_compressed("/tmp/lvar_test_bc_missing.lvc", tex::bc_quality::fast, 1234, 5678, loaded, mem));
+  std::remove(path);
+}
+
+void test_bc()
+{
+  test_solid_block();
+  test_bc4_two_values();
+  test_gradient_error();
+  test_image_edges();
+  test_compressed_cache();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_bc();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+// built against the header make tests generates with tools/embed.cpp from light_cube.vert, light_cube.frag
+// and res/basic.frag
+#include "lvar_embed.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>              // strlen, strcmp
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace lvar;
+
+// looked up while compiling, nothing left to do when it runs
+static_assert(embed::find("res/shaders/light_cube.vert"_id)->size > 0);
+static_assert(embed::find("./res/shaders/light_cube.vert") == embed::find("res/shaders/light_cube.vert"_id));
+static_assert(embed::ids::res_shaders_light_cube_frag == "res/shaders/light_cube.frag"_id);
+static_assert(embed::enabled());
+
+static std::string read_disk(char const* path)
+{
+  std::ifstream f(path, std::ios::binary);
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+void test_same_as_the_disk()
+{
+  assert(embed::num_assets == 3);
+  for(char const* const path : { "./res/shaders/light_cube.vert", "./res/shaders/light_cube.frag", "./res/basic.frag" }) {
+    embed::asset const* const a{ embed::find(path) };
+    assert(a && std::strcmp(a->path, path + 2) == 0);
+    std::string const disk{ read_disk(path) };
+    assert(!disk.empty() && a->size == disk.size());
+    assert(std::memcmp(a->data, disk.data(), disk.size()) == 0);
+    // a c string too
+    assert(a->data[a->size] == '\0' && std::strlen(reinterpret_cast<char const*>(a->data)) == a->size);
+  }
+}
+
+void test_find()
+{
+  // the ids are the pack's
+  embed::asset const* const a{ embed::find(embed::ids::res_basic_frag) };
+  assert(a && a->id == fnv1a("res/basic.frag") && std::strcmp(a->path, "res/basic.frag") == 0);
+  assert(embed::find("./res/basic.frag") == a);
+  assert(!embed::find("./res/basic.vert"));
+  assert(!embed::find("res/shaders/light_cube"));
+  assert(!embed::find(0));
+  // sorted, that's what the search needs
+  for(std::size_t i{ 1 }; i < embed::num_assets; ++i) {
+    assert(embed::assets[i - 1].id < embed::assets[i].id);
+  }
+}
+
+void test_embed()
+{
+  test_same_as_the_disk();
+  test_find();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_embed();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
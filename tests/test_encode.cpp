@@ -0,0 +1,109 @@
+#include "lvar_encode.h"
+#include "lvar_normals.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace lvar;
+
+void test_half()
+{
+  assert(obj::float_to_half(0.0f) == 0x0000);
+  assert(obj::float_to_half(-0.0f) == 0x8000);
+  assert(obj::float_to_half(1.0f) == 0x3c00);
+  assert(obj::float_to_half(-2.0f) == 0xc000);
+  assert(obj::float_to_half(65504.0f) == 0x7bff);
+  assert(obj::float_to_half(1e6f) == 0x7c00);                 // too big -> inf
+  assert(obj::float_to_half(std::ldexp(1.0f, -24)) == 0x0001); // smallest denormal
+  assert(obj::float_to_half(std::ldexp(1.0f, -26)) == 0x0000);
+  assert(obj::float_to_half(1.0f + std::ldexp(1.0f, -11)) == 0x3c00); // tie, rounds to even
+  assert(obj::float_to_half(1.0f + 3.0f * std::ldexp(1.0f, -11)) == 0x3c02);
+  for(float f{ -4.0f }; f <= 4.0f; f += 0.0173f) {
+    float const back{ obj::half_to_float(obj::float_to_half(f)) };
+    assert(std::fabs(back - f) <= std::fabs(f) * (1.0f / 2048.0f) + 1e-7f);
+  }
+  for(unsigned int h{ 0 }; h < 0x7c00; ++h) {
+    assert(obj::float_to_half(obj::half_to_float(static_cast<unsigned short>(h))) == h);
+  }
+}
+
+void test_octahedral()
+{
+  for(float theta{ 0.0f }; theta <= 3.1416f; theta += 0.05f) {
+    for(float phi{ 0.0f }; phi < 6.2832f; phi += 0.05f) {
+      v3 const n{ std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta) };
+      short e[2];
+      obj::oct_encode(n.x, n.y, n.z, e);
+      v3 const d{ obj::oct_decode(e) };
+      // 16 bits per component is way below a thousandth of a degree
+      assert(dot(n, d) > 0.99999f);
+    }
+  }
+}
+
+void test_encode_teapot()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  assert(obj::generate_normals(teapot, mem, scratch));
+  teapot.uvs = mem.push_array<obj::texcoord>(teapot.vertices.size());
+  for(std::size_t i{ 0 }; i < teapot.vertices.size(); ++i) {
+    teapot.uvs[i] = { teapot.vertices[i].x * 0.25f, teapot.vertices[i].y * 0.25f };
+  }
+  obj::encoded_mesh packed;
+  assert(obj::encode(teapot, packed, mem));
+  assert(packed.num_attributes == 3 && packed.stride == 16);
+  assert(packed.index_type == GL_UNSIGNED_SHORT && packed.indices.bytes() == teapot.indices.size() * 2);
+  obj::encoded_mesh raw;
+  assert(obj::encode(teapot, raw, mem, { false, false, false, false }));
+  assert(raw.stride == 32 && raw.index_type == GL_UNSIGNED_INT);
+  std::size_t const packed_bytes{ packed.vertices.bytes() + packed.indices.bytes() };
+  std::size_t const raw_bytes{ raw.vertices.bytes() + raw.indices.bytes() };
+  std::clog << "teapot: " << raw_bytes << " -> " << packed_bytes << " bytes\n";
+  assert(packed_bytes * 2 <= raw_bytes);
+  // decode everything back and compare
+  m4 const dq{ packed.dequantise() };
+  for(std::size_t v{ 0 }; v < teapot.vertices.size(); ++v) {
+    unsigned char const* const src{ packed.vertices.data() + v * packed.stride };
+    unsigned short q[3];
+    std::memcpy(q, src + packed.attributes[0].offset, sizeof(q));
+    float const p[3]{ teapot.vertices[v].x, teapot.vertices[v].y, teapot.vertices[v].z };
+    for(int i{ 0 }; i < 3; ++i) {
+      float const back{ dq.get(i, i) * (q[i] / 65535.0f) + dq.get(3, i) };
+      assert(std::fabs(back - p[i]) <= packed.aabb_extent[i] / 65535.0f);
+    }
+    short e[2];
+    std::memcpy(e, src + packed.attributes[1].offset, sizeof(e));
+    v3 const n{ teapot.normals[v].x, teapot.normals[v].y, teapot.normals[v].z };
+    if(dot(n, n) > 0.0f) {
+      assert(dot(obj::oct_decode(e), n) > 0.99999f);
+    }
+    unsigned short h[2];
+    std::memcpy(h, src + packed.attributes[2].offset, sizeof(h));
+    assert(std::fabs(obj::half_to_float(h[0]) - teapot.uvs[v].u) < 1e-3f);
+  }
+  unsigned short const* const idx{ reinterpret_cast<unsigned short const*>(packed.indices.data()) };
+  for(std::size_t i{ 0 }; i < teapot.indices.size(); ++i) {
+    assert(idx[i] == teapot.indices[i]);
+  }
+}
+
+void test_encode()
+{
+  test_half();
+  test_octahedral();
+  test_encode_teapot();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_encode();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#include "lvar_handle.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using namespace lvar;
+
+class thing final {
+public:
+  int value;
+};
+
+void test_insert_get_remove()
+{
+  slot_map<thing> m;
+  assert(m.get(handle<thing>{}) == nullptr);
+  handle<thing> const a{ m.insert(thing{ 1 }) };
+  handle<thing> const b{ m.insert(thing{ 2 }) };
+  handle<thing> const c{ m.insert(thing{ 3 }) };
+  assert(a.valid() && b.valid() && c.valid() && !(a == b));
+  assert(m.get(a)->value == 1 && m.get(b)->value == 2 && m.get(c)->value == 3);
+  // the last one fills the hole, the handles don't notice
+  assert(m.remove(a));
+  assert(!m.remove(a));
+  assert(m.size() == 2 && m.get(a) == nullptr);
+  assert(m.get(b)->value == 2 && m.get(c)->value == 3);
+  // same slot again, the old handle still doesn't work
+  handle<thing> const d{ m.insert(thing{ 4 }) };
+  assert(d.index() == a.index() && d.generation() != a.generation());
+  assert(m.get(a) == nullptr && m.get(d)->value == 4);
+  // dense
+  int sum{ 0 };
+  for(thing const& t : m) {
+    sum += t.value;
+  }
+  assert(sum == 9);
+  for(std::size_t i{ 0 }; i < m.size(); ++i) {
+    assert(m.get(m.handle_of(i)) == &*(m.begin() + i));
+  }
+}
+
+void test_generations_wrap()
+{
+  slot_map<thing> m;
+  handle<thing> const first{ m.insert(thing{ 0 }) };
+  handle<thing> last{ first };
+  for(unsigned int i{ 0 }; i < handle<thing>::generation_mask + 1; ++i) {
+    assert(m.remove(last));
+    last = m.insert(thing{ static_cast<int>(i) });
+    assert(last.valid() && last.index() == first.index());
+  }
+  // it wrapped around without ever being 0
+  assert(last.generation() != 0);
+}
+
+void test_handle()
+{
+  test_insert_get_remove();
+  test_generations_wrap();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_handle();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
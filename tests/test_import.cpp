@@ -0,0 +1,112 @@
+#include "lvar_obj.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/resource.h>       // getrusage
+
+using namespace lvar;
+
+static long peak_rss_kb()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+// a grid of quads, bigger than the window so it has to slide a bunch of times
+static void write_grid(char const* path, unsigned int const side)
+{
+  FILE* f{ std::fopen(path, "w") };
+  assert(f);
+  for(unsigned int y{ 0 }; y < side; ++y) {
+    for(unsigned int x{ 0 }; x < side; ++x) {
+      std::fprintf(f, "v %u.25 %u.5 %u\n", x, y, (x * y) % 7);
+    }
+  }
+  std::fprintf(f, "vn 0 0 1\n");
+  for(unsigned int y{ 0 }; y + 1 < side; ++y) {
+    for(unsigned int x{ 0 }; x + 1 < side; ++x) {
+      unsigned int const a{ y * side + x + 1 };
+      std::fprintf(f, "f %u//1 %u//1 %u//1 %u//1\n", a, a + 1, a + side + 1, a + side);
+    }
+  }
+  std::fprintf(f, "f 1 2 999999999\n");  // dropped, like parse_file does
+  std::fclose(f);
+}
+
+void test_import_budget()
+{
+  write_grid("/tmp/lvar_test_grid.obj", 400);
+  std::size_t constexpr budget{ 2 * 1024 * 1024 };
+  long const before{ peak_rss_kb() };
+  assert(obj::import_file("/tmp/lvar_test_grid.obj", "/tmp/lvar_test_grid.lvm", budget));
+  long const after{ peak_rss_kb() };
+  std::clog << "import: peak rss grew " << (after - before) << " KiB, budget " << budget / 1024 << " KiB\n";
+  assert((after - before) * 1024 <= static_cast<long>(budget));
+  arena mem(64 * 1024 * 1024);
+  obj::mesh m;
+  assert(obj::load_mesh("/tmp/lvar_test_grid.lvm", m, mem));
+  assert(m.vertices.size() == 400 * 400 && m.normals.empty());
+  assert(m.num_faces() == 399 * 399 * 2);
+  assert(m.vertices[401].x == 1.25f && m.vertices[401].y == 1.5f && m.vertices[401].z == 1.0f);
+  assert(m.indices[0] == 0 && m.indices[1] == 1 && m.indices[2] == 401);
+  assert(m.indices[3] == 0 && m.indices[4] == 401 && m.indices[5] == 400);
+}
+
+void test_import_matches_parse()
+{
+  arena mem(64 * 1024 * 1024);
+  obj::mesh parsed;
+  obj::mesh imported;
+  assert(obj::parse_file("./res/MIT_teapot.obj", parsed, mem));
+  assert(obj::import_file("./res/MIT_teapot.obj", "/tmp/lvar_test_teapot.lvm"));
+  assert(obj::load_mesh("/tmp/lvar_test_teapot.lvm", imported, mem));
+  assert(parsed.vertices.bytes() == imported.vertices.bytes());
+  assert(parsed.indices.bytes() == imported.indices.bytes());
+  assert(std::memcmp(parsed.vertices.data(), imported.vertices.data(), parsed.vertices.bytes()) == 0);
+  assert(std::memcmp(parsed.indices.data(), imported.indices.data(), parsed.indices.bytes()) == 0);
+}
+
+void test_save_load()
+{
+  arena mem(1024 * 1024);
+  obj::mesh m;
+  m.vertices = mem.push_array<obj::vertex>(3);
+  m.uvs = mem.push_array<obj::texcoord>(3);
+  m.indices = mem.push_array<unsigned int>(3);
+  for(unsigned int i{ 0 }; i < 3; ++i) {
+    m.vertices[i] = { float(i), 2.0f, 3.0f };
+    m.uvs[i] = { 0.5f, float(i) };
+    m.indices[i] = 2 - i;
+  }
+  assert(obj::save_mesh("/tmp/lvar_test_tri.lvm", m));
+  obj::mesh loaded;
+  assert(obj::load_mesh("/tmp/lvar_test_tri.lvm", loaded, mem));
+  assert(loaded.normals.empty() && loaded.tangents.empty() && loaded.uvs.size() == 3);
+  assert(loaded.vertices[2].x == 2.0f && loaded.uvs[1].v == 1.0f && loaded.indices[0] == 2);
+  // garbage must be rejected and not leave anything in the arena
+  auto const mark = mem.mark();
+  assert(!obj::load_mesh("./res/MIT_teapot.obj", loaded, mem));
+  assert(mem.mark() == mark && loaded.vertices.empty());
+  assert(!obj::import_file("./res/does_not_exist.obj", "/tmp/lvar_test_nope.lvm"));
+  assert(!obj::import_file("./res/MIT_teapot.obj", "/tmp/lvar_test_nope.lvm", 1024));
+}
+
+void test_import()
+{
+  // first, before anything else makes the peak rss go up
+  test_import_budget();
+  test_import_matches_parse();
+  test_save_load();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_import();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
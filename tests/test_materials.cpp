@@ -0,0 +1,153 @@
+#include "lvar_obj.h"
+#include "lvar_mesh_opt.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>           // mkdir
+
+using namespace lvar;
+
+static void write_file(char const* path, char const* contents)
+{
+  FILE* f{ std::fopen(path, "w") };
+  assert(f);
+  std::fputs(contents, f);
+  std::fclose(f);
+}
+
+// three strips of quads, x in [0, 10) is red, [10, 20) is textured and [20, 30) is red again
+static void write_scene()
+{
+  mkdir("/tmp/lvar_test_mtl", 0755);
+  mkdir("/tmp/lvar_test_mtl/textures", 0755);
+  write_file("/tmp/lvar_test_mtl/scene.mtl",
+             "# materials\n"
+             "newmtl red\n"
+             "Ka 0.1 0.1 0.1\n"
+             "Kd 1 0 0\n"
+             "Ks 0.5\n"
+             "Ns 32\n"
+             "d 0.5\n"
+             "\n"
+             "newmtl bricks\n"
+             "  Kd 0.8 0.8 0.8\n"
+             "Tr 0.25\n"
+             "map_Kd -s 2 2 1 textures/bricks.png\n"
+             "map_Bump -bm 0.5 textures/bricks_n.png\n");
+  FILE* f{ std::fopen("/tmp/lvar_test_mtl/scene.obj", "w") };
+  assert(f);
+  std::fprintf(f, "mtllib scene.mtl\n");
+  for(unsigned int x{ 0 }; x <= 30; ++x) {
+    std::fprintf(f, "v %u 0 0\nv %u 1 0\n", x, x);
+  }
+  char const* const materials[3]{ "red", "bricks", "red" };
+  for(unsigned int strip{ 0 }; strip < 3; ++strip) {
+    std::fprintf(f, "usemtl %s\n", materials[strip]);
+    if(strip == 2) {
+      std::fprintf(f, "usemtl bricks\nusemtl red\n"); // nothing in between, no submesh for it
+    }
+    for(unsigned int x{ strip * 10 }; x < strip * 10 + 10; ++x) {
+      unsigned int const a{ x * 2 + 1 };
+      std::fprintf(f, "f %u %u %u %u\n", a, a + 2, a + 3, a + 1);
+    }
+  }
+  std::fclose(f);
+}
+
+void test_parse_materials()
+{
+  write_scene();
+  arena mem(1024 * 1024);
+  obj::mesh m;
+  assert(obj::parse_file("/tmp/lvar_test_mtl/scene.obj", m, mem));
+  assert(m.materials.size() == 2);
+  obj::material const& red{ m.materials[0] };
+  assert(std::strcmp(red.name, "red") == 0);
+  assert(red.diffuse[0] == 1.0f && red.diffuse[1] == 0.0f && red.ambient[2] == 0.1f);
+  assert(red.specular[0] == 0.5f && red.specular[2] == 0.5f && red.shininess == 32.0f && red.opacity == 0.5f);
+  assert(red.diffuse_map[0] == '\0');
+  obj::material const& bricks{ m.materials[1] };
+  assert(std::strcmp(bricks.name, "bricks") == 0 && bricks.opacity == 0.75f);
+  assert(std::strcmp(bricks.diffuse_map, "/tmp/lvar_test_mtl/textures/bricks.png") == 0);
+  assert(std::strcmp(bricks.normal_map, "/tmp/lvar_test_mtl/textures/bricks_n.png") == 0);
+  assert(m.submeshes.size() == 3);
+  for(unsigned int s{ 0 }; s < 3; ++s) {
+    assert(m.submeshes[s].index_offset == s * 60 && m.submeshes[s].index_count == 60);
+  }
+  assert(m.submeshes[0].material == 0 && m.submeshes[1].material == 1 && m.submeshes[2].material == 0);
+  // no usemtl, no submeshes
+  arena other(1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, other));
+  assert(teapot.submeshes.empty() && teapot.materials.empty());
+}
+
+void test_optimise_keeps_submeshes()
+{
+  write_scene();
+  arena mem(1024 * 1024);
+  arena scratch(1024 * 1024);
+  obj::mesh m;
+  assert(obj::parse_file("/tmp/lvar_test_mtl/scene.obj", m, mem));
+  assert(obj::optimise(m, scratch));
+  for(unsigned int s{ 0 }; s < 3; ++s) {
+    obj::submesh const& sub{ m.submeshes[s] };
+    for(unsigned int i{ sub.index_offset }; i < sub.index_offset + sub.index_count; ++i) {
+      float const x{ m.vertices[m.indices[i]].x };
+      assert(x >= s * 10.0f && x <= s * 10.0f + 10.0f);
+    }
+  }
+}
+
+void test_lvm_materials()
+{
+  write_scene();
+  arena mem(1024 * 1024);
+  obj::mesh m;
+  assert(obj::parse_file("/tmp/lvar_test_mtl/scene.obj", m, mem));
+  assert(obj::save_mesh("/tmp/lvar_test_mtl/scene.lvm", m));
+  obj::mesh loaded;
+  assert(obj::load_mesh("/tmp/lvar_test_mtl/scene.lvm", loaded, mem));
+  assert(loaded.submeshes.size() == 3 && loaded.materials.size() == 2);
+  assert(loaded.submeshes[2].material == 0 && loaded.submeshes[2].index_offset == 120);
+  assert(std::strcmp(loaded.materials[1].diffuse_map, m.materials[1].diffuse_map) == 0);
+  assert(loaded.materials[0].diffuse_layer == obj::no_layer);
+}
+
+void test_diffuse_layers()
+{
+  obj::material ms[4]{};
+  std::strcpy(ms[0].diffuse_map, "a.png");
+  std::strcpy(ms[2].diffuse_map, "b.png");
+  std::strcpy(ms[3].diffuse_map, "a.png");
+  char const* paths[2];
+  unsigned int count{ 0 };
+  assert(obj::diffuse_layers({ ms, 4 }, paths, 2, count));
+  assert(count == 2 && std::strcmp(paths[0], "a.png") == 0 && std::strcmp(paths[1], "b.png") == 0);
+  assert(ms[0].diffuse_layer == 0 && ms[1].diffuse_layer == obj::no_layer && ms[2].diffuse_layer == 1 &&
+         ms[3].diffuse_layer == 0);
+  // one too many, nothing changes
+  std::strcpy(ms[1].diffuse_map, "c.png");
+  count = 7;
+  assert(!obj::diffuse_layers({ ms, 4 }, paths, 2, count));
+  assert(count == 7 && ms[1].diffuse_layer == obj::no_layer);
+}
+
+void test_materials()
+{
+  test_parse_materials();
+  test_optimise_keeps_submeshes();
+  test_lvm_materials();
+  test_diffuse_layers();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_materials();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
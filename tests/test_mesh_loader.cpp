@@ -0,0 +1,153 @@
+#include "lvar_mesh_loader.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>              // memcmp
+#include <iostream>
+#include <thread>
+
+using namespace lvar;
+
+void test_mpmc_queue()
+{
+  jobs::mpmc_queue<unsigned int, 256> q;
+  unsigned int constexpr per_thread{ 100000 };
+  unsigned int constexpr num_threads{ 4 };
+  std::atomic<unsigned long long> sum{ 0 };
+  std::atomic<unsigned int> popped{ 0 };
+  std::thread producers[num_threads];
+  std::thread consumers[num_threads];
+  for(unsigned int t{ 0 }; t < num_threads; ++t) {
+    producers[t] = std::thread([&q, t]() {
+      for(unsigned int i{ 1 }; i <= per_thread; ++i) {
+        while(!q.push(t * per_thread + i)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+    consumers[t] = std::thread([&]() {
+      unsigned int v;
+      while(popped.load() < per_thread * num_threads) {
+        if(q.pop(v)) {
+          sum += v;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(unsigned int t{ 0 }; t < num_threads; ++t) {
+    producers[t].join();
+    consumers[t].join();
+  }
+  unsigned long long const n{ per_thread * num_threads };
+  assert(sum.load() == n * (n + 1) / 2);
+  unsigned int v;
+  assert(!q.pop(v));
+  // full is full
+  for(unsigned int i{ 0 }; i < 256; ++i) {
+    assert(q.push(i));
+  }
+  assert(!q.push(256));
+}
+
+void test_pool()
+{
+  std::atomic<unsigned int> count{ 0 };
+  {
+    jobs::pool p(3);
+    for(unsigned int i{ 0 }; i < 1000; ++i) {
+      while(!p.submit([](void* data) { ++*static_cast<std::atomic<unsigned int>*>(data); }, &count)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+  // the destructor runs everything that was submitted
+  assert(count.load() == 1000);
+  // from more than one thread, a count can get to a worker before its task does and it mustn't be lost
+  count = 0;
+  {
+    jobs::pool p(3);
+    std::thread producers[4];
+    for(std::thread& t : producers) {
+      t = std::thread([&p, &count]() {
+        for(unsigned int i{ 0 }; i < 20000; ++i) {
+          while(!p.submit([](void* data) { ++*static_cast<std::atomic<unsigned int>*>(data); }, &count)) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    for(std::thread& t : producers) {
+      t.join();
+    }
+  }
+  assert(count.load() == 80000);
+}
+
+void test_mesh_loader()
+{
+  jobs::pool workers(2);
+  obj::mesh_loader loader(workers);
+  unsigned int constexpr num_meshes{ 6 };
+  for(unsigned int i{ 0 }; i < num_meshes; ++i) {
+    assert(loader.load("./res/MIT_teapot.obj", i));
+  }
+  assert(loader.load("./res/does_not_exist.obj", 99));
+  assert(loader.in_flight() == num_meshes + 1);
+  std::size_t constexpr budget{ 16 * 1024 };
+  std::size_t next_byte[num_meshes]{};
+  unsigned int loaded{ 0 };
+  unsigned int failed{ 0 };
+  unsigned int frames{ 0 };
+  while(loader.in_flight() > 0) {
+    std::size_t const spent{ loader.drain(budget,
+      [&](obj::loaded_mesh& lm, std::size_t const begin, std::size_t const end) {
+        // every mesh is handed out in order with no gaps
+        assert(lm.ok && lm.id < num_meshes);
+        assert(begin == next_byte[lm.id] && end > begin && end <= lm.gpu_bytes());
+        next_byte[lm.id] = end;
+      },
+      [&](obj::loaded_mesh& lm) {
+        if(lm.ok) {
+          assert(next_byte[lm.id] == lm.gpu_bytes());
+          assert(lm.m.num_faces() == 6320 && !lm.m.normals.empty());
+          // the ebo has the whole lod chain, num_indices is level 0
+          assert(lm.m.lods.levels.size() >= 3 && lm.gpu.lods.size() == lm.m.lods.levels.size());
+          assert(lm.gpu.num_indices == lm.m.indices.size());
+          assert(lm.gpu.indices.bytes() == lm.m.lods.indices.size() * lm.gpu.index_size());
+          // the meshlets cover level 0, which is still the start of the chain
+          assert(!lm.meshlets.empty());
+          obj::meshlet const& last{ lm.meshlets[lm.meshlets.size() - 1] };
+          assert(last.index_offset + last.index_count == lm.gpu.num_indices);
+          assert(std::memcmp(lm.m.lods.indices.data(), lm.m.indices.data(), lm.m.indices.bytes()) == 0);
+          ++loaded;
+        } else {
+          assert(lm.id == 99);
+          ++failed;
+        }
+      }) };
+    assert(spent <= budget);
+    ++frames;
+    std::this_thread::yield();
+  }
+  std::clog << "mesh loader: " << loaded << " meshes in " << frames << " frames\n";
+  assert(loaded == num_meshes && failed == 1);
+}
+
+void test_loader()
+{
+  test_mpmc_queue();
+  test_pool();
+  test_mesh_loader();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_loader();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "lvar_mesh_opt.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <array>
+
+using namespace lvar;
+
+// a triangle is the same if it has the same vertices in the same winding, no matter where it starts
+static bool same_triangles(obj::mesh const& a, slice<obj::vertex> const& va, obj::mesh const& b, arena& mem)
+{
+  arena_scope scope(mem);
+  auto const n = a.num_faces();
+  auto ka = mem.push_array<float>(n * 9);
+  auto kb = mem.push_array<float>(n * 9);
+  auto const fill = [](obj::mesh const& m, slice<obj::vertex> const& verts, slice<float>& keys) {
+    for(std::size_t t{ 0 }; t < m.num_faces(); ++t) {
+      // rotate so the smallest x goes first
+      unsigned int r{ 0 };
+      for(unsigned int k{ 1 }; k < 3; ++k) {
+        if(verts[m.indices[t * 3 + k]].x < verts[m.indices[t * 3 + r]].x) {
+          r = k;
+        }
+      }
+      for(unsigned int k{ 0 }; k < 3; ++k) {
+        auto const& v = verts[m.indices[t * 3 + (r + k) % 3]];
+        keys[t * 9 + k * 3] = v.x;
+        keys[t * 9 + k * 3 + 1] = v.y;
+        keys[t * 9 + k * 3 + 2] = v.z;
+      }
+    }
+  };
+  fill(a, va, ka);
+  fill(b, b.vertices, kb);
+  // compare as sorted lists of 9 floats
+  auto const sort_tris = [n](slice<float>& keys) {
+    auto* tris = reinterpret_cast<std::array<float, 9>*>(keys.data());
+    std::sort(tris, tris + n);
+  };
+  sort_tris(ka);
+  sort_tris(kb);
+  return std::memcmp(ka.data(), kb.data(), ka.bytes()) == 0;
+}
+
+void test_mesh_opt_teapot()
+{
+  arena mem(256 * 1024 * 1024);
+  arena scratch(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  // keep a copy of the original to compare
+  auto original_vertices = mem.push_array<obj::vertex>(teapot.vertices.size());
+  auto original_indices = mem.push_array<unsigned int>(teapot.indices.size());
+  std::memcpy(original_vertices.data(), teapot.vertices.data(), teapot.vertices.bytes());
+  std::memcpy(original_indices.data(), teapot.indices.data(), teapot.indices.bytes());
+  obj::mesh original;
+  original.indices = original_indices;
+  auto const scratch_used = scratch.size();
+  obj::optimise_report report;
+  assert(obj::optimise(teapot, scratch, &report));
+  assert(scratch.size() == scratch_used);
+  std::clog << "teapot acmr " << report.before.acmr << " -> " << report.after.acmr
+            << ", atvr " << report.before.atvr << " -> " << report.after.atvr << '\n';
+  assert(report.after.acmr < report.before.acmr);
+  assert(report.after.atvr <= report.before.atvr);
+  assert(same_triangles(original, original_vertices, teapot, scratch));
+  // after fetch optimisation the index buffer uses the vertices in order
+  unsigned int next{ 0 };
+  for(auto const i : teapot.indices) {
+    assert(i <= next);
+    if(i == next) {
+      ++next;
+    }
+  }
+  // deterministic
+  obj::mesh again;
+  again.vertices = mem.push_array<obj::vertex>(original_vertices.size());
+  again.indices = mem.push_array<unsigned int>(original_indices.size());
+  std::memcpy(again.vertices.data(), original_vertices.data(), original_vertices.bytes());
+  std::memcpy(again.indices.data(), original_indices.data(), original_indices.bytes());
+  assert(obj::optimise(again, scratch));
+  assert(std::memcmp(again.indices.data(), teapot.indices.data(), teapot.indices.bytes()) == 0);
+  assert(std::memcmp(again.vertices.data(), teapot.vertices.data(), teapot.vertices.bytes()) == 0);
+}
+
+void test_mesh_opt()
+{
+  test_mesh_opt_teapot();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_mesh_opt();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "lvar_meshlet.h"
+#include "lvar_mesh_opt.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>              // memcpy
+#include <iostream>
+
+using namespace lvar;
+
+static v3 position(obj::mesh const& m, unsigned int const i)
+{
+  return { m.vertices[i].x, m.vertices[i].y, m.vertices[i].z };
+}
+
+void test_meshlet_build()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  assert(obj::optimise_vertex_cache(teapot, scratch));
+  slice<obj::meshlet> meshlets;
+  assert(obj::build_meshlets(teapot, meshlets, mem, scratch));
+  assert(!meshlets.empty());
+  std::clog << "teapot: " << teapot.num_faces() << " tris in " << meshlets.size() << " meshlets\n";
+  unsigned int expected_offset{ 0 };
+  for(auto const& ml : meshlets) {
+    // contiguous and within limits
+    assert(ml.index_offset == expected_offset);
+    assert(ml.index_count > 0 && ml.index_count / 3 <= obj::meshlet_max_triangles);
+    expected_offset += ml.index_count;
+    for(unsigned int i{ ml.index_offset }; i < ml.index_offset + ml.index_count; ++i) {
+      v3 const d{ sub(position(teapot, teapot.indices[i]), ml.centre) };
+      assert(std::sqrt(dot(d, d)) <= ml.radius * 1.001f + 1e-5f);
+    }
+    // if the camera is inside the cone, all the triangles must face away from it
+    if(ml.cone_cutoff < 1.0f) {
+      v3 const camera{ sub(ml.cone_apex, scale(ml.cone_axis, 100.0f)) };
+      assert(dot(normalise(sub(ml.cone_apex, camera)), ml.cone_axis) >= ml.cone_cutoff);
+      for(unsigned int i{ ml.index_offset }; i < ml.index_offset + ml.index_count; i += 3) {
+        v3 const a{ position(teapot, teapot.indices[i]) };
+        v3 const n{ cross(sub(position(teapot, teapot.indices[i + 1]), a), sub(position(teapot, teapot.indices[i + 2]), a)) };
+        assert(dot(n, sub(camera, a)) <= 1e-4f);
+      }
+    }
+  }
+  assert(expected_offset == teapot.indices.size());
+}
+
+void test_meshlet_cull()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  slice<obj::meshlet> meshlets;
+  assert(obj::build_meshlets(teapot, meshlets, mem, scratch));
+  auto ranges = mem.push_array<obj::draw_range>(meshlets.size());
+  m4 const proj{ perspective(45.0f, 16.0f / 9.0f, 0.1f, 100.0f) };
+  v3 const up{ 0.0f, 1.0f, 0.0f };
+  // looking at it, the back is cone culled but something is visible
+  v3 const eye{ 0.0f, 1.0f, 15.0f };
+  frustum const looking{ extract_frustum(mul(look_at(eye, v3{ 0.0f, 1.0f, 0.0f }, up), proj)) };
+  std::size_t const n{ obj::cull_meshlets(meshlets, looking, eye, ranges.data()) };
+  assert(n > 0);
+  std::size_t drawn{ 0 };
+  for(std::size_t i{ 0 }; i < n; ++i) {
+    drawn += ranges[i].index_count;
+  }
+  std::clog << "teapot: drawing " << drawn / 3 << " of " << teapot.num_faces() << " tris in " << n << " draws\n";
+  assert(drawn < teapot.indices.size());
+  // looking the other way, nothing
+  frustum const away{ extract_frustum(mul(look_at(eye, v3{ 0.0f, 1.0f, 30.0f }, up), proj)) };
+  assert(obj::cull_meshlets(meshlets, away, eye, ranges.data()) == 0);
+}
+
+void test_meshlet_submeshes()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(64 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  // two materials, the first third of the triangles and the rest
+  unsigned int const split{ static_cast<unsigned int>(teapot.num_faces() / 3 * 3) };
+  auto submeshes = mem.push_array<obj::submesh>(2);
+  submeshes[0] = { 0, split, 0 };
+  submeshes[1] = { split, static_cast<unsigned int>(teapot.indices.size()) - split, 1 };
+  teapot.submeshes = submeshes;
+  auto before = mem.push_array<unsigned int>(teapot.indices.size());
+  std::memcpy(before.data(), teapot.indices.data(), before.bytes());
+  slice<obj::meshlet> meshlets;
+  assert(obj::build_meshlets(teapot, meshlets, mem, scratch));
+  // every meshlet is inside the submesh it says, and they're in order with no gaps
+  unsigned int expected_offset{ 0 };
+  for(auto const& ml : meshlets) {
+    obj::submesh const& sm{ submeshes[ml.submesh] };
+    assert(ml.index_offset == expected_offset);
+    assert(ml.index_offset >= sm.index_offset && ml.index_offset + ml.index_count <= sm.index_offset + sm.index_count);
+    expected_offset += ml.index_count;
+  }
+  assert(expected_offset == teapot.indices.size());
+  // and no triangle moved to the other submesh: the same vertices are used as many times on each side
+  for(unsigned int s{ 0 }; s < 2; ++s) {
+    long long sum_before{ 0 }, sum_after{ 0 };
+    for(unsigned int i{ submeshes[s].index_offset }; i < submeshes[s].index_offset + submeshes[s].index_count; ++i) {
+      sum_before += before[i];
+      sum_after += teapot.indices[i];
+    }
+    assert(sum_before == sum_after);
+  }
+  // everything visible: the meshlets are contiguous, but the two submeshes are never one draw
+  for(auto& ml : meshlets) {
+    ml.cone_cutoff = 1.0f;
+  }
+  v3 const eye{ 0.0f, 1.0f, 30.0f };
+  frustum const all{ extract_frustum(mul(look_at(eye, v3{ 0.0f, 1.0f, 0.0f }, v3{ 0.0f, 1.0f, 0.0f }),
+                                         perspective(90.0f, 1.0f, 0.1f, 100.0f))) };
+  auto ranges = mem.push_array<obj::draw_range>(meshlets.size());
+  assert(obj::cull_meshlets(meshlets, all, eye, ranges.data()) == 2);
+  assert(ranges[0].index_offset == 0 && ranges[0].index_count == split && ranges[0].submesh == 0);
+  assert(ranges[1].index_offset == split && ranges[1].index_count == teapot.indices.size() - split && ranges[1].submesh == 1);
+}
+
+void test_meshlet()
+{
+  test_meshlet_build();
+  test_meshlet_cull();
+  test_meshlet_submeshes();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_meshlet();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
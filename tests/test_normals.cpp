@@ -0,0 +1,176 @@
+#include "lvar_normals.h"
+#include "lvar_math.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+using namespace lvar;
+
+static bool close(float const a, float const b)
+{
+  return std::fabs(a - b) < 1e-4f;
+}
+
+static void write_file(char const* path, char const* contents)
+{
+  FILE* f{ std::fopen(path, "w") };
+  assert(f);
+  std::fputs(contents, f);
+  std::fclose(f);
+}
+
+// quads, all of them facing out
+static char const* const cube_obj{
+  "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\n"
+  "v -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n"
+  "f 1 4 3 2\nf 5 6 7 8\nf 1 2 6 5\nf 4 8 7 3\nf 1 5 8 4\nf 2 3 7 6\n"
+};
+
+void test_parse_attributes()
+{
+  arena mem(1024 * 1024);
+  obj::mesh m;
+  write_file("/tmp/lvar_test_attributes.obj",
+             "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+             "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+             "vn 0 0 1\n"
+             "f 1/1/1 2/2/1 3/3/1 4/4/1\n"                  // quad -> 2 tris
+             "f -4//-1 -3//-1 -2//-1\n"                     // relative indices, no uv -> new vertices
+             "f 1/1 2/2 3/3\n");                            // no normal -> new vertices again
+  assert(obj::parse_file("/tmp/lvar_test_attributes.obj", m, mem));
+  assert(m.num_faces() == 4);
+  assert(m.vertices.size() == 10);
+  assert(m.normals.size() == m.vertices.size() && m.uvs.size() == m.vertices.size());
+  // the two triangles of the quad share 2 vertices
+  assert(m.indices[0] == m.indices[3] && m.indices[2] == m.indices[4]);
+  assert(close(m.uvs[m.indices[1]].u, 1.0f) && close(m.normals[m.indices[1]].z, 1.0f));
+  assert(close(m.vertices[m.indices[7]].x, 1.0f) && close(m.vertices[m.indices[8]].y, 1.0f));
+}
+
+void test_smooth_normals()
+{
+  arena mem(1024 * 1024);
+  arena scratch(1024 * 1024);
+  obj::mesh cube;
+  write_file("/tmp/lvar_test_cube.obj", cube_obj);
+  assert(obj::parse_file("/tmp/lvar_test_cube.obj", cube, mem));
+  assert(cube.vertices.size() == 8 && cube.normals.empty());
+  assert(obj::generate_normals(cube, mem, scratch));
+  assert(cube.vertices.size() == 8 && cube.normals.size() == 8);
+  float const d{ 1.0f / std::sqrt(3.0f) };
+  for(std::size_t i{ 0 }; i < cube.vertices.size(); ++i) {
+    // every corner sees 90 degrees of each of its 3 faces, so with angle weighting it points out of the centre
+    assert(close(cube.normals[i].x, cube.vertices[i].x * d));
+    assert(close(cube.normals[i].y, cube.vertices[i].y * d));
+    assert(close(cube.normals[i].z, cube.vertices[i].z * d));
+  }
+  assert(scratch.size() == 0);
+}
+
+void test_crease_normals()
+{
+  arena mem(1024 * 1024);
+  arena scratch(1024 * 1024);
+  obj::mesh cube;
+  write_file("/tmp/lvar_test_cube.obj", cube_obj);
+  assert(obj::parse_file("/tmp/lvar_test_cube.obj", cube, mem));
+  assert(obj::generate_normals(cube, mem, scratch, 60.0f));
+  // 8 corners * 3 faces
+  assert(cube.vertices.size() == 24 && cube.normals.size() == 24);
+  for(std::size_t t{ 0 }; t < cube.num_faces(); ++t) {
+    obj::face const f{ cube.get_face(t) };
+    v3 const a{ cube.vertices[f.idx_x].x, cube.vertices[f.idx_x].y, cube.vertices[f.idx_x].z };
+    v3 const b{ cube.vertices[f.idx_y].x, cube.vertices[f.idx_y].y, cube.vertices[f.idx_y].z };
+    v3 const c{ cube.vertices[f.idx_z].x, cube.vertices[f.idx_z].y, cube.vertices[f.idx_z].z };
+    v3 const n{ normalise(cross(sub(b, a), sub(c, a))) };
+    for(auto const i : { f.idx_x, f.idx_y, f.idx_z }) {
+      assert(close(cube.normals[i].x, n.x) && close(cube.normals[i].y, n.y) && close(cube.normals[i].z, n.z));
+    }
+  }
+}
+
+void test_tangents()
+{
+  arena mem(1024 * 1024);
+  arena scratch(1024 * 1024);
+  obj::mesh quad;
+  write_file("/tmp/lvar_test_quad.obj",
+             "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+             "v 2 0 0\nv 3 0 0\nv 3 1 0\nv 2 1 0\n"
+             "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+             "f 1/1 2/2 3/3 4/4\n"
+             "f 5/2 6/1 7/4 8/3\n");                        // u is mirrored
+  assert(obj::parse_file("/tmp/lvar_test_quad.obj", quad, mem));
+  assert(!obj::generate_tangents(quad, mem, scratch));      // no normals yet
+  assert(obj::generate_normals(quad, mem, scratch));
+  assert(obj::generate_tangents(quad, mem, scratch));
+  assert(quad.tangents.size() == quad.vertices.size());
+  for(std::size_t i{ 0 }; i < quad.vertices.size(); ++i) {
+    bool const mirrored{ quad.vertices[i].x > 1.5f };
+    assert(close(quad.normals[i].z, 1.0f));
+    assert(close(quad.tangents[i].x, mirrored ? -1.0f : 1.0f));
+    assert(close(quad.tangents[i].w, mirrored ? -1.0f : 1.0f));
+  }
+}
+
+// big enough to be split between threads
+void test_sphere_normals()
+{
+  arena mem(256 * 1024 * 1024);
+  arena scratch(256 * 1024 * 1024);
+  unsigned int constexpr rings{ 512 };
+  unsigned int constexpr segments{ 1024 };
+  obj::mesh sphere;
+  sphere.vertices = mem.push_array<obj::vertex>((rings + 1) * (segments + 1));
+  sphere.indices = mem.push_array<unsigned int>(rings * segments * 6);
+  float const pi{ std::acos(-1.0f) };
+  for(unsigned int r{ 0 }; r <= rings; ++r) {
+    for(unsigned int s{ 0 }; s <= segments; ++s) {
+      float const theta{ pi * r / rings };
+      float const phi{ 2.0f * pi * s / segments };
+      sphere.vertices[r * (segments + 1) + s] = { std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+    }
+  }
+  std::size_t n{ 0 };
+  for(unsigned int r{ 0 }; r < rings; ++r) {
+    for(unsigned int s{ 0 }; s < segments; ++s) {
+      unsigned int const a{ r * (segments + 1) + s };
+      unsigned int const b{ a + segments + 1 };
+      for(auto const i : { a, a + 1, b, a + 1, b + 1, b }) {
+        sphere.indices[n++] = i;
+      }
+    }
+  }
+  assert(obj::generate_normals(sphere, mem, scratch));
+  for(std::size_t i{ 0 }; i < sphere.vertices.size(); ++i) {
+    // the poles and the seam aren't welded, skip them
+    unsigned int const r{ static_cast<unsigned int>(i / (segments + 1)) };
+    unsigned int const s{ static_cast<unsigned int>(i % (segments + 1)) };
+    if(r == 0 || r == rings || s == 0 || s == segments) {
+      continue;
+    }
+    v3 const p{ sphere.vertices[i].x, sphere.vertices[i].y, sphere.vertices[i].z };
+    v3 const nrm{ sphere.normals[i].x, sphere.normals[i].y, sphere.normals[i].z };
+    assert(std::fabs(dot(p, nrm)) > 0.999f);
+  }
+}
+
+void test_normals()
+{
+  test_parse_attributes();
+  test_smooth_normals();
+  test_crease_normals();
+  test_tangents();
+  test_sphere_normals();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_normals();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+#include "lvar_pack.h"
+#include "lvar_common.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>           // mkdir
+
+using namespace lvar;
+
+static void write_file(char const* path, void const* data, std::size_t const sz)
+{
+  FILE* f{ std::fopen(path, "wb") };
+  assert(f);
+  std::fwrite(data, 1, sz, f);
+  std::fclose(f);
+}
+
+static bool round_trip(unsigned char const* src, std::size_t const sz)
+{
+  static unsigned char packed[1 << 20];
+  static unsigned char out[1 << 19];
+  std::size_t const n{ pack::lz_compress(src, sz, packed, sizeof(packed)) };
+  return n > 0 && pack::lz_decompress(packed, n, out, sz) && std::memcmp(src, out, sz) == 0;
+}
+
+void test_lz()
+{
+  static unsigned char data[1 << 19];
+  // nothing, less than a match, long runs, text and noise
+  assert(round_trip(data, 0));
+  assert(round_trip(reinterpret_cast<unsigned char const*>("abc"), 3));
+  assert(round_trip(data, sizeof(data)));
+  for(std::size_t i{ 0 }; i < sizeof(data); ++i) {
+    data[i] = static_cast<unsigned char>("the quick brown fox "[i % 20] + (i % 7 == 0));
+  }
+  assert(round_trip(data, sizeof(data)));
+  unsigned int x{ 1 };
+  for(std::size_t i{ 0 }; i < sizeof(data); ++i) {
+    x = x * 1664525u + 1013904223u;
+    data[i] = static_cast<unsigned char>(x >> 24);
+  }
+  assert(round_trip(data, sizeof(data)));
+  // a broken stream is an error, not a crash
+  static unsigned char packed[1 << 20];
+  std::memset(data, 'a', 1000);
+  std::size_t const n{ pack::lz_compress(data, 1000, packed, sizeof(packed)) };
+  assert(n < 100);
+  assert(!pack::lz_decompress(packed, n, data, 999));
+  assert(!pack::lz_decompress(packed, n - 1, data, 1000));
+  packed[n - 1] ^= 0xff;
+  unsigned char out[1000];
+  pack::lz_decompress(packed, n, out, 1000);
+}
+
+void test_pack_files()
+{
+  mkdir("/tmp/lvar_test_pack", 0755);
+  static char text[100000];
+  for(std::size_t i{ 0 }; i < sizeof(text); ++i) {
+    text[i] = "#version 330 core\nuniform mat4 model;\n"[i % 38];
+  }
+  static unsigned char noise[5000];
+  unsigned int x{ 7 };
+  for(auto& b : noise) {
+    x = x * 1664525u + 1013904223u;
+    b = static_cast<unsigned char>(x >> 24);
+  }
+  write_file("/tmp/lvar_test_pack/a.vert", text, sizeof(text));
+  write_file("/tmp/lvar_test_pack/b.png", noise, sizeof(noise));
+  write_file("/tmp/lvar_test_pack/empty", text, 0);
+  char const* const paths[]{ "/tmp/lvar_test_pack/a.vert", "/tmp/lvar_test_pack/b.png", "/tmp/lvar_test_pack/empty" };
+  assert(pack::write_pack("/tmp/lvar_test_pack/all.lvp", paths, 3, true));
+
+  pack::reader r;
+  assert(r.open("/tmp/lvar_test_pack/all.lvp") && r.size() == 3);
+  // text is compressed, noise isn't worth it
+  pack::entry const* a{ r.find("/tmp/lvar_test_pack/a.vert") };
+  assert(a && (a->flags & pack::entry::compressed) && a->size < a->raw_size / 4 && a->raw_size == sizeof(text));
+  static char out[sizeof(text)];
+  assert(r.read(*a, out) && std::memcmp(out, text, sizeof(text)) == 0);
+  pack::entry const* b{ r.find(pack::asset_id("/tmp/lvar_test_pack/b.png")) };
+  assert(b && !(b->flags & pack::entry::compressed));
+  // straight from the mapping, aligned
+  slice<unsigned char const> v{ r.view(*b) };
+  assert(v.size() == sizeof(noise) && std::memcmp(v.data(), noise, sizeof(noise)) == 0);
+  assert(reinterpret_cast<std::size_t>(v.data()) % pack::header::blob_alignment == 0);
+  pack::entry const* e{ r.find("/tmp/lvar_test_pack/empty") };
+  assert(e && e->raw_size == 0);
+  assert(!r.find("/tmp/lvar_test_pack/c.vert"));
+  // "./" is the same asset
+  assert(pack::asset_id("./res/shaders/x.vert") == pack::asset_id("res/shaders/x.vert"));
+  assert(pack::asset_id("res/shaders/x.vert") == "res/shaders/x.vert"_id);
+
+  // not compressed, same contents
+  assert(pack::write_pack("/tmp/lvar_test_pack/raw.lvp", paths, 3, false));
+  pack::reader raw;
+  assert(raw.open("/tmp/lvar_test_pack/raw.lvp"));
+  a = raw.find("/tmp/lvar_test_pack/a.vert");
+  assert(a && !(a->flags & pack::entry::compressed) && std::memcmp(raw.view(*a).data(), text, sizeof(text)) == 0);
+}
+
+void test_pack_chunks()
+{
+  // bigger than a chunk, with a last one that isn't whole: text, then a chunk of noise (stored as it is)
+  // and text again
+  std::size_t constexpr chunk{ pack::entry::chunk_size };
+  std::size_t constexpr size{ chunk * 2 + chunk / 2 + 3 };
+  static unsigned char big[size];
+  unsigned int x{ 11 };
+  for(std::size_t i{ 0 }; i < size; ++i) {
+    x = x * 1664525u + 1013904223u;
+    big[i] = i >= chunk && i < chunk * 2 ? static_cast<unsigned char>(x >> 24) : "uniform vec3 light_pos;\n"[i % 24];
+  }
+  write_file("/tmp/lvar_test_pack/big.lvm", big, size);
+  char const* const paths[]{ "/tmp/lvar_test_pack/big.lvm" };
+  assert(pack::write_pack("/tmp/lvar_test_pack/big.lvp", paths, 1, true));
+  pack::reader r;
+  assert(r.open("/tmp/lvar_test_pack/big.lvp"));
+  pack::entry const* e{ r.find("/tmp/lvar_test_pack/big.lvm") };
+  assert(e && (e->flags & pack::entry::compressed) && e->raw_size == size);
+  // the noise is all of it but a few kb
+  assert(e->size > chunk && e->size < chunk + chunk / 8);
+  static unsigned char out[size];
+  assert(r.read(*e, out) && std::memcmp(out, big, size) == 0);
+  // the first chunk is noise, so it's all stored as it is even if the rest would compress
+  std::memcpy(big, big + chunk, chunk);
+  write_file("/tmp/lvar_test_pack/big.lvm", big, size);
+  assert(pack::write_pack("/tmp/lvar_test_pack/big.lvp", paths, 1, true));
+  assert(r.open("/tmp/lvar_test_pack/big.lvp"));
+  e = r.find("/tmp/lvar_test_pack/big.lvm");
+  assert(e && !(e->flags & pack::entry::compressed) && e->size == size);
+  assert(std::memcmp(r.view(*e).data(), big, size) == 0);
+}
+
+void test_pack_errors()
+{
+  pack::reader r;
+  assert(!r.open("/tmp/lvar_test_pack/does_not_exist.lvp"));
+  assert(!r.find("anything") && r.size() == 0);
+  // not a pack
+  assert(!r.open("/tmp/lvar_test_pack/a.vert"));
+  char const* const missing[]{ "/tmp/lvar_test_pack/a.vert", "/tmp/lvar_test_pack/nope" };
+  assert(!pack::write_pack("/tmp/lvar_test_pack/bad.lvp", missing, 2, true));
+  struct stat sb;
+  assert(stat("/tmp/lvar_test_pack/bad.lvp", &sb) == -1);
+  // same path twice is the same id
+  char const* const twice[]{ "/tmp/lvar_test_pack/a.vert", "/tmp/lvar_test_pack/a.vert" };
+  assert(!pack::write_pack("/tmp/lvar_test_pack/bad.lvp", twice, 2, true));
+}
+
+void test_pack()
+{
+  test_lz();
+  test_pack_files();
+  test_pack_chunks();
+  test_pack_errors();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_pack();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include "lvar_residency.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace lvar;
+using namespace lvar::resource;
+
+// stand ins for a texture and a mesh, the manager's have gl ids in them
+class image final {
+public:
+  int id;
+  residency res;
+};
+
+class model final {
+public:
+  int id;
+  residency res;
+};
+
+image make_image(int const id, std::size_t const bytes)
+{
+  return image{ id, { .bytes = bytes, .refs = 0, .last_used = 0, .name = 0 } };
+}
+
+model make_model(int const id, std::size_t const bytes)
+{
+  return model{ id, { .bytes = bytes, .refs = 0, .last_used = 0, .name = 0 } };
+}
+
+void test_refs_and_names()
+{
+  resident_set<image> s;
+  handle<image> const a{ s.insert(make_image(1, 100), 11, 0) };
+  assert(a.valid() && s.get(a)->res.refs == 1 && s.get(a)->res.name == 11);
+  assert(s.bytes() == 100);
+  // the name is taken
+  assert(!s.insert(make_image(2, 50), 11, 0).valid());
+  assert(s.size() == 1 && s.bytes() == 100);
+  // the same name is the same handle, one more ref
+  assert(s.acquire(11) == a && s.get(a)->res.refs == 2);
+  assert(!s.acquire(12).valid());
+  s.release(a);
+  s.release(a);
+  s.release(a); // one too many, it doesn't wrap
+  assert(s.get(a)->res.refs == 0);
+  // use is the frame it was last wanted in
+  assert(s.use(a, 7)->res.last_used == 7);
+  // loaded, then something smaller
+  s.set_bytes(a, 400);
+  assert(s.bytes() == 400);
+  s.set_bytes(a, 40);
+  assert(s.bytes() == 40 && s.get(a)->res.bytes == 40);
+  // gone, the handle and the name with it
+  assert(s.remove(a));
+  assert(!s.remove(a));
+  assert(s.bytes() == 0 && s.get(a) == nullptr && s.use(a, 8) == nullptr && !s.find(11).valid());
+  s.release(a);
+  s.set_bytes(a, 10);
+  assert(s.bytes() == 0);
+  // and the name can be used again
+  handle<image> const b{ s.insert(make_image(3, 10), 11, 9) };
+  assert(b.valid() && !(b == a) && s.find(11) == b);
+}
+
+void test_evict_lru()
+{
+  resident_set<image> images;
+  resident_set<model> models;
+  // last used in frames 3, 1, 4 and 2, all 100 bytes
+  handle<image> const i3{ images.insert(make_image(3, 100), 3, 3) };
+  handle<image> const i1{ images.insert(make_image(1, 100), 1, 1) };
+  handle<model> const m4{ models.insert(make_model(4, 100), 4, 4) };
+  handle<model> const m2{ models.insert(make_model(2, 100), 2, 2) };
+  std::vector<int> freed;
+  auto const free_image = [&](image const& i) { freed.push_back(i.id); };
+  auto const free_model = [&](model const& m) { freed.push_back(m.id); };
+  // everything's wanted, nothing goes even over the budget
+  evict_lru(images, models, 0, free_image, free_model);
+  assert(freed.empty() && images.bytes() + models.bytes() == 400);
+  images.release(i3);
+  images.release(i1);
+  models.release(m4);
+  models.release(m2);
+  // under the budget, nothing goes either
+  evict_lru(images, models, 400, free_image, free_model);
+  assert(freed.empty());
+  // the oldest across both sets until it fits
+  evict_lru(images, models, 250, free_image, free_model);
+  assert(freed.size() == 2 && freed[0] == 1 && freed[1] == 2);
+  assert(images.get(i1) == nullptr && models.get(m2) == nullptr);
+  assert(images.get(i3) != nullptr && models.get(m4) != nullptr);
+  assert(images.bytes() + models.bytes() == 200);
+  // the oldest one is wanted again, so the next oldest goes
+  assert(images.acquire(3) == i3);
+  evict_lru(images, models, 100, free_image, free_model);
+  assert(freed.size() == 3 && freed[2] == 4);
+  assert(images.get(i3) != nullptr && !models.find(4).valid() && models.size() == 0);
+  // and it stays over the budget rather than evict it
+  evict_lru(images, models, 0, free_image, free_model);
+  assert(freed.size() == 3 && images.bytes() == 100);
+}
+
+void test_residency()
+{
+  test_refs_and_names();
+  test_evict_lru();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_residency();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include "lvar_simplify.h"
+#include "lvar_mesh_opt.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>              // memcmp
+#include <iostream>
+
+using namespace lvar;
+
+static void check_chain(obj::mesh const& m, obj::lod_chain const& chain)
+{
+  for(std::size_t l{ 0 }; l < chain.levels.size(); ++l) {
+    auto const& level = chain.levels[l];
+    assert(level.index_count % 3 == 0);
+    assert(level.index_offset + level.index_count <= chain.indices.size());
+    if(l > 0) {
+      assert(level.index_count < chain.levels[l - 1].index_count);
+      assert(level.error >= chain.levels[l - 1].error);
+    }
+    for(unsigned int i{ 0 }; i < level.index_count; ++i) {
+      assert(chain.indices[level.index_offset + i] < m.vertices.size());
+    }
+  }
+}
+
+void test_simplify_teapot()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(256 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  obj::lod_chain chain;
+  assert(obj::build_lods(teapot, chain, mem, scratch, 5));
+  assert(chain.levels.size() >= 3);
+  assert(scratch.size() == 0);
+  check_chain(teapot, chain);
+  for(auto const& l : chain.levels) {
+    std::clog << "teapot lod " << l.index_count / 3 << " tris, error " << l.error << '\n';
+  }
+  // far away -> coarse, close -> full resolution
+  float constexpr proj_scale{ 2.414f }; // 45 degrees
+  assert(obj::select_lod(chain, 0.5f, proj_scale, 1080.0f) == 0);
+  assert(obj::select_lod(chain, 10000.0f, proj_scale, 1080.0f) == chain.levels.size() - 1);
+  unsigned int prev{ 0 };
+  for(float d{ 1.0f }; d < 10000.0f; d *= 2.0f) {
+    unsigned int const l{ obj::select_lod(chain, d, proj_scale, 1080.0f) };
+    assert(l >= prev);
+    prev = l;
+  }
+}
+
+// a strip of quads, every vertex is on the border so nothing can collapse
+static obj::mesh make_strip(unsigned int const quads, arena& mem)
+{
+  obj::mesh m;
+  m.vertices = mem.push_array<obj::vertex>((quads + 1) * 2);
+  m.indices = mem.push_array<unsigned int>(quads * 6);
+  for(unsigned int i{ 0 }; i <= quads; ++i) {
+    m.vertices[i * 2] = { static_cast<float>(i), 0.0f, 0.0f };
+    m.vertices[i * 2 + 1] = { static_cast<float>(i), 1.0f, 0.0f };
+  }
+  for(unsigned int i{ 0 }; i < quads; ++i) {
+    unsigned int const a{ i * 2 }, b{ i * 2 + 1 }, c{ i * 2 + 2 }, d{ i * 2 + 3 };
+    unsigned int const tris[6]{ a, c, b, b, c, d };
+    for(unsigned int k{ 0 }; k < 6; ++k) {
+      m.indices[i * 6 + k] = tris[k];
+    }
+  }
+  return m;
+}
+
+void test_locked_borders()
+{
+  arena mem(1024 * 1024);
+  arena scratch(16 * 1024 * 1024);
+  obj::mesh const strip{ make_strip(64, mem) };
+  obj::lod_chain chain;
+  assert(obj::build_lods(strip, chain, mem, scratch, 5));
+  assert(chain.levels.size() == 1 && chain.indices.size() == strip.indices.size());
+  check_chain(strip, chain);
+}
+
+void test_simplify_capacity()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(256 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  // too small for the result, out isn't touched
+  unsigned int out[64];
+  for(unsigned int& i : out) {
+    i = 0xdeadbeef;
+  }
+  std::size_t const target{ teapot.indices.size() / 2 / 3 * 3 };
+  std::size_t const n{ obj::simplify(teapot.indices, teapot.vertices, target, 1e10f, { out, 64 }, nullptr, scratch) };
+  assert(n > 64);
+  for(unsigned int const i : out) {
+    assert(i == 0xdeadbeef);
+  }
+}
+
+void test_submeshes()
+{
+  arena mem(64 * 1024 * 1024);
+  arena scratch(256 * 1024 * 1024);
+  obj::mesh teapot;
+  assert(obj::parse_file("./res/MIT_teapot.obj", teapot, mem));
+  // two materials, the first third of the triangles and the rest
+  unsigned int const split{ static_cast<unsigned int>(teapot.indices.size() / 9 * 3) };
+  unsigned int const total{ static_cast<unsigned int>(teapot.indices.size()) };
+  teapot.submeshes = mem.push_array<obj::submesh>(2);
+  teapot.submeshes[0] = { 0, split, 1 };
+  teapot.submeshes[1] = { split, total - split, 0 };
+  obj::lod_chain chain;
+  assert(obj::build_lods(teapot, chain, mem, scratch, 5));
+  assert(chain.levels.size() >= 3 && chain.submeshes.size() == chain.levels.size() * 2);
+  check_chain(teapot, chain);
+  for(std::size_t l{ 0 }; l < chain.levels.size(); ++l) {
+    auto const subs = chain.level_submeshes(l);
+    // they cover the level, in order, with the materials they had
+    assert(subs.size() == 2 && subs[0].material == 1 && subs[1].material == 0);
+    assert(subs[0].index_offset == chain.levels[l].index_offset);
+    assert(subs[1].index_offset == subs[0].index_offset + subs[0].index_count);
+    assert(subs[0].index_count + subs[1].index_count == chain.levels[l].index_count);
+    assert(subs[0].index_count % 3 == 0 && subs[0].index_count > 0 && subs[1].index_count > 0);
+  }
+  // the .lvm keeps them
+  teapot.lods = chain;
+  assert(obj::save_mesh("/tmp/lvar_test_lods.lvm", teapot));
+  obj::mesh loaded;
+  assert(obj::load_mesh("/tmp/lvar_test_lods.lvm", loaded, mem));
+  assert(loaded.lods.levels.size() == chain.levels.size() && loaded.lods.submeshes.size() == chain.submeshes.size());
+  assert(loaded.lods.indices.size() == chain.indices.size());
+  assert(std::memcmp(loaded.lods.indices.data(), chain.indices.data(), chain.indices.bytes()) == 0);
+  assert(loaded.lods.level_submeshes(1)[1].index_offset == chain.level_submeshes(1)[1].index_offset);
+  assert(loaded.lods.levels[2].error == chain.levels[2].error);
+}
+
+void test_simplify()
+{
+  test_simplify_teapot();
+  test_locked_borders();
+  test_simplify_capacity();
+  test_submeshes();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_simplify();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
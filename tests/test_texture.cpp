@@ -0,0 +1,218 @@
+#include "lvar_texture.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace lvar;
+
+void test_lvt_round_trip()
+{
+  unsigned char pixels[3 * 5 * 3];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i * 7);
+  }
+  tex::image const img{ 5, 3, 3, { pixels, sizeof(pixels) } };
+  assert(img.row_bytes() == 15);
+  assert(tex::save_texture("/tmp/lvar_test_texture.lvt", img));
+  static unsigned char file[1024];
+  FILE* f{ std::fopen("/tmp/lvar_test_texture.lvt", "rb") };
+  assert(f);
+  std::size_t const sz{ std::fread(file, 1, sizeof(file), f) };
+  std::fclose(f);
+  assert(sz == sizeof(tex::texture_header) + sizeof(pixels));
+  assert(tex::is_texture(file, sz));
+  tex::image loaded;
+  assert(tex::read_texture(file, sz, loaded));
+  assert(loaded.width == 5 && loaded.height == 3 && loaded.channels == 3);
+  // no copy, it points into the file
+  assert(loaded.pixels.data() == file + sizeof(tex::texture_header));
+  assert(std::memcmp(loaded.pixels.data(), pixels, sizeof(pixels)) == 0);
+  // truncated, or a png
+  assert(!tex::read_texture(file, sz - 1, loaded));
+  unsigned char const png[]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  assert(!tex::is_texture(png, sizeof(png)) && !tex::read_texture(png, sizeof(png), loaded));
+  assert(!tex::read_texture(nullptr, 0, loaded));
+}
+
+void test_mip_settings()
+{
+  tex::mip_settings const normal{ tex::mip_settings_for("./res/brick_normal.png", 3) };
+  assert(normal.normal_map && !normal.srgb && normal.filter == tex::mip_filter::kaiser);
+  assert(tex::mip_settings_for("rock_N.jpg", 3).normal_map && tex::mip_settings_for("./cooked/res/wall_nrm.lvt", 2).normal_map);
+  tex::mip_settings const colour{ tex::mip_settings_for("./res/sky.png", 4) };
+  assert(colour.srgb && !colour.normal_map);
+  // data, and names that only look like it
+  assert(!tex::mip_settings_for("./res/height.png", 1).srgb && !tex::mip_settings_for("./res/noise.png", 2).srgb);
+  assert(!tex::mip_settings_for("./res/n_sky.png", 3).normal_map && !tex::mip_settings_for("./res_n/sky.png", 3).normal_map);
+}
+
+void test_mip_layout()
+{
+  unsigned char pixels[5 * 3 * 3];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i * 5);
+  }
+  tex::image const img{ 5, 3, 3, { pixels, sizeof(pixels) } };
+  assert(tex::num_mip_levels(5, 3) == 3 && tex::num_mip_levels(1, 1) == 1 && tex::num_mip_levels(1024, 16) == 11);
+  arena mem(1024 * 1024);
+  for(tex::mip_filter const f : { tex::mip_filter::box, tex::mip_filter::kaiser }) {
+    tex::mip_chain mips;
+    assert(tex::generate_mips(img, { f, true, false }, mips, mem));
+    // 5x3, 2x1, 1x1 one after the other
+    assert(mips.num_levels == 3 && mips.data.size() == 45 + 6 + 3);
+    assert(mips.levels[1].width == 2 && mips.levels[1].height == 1 && mips.levels[2].width == 1 && mips.levels[2].height == 1);
+    assert(mips.levels[0].pixels.data() == mips.data.data() && mips.levels[1].pixels.data() == mips.data.data() + 45);
+    assert(mips.levels[2].pixels.data() == mips.data.data() + 51);
+    assert(std::memcmp(mips.levels[0].pixels.data(), pixels, sizeof(pixels)) == 0);
+  }
+  // an arena of mip_chain_bytes is enough
+  arena exact(tex::mip_chain_bytes(img));
+  tex::mip_chain mips;
+  assert(tex::mip_chain_bytes(img) >= 45 + 6 + 3);
+  assert(tex::generate_mips(img, { tex::mip_filter::kaiser, true, false }, mips, exact));
+}
+
+void test_mip_flat()
+{
+  // a flat colour stays that colour with every filter, srgb or not
+  unsigned char pixels[16 * 8 * 4];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); i += 4) {
+    pixels[i + 0] = 200;
+    pixels[i + 1] = 30;
+    pixels[i + 2] = 101;
+    pixels[i + 3] = 77;
+  }
+  tex::image const img{ 16, 8, 4, { pixels, sizeof(pixels) } };
+  arena mem(1024 * 1024);
+  for(tex::mip_filter const f : { tex::mip_filter::box, tex::mip_filter::kaiser }) {
+    for(bool const srgb : { false, true }) {
+      tex::mip_chain mips;
+      assert(tex::generate_mips(img, { f, srgb, false }, mips, mem));
+      assert(mips.num_levels == 5);
+      for(unsigned int l{ 1 }; l < mips.num_levels; ++l) {
+        tex::image const& level{ mips.levels[l] };
+        for(std::size_t i{ 0 }; i < level.pixels.size(); ++i) {
+          assert(level.pixels[i] == pixels[i % 4]);
+        }
+      }
+    }
+  }
+}
+
+void test_mip_srgb()
+{
+  // black and white, half of the light is 188 in srgb and not 128
+  unsigned char pixels[2 * 2 * 4];
+  for(unsigned int i{ 0 }; i < 4; ++i) {
+    unsigned char const v{ static_cast<unsigned char>(i == 0 || i == 3 ? 255 : 0) };
+    std::memset(pixels + i * 4, v, 4);
+  }
+  tex::image const img{ 2, 2, 4, { pixels, sizeof(pixels) } };
+  arena mem(64 * 1024);
+  tex::mip_chain mips;
+  assert(tex::generate_mips(img, { tex::mip_filter::box, false, false }, mips, mem));
+  unsigned char const* p{ mips.levels[1].pixels.data() };
+  assert(p[0] == 128 && p[1] == 128 && p[2] == 128 && p[3] == 128);
+  assert(tex::generate_mips(img, { tex::mip_filter::box, true, false }, mips, mem));
+  p = mips.levels[1].pixels.data();
+  // alpha isn't a colour
+  assert(p[0] == 188 && p[1] == 188 && p[2] == 188 && p[3] == 128);
+}
+
+void test_mip_kaiser_ramp()
+{
+  // the kernel is centred: a ramp comes out as the same ramp as the box filter, away from the edges
+  unsigned char pixels[32];
+  for(unsigned int x{ 0 }; x < 32; ++x) {
+    pixels[x] = static_cast<unsigned char>(x * 8);
+  }
+  tex::image const img{ 32, 1, 1, { pixels, sizeof(pixels) } };
+  arena mem(64 * 1024);
+  tex::mip_chain box;
+  tex::mip_chain kaiser;
+  assert(tex::generate_mips(img, { tex::mip_filter::box, false, false }, box, mem));
+  assert(tex::generate_mips(img, { tex::mip_filter::kaiser, false, false }, kaiser, mem));
+  for(unsigned int x{ 2 }; x < 14; ++x) {
+    assert(box.levels[1].pixels[x] == x * 16 + 4);
+    int const d{ static_cast<int>(kaiser.levels[1].pixels[x]) - static_cast<int>(box.levels[1].pixels[x]) };
+    assert(d >= -1 && d <= 1);
+  }
+}
+
+void test_mip_normals()
+{
+  // columns of normals leaning left and right, (+-0.6, 0, 0.8). the average is (0, 0, 0.8), it's (0, 0, 1)
+  // when it's made unit length again
+  unsigned char pixels[4 * 4 * 3];
+  for(unsigned int i{ 0 }; i < 16; ++i) {
+    pixels[i * 3 + 0] = i % 2 ? 51 : 204;
+    pixels[i * 3 + 1] = 128;
+    pixels[i * 3 + 2] = 230;
+  }
+  tex::image const img{ 4, 4, 3, { pixels, sizeof(pixels) } };
+  arena mem(64 * 1024);
+  tex::mip_chain mips;
+  assert(tex::generate_mips(img, { tex::mip_filter::box, false, true }, mips, mem));
+  for(unsigned int l{ 1 }; l < mips.num_levels; ++l) {
+    unsigned char const* const p{ mips.levels[l].pixels.data() };
+    assert(p[0] >= 127 && p[0] <= 128 && p[1] >= 127 && p[1] <= 129 && p[2] >= 254);
+  }
+  assert(tex::generate_mips(img, { tex::mip_filter::box, false, false }, mips, mem));
+  assert(mips.levels[1].pixels[2] == 230);
+}
+
+void test_lvt_mips()
+{
+  unsigned char pixels[8 * 4 * 2];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i * 3);
+  }
+  tex::image const img{ 8, 4, 2, { pixels, sizeof(pixels) } };
+  arena mem(64 * 1024);
+  tex::mip_chain mips;
+  assert(tex::generate_mips(img, tex::mip_settings_for("x.png", 2), mips, mem));
+  assert(tex::save_texture("/tmp/lvar_test_texture_mips.lvt", mips));
+  static unsigned char file[1024];
+  FILE* f{ std::fopen("/tmp/lvar_test_texture_mips.lvt", "rb") };
+  assert(f);
+  std::size_t const sz{ std::fread(file, 1, sizeof(file), f) };
+  std::fclose(f);
+  assert(sz == sizeof(tex::texture_header) + mips.data.size());
+  tex::mip_chain loaded;
+  assert(tex::read_texture(file, sz, loaded));
+  assert(loaded.num_levels == 4 && loaded.levels[3].width == 1 && loaded.levels[3].height == 1);
+  assert(loaded.data.data() == file + sizeof(tex::texture_header));
+  assert(std::memcmp(loaded.data.data(), mips.data.data(), mips.data.size()) == 0);
+  // truncated in the last level
+  assert(!tex::read_texture(file, sz - 1, loaded));
+  // version 1 had padding where the levels are now, it's level 0 only
+  tex::texture_header h;
+  std::memcpy(&h, file, sizeof(h));
+  h.version = 1;
+  h.num_levels = 0;
+  std::memcpy(file, &h, sizeof(h));
+  assert(tex::read_texture(file, sz, loaded) && loaded.num_levels == 1 && loaded.data.size() == sizeof(pixels));
+}
+
+void test_texture()
+{
+  test_lvt_round_trip();
+  test_mip_settings();
+  test_mip_layout();
+  test_mip_flat();
+  test_mip_srgb();
+  test_mip_kaiser_ramp();
+  test_mip_normals();
+  test_lvt_mips();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_texture();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
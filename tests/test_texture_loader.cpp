@@ -0,0 +1,146 @@
+#include "lvar_texture_loader.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using namespace lvar;
+
+void test_texture_loader()
+{
+  // a cooked one too, the loader only reads it
+  unsigned char pixels[4 * 4 * 4];
+  for(unsigned int i{ 0 }; i < sizeof(pixels); ++i) {
+    pixels[i] = static_cast<unsigned char>(i);
+  }
+  assert(tex::save_texture("/tmp/lvar_test_loader.lvt", tex::image{ 4, 4, 4, { pixels, sizeof(pixels) } }));
+  char const* const paths[]{ "./res/despera.jpg", "./res/sky.png", "./res/Cobblestone.png", "/tmp/lvar_test_loader.lvt" };
+  unsigned int constexpr num_textures{ 4 };
+  jobs::pool workers(2);
+  tex::texture_loader loader(workers);
+  // the same one many times, like a level that uses it everywhere
+  unsigned int constexpr copies{ 8 };
+  for(unsigned int i{ 0 }; i < num_textures * copies; ++i) {
+    assert(loader.load(paths[i % num_textures], i));
+  }
+  assert(loader.load("./res/does_not_exist.png", 999));
+  assert(loader.in_flight() == num_textures * copies + 1);
+  std::size_t constexpr budget{ 256 * 1024 };
+  std::size_t next_byte[num_textures * copies]{};
+  std::size_t sizes[num_textures]{};
+  unsigned char sky_start[16]{};
+  unsigned int loaded{ 0 };
+  unsigned int failed{ 0 };
+  unsigned int frames{ 0 };
+  while(loader.in_flight() > 0) {
+    std::size_t const spent{ loader.drain(budget,
+      [&](tex::loaded_texture& lt, std::size_t const begin, std::size_t const end) {
+        // every texture is handed out in order with no gaps
+        assert(lt.ok && lt.id < num_textures * copies);
+        assert(begin == next_byte[lt.id] && end > begin && end <= lt.bytes());
+        next_byte[lt.id] = end;
+      },
+      [&](tex::loaded_texture& lt) {
+        if(!lt.ok) {
+          assert(lt.id == 999);
+          ++failed;
+          return;
+        }
+        assert(next_byte[lt.id] == lt.bytes());
+        // every level is in there, the mips are made on the workers
+        tex::image const& top{ lt.mips.levels[0] };
+        assert(lt.mips.num_levels == tex::num_mip_levels(top.width, top.height));
+        assert(top.pixels.data() == lt.mips.data.data() && lt.bytes() > static_cast<std::size_t>(top.width) * top.height * top.channels);
+        // all the copies decode to the same thing
+        unsigned int const k{ lt.id % num_textures };
+        assert(sizes[k] == 0 || sizes[k] == top.pixels.bytes());
+        sizes[k] = top.pixels.bytes();
+        if(k == 1) {
+          std::memcpy(sky_start, top.pixels.data(), sizeof(sky_start));
+        }
+        if(k == 3) {
+          // cooked without mips, they're made when it's loaded
+          assert(top.width == 4 && std::memcmp(top.pixels.data(), pixels, sizeof(pixels)) == 0 && lt.mips.num_levels == 3);
+        }
+        ++loaded;
+      }) };
+    assert(spent <= budget);
+    ++frames;
+    std::this_thread::yield();
+  }
+  std::clog << "texture loader: " << loaded << " textures in " << frames << " frames\n";
+  assert(loaded == num_textures * copies && failed == 1);
+  // flipped like stbi_load with the flag does it, the first row is the bottom one
+  int w, h, c;
+  stbi_set_flip_vertically_on_load(true);
+  unsigned char* const flipped{ stbi_load("./res/sky.png", &w, &h, &c, 0) };
+  assert(flipped && sizes[1] == static_cast<std::size_t>(w) * h * c);
+  assert(std::memcmp(flipped, sky_start, sizeof(sky_start)) == 0);
+  stbi_image_free(flipped);
+}
+
+void test_atlas_and_array()
+{
+  unsigned char a[8 * 8 * 3];
+  unsigned char b[8 * 8 * 3];
+  for(unsigned int i{ 0 }; i < sizeof(a); ++i) {
+    a[i] = static_cast<unsigned char>(i);
+    b[i] = static_cast<unsigned char>(255 - i);
+  }
+  assert(tex::save_texture("/tmp/lvar_test_layer_a.lvt", tex::image{ 8, 8, 3, { a, sizeof(a) } }));
+  assert(tex::save_texture("/tmp/lvar_test_layer_b.lvt", tex::image{ 8, 8, 3, { b, sizeof(b) } }));
+  char const* const atlas_paths[]{ "./res/sky.png", "/tmp/lvar_test_layer_a.lvt" };
+  char const* const layer_paths[]{ "/tmp/lvar_test_layer_a.lvt", "/tmp/lvar_test_layer_b.lvt" };
+  char const* const mismatched[]{ "/tmp/lvar_test_layer_a.lvt", "./res/sky.png" };
+  jobs::pool workers(2);
+  tex::texture_loader loader(workers);
+  tex::uv_rect rects[2]{};
+  assert(loader.load_atlas(atlas_paths, 2, 1, rects));
+  assert(loader.load_array(layer_paths, 2, 2));
+  assert(loader.load_array(mismatched, 2, 3));
+  assert(!loader.load_array(layer_paths, 0, 4) && !loader.load_array(layer_paths, tex::loaded_texture::max_images + 1, 4));
+  unsigned int done{ 0 };
+  while(loader.in_flight() > 0) {
+    loader.drain(1024 * 1024, [](tex::loaded_texture&, std::size_t, std::size_t) {},
+      [&](tex::loaded_texture& lt) {
+        ++done;
+        if(lt.id == 1) {
+          // sky is 900x630 rgba, the atlas is rgba with both and its mips
+          assert(lt.ok && lt.kind == tex::texture_kind::atlas && lt.count == 2 && lt.rects_out == rects);
+          tex::image const& top{ lt.mips.levels[0] };
+          assert(top.channels == 4 && top.width >= 900 && top.height >= 630);
+          assert(lt.mips.num_levels == tex::num_mip_levels(top.width, top.height));
+          assert(lt.rects[0].width * top.width == 900.0f && lt.rects[1].width * top.width == 8.0f);
+        } else if(lt.id == 2) {
+          // every level has both layers
+          assert(lt.ok && lt.kind == tex::texture_kind::array && lt.mips.num_levels == 4);
+          assert(lt.mips.levels[0].width == 8 && lt.mips.levels[0].height == 16 && lt.mips.levels[3].height == 2);
+          assert(std::memcmp(lt.mips.levels[0].pixels.data(), a, sizeof(a)) == 0);
+          assert(std::memcmp(lt.mips.levels[0].pixels.data() + sizeof(a), b, sizeof(b)) == 0);
+        } else {
+          assert(lt.id == 3 && !lt.ok);
+        }
+      });
+    std::this_thread::yield();
+  }
+  assert(done == 3);
+}
+
+void test_loader()
+{
+  test_texture_loader();
+  test_atlas_and_array();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_loader();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
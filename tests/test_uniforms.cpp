@@ -0,0 +1,59 @@
+#include "lvar_shader.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+using namespace lvar;
+
+void test_hash()
+{
+  static_assert("model"_id == fnv1a("model"));
+  static_assert(""_id == static_cast<int>(0x811c9dc5));
+  // known values, run time and compile time have to agree
+  assert(fnv1a("a") == static_cast<int>(0xe40c292c));
+  assert(fnv1a("foobar") == static_cast<int>(0xbf9cf968));
+  char const name[]{ "colour_light" };
+  assert(fnv1a(name) == "colour_light"_id);
+  assert(fnv1a("lights[0]", 6) == "lights"_id);
+}
+
+void test_uniform_table()
+{
+  resource::uniform_table t;
+  assert(t.location("model"_id) == -1);
+  assert(t.insert("model"_id, 3));
+  assert(t.insert("view"_id, 0));
+  assert(t.location("model"_id) == 3 && t.location("view"_id) == 0 && t.location("proj"_id) == -1);
+  // same slot, they have to probe
+  int const a{ 5 };
+  int const b{ a + static_cast<int>(resource::uniform_table::max_slots) };
+  assert(t.insert(a, 10) && t.insert(b, 11));
+  assert(t.location(a) == 10 && t.location(b) == 11);
+  assert(t.location(a + 2 * static_cast<int>(resource::uniform_table::max_slots)) == -1);
+  // again is an update
+  assert(t.insert("model"_id, 4) && t.location("model"_id) == 4 && t.size() == 4);
+  // half full at most
+  resource::uniform_table full;
+  for(unsigned int i{ 0 }; i < resource::uniform_table::max_slots / 2; ++i) {
+    assert(full.insert(static_cast<int>(i * 7), static_cast<int>(i)));
+  }
+  assert(!full.insert(1000, 1));
+  for(unsigned int i{ 0 }; i < resource::uniform_table::max_slots / 2; ++i) {
+    assert(full.location(static_cast<int>(i * 7)) == static_cast<int>(i));
+  }
+}
+
+void test_uniforms()
+{
+  test_hash();
+  test_uniform_table();
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_uniforms();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#include "lvar_watcher.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>           // mkdir
+#include <thread>
+
+using namespace lvar;
+
+class seen final {
+public:
+  std::atomic<unsigned int> written{ 0 };
+  std::atomic<unsigned int> other{ 0 };
+};
+
+static void on_change(char const* path, void* data)
+{
+  seen* const s{ static_cast<seen*>(data) };
+  if(std::strcmp(path, "/tmp/lvar_test_watch/a.frag") == 0) {
+    ++s->written;
+  } else {
+    ++s->other;
+  }
+}
+
+static void write_file(char const* path, char const* contents)
+{
+  FILE* f{ std::fopen(path, "w") };
+  assert(f);
+  std::fputs(contents, f);
+  std::fclose(f);
+}
+
+static bool wait_for(std::atomic<unsigned int> const& v, unsigned int const value)
+{
+  for(unsigned int i{ 0 }; i < 500 && v.load() < value; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  return v.load() >= value;
+}
+
+void test_watcher()
+{
+  mkdir("/tmp/lvar_test_watch", 0755);
+  write_file("/tmp/lvar_test_watch/a.frag", "void main() {}\n");
+  seen s;
+  {
+    char const* const dirs[]{ "/tmp/lvar_test_watch" };
+    files::watcher w(dirs, 1, on_change, &s);
+    assert(!w.error());
+    // written in place
+    write_file("/tmp/lvar_test_watch/a.frag", "void main() { }\n");
+    assert(wait_for(s.written, 1));
+    // saved like editors do, to another file and renamed over it
+    write_file("/tmp/lvar_test_watch/a.frag.tmp", "void main() {  }\n");
+    std::rename("/tmp/lvar_test_watch/a.frag.tmp", "/tmp/lvar_test_watch/a.frag");
+    assert(wait_for(s.written, 2));
+    assert(s.other.load() == 1); // the .tmp
+  }
+  // the destructor stopped it
+  unsigned int const before{ s.written.load() };
+  write_file("/tmp/lvar_test_watch/a.frag", "void main() {}\n");
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  assert(s.written.load() == before);
+  char const* const missing[]{ "/tmp/lvar_test_watch/does_not_exist" };
+  files::watcher bad(missing, 1, on_change, &s);
+  assert(bad.error());
+}
+
+int main()
+{
+  std::ios::sync_with_stdio(false);
+  test_watcher();
+  std::clog << __FILE__ << "...ok\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+// encoding throughput, error and memory of the block compressed formats, for every image it's given
+//
+//   bench_bc <image>...
+//
+// first how fast generate_mips makes the chain with each filter, then every format the image can go in
+// (rgb: bc1, rgba: bc1 and bc3, rg: bc5) at both qualities. the time is encoding the whole chain, the
+// error is the psnr of the biggest level over the channels the format keeps, and the bytes are all the
+// levels against the same levels uncompressed
+
+#include "lvar_bc.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+using namespace lvar;
+
+static double psnr(tex::image const& img, unsigned char const* rgba, unsigned int const channels)
+{
+  double err{ 0.0 };
+  std::size_t const n{ static_cast<std::size_t>(img.width) * img.height };
+  for(std::size_t i{ 0 }; i < n; ++i) {
+    for(unsigned int c{ 0 }; c < channels; ++c) {
+      int const d{ static_cast<int>(img.pixels[i * img.channels + c]) - static_cast<int>(rgba[i * 4 + c]) };
+      err += d * d;
+    }
+  }
+  double const mse{ err / static_cast<double>(n * channels) };
+  return mse == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+int main(int argc, char** argv)
+{
+  if(argc < 2) {
+    std::cerr << "usage: " << argv[0] << " <image>...\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << std::fixed << std::setprecision(2);
+  for(int a{ 1 }; a < argc; ++a) {
+    int w, h, ch;
+    unsigned char* const data{ stbi_load(argv[a], &w, &h, &ch, 0) };
+    if(!data) {
+      std::cerr << "bench_bc: couldn't load " << argv[a] << '\n';
+      continue;
+    }
+    tex::image const img{ static_cast<unsigned int>(w), static_cast<unsigned int>(h), static_cast<unsigned int>(ch),
+                          { data, static_cast<std::size_t>(w) * h * ch } };
+    // the chain and the blocks of one format and quality at a time, with a lot of room to spare
+    arena mem(img.pixels.size() * 8 + 64 * 1024 * 1024);
+    tex::mip_chain mips;
+    for(tex::mip_filter const filter : { tex::mip_filter::box, tex::mip_filter::kaiser }) {
+      tex::mip_settings s{ tex::mip_settings_for(argv[a], img.channels) };
+      s.filter = filter;
+      mem.reset();
+      auto const start = std::chrono::steady_clock::now();
+      if(!tex::generate_mips(img, s, mips, mem)) {
+        std::cerr << "bench_bc: couldn't make the mips of " << argv[a] << '\n';
+        return EXIT_FAILURE;
+      }
+      double const seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+      // what's filtered is level 0, the rest is a third of it
+      std::cout << argv[a] << ": " << w << 'x' << h << " mips " << (filter == tex::mip_filter::box ? "box " : "kaiser ")
+                << static_cast<double>(w) * h / seconds / 1e6 << " Mpx/s" << (s.srgb ? " srgb" : "")
+                << (s.normal_map ? " normal map" : "") << '\n';
+    }
+    std::size_t const raw{ mips.data.size() };
+    for(tex::bc_format const f : { tex::bc_format::bc1, tex::bc_format::bc3, tex::bc_format::bc5 }) {
+      if((f == tex::bc_format::bc5) != (ch == 2) || (f == tex::bc_format::bc3 && ch != 4) || ch == 1) {
+        continue;
+      }
+      for(tex::bc_quality const q : { tex::bc_quality::fast, tex::bc_quality::high }) {
+        arena_scope scope(mem);
+        tex::compressed_texture ct;
+        auto const start = std::chrono::steady_clock::now();
+        if(!tex::compress(mips, f, q, ct, mem)) {
+          std::cerr << "bench_bc: couldn't compress " << argv[a] << '\n';
+          return EXIT_FAILURE;
+        }
+        double const seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+        slice<unsigned char> const decoded{ mem.push_array<unsigned char>(static_cast<std::size_t>(w) * h * 4) };
+        tex::decode_image(ct.data.data(), f, img.width, img.height, decoded.data());
+        unsigned int const kept{ f == tex::bc_format::bc5 ? 2u : f == tex::bc_format::bc1 ? 3u : 4u };
+        double const mpx{ static_cast<double>(raw) / ch / 1e6 };
+        std::cout << argv[a] << ": " << w << 'x' << h << " bc" << static_cast<unsigned int>(f)
+                  << (q == tex::bc_quality::fast ? " fast " : " high ") << mpx / seconds << " Mpx/s, psnr "
+                  << psnr(img, decoded.data(), kept) << " dB, " << raw / 1024 << " KB -> " << ct.data.size() / 1024
+                  << " KB (" << static_cast<double>(raw) / static_cast<double>(ct.data.size()) << ":1)\n";
+      }
+    }
+    stbi_image_free(data);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,52 @@
+// parse_file throughput for the files generated by gen_obj (or any .obj)
+//
+//   bench_obj <file.obj>
+//
+// one file per run, the peak rss is the peak of the whole process
+
+#include "lvar_obj.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <sys/resource.h>       // getrusage
+#include <sys/stat.h>           // stat
+
+using namespace lvar;
+
+static double peak_rss_mb()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_maxrss) / 1024.0;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc != 2) {
+    std::cerr << "usage: " << argv[0] << " <file.obj>\n";
+    return EXIT_FAILURE;
+  }
+  struct stat sb;
+  if(stat(argv[1], &sb) == -1) {
+    std::cerr << "bench_obj: couldn't stat " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  double const mb{ static_cast<double>(sb.st_size) / (1024.0 * 1024.0) };
+  // only address space, the pages that parse_file doesn't touch cost nothing
+  arena mem(static_cast<std::size_t>(sb.st_size) * 4 + 64 * 1024 * 1024);
+  obj::mesh m;
+  auto const start = std::chrono::steady_clock::now();
+  bool const ok{ obj::parse_file(argv[1], m, mem) };
+  double const seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+  if(!ok) {
+    std::cerr << "bench_obj: couldn't parse " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  double const tris{ static_cast<double>(m.num_faces()) };
+  std::cout << std::fixed << std::setprecision(2) << argv[1] << ": " << mb << " MB, " << m.num_faces() << " tris, "
+            << m.vertices.size() << " vertices in " << seconds << " s -> " << mb / seconds << " MB/s, "
+            << tris / seconds / 1e6 << " Mtris/s, peak rss " << peak_rss_mb() << " MB\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+// build_lods throughput on a bumpy grid, 2 * side^2 triangles (708 is about 1M)
+//
+//   bench_simplify [side]
+//
+// the grid is the same every run, 5 lods
+
+#include "lvar_simplify.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+
+using namespace lvar;
+
+// (n + 1)^2 vertices and 2 * n^2 triangles
+static obj::mesh make_grid(unsigned int const n, arena& mem)
+{
+  obj::mesh m;
+  m.vertices = mem.push_array<obj::vertex>((n + 1) * (n + 1));
+  m.indices = mem.push_array<unsigned int>(n * n * 6);
+  for(unsigned int y{ 0 }; y <= n; ++y) {
+    for(unsigned int x{ 0 }; x <= n; ++x) {
+      float const fx{ static_cast<float>(x) / n };
+      float const fy{ static_cast<float>(y) / n };
+      m.vertices[y * (n + 1) + x] = { fx, 0.05f * std::sin(fx * 12.0f) * std::cos(fy * 9.0f), fy };
+    }
+  }
+  std::size_t i{ 0 };
+  for(unsigned int y{ 0 }; y < n; ++y) {
+    for(unsigned int x{ 0 }; x < n; ++x) {
+      unsigned int const a{ y * (n + 1) + x };
+      unsigned int const b{ a + 1 };
+      unsigned int const c{ a + n + 1 };
+      unsigned int const d{ c + 1 };
+      m.indices[i++] = a; m.indices[i++] = c; m.indices[i++] = b;
+      m.indices[i++] = b; m.indices[i++] = c; m.indices[i++] = d;
+    }
+  }
+  return m;
+}
+
+int main(int argc, char** argv)
+{
+  if(argc > 2) {
+    std::cerr << "usage: " << argv[0] << " [side]\n";
+    return EXIT_FAILURE;
+  }
+  unsigned long const side{ argc == 2 ? std::strtoul(argv[1], nullptr, 10) : 708ul };
+  if(side < 2 || side > 4096) {
+    std::cerr << "bench_simplify: the side goes from 2 to 4096\n";
+    return EXIT_FAILURE;
+  }
+  // sized for the biggest grid, arena only commits the pages build_lods writes to
+  arena mem(1024ull * 1024 * 1024 + side * side * 512);
+  arena scratch(2048ull * 1024 * 1024 + side * side * 1024);
+  obj::mesh const grid{ make_grid(static_cast<unsigned int>(side), mem) };
+  auto const start = std::chrono::steady_clock::now();
+  obj::lod_chain chain;
+  bool const ok{ obj::build_lods(grid, chain, mem, scratch, 5) };
+  double const seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+  if(!ok) {
+    std::cerr << "bench_simplify: build_lods failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << std::fixed << std::setprecision(2) << "simplify: " << grid.num_faces() << " tris -> "
+            << chain.levels.size() << " lods in " << seconds << " s -> "
+            << static_cast<double>(grid.num_faces()) / seconds / 1e6 << " Mtris/s\n";
+  for(auto const& l : chain.levels) {
+    std::cout << "  " << l.index_count / 3 << " tris, error " << l.error << '\n';
+  }
+  return EXIT_SUCCESS;
+}
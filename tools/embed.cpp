@@ -0,0 +1,153 @@
+// files into a header, compiled into the program as constexpr arrays. the release builds read their
+// shaders from there and never open them (make embed, make colours-release)
+//
+//   embed <output.h> <file>...
+//
+// every file gets an id, the same one the pack gives it (fnv1a of the path without the ./), a constant
+// with a name made from the path (res/shaders/light_cube.vert -> ids::res_shaders_light_cube_vert) and a
+// row in a table sorted by id, lvar_embed.h looks them up. the output is only written when it's
+// different, so make doesn't rebuild everything that includes it every time
+
+#include "lvar_common.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+  class file final {
+  public:
+    std::string path;           // without the ./
+    std::string name;           // a c++ identifier
+    int id;
+    std::string data;
+  };
+
+  bool read_whole(char const* path, std::string& out) noexcept
+  {
+    FILE* f{ std::fopen(path, "rb") };
+    if(!f) {
+      return false;
+    }
+    out.clear();
+    char buffer[64 * 1024];
+    std::size_t n;
+    while((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) {
+      out.append(buffer, n);
+    }
+    bool const ok{ std::ferror(f) == 0 };
+    std::fclose(f);
+    return ok;
+  }
+
+  // anything that can't be in an identifier is a _, a leading digit gets one in front
+  std::string identifier(std::string const& path) noexcept
+  {
+    std::string name;
+    if(!path.empty() && path[0] >= '0' && path[0] <= '9') {
+      name += '_';
+    }
+    for(char const c : path) {
+      bool const ok{ (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' };
+      name += ok ? c : '_';
+    }
+    return name;
+  }
+
+  std::string generate(std::vector<file> const& files) noexcept
+  {
+    std::string out;
+    char line[128];
+    out += "// generated by tools/embed.cpp from";
+    for(file const& f : files) {
+      out += ' ';
+      out += f.path;
+    }
+    out += ", don't edit it\n#pragma once\n\nnamespace lvar {\n  namespace embed {\n\n    namespace ids {\n";
+    for(file const& f : files) {
+      std::snprintf(line, sizeof(line), "{ %d };\n", f.id);
+      out += "      inline constexpr int " + f.name + line;
+    }
+    out += "    };\n\n";
+    // a '\0' after the last byte, text is a c string too
+    for(std::size_t i{ 0 }; i < files.size(); ++i) {
+      std::snprintf(line, sizeof(line), "    inline constexpr unsigned char data_%zu[]{", i);
+      out += line;
+      for(std::size_t b{ 0 }; b <= files[i].data.size(); ++b) {
+        unsigned int const c{ b < files[i].data.size() ? static_cast<unsigned char>(files[i].data[b]) : 0u };
+        std::snprintf(line, sizeof(line), "%s0x%02x,", b % 16 == 0 ? "\n      " : " ", c);
+        out += line;
+      }
+      out += "\n    };\n";
+    }
+    out += "\n    inline constexpr asset table[]{\n";
+    for(std::size_t i{ 0 }; i < files.size(); ++i) {
+      std::snprintf(line, sizeof(line), "\", ids::%s, data_%zu, %zu },\n", files[i].name.c_str(), i, files[i].data.size());
+      out += "      { \"" + files[i].path + line;
+    }
+    std::snprintf(line, sizeof(line), "    inline constexpr std::size_t num_assets{ %zu };\n", files.size());
+    out += "    };\n    inline constexpr asset const* assets{ table };\n";
+    out += line;
+    out += "\n  };\n};\n";
+    return out;
+  }
+
+};
+
+int main(int argc, char** argv)
+{
+  if(argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <output.h> <file>...\n";
+    return EXIT_FAILURE;
+  }
+  std::vector<file> files;
+  for(int i{ 2 }; i < argc; ++i) {
+    char const* path{ argv[i] };
+    if(path[0] == '.' && path[1] == '/') {
+      path += 2;
+    }
+    file f{ path, identifier(path), lvar::fnv1a(path), {} };
+    if(!read_whole(argv[i], f.data)) {
+      std::cerr << "embed: couldn't read " << argv[i] << '\n';
+      return EXIT_FAILURE;
+    }
+    files.push_back(std::move(f));
+  }
+  // the lookup is a binary search on the id
+  std::sort(files.begin(), files.end(), [](file const& a, file const& b) { return a.id < b.id; });
+  for(std::size_t i{ 1 }; i < files.size(); ++i) {
+    if(files[i].id == files[i - 1].id) {
+      std::cerr << "embed: " << files[i - 1].path << " and " << files[i].path << " have the same id, rename one of them\n";
+      return EXIT_FAILURE;
+    }
+  }
+  std::vector<std::string> names;
+  for(file const& f : files) {
+    names.push_back(f.name);
+  }
+  std::sort(names.begin(), names.end());
+  if(std::adjacent_find(names.begin(), names.end()) != names.end()) {
+    std::cerr << "embed: two paths make the same name, " << *std::adjacent_find(names.begin(), names.end()) << '\n';
+    return EXIT_FAILURE;
+  }
+  std::string const out{ generate(files) };
+  std::string old;
+  if(read_whole(argv[1], old) && old == out) {
+    return EXIT_SUCCESS;
+  }
+  FILE* f{ std::fopen(argv[1], "wb") };
+  if(!f) {
+    std::cerr << "embed: couldn't open " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  bool const ok{ std::fwrite(out.data(), 1, out.size(), f) == out.size() };
+  if(std::fclose(f) != 0 || !ok) {
+    std::cerr << "embed: couldn't write " << argv[1] << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,198 @@
+// generates big .obj files to benchmark the parser with. same arguments -> same file, byte for byte.
+//
+//   gen_obj sphere|terrain <megabytes> <output.obj>
+//
+// every vertex has v, vt and vn and the faces go through all the syntaxes the parser knows, a
+// different one every row: v, v/vt, v//vn, v/vt/vn, negative indices, triangles and quads.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+  enum class kind {
+    sphere,
+    terrain
+  };
+
+  unsigned int constexpr num_syntaxes{ 5 };
+
+  // integer hash -> [0, 1), the noise has to be the same everywhere, no rand()
+  float hash(unsigned int x, unsigned int y) noexcept
+  {
+    unsigned int h{ x * 374761393u + y * 668265263u };
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return static_cast<float>((h ^ (h >> 16)) & 0xffffff) / 16777216.0f;
+  }
+
+  float value_noise(float const x, float const y) noexcept
+  {
+    unsigned int const ix{ static_cast<unsigned int>(x) };
+    unsigned int const iy{ static_cast<unsigned int>(y) };
+    float const fx{ x - static_cast<float>(ix) };
+    float const fy{ y - static_cast<float>(iy) };
+    float const sx{ fx * fx * (3.0f - 2.0f * fx) };
+    float const sy{ fy * fy * (3.0f - 2.0f * fy) };
+    float const a{ hash(ix, iy) + (hash(ix + 1, iy) - hash(ix, iy)) * sx };
+    float const b{ hash(ix, iy + 1) + (hash(ix + 1, iy + 1) - hash(ix, iy + 1)) * sx };
+    return a + (b - a) * sy;
+  }
+
+  float height(float const x, float const y) noexcept
+  {
+    float h{ 0.0f };
+    float amplitude{ 1.0f };
+    float frequency{ 1.0f / 64.0f };
+    for(int octave{ 0 }; octave < 5; ++octave) {
+      h += value_noise(x * frequency, y * frequency) * amplitude;
+      amplitude *= 0.5f;
+      frequency *= 2.0f;
+    }
+    return h * 16.0f;
+  }
+
+  // avg number of digits of 1 .. n, that's what the indices look like
+  double average_digits(unsigned long long const n) noexcept
+  {
+    double total{ 0.0 };
+    unsigned long long lo{ 1 };
+    for(unsigned int d{ 1 }; lo <= n; ++d, lo *= 10) {
+      unsigned long long const hi{ std::min(n, lo * 10 - 1) };
+      total += static_cast<double>(hi - lo + 1) * d;
+    }
+    return total / static_cast<double>(n);
+  }
+
+  // roughly how big the file is for a side x side grid, to pick the side for a size
+  double estimate_bytes(unsigned long long const side) noexcept
+  {
+    double const points{ static_cast<double>(side * side) };
+    double const d{ average_digits(side * side) };
+    // v + vt + vn lines with %.6f, measured
+    double const per_point{ 83.0 };
+    // avg of all the syntaxes, per cell
+    double const per_cell{ ((2 * (2 + 3 * (d + 1))) + (2 + 4 * (2 * d + 2)) + (2 + 4 * (2 * d + 3)) +
+                            (2 * (2 + 3 * (3 * d + 3))) + (2 + 4 * (3 * d + 6))) / num_syntaxes };
+    return points * per_point + static_cast<double>((side - 1) * (side - 1)) * per_cell;
+  }
+
+  class writer final {
+  public:
+    explicit writer(FILE* file) noexcept
+      : f{ file }
+    {
+    }
+    void vertex(float const x, float const y, float const z) noexcept { std::fprintf(f, "v %.6f %.6f %.6f\n", x, y, z); }
+    void uv(float const u, float const v) noexcept { std::fprintf(f, "vt %.6f %.6f\n", u, v); }
+    void normal(float const x, float const y, float const z) noexcept { std::fprintf(f, "vn %.6f %.6f %.6f\n", x, y, z); }
+    // a b c d are 1-based and go around the cell
+    void cell(unsigned long long const a, unsigned long long const b, unsigned long long const c,
+              unsigned long long const d, unsigned int const syntax, unsigned long long const total) noexcept
+    {
+      switch(syntax) {
+      case 0:
+        std::fprintf(f, "f %llu %llu %llu\nf %llu %llu %llu\n", a, b, c, a, c, d);
+        break;
+      case 1:
+        std::fprintf(f, "f %llu/%llu %llu/%llu %llu/%llu %llu/%llu\n", a, a, b, b, c, c, d, d);
+        break;
+      case 2:
+        std::fprintf(f, "f %llu//%llu %llu//%llu %llu//%llu %llu//%llu\n", a, a, b, b, c, c, d, d);
+        break;
+      case 3:
+        std::fprintf(f, "f %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\nf %llu/%llu/%llu %llu/%llu/%llu %llu/%llu/%llu\n",
+                     a, a, a, b, b, b, c, c, c, a, a, a, c, c, c, d, d, d);
+        break;
+      default: {
+        // relative to the end, all the v/vt/vn are written before the faces
+        long long const ra{ static_cast<long long>(a) - static_cast<long long>(total) - 1 };
+        long long const rb{ static_cast<long long>(b) - static_cast<long long>(total) - 1 };
+        long long const rc{ static_cast<long long>(c) - static_cast<long long>(total) - 1 };
+        long long const rd{ static_cast<long long>(d) - static_cast<long long>(total) - 1 };
+        std::fprintf(f, "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n",
+                     ra, ra, ra, rb, rb, rb, rc, rc, rc, rd, rd, rd);
+        break;
+      }
+      }
+    }
+  private:
+    FILE* f;
+  };
+
+  bool generate(kind const k, unsigned long long const bytes, char const* path) noexcept
+  {
+    unsigned long long side{ 8 };
+    while(estimate_bytes(side) < static_cast<double>(bytes)) {
+      side += side / 64 + 1;
+    }
+    FILE* f{ std::fopen(path, "w") };
+    if(!f) {
+      std::cerr << "gen_obj: couldn't open " << path << '\n';
+      return false;
+    }
+    static char buffer[1 << 20];
+    std::setvbuf(f, buffer, _IOFBF, sizeof(buffer));
+    writer w(f);
+    std::fprintf(f, "# lvar gen_obj %s %llux%llu\n", k == kind::sphere ? "sphere" : "terrain", side, side);
+    float const pi{ 3.14159265358979f };
+    float const inv{ 1.0f / static_cast<float>(side - 1) };
+    for(unsigned long long j{ 0 }; j < side; ++j) {
+      for(unsigned long long i{ 0 }; i < side; ++i) {
+        float const u{ static_cast<float>(i) * inv };
+        float const v{ static_cast<float>(j) * inv };
+        if(k == kind::sphere) {
+          float const theta{ v * pi };
+          float const phi{ u * 2.0f * pi };
+          float const x{ std::sin(theta) * std::cos(phi) };
+          float const y{ std::cos(theta) };
+          float const z{ std::sin(theta) * std::sin(phi) };
+          w.vertex(x, y, z);
+          w.uv(u, v);
+          w.normal(x, y, z);
+        } else {
+          float const x{ static_cast<float>(i) };
+          float const z{ static_cast<float>(j) };
+          float const dx{ height(x + 1.0f, z) - height(x > 0.0f ? x - 1.0f : x, z) };
+          float const dz{ height(x, z + 1.0f) - height(x, z > 0.0f ? z - 1.0f : z) };
+          float const len{ std::sqrt(dx * dx + 4.0f + dz * dz) };
+          w.vertex(x, height(x, z), z);
+          w.uv(u, v);
+          w.normal(-dx / len, 2.0f / len, -dz / len);
+        }
+      }
+    }
+    unsigned long long const total{ side * side };
+    for(unsigned long long j{ 0 }; j + 1 < side; ++j) {
+      for(unsigned long long i{ 0 }; i + 1 < side; ++i) {
+        unsigned long long const a{ j * side + i + 1 };
+        w.cell(a, a + side, a + side + 1, a + 1, static_cast<unsigned int>(j % num_syntaxes), total);
+      }
+    }
+    bool const ok{ std::ferror(f) == 0 };
+    std::fclose(f);
+    if(!ok) {
+      std::cerr << "gen_obj: couldn't write " << path << '\n';
+    }
+    return ok;
+  }
+
+};
+
+int main(int argc, char** argv)
+{
+  if(argc != 4 || (std::strcmp(argv[1], "sphere") != 0 && std::strcmp(argv[1], "terrain") != 0)) {
+    std::cerr << "usage: " << argv[0] << " sphere|terrain <megabytes> <output.obj>\n";
+    return EXIT_FAILURE;
+  }
+  unsigned long long const mb{ std::strtoull(argv[2], nullptr, 10) };
+  if(mb == 0) {
+    std::cerr << "gen_obj: the size is in megabytes and it can't be 0\n";
+    return EXIT_FAILURE;
+  }
+  kind const k{ std::strcmp(argv[1], "sphere") == 0 ? kind::sphere : kind::terrain };
+  return generate(k, mb * 1024 * 1024, argv[3]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
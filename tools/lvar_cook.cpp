@@ -0,0 +1,625 @@
+// converts what's in res/ into what the game loads, so the runtime never parses an .obj or decodes a jpg
+//
+//   lvar_cook [-f] <input dir> <output dir>
+//
+//   .obj              -> .lvm, normals generated if it has none, optimised and with its lods (depends on its
+//                        .mtl files). the maps of its materials are the cooked .lvt
+//   .png .jpg .tga .. -> .lvt, decoded, flipped for opengl and with all its mips (tex::mip_settings_for)
+//   .vert .frag ..    -> same file, after checking it has a #version and the brackets match
+//   .mtl              -> nothing, they're baked into the .lvm of the meshes that use them
+//   anything else     -> copied
+//
+// the output keeps the paths of the input (./res/x.obj -> <output dir>/res/x.lvm). <output dir>/manifest.txt
+// has the content hash of every input and of the files it depends on: only what changed (or depends on
+// something that changed) is cooked again, and a file is only hashed if its size or mtime changed, so an
+// unchanged tree is a stat per file. -f cooks everything. everything is cooked on all the cores.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "lvar_obj.h"
+#include "lvar_mesh_opt.h"
+#include "lvar_normals.h"
+#include "lvar_simplify.h"
+#include "lvar_texture.h"
+#include "lvar_jobs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>             // opendir
+#include <strings.h>            // strcasecmp
+#include <fcntl.h>              // open
+#include <sys/mman.h>           // mmap
+#include <sys/stat.h>           // stat, mkdir
+#include <unistd.h>             // close, unlink
+
+using namespace lvar;
+
+namespace {
+
+  // bump it when a conversion changes, everything is cooked again
+  unsigned int constexpr cook_version{ 5 };
+
+  enum class kind {
+    mesh,
+    texture,
+    shader,
+    dependency,
+    copy
+  };
+
+  // what was cooked last time, one line of the manifest
+  class record final {
+  public:
+    std::string output;
+    unsigned long long size;
+    long long mtime;
+    unsigned long long hash;
+    std::vector<std::pair<std::string, unsigned long long>> deps;
+  };
+
+  class input final {
+  public:
+    std::string path;
+    kind k;
+    unsigned long long size;
+    long long mtime;
+    unsigned long long hash;
+    bool exists;
+    bool dirty;
+    bool ok;
+    std::vector<std::string> deps; // what the cook found out it depends on
+  };
+
+  bool ends_with(std::string const& s, char const* suffix) noexcept
+  {
+    std::size_t const n{ std::strlen(suffix) };
+    return s.size() >= n && strcasecmp(s.c_str() + s.size() - n, suffix) == 0;
+  }
+
+  kind kind_of(std::string const& path) noexcept
+  {
+    if(ends_with(path, ".obj")) {
+      return kind::mesh;
+    }
+    for(char const* ext : { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".gif", ".hdr" }) {
+      if(ends_with(path, ext)) {
+        return kind::texture;
+      }
+    }
+    for(char const* ext : { ".vert", ".frag", ".geom", ".comp", ".glsl" }) {
+      if(ends_with(path, ext)) {
+        return kind::shader;
+      }
+    }
+    return ends_with(path, ".mtl") ? kind::dependency : kind::copy;
+  }
+
+  std::string output_path(std::string const& out_dir, std::string const& path, kind const k)
+  {
+    if(k == kind::dependency) {
+      return {};
+    }
+    std::string rel{ path.compare(0, 2, "./") == 0 ? path.substr(2) : path };
+    if(k == kind::mesh || k == kind::texture) {
+      std::size_t const dot{ rel.rfind('.') };
+      rel = rel.substr(0, dot) + (k == kind::mesh ? ".lvm" : ".lvt");
+    }
+    return out_dir + '/' + rel;
+  }
+
+  // the whole file, mapped. empty is fine
+  class mapped_file final {
+  public:
+    explicit mapped_file(char const* path) noexcept
+      : data{ nullptr },
+        size{ 0 },
+        err{ true }
+    {
+      int const fd{ open(path, O_RDONLY) };
+      struct stat sb;
+      if(fd == -1) {
+        return;
+      }
+      if(fstat(fd, &sb) == 0) {
+        size = static_cast<std::size_t>(sb.st_size);
+        void* const p{ size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr };
+        if(p != MAP_FAILED) {
+          data = static_cast<unsigned char const*>(p);
+          err = false;
+        }
+      }
+      close(fd);
+    }
+    ~mapped_file()
+    {
+      if(data) {
+        munmap(const_cast<unsigned char*>(data), size);
+      }
+    }
+    mapped_file(mapped_file const&) = delete;
+    mapped_file& operator=(mapped_file const&) = delete;
+  public:
+    unsigned char const* data;
+    std::size_t size;
+    bool err;
+  };
+
+  // 8 bytes at a time, it only has to notice that a file changed. 0 is "it isn't there"
+  unsigned long long content_hash(char const* path) noexcept
+  {
+    mapped_file f(path);
+    if(f.err) {
+      return 0;
+    }
+    unsigned long long constexpr prime{ 0x100000001b3ull };
+    unsigned long long h{ 0xcbf29ce484222325ull ^ f.size };
+    std::size_t i{ 0 };
+    for(; i + 8 <= f.size; i += 8) {
+      unsigned long long w;
+      std::memcpy(&w, f.data + i, sizeof(w));
+      h = (h ^ w) * prime;
+      h ^= h >> 29;
+    }
+    for(; i < f.size; ++i) {
+      h = (h ^ f.data[i]) * prime;
+    }
+    return h ? h : 1;
+  }
+
+  bool make_parent_dirs(std::string const& path) noexcept
+  {
+    for(std::size_t slash{ path.find('/', 1) }; slash != std::string::npos; slash = path.find('/', slash + 1)) {
+      std::string const dir{ path.substr(0, slash) };
+      if(mkdir(dir.c_str(), 0755) == -1 && errno != EEXIST) {
+        std::cerr << "lvar_cook: couldn't create " << dir << ": " << std::strerror(errno) << '\n';
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool write_file(std::string const& path, void const* data, std::size_t const size) noexcept
+  {
+    FILE* const f{ std::fopen(path.c_str(), "wb") };
+    if(!f) {
+      std::cerr << "lvar_cook: couldn't open " << path << '\n';
+      return false;
+    }
+    bool const ok{ std::fwrite(data, 1, size, f) == size };
+    return std::fclose(f) == 0 && ok;
+  }
+
+  void walk(std::string const& dir, std::string const& skip, std::vector<std::string>& o)
+  {
+    DIR* const d{ opendir(dir.c_str()) };
+    if(!d) {
+      return;
+    }
+    while(dirent const* e{ readdir(d) }) {
+      if(e->d_name[0] == '.') {
+        continue;
+      }
+      std::string const path{ dir + '/' + e->d_name };
+      struct stat sb;
+      if(stat(path.c_str(), &sb) == -1 || path == skip) {
+        continue;
+      }
+      if(S_ISDIR(sb.st_mode)) {
+        walk(path, skip, o);
+      } else if(S_ISREG(sb.st_mode)) {
+        o.push_back(path);
+      }
+    }
+    closedir(d);
+  }
+
+  // ----------------------------------------------------------------------------------------------------
+  // cooks
+  // ----------------------------------------------------------------------------------------------------
+
+  // the mtllib lines, the materials end up in the .lvm so it has to be cooked again if one changes
+  void mtllib_deps(std::string const& obj_path, mapped_file const& f, std::vector<std::string>& o)
+  {
+    std::size_t const slash{ obj_path.rfind('/') };
+    std::string const dir{ slash == std::string::npos ? std::string{} : obj_path.substr(0, slash + 1) };
+    char const* p{ reinterpret_cast<char const*>(f.data) };
+    char const* const end{ p + f.size };
+    while(p < end) {
+      char const* le{ static_cast<char const*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p))) };
+      le = le ? le : end;
+      if(le - p > 7 && std::memcmp(p, "mtllib", 6) == 0 && (p[6] == ' ' || p[6] == '\t')) {
+        for(char const* q{ p + 6 }; q < le;) {
+          while(q < le && (*q == ' ' || *q == '\t' || *q == '\r')) {
+            ++q;
+          }
+          char const* e{ q };
+          while(e < le && *e != ' ' && *e != '\t' && *e != '\r') {
+            ++e;
+          }
+          if(e > q) {
+            o.push_back(*q == '/' ? std::string(q, e) : dir + std::string(q, e));
+          }
+          q = e;
+        }
+      }
+      p = le + 1;
+    }
+  }
+
+  // the .lvm is what the game loads, so its maps have to be what the game loads too: ./res/a.png ->
+  // <output dir>/res/a.lvt. a map that isn't in the input dir isn't cooked and stays as it is
+  bool cooked_map(char (&map)[256], std::string const& in_dir, std::string const& out_dir) noexcept
+  {
+    std::string const path{ map };
+    if(path.compare(0, in_dir.size() + 1, in_dir + '/') != 0 || kind_of(path) != kind::texture) {
+      return true;
+    }
+    std::string const out{ output_path(out_dir, path, kind::texture) };
+    if(out.size() >= sizeof(map)) {
+      std::cerr << "lvar_cook: " << out << " is too long for a material\n";
+      return false;
+    }
+    std::memcpy(map, out.c_str(), out.size() + 1);
+    return true;
+  }
+
+  bool cook_mesh(input& in, std::string const& in_dir, std::string const& out_dir, std::string const& out)
+  {
+    {
+      mapped_file f(in.path.c_str());
+      if(f.err) {
+        return false;
+      }
+      mtllib_deps(in.path, f, in.deps);
+    }
+    // the same sizes bench_obj parses with
+    arena mem(static_cast<std::size_t>(in.size) * 4 + 64 * 1024 * 1024);
+    arena scratch(static_cast<std::size_t>(in.size) * 4 + 64 * 1024 * 1024);
+    obj::mesh m;
+    if(!obj::parse_file(in.path.c_str(), m, mem)) {
+      return false;
+    }
+    for(obj::material& mat : m.materials) {
+      if(!cooked_map(mat.diffuse_map, in_dir, out_dir) || !cooked_map(mat.specular_map, in_dir, out_dir) ||
+         !cooked_map(mat.normal_map, in_dir, out_dir)) {
+        return false;
+      }
+    }
+    if(m.normals.empty() && !obj::generate_normals(m, mem, scratch)) {
+      std::cerr << "lvar_cook: couldn't generate normals for " << in.path << '\n';
+      return false;
+    }
+    if(!obj::optimise(m, scratch)) {
+      std::cerr << "lvar_cook: couldn't optimise " << in.path << '\n';
+      return false;
+    }
+    // after optimise, it reorders the vertices the lods use
+    if(!obj::build_lods(m, m.lods, mem, scratch)) {
+      std::cerr << "lvar_cook: couldn't build the lods of " << in.path << '\n';
+      return false;
+    }
+    return obj::save_mesh(out.c_str(), m);
+  }
+
+  bool cook_texture(input const& in, std::string const& out)
+  {
+    int width, height, channels;
+    unsigned char* const data{ stbi_load(in.path.c_str(), &width, &height, &channels, 0) };
+    if(!data) {
+      std::cerr << "lvar_cook: couldn't decode " << in.path << ": " << stbi_failure_reason() << '\n';
+      return false;
+    }
+    tex::image const img{ static_cast<unsigned int>(width), static_cast<unsigned int>(height), static_cast<unsigned int>(channels),
+                          { data, static_cast<std::size_t>(width) * height * channels } };
+    arena mem(tex::mip_chain_bytes(img));
+    tex::mip_chain mips;
+    bool const ok{ tex::generate_mips(img, tex::mip_settings_for(in.path.c_str(), img.channels), mips, mem) &&
+                   tex::save_texture(out.c_str(), mips) };
+    stbi_image_free(data);
+    return ok;
+  }
+
+  // no gl here, so no real compile: the mistakes that would only show up when the game starts and that
+  // don't need a compiler to see. the driver still has the last word
+  bool check_shader(std::string const& path, char const* p, char const* const end)
+  {
+    unsigned int line{ 1 };
+    bool version{ false };
+    bool code{ false }; // anything that isn't a comment seen yet
+    int depth[2]{ 0, 0 }; // {} and ()
+    while(p < end) {
+      if(p + 1 < end && p[0] == '/' && p[1] == '/') {
+        while(p < end && *p != '\n') {
+          ++p;
+        }
+        continue;
+      }
+      if(p + 1 < end && p[0] == '/' && p[1] == '*') {
+        for(p += 2; p + 1 < end && !(p[0] == '*' && p[1] == '/'); ++p) {
+          line += *p == '\n';
+        }
+        p += 2;
+        continue;
+      }
+      char const c{ *p };
+      if(c == '#' && !code && end - p >= 8 && std::memcmp(p, "#version", 8) == 0) {
+        version = true;
+      }
+      if(c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        code = true;
+      }
+      line += c == '\n';
+      depth[0] += c == '{' ? 1 : c == '}' ? -1 : 0;
+      depth[1] += c == '(' ? 1 : c == ')' ? -1 : 0;
+      if(depth[0] < 0 || depth[1] < 0) {
+        std::cerr << path << ':' << line << ": unmatched " << c << '\n';
+        return false;
+      }
+      ++p;
+    }
+    if(!version) {
+      std::cerr << path << ": the first thing has to be #version\n";
+      return false;
+    }
+    if(depth[0] != 0 || depth[1] != 0) {
+      std::cerr << path << ": unclosed " << (depth[0] != 0 ? '{' : '(') << '\n';
+      return false;
+    }
+    return true;
+  }
+
+  bool cook_copy(input const& in, std::string const& out)
+  {
+    mapped_file f(in.path.c_str());
+    if(f.err) {
+      return false;
+    }
+    char const* const p{ reinterpret_cast<char const*>(f.data) };
+    if(in.k == kind::shader && !check_shader(in.path, p, p + f.size)) {
+      return false;
+    }
+    return write_file(out, f.data, f.size);
+  }
+
+  bool cook(input& in, std::string const& in_dir, std::string const& out_dir)
+  {
+    std::string const out{ output_path(out_dir, in.path, in.k) };
+    if(in.k == kind::dependency) {
+      return true;
+    }
+    if(!make_parent_dirs(out)) {
+      return false;
+    }
+    switch(in.k) {
+    case kind::mesh:
+      return cook_mesh(in, in_dir, out_dir, out);
+    case kind::texture:
+      return cook_texture(in, out);
+    default:
+      return cook_copy(in, out);
+    }
+  }
+
+  // ----------------------------------------------------------------------------------------------------
+  // manifest
+  // ----------------------------------------------------------------------------------------------------
+
+  // "lvar-cook <version>" and then a line per input: path, output, size, mtime, hash and a path and a hash
+  // per dependency, separated by tabs. a different version is an empty manifest
+  void load_manifest(std::string const& path, std::unordered_map<std::string, record>& o)
+  {
+    FILE* const f{ std::fopen(path.c_str(), "r") };
+    if(!f) {
+      return;
+    }
+    char* line{ nullptr };
+    std::size_t cap{ 0 };
+    unsigned int version{ 0 };
+    if(getline(&line, &cap, f) > 0 && std::sscanf(line, "lvar-cook %u", &version) == 1 && version == cook_version) {
+      ssize_t n;
+      while((n = getline(&line, &cap, f)) > 0) {
+        line[n - 1] = line[n - 1] == '\n' ? '\0' : line[n - 1];
+        std::vector<char const*> fields;
+        for(char* p{ line }; p; ) {
+          fields.push_back(p);
+          p = std::strchr(p, '\t');
+          if(p) {
+            *p++ = '\0';
+          }
+        }
+        if(fields.size() < 5 || fields.size() % 2 == 0) {
+          continue;
+        }
+        record r{ fields[1], std::strtoull(fields[2], nullptr, 10), std::strtoll(fields[3], nullptr, 10),
+                  std::strtoull(fields[4], nullptr, 16), {} };
+        for(std::size_t i{ 5 }; i < fields.size(); i += 2) {
+          r.deps.emplace_back(fields[i], std::strtoull(fields[i + 1], nullptr, 16));
+        }
+        o[fields[0]] = std::move(r);
+      }
+    }
+    std::free(line);
+    std::fclose(f);
+  }
+
+  bool save_manifest(std::string const& path, std::unordered_map<std::string, record> const& records)
+  {
+    // written next to it and renamed, a cook that dies halfway leaves the old one
+    std::string const tmp{ path + ".tmp" };
+    FILE* const f{ std::fopen(tmp.c_str(), "w") };
+    if(!f) {
+      std::cerr << "lvar_cook: couldn't write " << tmp << '\n';
+      return false;
+    }
+    // sorted by path, the same records -> the same file
+    std::vector<std::pair<std::string const, record> const*> entries;
+    for(auto const& e : records) {
+      entries.push_back(&e);
+    }
+    std::sort(entries.begin(), entries.end(), [](auto const* a, auto const* b) { return a->first < b->first; });
+    std::fprintf(f, "lvar-cook %u\n", cook_version);
+    for(auto const* const e : entries) {
+      auto const& [p, r] = *e;
+      std::fprintf(f, "%s\t%s\t%llu\t%lld\t%016llx", p.c_str(), r.output.c_str(), r.size, r.mtime, r.hash);
+      for(auto const& [dep, hash] : r.deps) {
+        std::fprintf(f, "\t%s\t%016llx", dep.c_str(), hash);
+      }
+      std::fputc('\n', f);
+    }
+    bool const ok{ std::ferror(f) == 0 };
+    std::fclose(f);
+    return ok && std::rename(tmp.c_str(), path.c_str()) == 0;
+  }
+
+  // fx(i) for every i in [0, count) on all the cores, the next i goes to whoever is free: a big mesh and a
+  // lot of small textures take as long as the big mesh
+  template<typename F>
+  void for_each_parallel(std::size_t const count, F const& fx)
+  {
+    std::atomic<std::size_t> next{ 0 };
+    std::size_t const threads{ std::min<std::size_t>(count, jobs::num_workers()) };
+    jobs::parallel_for(threads, 1, [&next, count, &fx](std::size_t, std::size_t) {
+      for(std::size_t i{ next++ }; i < count; i = next++) {
+        fx(i);
+      }
+    });
+  }
+
+};
+
+int main(int argc, char** argv)
+{
+  bool const force{ argc > 1 && std::strcmp(argv[1], "-f") == 0 };
+  int const first{ force ? 2 : 1 };
+  if(argc - first != 2) {
+    std::cerr << "usage: " << argv[0] << " [-f] <input dir> <output dir>\n";
+    return EXIT_FAILURE;
+  }
+  auto const start = std::chrono::steady_clock::now();
+  std::string in_dir{ argv[first] };
+  std::string out_dir{ argv[first + 1] };
+  while(in_dir.size() > 1 && in_dir.back() == '/') {
+    in_dir.pop_back();
+  }
+  while(out_dir.size() > 1 && out_dir.back() == '/') {
+    out_dir.pop_back();
+  }
+  std::string const manifest_path{ out_dir + "/manifest.txt" };
+  std::unordered_map<std::string, record> records;
+  if(!force) {
+    load_manifest(manifest_path, records);
+  }
+  std::vector<std::string> paths;
+  walk(in_dir, out_dir, paths);
+  std::sort(paths.begin(), paths.end());
+  std::vector<input> inputs(paths.size());
+  for(std::size_t i{ 0 }; i < paths.size(); ++i) {
+    inputs[i].path = paths[i];
+    inputs[i].k = kind_of(paths[i]);
+  }
+
+  // same size and mtime as last time is the same contents, the rest are hashed
+  std::atomic<unsigned int> num_hashed{ 0 };
+  for_each_parallel(inputs.size(), [&inputs, &records, &num_hashed](std::size_t const i) {
+    input& in{ inputs[i] };
+    struct stat sb;
+    in.exists = stat(in.path.c_str(), &sb) == 0;
+    in.size = in.exists ? static_cast<unsigned long long>(sb.st_size) : 0;
+    in.mtime = in.exists ? static_cast<long long>(sb.st_mtim.tv_sec) * 1000000000 + sb.st_mtim.tv_nsec : 0;
+    auto const it = records.find(in.path);
+    if(it != records.end() && it->second.size == in.size && it->second.mtime == in.mtime) {
+      in.hash = it->second.hash;
+    } else {
+      in.hash = content_hash(in.path.c_str());
+      ++num_hashed;
+    }
+  });
+  std::unordered_map<std::string, unsigned long long> hashes;
+  for(input const& in : inputs) {
+    hashes[in.path] = in.hash;
+  }
+  // dependencies outside of the input dir are hashed every time, there shouldn't be many
+  auto const hash_of = [&hashes](std::string const& path) {
+    auto const it = hashes.find(path);
+    return it != hashes.end() ? it->second : content_hash(path.c_str());
+  };
+
+  // dirty: new, changed, its output is gone or something it depends on changed
+  std::vector<std::size_t> dirty;
+  for(std::size_t i{ 0 }; i < inputs.size(); ++i) {
+    input& in{ inputs[i] };
+    auto const it = records.find(in.path);
+    std::string const out{ output_path(out_dir, in.path, in.k) };
+    struct stat sb;
+    in.dirty = it == records.end() || it->second.hash != in.hash || it->second.output != out ||
+               (!out.empty() && stat(out.c_str(), &sb) == -1);
+    for(std::size_t d{ 0 }; !in.dirty && d < it->second.deps.size(); ++d) {
+      in.dirty = hash_of(it->second.deps[d].first) != it->second.deps[d].second;
+    }
+    if(in.dirty) {
+      dirty.push_back(i);
+    }
+  }
+  stbi_set_flip_vertically_on_load(true); // once, it's a global
+  for_each_parallel(dirty.size(), [&inputs, &dirty, &in_dir, &out_dir](std::size_t const i) {
+    input& in{ inputs[dirty[i]] };
+    in.ok = cook(in, in_dir, out_dir);
+    if(!in.ok) {
+      std::cerr << "lvar_cook: couldn't cook " << in.path << '\n';
+    }
+  });
+
+  // the manifest is only written if something changed, a no-op doesn't write anything
+  bool changed{ num_hashed > 0 };
+  unsigned int num_failed{ 0 };
+  std::unordered_map<std::string, record> next;
+  for(input const& in : inputs) {
+    if(in.dirty && !in.ok) {
+      // not in the manifest, tried again next time
+      ++num_failed;
+      changed = true;
+      continue;
+    }
+    record r{ in.dirty ? record{} : records[in.path] };
+    r.output = output_path(out_dir, in.path, in.k);
+    r.size = in.size;
+    r.mtime = in.mtime;
+    r.hash = in.hash;
+    if(in.dirty) {
+      for(std::string const& dep : in.deps) {
+        r.deps.emplace_back(dep, hash_of(dep));
+      }
+      changed = true;
+    }
+    next[in.path] = std::move(r);
+  }
+  // inputs that are gone take their outputs with them
+  unsigned int num_removed{ 0 };
+  for(auto const& [path, r] : records) {
+    if(next.find(path) == next.end() && hashes.find(path) == hashes.end()) {
+      if(!r.output.empty()) {
+        unlink(r.output.c_str());
+      }
+      ++num_removed;
+      changed = true;
+    }
+  }
+  if(changed && (!make_parent_dirs(manifest_path) || !save_manifest(manifest_path, next))) {
+    std::cerr << "lvar_cook: couldn't write " << manifest_path << '\n';
+    return EXIT_FAILURE;
+  }
+  double const ms{ std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() };
+  std::cout << "lvar_cook: " << inputs.size() << " inputs, " << dirty.size() - num_failed << " cooked, " << num_failed
+            << " failed, " << num_removed << " removed in " << ms << " ms on " << jobs::num_workers() << " threads\n";
+  return num_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,41 @@
+// packs files into one .lvp that the resource manager reads instead of the loose files
+//
+//   make_pack [-c] <output.lvp> <files...>
+//
+// -c compresses the blobs that get at least 1/8 smaller. the ids are the paths as they're given
+// (without the "./"), so run it from where the program runs, with the paths the program uses.
+
+#include "lvar_pack.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace lvar;
+
+int main(int argc, char** argv)
+{
+  bool const compress{ argc > 1 && std::strcmp(argv[1], "-c") == 0 };
+  int const first{ compress ? 2 : 1 };
+  if(argc - first < 2) {
+    std::cerr << "usage: " << argv[0] << " [-c] <output.lvp> <files...>\n";
+    return EXIT_FAILURE;
+  }
+  unsigned int const count{ static_cast<unsigned int>(argc - first - 1) };
+  if(!pack::write_pack(argv[first], argv + first + 1, count, compress)) {
+    return EXIT_FAILURE;
+  }
+  pack::reader r;
+  if(!r.open(argv[first])) {
+    return EXIT_FAILURE;
+  }
+  unsigned long long stored{ 0 };
+  unsigned long long raw{ 0 };
+  for(unsigned int i{ 0 }; i < count; ++i) {
+    pack::entry const* const e{ r.find(argv[first + 1 + i]) };
+    stored += e->size;
+    raw += e->raw_size;
+  }
+  std::cout << argv[first] << ": " << count << " files, " << raw << " bytes -> " << stored << " bytes\n";
+  return EXIT_SUCCESS;
+}